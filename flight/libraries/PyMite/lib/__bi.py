@@ -70,9 +70,9 @@ def dir(o):
     PmReturn_t retval = PM_RET_OK;
     pPmObj_t po;
     pPmObj_t pk;
+    pPmObj_t pv;
     pPmObj_t pl;
-    pSeglist_t psl;
-    int16_t i;
+    int16_t i = 0;
     uint8_t objid;
 
     /* Use globals if no arg given */
@@ -133,11 +133,8 @@ def dir(o):
         PM_RETURN_IF_ERROR(retval);
 
         /* Copy dict's keys to the list */
-        psl = ((pPmDict_t)po)->d_keys;
-        for (i = 0; i < ((pPmDict_t)po)->length; i++)
+        while (dict_getNext(po, &i, &pk, &pv) == PM_RET_OK)
         {
-            retval = seglist_getItem(psl, i, &pk);
-            PM_RETURN_IF_ERROR(retval);
             heap_gcPushTempRoot(pl, &objid);
             retval = list_append(pl, pk);
             heap_gcPopTempRoot(objid);
@@ -45,8 +45,8 @@ def keys(d):
     pPmObj_t pd;
     pPmObj_t pl;
     pPmObj_t pk;
-    pSeglist_t psl;
-    uint16_t i;
+    pPmObj_t pv;
+    int16_t i = 0;
     PmReturn_t retval = PM_RET_OK;
     uint8_t objid;
 
@@ -62,13 +62,10 @@ def keys(d):
     retval = list_new(&pl);
     PM_RETURN_IF_ERROR(retval);
 
-    /* Iterate through the keys seglist */
-    psl = ((pPmDict_t)pd)->d_keys;
-    for (i = 0; i < ((pPmDict_t)pd)->length; i++)
+    /* Iterate through the key,value pairs */
+    while (dict_getNext(pd, &i, &pk, &pv) == PM_RET_OK)
     {
-        /* Get the key and append it to the list */
-        retval = seglist_getItem(psl, i, &pk);
-        PM_RETURN_IF_ERROR(retval);
+        /* Append the key to the list */
         heap_gcPushTempRoot(pl, &objid);
         retval = list_append(pl, pk);
         heap_gcPopTempRoot(objid);
@@ -94,9 +91,9 @@ def values(d):
     """__NATIVE__
     pPmObj_t pd;
     pPmObj_t pl;
+    pPmObj_t pk;
     pPmObj_t pv;
-    pSeglist_t psl;
-    uint16_t i;
+    int16_t i = 0;
     PmReturn_t retval = PM_RET_OK;
     uint8_t objid;
 
@@ -112,13 +109,10 @@ def values(d):
     retval = list_new(&pl);
     PM_RETURN_IF_ERROR(retval);
 
-    /* Iterate through the values seglist */
-    psl = ((pPmDict_t)pd)->d_vals;
-    for (i = 0; i < ((pPmDict_t)pd)->length; i++)
+    /* Iterate through the key,value pairs */
+    while (dict_getNext(pd, &i, &pk, &pv) == PM_RET_OK)
     {
-        /* Get the value and append it to the list */
-        retval = seglist_getItem(psl, i, &pv);
-        PM_RETURN_IF_ERROR(retval);
+        /* Append the value to the list */
         heap_gcPushTempRoot(pl, &objid);
         retval = list_append(pl, pv);
         heap_gcPopTempRoot(objid);
@@ -66,6 +66,11 @@ def sizeof(obj):
         sizeof(Seglist_t),
         sizeof(PmSeqIter_t),
         sizeof(PmNativeFrame_t),
+#if USE_NAME_CACHE
+        sizeof(PmNameCache_t),
+#else
+        0,
+#endif
     };
 
     /* If wrong number of args, raise TypeError */
@@ -130,7 +135,7 @@ def print_sizes():
         'SGL',
         'SQI',
         'NFM',
-        0,
+        'NCA',
     )
     for i in range(32):
         if types[i] != 0:
@@ -228,7 +228,9 @@ def PmObjectClass(dumpversion, features):
                        (features.USE_STRING_CACHE and "cache_next:P," or "") +
                        "val:B:len"),
             PmTypeInfo("TUP", "len:H,items:P:len"),
-            PmTypeInfo("COB", "codeimg:P,names:P,consts:P,code:P"),
+            PmTypeInfo("COB", "codeimg:P,names:P,consts:P," +
+                       (features.USE_NAME_CACHE and "cache:P," or "") +
+                       "code:P"),
             PmTypeInfo("MOD", "co:P,attrs:P,globals:P," +
                        (features.HAVE_DEFAULTARGS and "defaultargs:P," or "") +
                        (features.HAVE_CLOSURES and "closure:P," or "")),
@@ -262,6 +264,7 @@ def PmObjectClass(dumpversion, features):
             PmTypeInfo("SQI", "sequence:P,index:H"),
             PmTypeInfo("NFM", "back:P,func:P,stack:P,active:B,numlocals:B,"
                               "locals:P:8"),
+            PmTypeInfo("NCA", "len:H,entries:B:*"),
             )
 
         FREE_TYPE = PmTypeInfo("FRE", "prev:P,next:P")
@@ -543,7 +546,7 @@ class PmHeap(UserDict.UserDict):
     """
 
     FEATURES = ['USE_STRING_CACHE', 'HAVE_DEFAULTARGS', 'HAVE_CLOSURES',
-                'HAVE_CLASSES']
+                'HAVE_CLASSES', 'USE_NAME_CACHE']
 
 
     def __init__(self, fp):
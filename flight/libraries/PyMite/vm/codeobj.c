@@ -68,6 +68,9 @@ co_loadFromImg(PmMemSpace_t memspace, uint8_t const **paddr, pPmObj_t *r_pco)
     /* Set these to null in case a GC occurs before their objects are alloc'd */
     pco->co_names = C_NULL;
     pco->co_consts = C_NULL;
+#if USE_NAME_CACHE
+    pco->co_cache = C_NULL;
+#endif /* USE_NAME_CACHE */
 
 #ifdef HAVE_CLOSURES
     pco->co_nfreevars = mem_getByte(memspace, paddr);
@@ -158,6 +161,54 @@ co_rSetCodeImgAddr(pPmCo_t pco, uint8_t const *pimg)
 }
 
 
+#if USE_NAME_CACHE
+PmReturn_t
+co_newNameCache(pPmCo_t pco)
+{
+    PmReturn_t retval = PM_RET_OK;
+    pPmNameCache_t pcache;
+    uint8_t *pchunk;
+    int16_t n = pco->co_names->length;
+    uint16_t size;
+    int16_t i;
+
+    /* Code objs without names need no cache */
+    if (n == 0)
+    {
+        return retval;
+    }
+
+    /*
+     * Raise MemoryError if the entries of the names would not fit a chunk
+     * or the heap has no room to spare (so no GC is run for the cache)
+     */
+    size = sizeof(PmNameCache_t) + (n - 1) * sizeof(PmDictCache_t);
+    if ((size > HEAP_MAX_LIVE_CHUNK_SIZE)
+        || (heap_getAvail() < HEAP_GC_NF_THRESHOLD + size))
+    {
+        PM_RAISE(retval, PM_RET_EX_MEM);
+        return retval;
+    }
+
+    retval = heap_getChunk(size, &pchunk);
+    PM_RETURN_IF_ERROR(retval);
+    pcache = (pPmNameCache_t)pchunk;
+    OBJ_SET_TYPE(pcache, OBJ_TYPE_NCA);
+    pcache->length = n;
+
+    /* No name was found yet */
+    for (i = 0; i < n; i++)
+    {
+        pcache->nc_entries[i].dc_dict = C_NULL;
+        pcache->nc_entries[i].dc_slot = 0;
+    }
+
+    pco->co_cache = pcache;
+    return retval;
+}
+#endif /* USE_NAME_CACHE */
+
+
 PmReturn_t
 no_loadFromImg(PmMemSpace_t memspace, uint8_t const **paddr, pPmObj_t *r_pno)
 {
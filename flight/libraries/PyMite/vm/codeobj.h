@@ -25,6 +25,13 @@
  */
 
 
+/**
+ * Set to nonzero to cache where the names of a code obj were last found.
+ * DO NOT REMOVE THE DEFINITION.
+ */
+#define USE_NAME_CACHE 1
+
+
 /** Code image field offset consts */
 #define CI_TYPE_FIELD       0
 #define CI_SIZE_FIELD       1
@@ -63,6 +70,28 @@
 #define CO_GENERATOR 0x20
 #define CO_NOFREE 0x40
 
+#if USE_NAME_CACHE
+/**
+ * Name Cache
+ *
+ * Holds a dict cache entry for each name of a code obj,
+ * so the bytecodes that load and store names seldom search a dict.
+ */
+typedef struct PmNameCache_s
+{
+    /** Object descriptor */
+    PmObjDesc_t od;
+
+    /** Number of entries, one per name */
+    int16_t length;
+
+    /** Array of entries, in the order of the names tuple */
+    PmDictCache_t nc_entries[1];
+} PmNameCache_t,
+ *pPmNameCache_t;
+#endif /* USE_NAME_CACHE */
+
+
 /**
  * Code Object
  *
@@ -80,6 +109,10 @@ typedef struct PmCo_s
     pPmTuple_t co_names;
     /** Address in RAM of constants tuple */
     pPmTuple_t co_consts;
+#if USE_NAME_CACHE
+    /** Address in RAM of names cache, null until the code obj is run */
+    pPmNameCache_t co_cache;
+#endif /* USE_NAME_CACHE */
     /** Address in memspace of bytecode (or native function) */
     uint8_t const *co_codeaddr;
 
@@ -185,6 +218,19 @@ co_loadFromImg(PmMemSpace_t memspace, uint8_t const **paddr, pPmObj_t *r_pco);
  */
 void co_rSetCodeImgAddr(pPmCo_t pco, uint8_t const *pimg);
 
+#if USE_NAME_CACHE
+/**
+ * Allocates the names cache of the code obj, with empty entries.
+ * Raises MemoryError, rather than run the GC, when the heap is low.
+ * The cache is optional: the caller may ignore a MemoryError
+ * and run the code obj without one.
+ *
+ * @param   pco Pointer to code object that gets the cache
+ * @return  Return status
+ */
+PmReturn_t co_newNameCache(pPmCo_t pco);
+#endif /* USE_NAME_CACHE */
+
 /**
  * Creates a Native code object by loading a native image.
  *
@@ -28,6 +28,280 @@
 #include "pm.h"
 
 
+/* #147: Change boolean keys to integers */
+#define DICT_BOOL_TO_INT(pkey) \
+    do \
+    { \
+        if ((pkey) == PM_TRUE) \
+        { \
+            (pkey) = PM_ONE; \
+        } \
+        else if ((pkey) == PM_FALSE) \
+        { \
+            (pkey) = PM_ZERO; \
+        } \
+    } \
+    while (0)
+
+
+/*
+ * Returns the hash of the key.
+ * Keys that obj_compare() finds the same have the same hash.
+ */
+static uint16_t
+dict_hash(pPmObj_t pkey)
+{
+    uint16_t hash;
+    uint32_t bits;
+    int16_t i;
+
+    switch (OBJ_GET_TYPE(pkey))
+    {
+        case OBJ_TYPE_NON:
+            return 0;
+
+        case OBJ_TYPE_INT:
+            bits = (uint32_t)((pPmInt_t)pkey)->val;
+            return (uint16_t)(bits ^ (bits >> 16));
+
+#ifdef HAVE_FLOAT
+        case OBJ_TYPE_FLT:
+            /* -0.0 is the same as 0.0 */
+            if (((pPmFloat_t)pkey)->val == 0.0)
+            {
+                return 0;
+            }
+            sli_memcpy((unsigned char *)&bits,
+                       (unsigned char *)&((pPmFloat_t)pkey)->val,
+                       sizeof(bits));
+            return (uint16_t)(bits ^ (bits >> 16));
+#endif /* HAVE_FLOAT */
+
+        case OBJ_TYPE_STR:
+            hash = 0;
+            for (i = 0; i < ((pPmString_t)pkey)->length; i++)
+            {
+                hash = hash * 31 + ((pPmString_t)pkey)->val[i];
+            }
+            return hash;
+
+        case OBJ_TYPE_TUP:
+            hash = ((pPmTuple_t)pkey)->length;
+            for (i = 0; i < ((pPmTuple_t)pkey)->length; i++)
+            {
+                hash = hash * 31 + dict_hash(((pPmTuple_t)pkey)->val[i]);
+            }
+            return hash;
+
+            /* Compared by their contents, which may change */
+        case OBJ_TYPE_LST:
+#ifdef HAVE_BYTEARRAY
+        case OBJ_TYPE_CLI:
+        case OBJ_TYPE_BYA:
+#endif /* HAVE_BYTEARRAY */
+            return 1;
+
+            /* All other types are the same only if they are the same object */
+        default:
+            return (uint16_t)((intptr_t)pkey >> 2);
+    }
+}
+
+
+/*
+ * Returns the slot of the key in the dict's tables,
+ * or the empty slot where the key would go.
+ * The tables must have at least one empty slot.
+ */
+static int16_t
+dict_findSlot(pPmDict_t pdict, pPmObj_t pkey)
+{
+    pPmObj_t *pkeys = pdict->d_keys->val;
+    int16_t size = pdict->d_keys->length;
+    int16_t slot = dict_hash(pkey) % size;
+
+    while (pkeys[slot] != C_NULL)
+    {
+        if ((pkeys[slot] == pkey) || (obj_compare(pkeys[slot], pkey) == C_SAME))
+        {
+            break;
+        }
+        if (++slot == size)
+        {
+            slot = 0;
+        }
+    }
+    return slot;
+}
+
+
+/* Allocates a table of empty slots */
+static PmReturn_t
+dict_newTable(int16_t size, pPmTuple_t *r_ptable)
+{
+    PmReturn_t retval;
+    uint8_t *pchunk;
+    int16_t i;
+
+    /* Not through tuple_new(), the largest tables are longer than a tuple */
+    retval = heap_getChunk(sizeof(PmTuple_t) + (size - 1) * sizeof(pPmObj_t),
+                           &pchunk);
+    PM_RETURN_IF_ERROR(retval);
+    OBJ_SET_TYPE(pchunk, OBJ_TYPE_TUP);
+    ((pPmTuple_t)pchunk)->length = size;
+    for (i = 0; i < size; i++)
+    {
+        ((pPmTuple_t)pchunk)->val[i] = C_NULL;
+    }
+
+    *r_ptable = (pPmTuple_t)pchunk;
+    return retval;
+}
+
+
+/* Moves the key,val pairs of the dict to new tables of the given size */
+static PmReturn_t
+dict_resize(pPmDict_t pdict, int16_t size)
+{
+    PmReturn_t retval;
+    pPmTuple_t pkeys;
+    pPmTuple_t pvals;
+    pPmTuple_t poldkeys = pdict->d_keys;
+    pPmTuple_t poldvals = pdict->d_vals;
+    int16_t i;
+    int16_t slot;
+    uint8_t objid;
+
+    retval = dict_newTable(size, &pkeys);
+    PM_RETURN_IF_ERROR(retval);
+    heap_gcPushTempRoot((pPmObj_t)pkeys, &objid);
+    retval = dict_newTable(size, &pvals);
+    heap_gcPopTempRoot(objid);
+    PM_RETURN_IF_ERROR(retval);
+
+    pdict->d_keys = pkeys;
+    pdict->d_vals = pvals;
+    if (poldkeys == C_NULL)
+    {
+        return retval;
+    }
+
+    /* The keys differ from one another, so only empty slots are looked for */
+    for (i = 0; i < poldkeys->length; i++)
+    {
+        if (poldkeys->val[i] == C_NULL)
+        {
+            continue;
+        }
+        slot = dict_hash(poldkeys->val[i]) % size;
+        while (pkeys->val[slot] != C_NULL)
+        {
+            if (++slot == size)
+            {
+                slot = 0;
+            }
+        }
+        pkeys->val[slot] = poldkeys->val[i];
+        pvals->val[slot] = poldvals->val[i];
+    }
+
+    /* Nothing else refers to the old tables */
+    retval = heap_freeChunk((pPmObj_t)poldkeys);
+    PM_RETURN_IF_ERROR(retval);
+    return heap_freeChunk((pPmObj_t)poldvals);
+}
+
+
+/*
+ * Sets a value in the dict using the given key
+ * and returns the slot of the key by reference.
+ *
+ * Searches the dict for the key.  If key val found, replace old
+ * with new val.  If no key found, add key/val pair to dict.
+ * Grows the tables before a key is added to tables that are
+ * three quarters full.
+ */
+static PmReturn_t
+dict_setItemSlot(pPmObj_t pdict, pPmObj_t pkey, pPmObj_t pval,
+                 int16_t *r_slot)
+{
+    PmReturn_t retval = PM_RET_OK;
+    pPmDict_t pd = (pPmDict_t)pdict;
+    int16_t size;
+    int16_t slot;
+
+    C_ASSERT(pdict != C_NULL);
+    C_ASSERT(pkey != C_NULL);
+    C_ASSERT(pval != C_NULL);
+
+    /* If it's not a dict, raise TypeError */
+    if (OBJ_GET_TYPE(pdict) != OBJ_TYPE_DIC)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* #112: Force Dict keys to be of hashable type */
+    /* If key is not hashable, raise TypeError */
+    if (OBJ_GET_TYPE(pkey) > OBJ_TYPE_HASHABLE_MAX)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    DICT_BOOL_TO_INT(pkey);
+
+    /* Replace the val of a key that is in the dict */
+    if (pd->length > 0)
+    {
+        slot = dict_findSlot(pd, pkey);
+        if (pd->d_keys->val[slot] != C_NULL)
+        {
+            pd->d_vals->val[slot] = pval;
+            *r_slot = slot;
+            return retval;
+        }
+    }
+
+    /*
+     * #115: If this is the first key/value pair to be added to the Dict,
+     * allocate the tables that hold those items
+     */
+    size = (pd->d_keys == C_NULL) ? 0 : pd->d_keys->length;
+    if ((pd->length + 1) * 4 > size * 3)
+    {
+        if (size == 0)
+        {
+            retval = dict_resize(pd, DICT_MIN_SIZE);
+        }
+        else if (size < DICT_MAX_SIZE / 2)
+        {
+            retval = dict_resize(pd, size * 2);
+        }
+        else if (size < DICT_MAX_SIZE)
+        {
+            retval = dict_resize(pd, DICT_MAX_SIZE);
+        }
+
+        /* A slot is kept empty so searches end */
+        else if (pd->length + 1 >= size)
+        {
+            PM_RAISE(retval, PM_RET_EX_MEM);
+        }
+        PM_RETURN_IF_ERROR(retval);
+    }
+
+    /* Insert the key,val pair */
+    slot = dict_findSlot(pd, pkey);
+    pd->d_keys->val[slot] = pkey;
+    pd->d_vals->val[slot] = pval;
+    pd->length++;
+
+    *r_slot = slot;
+    return retval;
+}
+
+
 PmReturn_t
 dict_new(pPmObj_t *r_pdict)
 {
@@ -68,17 +342,15 @@ dict_clear(pPmObj_t pdict)
     /* clear length */
     ((pPmDict_t)pdict)->length = 0;
 
-    /* Free the keys and values seglists if needed */
+    /* Free the keys and values tables if needed */
     if (((pPmDict_t)pdict)->d_keys != C_NULL)
     {
-        PM_RETURN_IF_ERROR(seglist_clear(((pPmDict_t)pdict)->d_keys));
         PM_RETURN_IF_ERROR(heap_freeChunk((pPmObj_t)
                                           ((pPmDict_t)pdict)->d_keys));
         ((pPmDict_t)pdict)->d_keys = C_NULL;
     }
     if (((pPmDict_t)pdict)->d_vals != C_NULL)
     {
-        PM_RETURN_IF_ERROR(seglist_clear(((pPmDict_t)pdict)->d_vals));
         retval = heap_freeChunk((pPmObj_t)((pPmDict_t)pdict)->d_vals);
         ((pPmDict_t)pdict)->d_vals = C_NULL;
     }
@@ -86,89 +358,107 @@ dict_clear(pPmObj_t pdict)
 }
 
 
-/*
- * Sets a value in the dict using the given key.
- *
- * Scans dict for the key.  If key val found, replace old
- * with new val.  If no key found, add key/val pair to dict.
- */
 PmReturn_t
 dict_setItem(pPmObj_t pdict, pPmObj_t pkey, pPmObj_t pval)
+{
+    int16_t slot;
+
+    return dict_setItemSlot(pdict, pkey, pval, &slot);
+}
+
+
+PmReturn_t
+dict_setItemCached(pPmObj_t pdict, pPmObj_t pkey, pPmObj_t pval,
+                   pPmDictCache_t pcache)
+{
+    PmReturn_t retval;
+    pPmDict_t pd = (pPmDict_t)pdict;
+    int16_t slot;
+
+    /* Replace the val in the slot where the key was last found */
+    if ((pcache != C_NULL)
+        && (pcache->dc_dict == pd)
+        && (OBJ_GET_TYPE(pdict) == OBJ_TYPE_DIC)
+        && (pd->d_keys != C_NULL)
+        && (pcache->dc_slot < pd->d_keys->length)
+        && (pd->d_keys->val[pcache->dc_slot] == pkey))
+    {
+        pd->d_vals->val[pcache->dc_slot] = pval;
+        return PM_RET_OK;
+    }
+
+    retval = dict_setItemSlot(pdict, pkey, pval, &slot);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Remember the slot of the key if it is the same object */
+    if ((pcache != C_NULL) && (pd->d_keys->val[slot] == pkey))
+    {
+        pcache->dc_dict = pd;
+        pcache->dc_slot = slot;
+    }
+    return retval;
+}
+
+
+PmReturn_t
+dict_getItem(pPmObj_t pdict, pPmObj_t pkey, pPmObj_t *r_pobj)
 {
     PmReturn_t retval = PM_RET_OK;
-    int16_t indx;
+    int16_t slot;
 
-    C_ASSERT(pdict != C_NULL);
-    C_ASSERT(pkey != C_NULL);
-    C_ASSERT(pval != C_NULL);
+/*    C_ASSERT(pdict != C_NULL);*/
 
-    /* If it's not a dict, raise TypeError */
+    /* if it's not a dict, raise TypeError */
     if (OBJ_GET_TYPE(pdict) != OBJ_TYPE_DIC)
     {
         PM_RAISE(retval, PM_RET_EX_TYPE);
         return retval;
     }
 
-    /* #112: Force Dict keys to be of hashable type */
-    /* If key is not hashable, raise TypeError */
-    if (OBJ_GET_TYPE(pkey) > OBJ_TYPE_HASHABLE_MAX)
+    /* if dict is empty, raise KeyError */
+    if (((pPmDict_t)pdict)->length <= 0)
     {
-        PM_RAISE(retval, PM_RET_EX_TYPE);
+        PM_RAISE(retval, PM_RET_EX_KEY);
         return retval;
     }
 
-    /* #147: Change boolean keys to integers */
-    if (pkey == PM_TRUE)
-    {
-        pkey = PM_ONE;
-    }
-    else if (pkey == PM_FALSE)
-    {
-        pkey = PM_ZERO;
-    }
+    DICT_BOOL_TO_INT(pkey);
 
-    /*
-     * #115: If this is the first key/value pair to be added to the Dict,
-     * allocate the key and value seglists that hold those items
-     */
-    if (((pPmDict_t)pdict)->length == 0)
-    {
-        retval = seglist_new(&((pPmDict_t)pdict)->d_keys);
-        PM_RETURN_IF_ERROR(retval);
-        retval = seglist_new(&((pPmDict_t)pdict)->d_vals);
-        PM_RETURN_IF_ERROR(retval);
-    }
-    else
-    {
-        /* Check for matching key */
-        indx = 0;
-        retval = seglist_findEqual(((pPmDict_t)pdict)->d_keys, pkey, &indx);
+    /* check for matching key */
+    slot = dict_findSlot((pPmDict_t)pdict, pkey);
 
-        /* If found a matching key, replace val obj */
-        if (retval == PM_RET_OK)
-        {
-            retval = seglist_setItem(((pPmDict_t)pdict)->d_vals, pval, indx);
-            return retval;
-        }
+    /* if key not found, raise KeyError */
+    if (((pPmDict_t)pdict)->d_keys->val[slot] == C_NULL)
+    {
+        PM_RAISE(retval, PM_RET_EX_KEY);
+        return retval;
     }
 
-    /* Otherwise, insert the key,val pair */
-    retval = seglist_insertItem(((pPmDict_t)pdict)->d_keys, pkey, 0);
-    PM_RETURN_IF_ERROR(retval);
-    retval = seglist_insertItem(((pPmDict_t)pdict)->d_vals, pval, 0);
-    ((pPmDict_t)pdict)->length++;
-
+    /* key was found, get obj from vals */
+    *r_pobj = ((pPmDict_t)pdict)->d_vals->val[slot];
     return retval;
 }
 
 
 PmReturn_t
-dict_getItem(pPmObj_t pdict, pPmObj_t pkey, pPmObj_t *r_pobj)
+dict_getItemCached(pPmObj_t pdict, pPmObj_t pkey, pPmDictCache_t pcache,
+                   pPmObj_t *r_pobj)
 {
     PmReturn_t retval = PM_RET_OK;
-    int16_t indx = 0;
-
-/*    C_ASSERT(pdict != C_NULL);*/
+    pPmDict_t pd = (pPmDict_t)pdict;
+    int16_t slot;
+
+    /* The slot where the key was last found still holds the key */
+    if ((pcache != C_NULL)
+        && (pcache->dc_dict == pd)
+        && (OBJ_GET_TYPE(pdict) == OBJ_TYPE_DIC)
+        && (pd->d_keys != C_NULL)
+        && (pcache->dc_slot < pd->d_keys->length)
+        && (pd->d_keys->val[pcache->dc_slot] == pkey))
+    {
+        *r_pobj = pd->d_vals->val[pcache->dc_slot];
+        return retval;
+    }
 
     /* if it's not a dict, raise TypeError */
     if (OBJ_GET_TYPE(pdict) != OBJ_TYPE_DIC)
@@ -178,35 +468,60 @@ dict_getItem(pPmObj_t pdict, pPmObj_t pkey, pPmObj_t *r_pobj)
     }
 
     /* if dict is empty, raise KeyError */
-    if (((pPmDict_t)pdict)->length <= 0)
+    if (pd->length <= 0)
     {
         PM_RAISE(retval, PM_RET_EX_KEY);
         return retval;
     }
 
-    /* #147: Change boolean keys to integers */
-    if (pkey == PM_TRUE)
+    DICT_BOOL_TO_INT(pkey);
+
+    /* if key not found, raise KeyError */
+    slot = dict_findSlot(pd, pkey);
+    if (pd->d_keys->val[slot] == C_NULL)
     {
-        pkey = PM_ONE;
+        PM_RAISE(retval, PM_RET_EX_KEY);
+        return retval;
     }
-    else if (pkey == PM_FALSE)
+
+    /* Remember the slot if the key is the same object */
+    if ((pcache != C_NULL) && (pd->d_keys->val[slot] == pkey))
     {
-        pkey = PM_ZERO;
+        pcache->dc_dict = pd;
+        pcache->dc_slot = slot;
     }
 
-    /* check for matching key */
-    retval = seglist_findEqual(((pPmDict_t)pdict)->d_keys, pkey, &indx);
-    /* if key not found, raise KeyError */
-    if (retval == PM_RET_NO)
+    *r_pobj = pd->d_vals->val[slot];
+    return retval;
+}
+
+
+PmReturn_t
+dict_getNext(pPmObj_t pdict, int16_t *pindex,
+             pPmObj_t *r_pkey, pPmObj_t *r_pval)
+{
+    pPmDict_t pd = (pPmDict_t)pdict;
+
+    C_ASSERT(pdict != C_NULL);
+    C_ASSERT(OBJ_GET_TYPE(pdict) == OBJ_TYPE_DIC);
+
+    if (pd->d_keys == C_NULL)
     {
-        PM_RAISE(retval, PM_RET_EX_KEY);
+        return PM_RET_NO;
     }
-    /* return any other error */
-    PM_RETURN_IF_ERROR(retval);
 
-    /* key was found, get obj from vals */
-    retval = seglist_getItem(((pPmDict_t)pdict)->d_vals, indx, r_pobj);
-    return retval;
+    /* Skip the empty slots */
+    for (; *pindex < pd->d_keys->length; (*pindex)++)
+    {
+        if (pd->d_keys->val[*pindex] != C_NULL)
+        {
+            *r_pkey = pd->d_keys->val[*pindex];
+            *r_pval = pd->d_vals->val[*pindex];
+            (*pindex)++;
+            return PM_RET_OK;
+        }
+    }
+    return PM_RET_NO;
 }
 
 
@@ -215,26 +530,66 @@ PmReturn_t
 dict_delItem(pPmObj_t pdict, pPmObj_t pkey)
 {
     PmReturn_t retval = PM_RET_OK;
-    int16_t indx = 0;
+    pPmObj_t *pkeys;
+    pPmObj_t *pvals;
+    int16_t size;
+    int16_t slot;
+    int16_t next;
+    int16_t home;
 
     C_ASSERT(pdict != C_NULL);
 
+    /* Raise KeyError if the dict is empty */
+    if (((pPmDict_t)pdict)->length <= 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_KEY);
+        return retval;
+    }
+
+    DICT_BOOL_TO_INT(pkey);
+
     /* Check for matching key */
-    retval = seglist_findEqual(((pPmDict_t)pdict)->d_keys, pkey, &indx);
+    slot = dict_findSlot((pPmDict_t)pdict, pkey);
+    pkeys = ((pPmDict_t)pdict)->d_keys->val;
+    pvals = ((pPmDict_t)pdict)->d_vals->val;
+    size = ((pPmDict_t)pdict)->d_keys->length;
 
     /* Raise KeyError if key is not found */
-    if (retval == PM_RET_NO)
+    if (pkeys[slot] == C_NULL)
     {
         PM_RAISE(retval, PM_RET_EX_KEY);
+        return retval;
     }
 
-    /* Return any other error */
-    PM_RETURN_IF_ERROR(retval);
+    /*
+     * Remove the key and value, moving back the keys after it that would
+     * no longer be found past the emptied slot
+     */
+    next = slot;
+    for (;;)
+    {
+        if (++next == size)
+        {
+            next = 0;
+        }
+        if (pkeys[next] == C_NULL)
+        {
+            break;
+        }
 
-    /* Remove the key and value */
-    retval = seglist_removeItem(((pPmDict_t)pdict)->d_keys, indx);
-    PM_RETURN_IF_ERROR(retval);
-    retval = seglist_removeItem(((pPmDict_t)pdict)->d_vals, indx);
+        /* Leave the key if its hash slot is after the emptied slot */
+        home = dict_hash(pkeys[next]) % size;
+        if ((slot <= next) ? ((slot < home) && (home <= next))
+                           : ((slot < home) || (home <= next)))
+        {
+            continue;
+        }
+        pkeys[slot] = pkeys[next];
+        pvals[slot] = pvals[next];
+        slot = next;
+    }
+    pkeys[slot] = C_NULL;
+    pvals[slot] = C_NULL;
 
     /* Reduce the item count */
     ((pPmDict_t)pdict)->length--;
@@ -249,10 +604,10 @@ PmReturn_t
 dict_print(pPmObj_t pdict)
 {
     PmReturn_t retval = PM_RET_OK;
-    int16_t index;
-    pSeglist_t keys,
-      vals;
-    pPmObj_t pobj1;
+    int16_t index = 0;
+    uint8_t first = C_TRUE;
+    pPmObj_t pkey;
+    pPmObj_t pval;
 
     C_ASSERT(pdict != C_NULL);
 
@@ -265,26 +620,19 @@ dict_print(pPmObj_t pdict)
 
     plat_putByte('{');
 
-    keys = ((pPmDict_t)pdict)->d_keys;
-    vals = ((pPmDict_t)pdict)->d_vals;
-
-    /* if dict is empty, raise KeyError */
-    for (index = 0; index < ((pPmDict_t)pdict)->length; index++)
+    while (dict_getNext(pdict, &index, &pkey, &pval) == PM_RET_OK)
     {
-        if (index != 0)
+        if (!first)
         {
             plat_putByte(',');
             plat_putByte(' ');
         }
-        retval = seglist_getItem(keys, index, &pobj1);
-        PM_RETURN_IF_ERROR(retval);
-        retval = obj_print(pobj1, C_FALSE, C_TRUE);
+        first = C_FALSE;
+        retval = obj_print(pkey, C_FALSE, C_TRUE);
         PM_RETURN_IF_ERROR(retval);
 
         plat_putByte(':');
-        retval = seglist_getItem(vals, index, &pobj1);
-        PM_RETURN_IF_ERROR(retval);
-        retval = obj_print(pobj1, C_FALSE, C_TRUE);
+        retval = obj_print(pval, C_FALSE, C_TRUE);
         PM_RETURN_IF_ERROR(retval);
     }
 
@@ -296,7 +644,7 @@ PmReturn_t
 dict_update(pPmObj_t pdestdict, pPmObj_t psourcedict)
 {
     PmReturn_t retval = PM_RET_OK;
-    int16_t i;
+    int16_t i = 0;
     pPmObj_t pkey;
     pPmObj_t pval;
 
@@ -318,14 +666,8 @@ dict_update(pPmObj_t pdestdict, pPmObj_t psourcedict)
     }
 
     /* Iterate over the add-on dict */
-    for (i = 0; i < ((pPmDict_t)psourcedict)->length; i++)
+    while (dict_getNext(psourcedict, &i, &pkey, &pval) == PM_RET_OK)
     {
-        /* Get the key,val from the add-on dict */
-        retval = seglist_getItem(((pPmDict_t)psourcedict)->d_keys, i, &pkey);
-        PM_RETURN_IF_ERROR(retval);
-        retval = seglist_getItem(((pPmDict_t)psourcedict)->d_vals, i, &pval);
-        PM_RETURN_IF_ERROR(retval);
-
         /* Set the key,val to the destination dict */
         retval = dict_setItem(pdestdict, pkey, pval);
         PM_RETURN_IF_ERROR(retval);
@@ -25,12 +25,26 @@
  */
 
 
+/** Number of slots of the smallest tables of a dict */
+#define DICT_MIN_SIZE 4
+
+/** Number of slots of the largest tables of a dict (a tuple filling a chunk) */
+#define DICT_MAX_SIZE (int16_t)((HEAP_MAX_LIVE_CHUNK_SIZE - sizeof(PmTuple_t)) \
+                                / sizeof(pPmObj_t) + 1)
+
+
 /**
  * Dict
  *
- * Contains ptr to two seglists,
+ * Contains ptr to two tables of the same size,
  * one for keys, the other for values;
  * and a length, the number of key/value pairs.
+ *
+ * The tables are tuples used as an open addressing hash table:
+ * a key goes in the first empty slot from the slot of its hash on
+ * and its value goes in the same slot of the values table.
+ * Empty slots hold C_NULL.
+ * The tables are allocated with the first key/value pair.
  */
 typedef struct PmDict_s
 {
@@ -38,14 +52,35 @@ typedef struct PmDict_s
     PmObjDesc_t od;
     /** number of key,value pairs in the dict */
     int16_t length;
-    /** ptr to seglist containing keys */
-    pSeglist_t d_keys;
-    /** ptr to seglist containing values */
-    pSeglist_t d_vals;
+    /** ptr to table of keys */
+    pPmTuple_t d_keys;
+    /** ptr to table of values */
+    pPmTuple_t d_vals;
 } PmDict_t,
  *pPmDict_t;
 
 
+/**
+ * Dict Cache Entry
+ *
+ * Remembers the slot in which a key was last found in a dict,
+ * so the next lookup of the same key object in the same dict
+ * needs no hashing or comparing.
+ * The dict is not a reference, it is only compared with the dict that is
+ * searched, so the entry does not keep the dict alive.
+ * An entry is used only if the slot still holds the same key object,
+ * so it never has to be invalidated when the dict changes.
+ */
+typedef struct PmDictCache_s
+{
+    /** ptr to dict in which the key was found */
+    pPmDict_t dc_dict;
+    /** slot of the key in the tables of the dict */
+    int16_t dc_slot;
+} PmDictCache_t,
+ *pPmDictCache_t;
+
+
 /**
  * Clears the contents of a dict.
  * after this operation, the dict should in the same state
@@ -66,6 +101,34 @@ PmReturn_t dict_clear(pPmObj_t pdict);
  */
 PmReturn_t dict_getItem(pPmObj_t pdict, pPmObj_t pkey, pPmObj_t *r_pobj);
 
+/**
+ * Gets the value in the dict using the given key
+ * and the slot in which the key was last found.
+ * Updates the cache entry when the key is found elsewhere.
+ *
+ * @param   pdict ptr to dict to search
+ * @param   pkey ptr to key obj
+ * @param   pcache ptr to cache entry of the key, or C_NULL
+ * @param   r_pobj Return; addr of ptr to obj
+ * @return  Return status
+ */
+PmReturn_t dict_getItemCached(pPmObj_t pdict, pPmObj_t pkey,
+                              pPmDictCache_t pcache, pPmObj_t *r_pobj);
+
+/**
+ * Gets the next key,value pair of the dict, in no particular order.
+ * Start with *pindex at zero; the pairs are only visited once
+ * if the dict is not changed between the calls.
+ *
+ * @param   pdict ptr to dict to iterate
+ * @param   pindex ptr to index of the next slot; updated
+ * @param   r_pkey Return; addr of ptr to key obj
+ * @param   r_pval Return; addr of ptr to val obj
+ * @return  Return status; PM_RET_NO when there are no more pairs
+ */
+PmReturn_t dict_getNext(pPmObj_t pdict, int16_t *pindex,
+                        pPmObj_t *r_pkey, pPmObj_t *r_pval);
+
 #ifdef HAVE_DEL
 /**
  * Removes a key and value from the dict.
@@ -93,8 +156,10 @@ PmReturn_t dict_new(pPmObj_t *r_pdict);
  *
  * If the dict already contains a matching key, the value is
  * replaced; otherwise the new key,val pair is inserted
- * at the front of the dict (for fast lookup).
- * In the later case, the length of the dict is incremented.
+ * and the length of the dict is incremented.
+ * The tables grow when they are three quarters full, up to the
+ * largest chunk of the heap (DICT_MAX_SIZE slots);
+ * raises MemoryError when a dict would fill its largest tables.
  *
  * @param   pdict ptr to dict in which (key,val) will go
  * @param   pkey ptr to key obj
@@ -103,6 +168,20 @@ PmReturn_t dict_new(pPmObj_t *r_pdict);
  */
 PmReturn_t dict_setItem(pPmObj_t pdict, pPmObj_t pkey, pPmObj_t pval);
 
+/**
+ * Sets a value in the dict using the given key
+ * and the slot in which the key was last found.
+ * Updates the cache entry when the key is found elsewhere.
+ *
+ * @param   pdict ptr to dict in which (key,val) will go
+ * @param   pkey ptr to key obj
+ * @param   pval ptr to val obj
+ * @param   pcache ptr to cache entry of the key, or C_NULL
+ * @return  Return status
+ */
+PmReturn_t dict_setItemCached(pPmObj_t pdict, pPmObj_t pkey, pPmObj_t pval,
+                              pPmDictCache_t pcache);
+
 #ifdef HAVE_PRINT
 /**
  * Prints out a dict. Uses obj_print() to print elements.
@@ -63,6 +63,14 @@ frame_new(pPmObj_t pfunc, pPmObj_t *r_pobj)
             + ((pco->co_cellvars == C_NULL) ? 0 : pco->co_cellvars->length);
 #endif /* HAVE_CLOSURES */
 
+#if USE_NAME_CACHE
+    /* Give the code obj its names cache, it runs fine without one */
+    if (pco->co_cache == C_NULL)
+    {
+        co_newNameCache(pco);
+    }
+#endif /* USE_NAME_CACHE */
+
     /* Allocate a frame */
     retval = heap_getChunk(fsize, &pchunk);
     PM_RETURN_IF_ERROR(retval);
@@ -41,14 +41,6 @@
 /** The size of the temporary roots stack */
 #define HEAP_NUM_TEMP_ROOTS 24
 
-/**
- * The maximum size a live chunk can be (a live chunk is one that is in use).
- * The live chunk size is limited by the size field in the *object* descriptor.
- * That field is nine bits with two assumed least significant bits (zeros):
- * (0x1FF << 2) == 2044
- */
-#define HEAP_MAX_LIVE_CHUNK_SIZE 2044
-
 /**
  * The maximum size a free chunk can be (a free chunk is one that is not in use).
  * The free chunk size is limited by the size field in the *heap* descriptor.
@@ -220,6 +212,9 @@ heap_dump(void)
 #endif
 #ifdef HAVE_CLASSES
     s |= 1<<3;
+#endif
+#if USE_NAME_CACHE
+    s |= 1<<4;
 #endif
     fwrite(&s, sizeof(uint16_t), 1, fp);
 
@@ -625,6 +620,9 @@ heap_gcMarkObj(pPmObj_t pobj)
         case OBJ_TYPE_NOB:
         case OBJ_TYPE_BOOL:
         case OBJ_TYPE_CIO:
+#if USE_NAME_CACHE
+        case OBJ_TYPE_NCA:
+#endif /* USE_NAME_CACHE */
             OBJ_SET_GCVAL(pobj, pmHeap.gcval);
             break;
 
@@ -655,11 +653,11 @@ heap_gcMarkObj(pPmObj_t pobj)
             /* Mark the dict head */
             OBJ_SET_GCVAL(pobj, pmHeap.gcval);
 
-            /* Mark the keys seglist */
+            /* Mark the keys table */
             retval = heap_gcMarkObj((pPmObj_t)((pPmDict_t)pobj)->d_keys);
             PM_RETURN_IF_ERROR(retval);
 
-            /* Mark the vals seglist */
+            /* Mark the vals table */
             retval = heap_gcMarkObj((pPmObj_t)((pPmDict_t)pobj)->d_vals);
             break;
 
@@ -675,6 +673,12 @@ heap_gcMarkObj(pPmObj_t pobj)
             retval = heap_gcMarkObj((pPmObj_t)((pPmCo_t)pobj)->co_consts);
             PM_RETURN_IF_ERROR(retval);
 
+#if USE_NAME_CACHE
+            /* Mark the names cache (it refers to no objects) */
+            retval = heap_gcMarkObj((pPmObj_t)((pPmCo_t)pobj)->co_cache);
+            PM_RETURN_IF_ERROR(retval);
+#endif /* USE_NAME_CACHE */
+
             /* #122: Mark the code image if it is in RAM */
             if (((pPmCo_t)pobj)->co_memspace == MEMSPACE_RAM)
             {
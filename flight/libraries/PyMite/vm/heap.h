@@ -31,6 +31,14 @@
  */
 #define HEAP_GC_NF_THRESHOLD (512)
 
+/**
+ * The maximum size a live chunk can be (a live chunk is one that is in use).
+ * The live chunk size is limited by the size field in the *object* descriptor.
+ * That field is nine bits with two assumed least significant bits (zeros):
+ * (0x1FF << 2) == 2044
+ */
+#define HEAP_MAX_LIVE_CHUNK_SIZE 2044
+
 
 #ifdef __DEBUG__
 #define DEBUG_PRINT_HEAP_AVAIL(s) \
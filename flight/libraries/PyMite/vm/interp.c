@@ -973,7 +973,8 @@ interpret(const uint8_t returnOnNoThreads)
                 pobj2 = PM_FP->fo_func->f_co->co_names->val[t16];
 
                 /* Set key=val in current frame's attrs dict */
-                retval = dict_setItem((pPmObj_t)PM_FP->fo_attrs, pobj2, TOS);
+                retval = dict_setItemCached((pPmObj_t)PM_FP->fo_attrs, pobj2,
+                                            TOS, NAME_CACHE(t16));
                 PM_BREAK_IF_ERROR(retval);
                 PM_SP--;
                 continue;
@@ -1126,7 +1127,8 @@ interpret(const uint8_t returnOnNoThreads)
                 pobj3 = PM_FP->fo_func->f_co->co_names->val[t16];
 
                 /* Set key=val in obj's dict */
-                retval = dict_setItem(pobj2, pobj3, TOS1);
+                retval = dict_setItemCached(pobj2, pobj3, TOS1,
+                                            NAME_CACHE(t16));
                 PM_BREAK_IF_ERROR(retval);
                 PM_SP -= 2;
                 continue;
@@ -1198,7 +1200,8 @@ interpret(const uint8_t returnOnNoThreads)
                 pobj2 = PM_FP->fo_func->f_co->co_names->val[t16];
 
                 /* Set key=val in global dict */
-                retval = dict_setItem((pPmObj_t)PM_FP->fo_globals, pobj2, TOS);
+                retval = dict_setItemCached((pPmObj_t)PM_FP->fo_globals,
+                                            pobj2, TOS, NAME_CACHE(t16));
                 PM_BREAK_IF_ERROR(retval);
                 PM_SP--;
                 continue;
@@ -1248,18 +1251,21 @@ interpret(const uint8_t returnOnNoThreads)
                 pobj1 = PM_FP->fo_func->f_co->co_names->val[t16];
 
                 /* Get value from frame's attrs dict */
-                retval = dict_getItem((pPmObj_t)PM_FP->fo_attrs, pobj1, &pobj2);
+                retval = dict_getItemCached((pPmObj_t)PM_FP->fo_attrs, pobj1,
+                                            NAME_CACHE(t16), &pobj2);
                 if (retval == PM_RET_EX_KEY)
                 {
                     /* Get val from globals */
-                    retval = dict_getItem((pPmObj_t)PM_FP->fo_globals,
-                                          pobj1, &pobj2);
+                    retval = dict_getItemCached((pPmObj_t)PM_FP->fo_globals,
+                                                pobj1, NAME_CACHE(t16),
+                                                &pobj2);
 
                     /* Check for name in the builtins module if it is loaded */
                     if ((retval == PM_RET_EX_KEY) && (PM_PBUILTINS != C_NULL))
                     {
                         /* Get val from builtins */
-                        retval = dict_getItem(PM_PBUILTINS, pobj1, &pobj2);
+                        retval = dict_getItemCached(PM_PBUILTINS, pobj1,
+                                                    NAME_CACHE(t16), &pobj2);
                         if (retval == PM_RET_EX_KEY)
                         {
                             /* Name not defined, raise NameError */
@@ -1358,7 +1364,8 @@ interpret(const uint8_t returnOnNoThreads)
                 pobj2 = PM_FP->fo_func->f_co->co_names->val[t16];
 
                 /* Get attr with given name */
-                retval = dict_getItem(pobj1, pobj2, &pobj3);
+                retval = dict_getItemCached(pobj1, pobj2, NAME_CACHE(t16),
+                                            &pobj3);
 
 #ifdef HAVE_CLASSES
                 /*
@@ -1603,13 +1610,14 @@ interpret(const uint8_t returnOnNoThreads)
                 pobj1 = PM_FP->fo_func->f_co->co_names->val[t16];
 
                 /* Try globals first */
-                retval = dict_getItem((pPmObj_t)PM_FP->fo_globals,
-                                      pobj1, &pobj2);
+                retval = dict_getItemCached((pPmObj_t)PM_FP->fo_globals,
+                                            pobj1, NAME_CACHE(t16), &pobj2);
 
                 /* If that didn't work, try builtins */
                 if (retval == PM_RET_EX_KEY)
                 {
-                    retval = dict_getItem(PM_PBUILTINS, pobj1, &pobj2);
+                    retval = dict_getItemCached(PM_PBUILTINS, pobj1,
+                                                NAME_CACHE(t16), &pobj2);
 
                     /* No such global, raise NameError */
                     if (retval == PM_RET_EX_KEY)
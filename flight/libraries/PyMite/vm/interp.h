@@ -55,6 +55,13 @@
 #define PM_PUSH(pobj)   (*(PM_SP++) = (pobj))
 /** gets the argument (S16) from the instruction stream */
 #define GET_ARG()       mem_getWord(PM_FP->fo_memspace, &PM_IP)
+#if USE_NAME_CACHE
+/** gets the dict cache entry of the nth name of the code, C_NULL if none */
+#define NAME_CACHE(n)   ((PM_FP->fo_func->f_co->co_cache == C_NULL) ? C_NULL \
+                         : &PM_FP->fo_func->f_co->co_cache->nc_entries[n])
+#else
+#define NAME_CACHE(n)   C_NULL
+#endif /* USE_NAME_CACHE */
 
 /** pushes an obj in the only stack slot of the native frame */
 #define NATIVE_SET_TOS(pobj) (gVmGlobal.nativeframe.nf_stack = \
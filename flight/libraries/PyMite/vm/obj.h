@@ -221,6 +221,9 @@ typedef enum PmType_e
 
     /** Native frame (there is only one) */
     OBJ_TYPE_NFM = 0x1E,
+
+    /** Name cache of a code obj */
+    OBJ_TYPE_NCA = 0x1F,
 } PmType_t, *pPmType_t;
 
 
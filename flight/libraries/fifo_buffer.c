@@ -27,6 +27,31 @@
 
 #include "fifo_buffer.h"
 
+/*
+ * One producer and one consumer, for instance an ISR and a task, use the buffer
+ * without a lock: the producer only writes wr and the consumer only writes rd.
+ * The producer clears the buffer through a request the consumer applies.
+ * Each side reads the index of the other side with acquire semantics and
+ * publishes its own with release semantics, the data copied before a release is
+ * visible to the other side once it sees the new index.
+ */
+#define FIFO_LOAD_ACQUIRE(index)         __atomic_load_n(&(index), __ATOMIC_ACQUIRE)
+#define FIFO_STORE_RELEASE(index, value) __atomic_store_n(&(index), (value), __ATOMIC_RELEASE)
+
+static inline uint16_t fifoBuf_used(uint16_t rd, uint16_t wr, uint16_t buf_size)
+{
+    return (wr >= rd) ? (wr - rd) : (buf_size - rd + wr);
+}
+
+static inline uint16_t fifoBuf_advance(uint16_t index, uint16_t len, uint16_t buf_size)
+{
+    index += len;
+    if (index >= buf_size) {
+        index -= buf_size;
+    }
+    return index;
+}
+
 // *****************************************************************************
 // circular buffer functions
 
@@ -43,17 +68,7 @@ uint16_t fifoBuf_getSize(t_fifo_buffer *buf)
 
 uint16_t fifoBuf_getUsed(t_fifo_buffer *buf)
 { // return the number of bytes available in the rx buffer
-    uint16_t rd = buf->rd;
-    uint16_t wr = buf->wr;
-    uint16_t buf_size  = buf->buf_size;
-
-    uint16_t num_bytes = wr - rd;
-
-    if (wr < rd) {
-        num_bytes = (buf_size - rd) + wr;
-    }
-
-    return num_bytes;
+    return fifoBuf_used(FIFO_LOAD_ACQUIRE(buf->rd), FIFO_LOAD_ACQUIRE(buf->wr), buf->buf_size);
 }
 
 uint16_t fifoBuf_getFree(t_fifo_buffer *buf)
@@ -67,7 +82,32 @@ uint16_t fifoBuf_getFree(t_fifo_buffer *buf)
 
 void fifoBuf_clearData(t_fifo_buffer *buf)
 { // remove all data from the buffer
-    buf->rd = buf->wr;
+    FIFO_STORE_RELEASE(buf->rd, FIFO_LOAD_ACQUIRE(buf->wr));
+}
+
+void fifoBuf_requestClear(t_fifo_buffer *buf)
+{ // ask the consumer to remove the data written so far, rd is only ever written by the consumer
+    buf->clear_wr = buf->wr;
+    FIFO_STORE_RELEASE(buf->clear_requests, (uint16_t)(buf->clear_requests + 1));
+}
+
+void fifoBuf_applyClear(t_fifo_buffer *buf)
+{ // remove the data written before the last clear request of the producer, if there is a new one
+    uint16_t requests = FIFO_LOAD_ACQUIRE(buf->clear_requests);
+
+    if (requests == buf->clears_applied) {
+        return; // no new request
+    }
+    buf->clears_applied = requests;
+
+    uint16_t rd = buf->rd;
+    uint16_t clear_wr = buf->clear_wr;
+    uint16_t buf_size = buf->buf_size;
+
+    // a position behind the data already taken is not moved back to
+    if (fifoBuf_used(rd, clear_wr, buf_size) <= fifoBuf_used(rd, FIFO_LOAD_ACQUIRE(buf->wr), buf_size)) {
+        FIFO_STORE_RELEASE(buf->rd, clear_wr);
+    }
 }
 
 void fifoBuf_removeData(t_fifo_buffer *buf, uint16_t len)
@@ -76,7 +116,7 @@ void fifoBuf_removeData(t_fifo_buffer *buf, uint16_t len)
     uint16_t buf_size  = buf->buf_size;
 
     // get number of bytes available
-    uint16_t num_bytes = fifoBuf_getUsed(buf);
+    uint16_t num_bytes = fifoBuf_used(rd, FIFO_LOAD_ACQUIRE(buf->wr), buf_size);
 
     if (num_bytes > len) {
         num_bytes = len;
@@ -85,22 +125,15 @@ void fifoBuf_removeData(t_fifo_buffer *buf, uint16_t len)
     if (num_bytes < 1) {
         return; // nothing to remove
     }
-    rd += num_bytes;
-    if (rd >= buf_size) {
-        rd -= buf_size;
-    }
 
-    buf->rd = rd;
+    FIFO_STORE_RELEASE(buf->rd, fifoBuf_advance(rd, num_bytes, buf_size));
 }
 
 int16_t fifoBuf_getBytePeek(t_fifo_buffer *buf)
 { // get a data byte from the buffer without removing it
     uint16_t rd = buf->rd;
 
-    // get number of bytes available
-    uint16_t num_bytes = fifoBuf_getUsed(buf);
-
-    if (num_bytes < 1) {
+    if (rd == FIFO_LOAD_ACQUIRE(buf->wr)) {
         return -1; // no byte retuened
     }
     return buf->buf_ptr[rd]; // return the byte
@@ -108,22 +141,14 @@ int16_t fifoBuf_getBytePeek(t_fifo_buffer *buf)
 
 int16_t fifoBuf_getByte(t_fifo_buffer *buf)
 { // get a data byte from the buffer
-    uint16_t rd        = buf->rd;
-    uint16_t buf_size  = buf->buf_size;
-    uint8_t *buff      = buf->buf_ptr;
-
-    // get number of bytes available
-    uint16_t num_bytes = fifoBuf_getUsed(buf);
+    uint16_t rd = buf->rd;
 
-    if (num_bytes < 1) {
+    if (rd == FIFO_LOAD_ACQUIRE(buf->wr)) {
         return -1; // no byte returned
     }
-    uint8_t b = buff[rd];
-    if (++rd >= buf_size) {
-        rd = 0;
-    }
+    uint8_t b = buf->buf_ptr[rd];
 
-    buf->rd = rd;
+    FIFO_STORE_RELEASE(buf->rd, fifoBuf_advance(rd, 1, buf->buf_size));
 
     return b; // return the byte
 }
@@ -135,7 +160,7 @@ uint16_t fifoBuf_getDataPeek(t_fifo_buffer *buf, void *data, uint16_t len)
     uint8_t *buff      = buf->buf_ptr;
 
     // get number of bytes available
-    uint16_t num_bytes = fifoBuf_getUsed(buf);
+    uint16_t num_bytes = fifoBuf_used(rd, FIFO_LOAD_ACQUIRE(buf->wr), buf_size);
 
     if (num_bytes > len) {
         num_bytes = len;
@@ -144,82 +169,41 @@ uint16_t fifoBuf_getDataPeek(t_fifo_buffer *buf, void *data, uint16_t len)
     if (num_bytes < 1) {
         return 0; // return number of bytes copied
     }
-    uint8_t *p = (uint8_t *)data;
-    uint16_t i = 0;
-
-    while (num_bytes > 0) {
-        uint16_t j = buf_size - rd;
-        if (j > num_bytes) {
-            j = num_bytes;
-        }
-        memcpy(p + i, buff + rd, j);
-        i  += j;
-        num_bytes -= j;
-        rd += j;
-        if (rd >= buf_size) {
-            rd = 0;
-        }
+
+    // at most two chunks, up to the end of the buffer and from its start
+    uint16_t j = buf_size - rd;
+    if (j > num_bytes) {
+        j = num_bytes;
     }
+    memcpy(data, buff + rd, j);
+    memcpy((uint8_t *)data + j, buff, num_bytes - j);
 
-    return i; // return number of bytes copied
+    return num_bytes; // return number of bytes copied
 }
 
 uint16_t fifoBuf_getData(t_fifo_buffer *buf, void *data, uint16_t len)
 { // get data from our rx buffer
-    uint16_t rd        = buf->rd;
-    uint16_t buf_size  = buf->buf_size;
-    uint8_t *buff      = buf->buf_ptr;
-
-    // get number of bytes available
-    uint16_t num_bytes = fifoBuf_getUsed(buf);
-
-    if (num_bytes > len) {
-        num_bytes = len;
-    }
+    uint16_t num_bytes = fifoBuf_getDataPeek(buf, data, len);
 
-    if (num_bytes < 1) {
-        return 0; // return number of bytes copied
-    }
-    uint8_t *p = (uint8_t *)data;
-    uint16_t i = 0;
-
-    while (num_bytes > 0) {
-        uint16_t j = buf_size - rd;
-        if (j > num_bytes) {
-            j = num_bytes;
-        }
-        memcpy(p + i, buff + rd, j);
-        i  += j;
-        num_bytes -= j;
-        rd += j;
-        if (rd >= buf_size) {
-            rd = 0;
-        }
+    if (num_bytes > 0) {
+        FIFO_STORE_RELEASE(buf->rd, fifoBuf_advance(buf->rd, num_bytes, buf->buf_size));
     }
 
-    buf->rd = rd;
-
-    return i; // return number of bytes copied
+    return num_bytes; // return number of bytes copied
 }
 
 uint16_t fifoBuf_putByte(t_fifo_buffer *buf, const uint8_t b)
 { // add a data byte to the buffer
-    uint16_t wr        = buf->wr;
-    uint16_t buf_size  = buf->buf_size;
-    uint8_t *buff      = buf->buf_ptr;
-
-    uint16_t num_bytes = fifoBuf_getFree(buf);
+    uint16_t wr = buf->wr;
+    uint16_t next_wr = fifoBuf_advance(wr, 1, buf->buf_size);
 
-    if (num_bytes < 1) {
+    if (next_wr == FIFO_LOAD_ACQUIRE(buf->rd)) {
         return 0;
     }
 
-    buff[wr] = b;
-    if (++wr >= buf_size) {
-        wr = 0;
-    }
+    buf->buf_ptr[wr] = b;
 
-    buf->wr = wr;
+    FIFO_STORE_RELEASE(buf->wr, next_wr);
 
     return 1; // return number of bytes copied
 }
@@ -230,7 +214,7 @@ uint16_t fifoBuf_putData(t_fifo_buffer *buf, const void *data, uint16_t len)
     uint16_t buf_size  = buf->buf_size;
     uint8_t *buff      = buf->buf_ptr;
 
-    uint16_t num_bytes = fifoBuf_getFree(buf);
+    uint16_t num_bytes = buf_size - fifoBuf_used(FIFO_LOAD_ACQUIRE(buf->rd), wr, buf_size) - 1;
 
     if (num_bytes > len) {
         num_bytes = len;
@@ -239,26 +223,60 @@ uint16_t fifoBuf_putData(t_fifo_buffer *buf, const void *data, uint16_t len)
     if (num_bytes < 1) {
         return 0; // return number of bytes copied
     }
-    uint8_t *p = (uint8_t *)data;
-    uint16_t i = 0;
-
-    while (num_bytes > 0) {
-        uint16_t j = buf_size - wr;
-        if (j > num_bytes) {
-            j = num_bytes;
-        }
-        memcpy(buff + wr, p + i, j);
-        i  += j;
-        num_bytes -= j;
-        wr += j;
-        if (wr >= buf_size) {
-            wr = 0;
-        }
+
+    // at most two chunks, up to the end of the buffer and from its start
+    uint16_t j = buf_size - wr;
+    if (j > num_bytes) {
+        j = num_bytes;
     }
+    memcpy(buff + wr, data, j);
+    memcpy(buff, (const uint8_t *)data + j, num_bytes - j);
 
-    buf->wr = wr;
+    FIFO_STORE_RELEASE(buf->wr, fifoBuf_advance(wr, num_bytes, buf_size));
+
+    return num_bytes; // return number of bytes copied
+}
+
+uint16_t fifoBuf_getReadSpan(t_fifo_buffer *buf, uint8_t **data)
+{ // get the contiguous data at the start of the buffer, to be removed with fifoBuf_removeData()
+    uint16_t rd = buf->rd;
+    uint16_t wr = FIFO_LOAD_ACQUIRE(buf->wr);
+
+    *data = buf->buf_ptr + rd;
+
+    return (wr >= rd) ? (wr - rd) : (buf->buf_size - rd);
+}
+
+uint16_t fifoBuf_getWriteSpan(t_fifo_buffer *buf, uint8_t **data)
+{ // get the contiguous free space at the end of the buffer, to be added with fifoBuf_commitData()
+    uint16_t rd = FIFO_LOAD_ACQUIRE(buf->rd);
+    uint16_t wr = buf->wr;
+
+    *data = buf->buf_ptr + wr;
+
+    if (rd > wr) {
+        return rd - wr - 1;
+    }
+    // the last byte before rd always stays free
+    return buf->buf_size - wr - (rd == 0 ? 1 : 0);
+}
+
+void fifoBuf_commitData(t_fifo_buffer *buf, uint16_t len)
+{ // add the data written in the span returned by fifoBuf_getWriteSpan()
+    uint16_t wr = buf->wr;
+    uint16_t buf_size  = buf->buf_size;
+
+    uint16_t num_bytes = buf_size - fifoBuf_used(FIFO_LOAD_ACQUIRE(buf->rd), wr, buf_size) - 1;
+
+    if (num_bytes > len) {
+        num_bytes = len;
+    }
+
+    if (num_bytes < 1) {
+        return; // nothing to add
+    }
 
-    return i; // return number of bytes copied
+    FIFO_STORE_RELEASE(buf->wr, fifoBuf_advance(wr, num_bytes, buf_size));
 }
 
 void fifoBuf_init(t_fifo_buffer *buf, const void *buffer, const uint16_t buffer_size)
@@ -267,6 +285,9 @@ void fifoBuf_init(t_fifo_buffer *buf, const void *buffer, const uint16_t buffer_
     buf->rd = 0;
     buf->wr = 0;
     buf->buf_size = buffer_size;
+    buf->clear_wr = 0;
+    buf->clear_requests = 0;
+    buf->clears_applied = 0;
 }
 
 // *****************************************************************************
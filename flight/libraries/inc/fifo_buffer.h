@@ -35,6 +35,10 @@ typedef struct {
     volatile uint16_t rd;
     volatile uint16_t wr;
     uint16_t buf_size;
+    // clear requests of the producer: wr at the last one and the number made and applied
+    volatile uint16_t clear_wr;
+    volatile uint16_t clear_requests;
+    uint16_t clears_applied;
 } t_fifo_buffer;
 
 // *********************
@@ -47,6 +51,11 @@ uint16_t fifoBuf_getFree(t_fifo_buffer *buf);
 void fifoBuf_clearData(t_fifo_buffer *buf);
 void fifoBuf_removeData(t_fifo_buffer *buf, uint16_t len);
 
+// Clearing from the producer side: the data written so far are removed by the consumer
+// when it calls fifoBuf_applyClear(), the data written after the request are kept
+void fifoBuf_requestClear(t_fifo_buffer *buf);
+void fifoBuf_applyClear(t_fifo_buffer *buf);
+
 int16_t fifoBuf_getBytePeek(t_fifo_buffer *buf);
 int16_t fifoBuf_getByte(t_fifo_buffer *buf);
 
@@ -57,6 +66,12 @@ uint16_t fifoBuf_putByte(t_fifo_buffer *buf, const uint8_t b);
 
 uint16_t fifoBuf_putData(t_fifo_buffer *buf, const void *data, uint16_t len);
 
+// Zero copy access: the contiguous part of the data, or of the free space, is used
+// in place and then removed with fifoBuf_removeData(), or added with fifoBuf_commitData()
+uint16_t fifoBuf_getReadSpan(t_fifo_buffer *buf, uint8_t **data);
+uint16_t fifoBuf_getWriteSpan(t_fifo_buffer *buf, uint8_t **data);
+void fifoBuf_commitData(t_fifo_buffer *buf, uint16_t len);
+
 void fifoBuf_init(t_fifo_buffer *buf, const void *buffer, const uint16_t buffer_size);
 
 // *********************
@@ -81,6 +81,10 @@ static const int8_t FrowMax[NUMX] = { 3, 4, 5, 9, 9, 9, 12, 12, 12, 12, -1, -1,
 static const int8_t GrowMin[NUMX] = { 9, 9, 9, 3, 3, 3, 0, 0, 0, 0, 6, 7, 8 };
 static const int8_t GrowMax[NUMX] = { -1, -1, -1, 5, 5, 5, 2, 2, 2, 2, 6, 7, 8 };
 
+// G*Q*G' is block diagonal, the rows in a block share the same columns of G
+static const int8_t GblockMin[NUMX] = { 0, 0, 0, 3, 3, 3, 6, 6, 6, 6, 10, 11, 12 };
+static const int8_t GblockMax[NUMX] = { -1, -1, -1, 5, 5, 5, 9, 9, 9, 9, 10, 11, 12 };
+
 static const int8_t HrowMin[NUMV] = { 0, 1, 2, 3, 4, 5, 6, 6, 6, 2 };
 static const int8_t HrowMax[NUMV] = { 0, 1, 2, 3, 4, 5, 9, 9, 9, 2 };
 
@@ -432,8 +436,8 @@ void INSCorrection(float mag_data[3], float Pos[3], float Vel[3],
 // Q is the discrete time covariance of process noise
 // Q is vector of the diagonal for a square matrix with
 // dimensions equal to the number of disturbance noise variables
-// The General Method is very inefficient,not taking advantage of the sparse F and G
-// The first Method is very specific to this implementation
+// Only the blocks of F and G which can hold nonzero elements are visited,
+// see FrowMin/FrowMax, GrowMin/GrowMax and GblockMin/GblockMax
 // ************************************************
 
 __attribute__((optimize("O3")))
@@ -445,55 +449,54 @@ void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
     float dT1  = 1.0f / dT; // multiplication is faster than division on fpu.
     float dTsq = dT * dT;
 
-    float Dummy[NUMX][NUMX];
-    int8_t i;
+    // Dummy is kept transposed so that all the inner loops below run along
+    // contiguous rows and vectorize. Every element is still summed in the
+    // same order as the straightforward loops, which keeps the result exact.
+    float DummyT[NUMX][NUMX];
+    float row[NUMX];
+    int8_t i, j, k;
 
-    for (i = 0; i < NUMX; i++) { // Calculate Dummy = (P/T +F*P)
-        float *Firow   = F[i];
-        float *Pirow   = P[i];
-        float *Dirow   = Dummy[i];
-        int8_t Fistart = FrowMin[i];
-        int8_t Fiend   = FrowMax[i];
-        int8_t j;
+    for (i = 0; i < NUMX; i++) { // Calculate Dummy = (P/T +F*P), a row at a time
+        float *Firow = F[i];
+        float *Pirow = P[i];
         for (j = 0; j < NUMX; j++) {
-            Dirow[j] = Pirow[j] * dT1; // Dummy = P / T ...
-            int8_t k;
-            for (k = Fistart; k <= Fiend; k++) {
-                Dirow[j] += Firow[k] * P[k][j]; // [] + F * P
+            row[j] = Pirow[j] * dT1; // Dummy = P / T ...
+        }
+        for (k = FrowMin[i]; k <= FrowMax[i]; k++) {
+            float Fik    = Firow[k];
+            float *Pkrow = P[k];
+            for (j = 0; j < NUMX; j++) {
+                row[j] += Fik * Pkrow[j]; // [] + F * P
             }
         }
+        for (j = 0; j < NUMX; j++) {
+            DummyT[j][i] = row[j];
+        }
     }
-    for (i = 0; i < NUMX; i++) { // Calculate Pnew = (T^2) [Dummy/T + Dummy*F' + G*Qw*G']
-        float *Dirow   = Dummy[i];
-        float *Girow   = G[i];
-        float *Pirow   = P[i];
-        int8_t Gistart = GrowMin[i];
-        int8_t Giend   = GrowMax[i];
-        int8_t j;
-        for (j = i; j < NUMX; j++) { // Use symmetry, ie only find upper triangular
-            float Ptmp = Dirow[j] * dT1; // Pnew = Dummy / T ...
-
-            {
-                float *Fjrow   = F[j];
-                int8_t Fjstart = FrowMin[j];
-                int8_t Fjend   = FrowMax[j];
-                int8_t k;
-                for (k = Fjstart; k <= Fjend; k++) {
-                    Ptmp += Dirow[k] * Fjrow[k]; // [] + Dummy*F' ...
-                }
+    for (j = 0; j < NUMX; j++) { // Calculate Pnew = (T^2) [Dummy/T + Dummy*F' + G*Qw*G'], a column at a time
+        float *DTjrow = DummyT[j];
+        float *Fjrow  = F[j];
+        float *Gjrow  = G[j];
+        int8_t Gistart = GblockMin[j];
+        int8_t Giend   = MIN(GblockMax[j], j);
+        for (i = 0; i <= j; i++) { // Use symmetry, ie only find upper triangular
+            row[i] = DTjrow[i] * dT1; // Pnew = Dummy / T ...
+        }
+        for (k = FrowMin[j]; k <= FrowMax[j]; k++) {
+            float Fjk     = Fjrow[k];
+            float *DTkrow = DummyT[k];
+            for (i = 0; i <= j; i++) {
+                row[i] += DTkrow[i] * Fjk; // [] + Dummy*F' ...
             }
-
-            {
-                float *Gjrow   = G[j];
-                int8_t Gjstart = MAX(Gistart, GrowMin[j]);
-                int8_t Gjend   = MIN(Giend, GrowMax[j]);
-                int8_t k;
-                for (k = Gjstart; k <= Gjend; k++) {
-                    Ptmp += Q[k] * Girow[k] * Gjrow[k]; // [] + G*Q*G' ...
-                }
+        }
+        for (k = GrowMin[j]; k <= GrowMax[j]; k++) {
+            float Gjk = Gjrow[k];
+            for (i = Gistart; i <= Giend; i++) {
+                row[i] += Q[k] * G[i][k] * Gjk; // [] + G*Q*G' ...
             }
-
-            P[j][i] = Pirow[j] = Ptmp * dTsq; // [] * (T^2)
+        }
+        for (i = 0; i <= j; i++) {
+            P[i][j] = P[j][i] = row[i] * dTsq; // [] * (T^2)
         }
     }
 }
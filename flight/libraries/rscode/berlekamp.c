@@ -38,47 +38,40 @@
 #include <stdio.h>
 #include "ecc.h"
 
-/* The Error Locator Polynomial, also known as Lambda or Sigma. Lambda[0] == 1 */
-static int Lambda[MAXDEG];
-
-/* The Error Evaluator Polynomial */
-static int Omega[MAXDEG];
-
 /* local ANSI declarations */
-static int compute_discrepancy(int lambda[], int S[], int L, int n);
-static void init_gamma(int gamma[]);
-static void compute_modified_omega (void);
-static void mul_z_poly (int src[]);
-
-/* error locations found using Chien's search*/
-static int ErrorLocs[256];
-static int NErrors;
+static uint8_t compute_discrepancy(const uint8_t lambda[], const uint8_t S[], int L, int n);
+static void init_gamma(uint8_t gamma[], int nerasures, const int erasures[]);
+static void compute_modified_omega (const uint8_t lambda[], const uint8_t S[], uint8_t omega[]);
+static void mul_z_poly (uint8_t src[]);
 
-/* erasure flags */
-static int ErasureLocs[256];
-static int NErasures;
+/* All the state lives on the stack of the caller, so that several
+ * codecs can correct packets at the same time. Lambda is the Error
+ * Locator Polynomial, also known as Sigma, Lambda[0] == 1. Omega is the
+ * Error Evaluator Polynomial. */
 
 /* From  Cain, Clark, "Error-Correction Coding For Digital Communications", pp. 216. */
-void
-Modified_Berlekamp_Massey (void)
+static void
+Modified_Berlekamp_Massey (const uint8_t S[], int nerasures, const int erasures[],
+			   uint8_t lambda[], uint8_t omega[])
 {	
-  int n, L, L2, k, d, i;
-  int psi[MAXDEG], psi2[MAXDEG], D[MAXDEG];
-  int gamma[MAXDEG];
+  int n, L, L2, k, i;
+  uint8_t d, dinv;
+  uint8_t psi[MAXDEG], psi2[MAXDEG], D[MAXDEG];
+  uint8_t gamma[MAXDEG];
 	
   /* initialize Gamma, the erasure locator polynomial */
-  init_gamma(gamma);
+  init_gamma(gamma, nerasures, erasures);
 
   /* initialize to z */
   copy_poly(D, gamma);
   mul_z_poly(D);
 	
   copy_poly(psi, gamma);	
-  k = -1; L = NErasures;
+  k = -1; L = nerasures;
 	
-  for (n = NErasures; n < RS_ECC_NPARITY; n++) {
+  for (n = nerasures; n < RS_ECC_NPARITY; n++) {
 	
-    d = compute_discrepancy(psi, synBytes, L, n);
+    d = compute_discrepancy(psi, S, L, n);
 		
     if (d != 0) {
 		
@@ -90,77 +83,73 @@ Modified_Berlekamp_Massey (void)
 	L2 = n-k;
 	k = n-L;
 	/* D = scale_poly(ginv(d), psi); */
-	for (i = 0; i < MAXDEG; i++) D[i] = gmult(psi[i], ginv(d));
+	dinv = ginv(d);
+	for (i = 0; i < MAXDEG; i++) D[i] = gmult(psi[i], dinv);
 	L = L2;
       }
 			
       /* psi = psi2 */
-      for (i = 0; i < MAXDEG; i++) psi[i] = psi2[i];
+      copy_poly(psi, psi2);
     }
 		
     mul_z_poly(D);
   }
 	
-  for(i = 0; i < MAXDEG; i++) Lambda[i] = psi[i];
-  compute_modified_omega();
-
-	
+  copy_poly(lambda, psi);
+  compute_modified_omega(lambda, S, omega);
 }
 
-/* given Psi (called Lambda in Modified_Berlekamp_Massey) and synBytes,
+/* given Psi (called Lambda in Modified_Berlekamp_Massey) and the syndrome,
    compute the combined erasure/error evaluator polynomial as 
    Psi*S mod z^4
   */
-void
-compute_modified_omega ()
+static void
+compute_modified_omega (const uint8_t lambda[], const uint8_t S[], uint8_t omega[])
 {
   int i;
-  int product[MAXDEG*2];
+  uint8_t syn[MAXDEG];
+  uint8_t product[MAXDEG*2];
 	
-  mult_polys(product, Lambda, synBytes);	
-  zero_poly(Omega);
-  for(i = 0; i < RS_ECC_NPARITY; i++) Omega[i] = product[i];
+  zero_poly(syn);
+  for(i = 0; i < RS_ECC_NPARITY; i++) syn[i] = S[i];
 
+  mult_polys(product, lambda, syn);	
+  zero_poly(omega);
+  for(i = 0; i < RS_ECC_NPARITY; i++) omega[i] = product[i];
 }
 
 /* polynomial multiplication */
 void
-mult_polys (int dst[], int p1[], int p2[])
+mult_polys (uint8_t dst[], const uint8_t p1[], const uint8_t p2[])
 {
   int i, j;
-  int tmp1[MAXDEG*2];
 	
   for (i=0; i < (MAXDEG*2); i++) dst[i] = 0;
 	
   for (i = 0; i < MAXDEG; i++) {
-    for(j=MAXDEG; j<(MAXDEG*2); j++) tmp1[j]=0;
-		
-    /* scale tmp1 by p1[i] */
-    for(j=0; j<MAXDEG; j++) tmp1[j]=gmult(p2[j], p1[i]);
-    /* and mult (shift) tmp1 right by i */
-    for (j = (MAXDEG*2)-1; j >= i; j--) tmp1[j] = tmp1[j-i];
-    for (j = 0; j < i; j++) tmp1[j] = 0;
-		
-    /* add into partial product */
-    for(j=0; j < (MAXDEG*2); j++) dst[j] ^= tmp1[j];
+    if (p1[i] == 0) continue;
+
+    /* add p2 scaled by p1[i] and shifted right by i into the product */
+    for (j = 0; j < MAXDEG; j++) dst[i+j] ^= gmult(p2[j], p1[i]);
   }
 }
 
 
 	
 /* gamma = product (1-z*a^Ij) for erasure locs Ij */
-void
-init_gamma (int gamma[])
+static void
+init_gamma (uint8_t gamma[], int nerasures, const int erasures[])
 {
-  int e, tmp[MAXDEG];
+  int e;
+  uint8_t tmp[MAXDEG];
 	
   zero_poly(gamma);
   zero_poly(tmp);
   gamma[0] = 1;
 	
-  for (e = 0; e < NErasures; e++) {
+  for (e = 0; e < nerasures; e++) {
     copy_poly(tmp, gamma);
-    scale_poly(gexp[ErasureLocs[e]], tmp);
+    scale_poly(gexp[erasures[e]], tmp);
     mul_z_poly(tmp);
     add_polys(gamma, tmp);
   }
@@ -169,7 +158,7 @@ init_gamma (int gamma[])
 	
 	
 void 
-compute_next_omega (int d, int A[], int dst[], int src[])
+compute_next_omega (uint8_t d, const uint8_t A[], uint8_t dst[], const uint8_t src[])
 {
   int i;
   for ( i = 0; i < MAXDEG;  i++) {
@@ -179,10 +168,11 @@ compute_next_omega (int d, int A[], int dst[], int src[])
 	
 
 
-int
-compute_discrepancy (int lambda[], int S[], int L, int n)
+static uint8_t
+compute_discrepancy (const uint8_t lambda[], const uint8_t S[], int L, int n)
 {
-  int i, sum=0;
+  int i;
+  uint8_t sum=0;
 	
   for (i = 0; i <= L; i++) 
     sum ^= gmult(lambda[i], S[n-i]);
@@ -191,26 +181,26 @@ compute_discrepancy (int lambda[], int S[], int L, int n)
 
 /********** polynomial arithmetic *******************/
 
-void add_polys (int dst[], int src[]) 
+void add_polys (uint8_t dst[], const uint8_t src[]) 
 {
   int i;
   for (i = 0; i < MAXDEG; i++) dst[i] ^= src[i];
 }
 
-void copy_poly (int dst[], int src[]) 
+void copy_poly (uint8_t dst[], const uint8_t src[]) 
 {
   int i;
   for (i = 0; i < MAXDEG; i++) dst[i] = src[i];
 }
 
-void scale_poly (int k, int poly[]) 
+void scale_poly (uint8_t k, uint8_t poly[]) 
 {	
   int i;
   for (i = 0; i < MAXDEG; i++) poly[i] = gmult(k, poly[i]);
 }
 
 
-void zero_poly (int poly[]) 
+void zero_poly (uint8_t poly[]) 
 {
   int i;
   for (i = 0; i < MAXDEG; i++) poly[i] = 0;
@@ -218,7 +208,7 @@ void zero_poly (int poly[])
 
 
 /* multiply by z, i.e., shift right by 1 */
-static void mul_z_poly (int src[])
+static void mul_z_poly (uint8_t src[])
 {
   int i;
   for (i = MAXDEG-1; i > 0; i--) src[i] = src[i-1];
@@ -226,99 +216,109 @@ static void mul_z_poly (int src[])
 }
 
 
-/* Finds all the roots of an error-locator polynomial with coefficients
- * Lambda[j] by evaluating Lambda at successive values of alpha. 
- * 
- * This can be tested with the decoder's equations case.
+/* Finds the roots of an error-locator polynomial with coefficients
+ * lambda[j] by evaluating it at successive values of alpha (Chien's
+ * search). Only the csize locations of the codeword are searched, the
+ * terms are stepped from one power of alpha to the next by adding k to
+ * the log of the k-th term. Returns the number of roots found, at most
+ * RS_ECC_NPARITY of them are stored into locs[].
  */
-
-
-void 
-Find_Roots (void)
+static int
+Find_Roots (const uint8_t lambda[], int csize, int locs[])
 {
-  int sum, r, k;	
-  NErrors = 0;
-  
-  for (r = 1; r < 256; r++) {
-    sum = 0;
-    /* evaluate lambda at r */
-    for (k = 0; k < RS_ECC_NPARITY+1; k++) {
-      sum ^= gmult(gexp[(k*r)%255], Lambda[k]);
+  int k, r, nerrors = 0;
+  int terms = 0;
+  int power[RS_ECC_NPARITY+1], step[RS_ECC_NPARITY+1];
+  uint8_t sum;
+
+  /* location i of the codeword is a root at r = 255-i */
+  if (csize > 255) csize = 255;
+  r = 256 - csize;
+
+  for (k = 1; k < RS_ECC_NPARITY+1; k++) {
+    if (lambda[k] != 0) {
+      power[terms] = (glog[lambda[k]] + k*r) % 255;
+      step[terms] = k;
+      terms++;
+    }
+  }
+
+  for (; r < 256; r++) {
+    /* evaluate lambda at r, lambda[0] == 1 */
+    sum = 1;
+    for (k = 0; k < terms; k++) {
+      sum ^= gexp[power[k]];
+      power[k] += step[k];
+      if (power[k] >= 255) power[k] -= 255;
+    }
+    if (sum == 0) {
+      if (nerrors < RS_ECC_NPARITY) locs[nerrors] = (255-r);
+      nerrors++;
     }
-    if (sum == 0) 
-      { 
-	ErrorLocs[NErrors] = (255-r); NErrors++; 
-	//if (DEBUG) fprintf(stderr, "Root found at r = %d, (255-r) = %d\n", r, (255-r));
-      }
   }
+  return (nerrors);
 }
 
 /* Combined Erasure And Error Magnitude Computation 
  * 
- * Pass in the codeword, its size in bytes, as well as
- * an array of any known erasure locations, along the number
- * of these erasures.
+ * Pass in the codec whose syndrome was computed by decode_data(),
+ * the codeword, its size in bytes, as well as an array of any known
+ * erasure locations, along the number of these erasures.
  * 
  * Evaluate Omega(actually Psi)/Lambda' at the roots
  * alpha^(-i) for error locs i. 
  *
- * Returns 1 if everything ok, or 0 if an out-of-bounds error is found
+ * Returns 1 if everything ok, or 0 if the codeword can not be corrected:
+ * the error locator has roots outside of the codeword, or fewer roots
+ * than its degree.
  *
  */
 
 int
-correct_errors_erasures (unsigned char codeword[], 
+correct_errors_erasures (const struct rs_ecc *ecc,
+			 unsigned char codeword[], 
 			 int csize,
 			 int nerasures,
 			 int erasures[])
 {
-  int r, i, j, err;
+  int r, i, j, degree, nerrors;
+  int errorLocs[RS_ECC_NPARITY];
+  uint8_t lambda[MAXDEG], omega[MAXDEG];
+  uint8_t num, denom;
 
   /* If you want to take advantage of erasure correction, be sure to
-     set NErasures and ErasureLocs[] with the locations of erasures. 
+     pass the locations of erasures. 
      */
-  NErasures = nerasures;
-  for (i = 0; i < NErasures; i++) ErasureLocs[i] = erasures[i];
+  if (nerasures > RS_ECC_NPARITY) return(0);
 
-  Modified_Berlekamp_Massey();
-  Find_Roots();
-  
+  Modified_Berlekamp_Massey(ecc->synBytes, nerasures, erasures, lambda, omega);
 
-  if ((NErrors <= RS_ECC_NPARITY) && NErrors > 0) { 
+  for (degree = MAXDEG-1; degree > 0 && lambda[degree] == 0; degree--);
+  if (degree == 0 || degree > RS_ECC_NPARITY) return(0);
 
-    /* first check for illegal error locs */
-    for (r = 0; r < NErrors; r++) {
-      if (ErrorLocs[r] >= csize) {
-				//if (DEBUG) fprintf(stderr, "Error loc i=%d outside of codeword length %d\n", i, csize);
-	return(0);
-      }
-    }
+  /* every root of lambda must be a location in the codeword */
+  nerrors = Find_Roots(lambda, csize, errorLocs);
+  if (nerrors != degree) {
+    //if (DEBUG) fprintf(stderr, "Uncorrectable codeword\n");
+    return(0);
+  }
 
-    for (r = 0; r < NErrors; r++) {
-      int num, denom;
-      i = ErrorLocs[r];
-      /* evaluate Omega at alpha^(-i) */
+  for (r = 0; r < nerrors; r++) {
+    i = errorLocs[r];
+    /* evaluate Omega at alpha^(-i) */
 
-      num = 0;
-      for (j = 0; j < MAXDEG; j++) 
-	num ^= gmult(Omega[j], gexp[((255-i)*j)%255]);
-      
-      /* evaluate Lambda' (derivative) at alpha^(-i) ; all odd powers disappear */
-      denom = 0;
-      for (j = 1; j < MAXDEG; j += 2) {
-	denom ^= gmult(Lambda[j], gexp[((255-i)*(j-1)) % 255]);
-      }
-      
-      err = gmult(num, ginv(denom));
-      //if (DEBUG) fprintf(stderr, "Error magnitude %#x at loc %d\n", err, csize-i);
+    num = 0;
+    for (j = 0; j < MAXDEG; j++) 
+      num ^= gmult(omega[j], gexp[((255-i)*j)%255]);
       
-      codeword[csize-i-1] ^= err;
+    /* evaluate Lambda' (derivative) at alpha^(-i) ; all odd powers disappear */
+    denom = 0;
+    for (j = 1; j < MAXDEG; j += 2) {
+      denom ^= gmult(lambda[j], gexp[((255-i)*(j-1)) % 255]);
     }
-    return(1);
-  }
-  else {
-    //if (DEBUG && NErrors) fprintf(stderr, "Uncorrectable codeword\n");
-    return(0);
+      
+    //if (DEBUG) fprintf(stderr, "Error magnitude %#x at loc %d\n", err, csize-i);
+    codeword[csize-i-1] ^= gmult(num, ginv(denom));
   }
+  return(1);
 }
-
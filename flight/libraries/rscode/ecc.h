@@ -59,40 +59,50 @@ typedef unsigned short BIT16;
 #define MAXDEG (RS_ECC_NPARITY*2)
 
 /*************************************/
-/* Encoder parity bytes */
-extern int pBytes[MAXDEG];
+/* State of a codec. Every user of the library has its own, so that
+ * several devices can encode and decode at the same time. */
+struct rs_ecc {
+  /* Encoder generator polynomial, and the logs of its coefficients */
+  uint8_t genPoly[RS_ECC_NPARITY+1];
+  uint8_t genLog[RS_ECC_NPARITY+1];
 
-/* Decoder syndrome bytes */
-extern int synBytes[MAXDEG];
-
-/* print debugging info */
-extern int DEBUG;
+  /* Decoder syndrome bytes */
+  uint8_t synBytes[RS_ECC_NPARITY];
+};
 
 /* Reed Solomon encode/decode routines */
-void initialize_ecc (void);
-int check_syndrome (void);
-void decode_data (unsigned char data[], int nbytes);
-void encode_data (unsigned char msg[], int nbytes, unsigned char dst[]);
+void initialize_ecc (struct rs_ecc *ecc);
+int check_syndrome (const struct rs_ecc *ecc);
+int decode_data (struct rs_ecc *ecc, const unsigned char data[], int nbytes);
+void encode_data (const struct rs_ecc *ecc, const unsigned char msg[], int nbytes, unsigned char dst[]);
 
 /* CRC-CCITT checksum generator */
 BIT16 crc_ccitt(unsigned char *msg, int len);
 
-/* galois arithmetic tables */
-extern const int gexp[];
-extern const int glog[];
+/* galois arithmetic tables, gexp holds two periods so that the sum
+ * of two logs can be looked up without reducing it */
+extern const uint8_t gexp[];
+extern const uint8_t glog[];
+
+static inline uint8_t gmult(uint8_t a, uint8_t b)
+{
+  if (a == 0 || b == 0) return (0);
+  return (gexp[glog[a] + glog[b]]);
+}
 
-void init_galois_tables (void);
-int ginv(int elt); 
-int gmult(int a, int b);
+static inline uint8_t ginv(uint8_t elt)
+{
+  return (gexp[255 - glog[elt]]);
+}
 
 
 /* Error location routines */
-int correct_errors_erasures (unsigned char codeword[], int csize,int nerasures, int erasures[]);
+int correct_errors_erasures (const struct rs_ecc *ecc, unsigned char codeword[], int csize, int nerasures, int erasures[]);
 
 /* polynomial arithmetic */
-void add_polys(int dst[], int src[]) ;
-void scale_poly(int k, int poly[]);
-void mult_polys(int dst[], int p1[], int p2[]);
+void add_polys(uint8_t dst[], const uint8_t src[]);
+void scale_poly(uint8_t k, uint8_t poly[]);
+void mult_polys(uint8_t dst[], const uint8_t p1[], const uint8_t p2[]);
 
-void copy_poly(int dst[], int src[]);
-void zero_poly(int poly[]);
+void copy_poly(uint8_t dst[], const uint8_t src[]);
+void zero_poly(uint8_t poly[]);
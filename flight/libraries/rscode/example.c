@@ -24,7 +24,7 @@
  * This same code demonstrates the use of the encodier and 
  * decoder/error-correction routines. 
  *
- * We are assuming we have at least four bytes of parity (NPAR >= 4).
+ * We are assuming we have at least four bytes of parity (RS_ECC_NPARITY >= 4).
  * 
  * This gives us the ability to correct up to two errors, or 
  * four erasures. 
@@ -79,19 +79,20 @@ main (int argc, char *argv[])
  
   int erasures[16];
   int nerasures = 0;
+  struct rs_ecc ecc;
 
   /* Initialization the ECC library */
  
-  initialize_ecc ();
+  initialize_ecc (&ecc);
  
   /* ************** */
  
-  /* Encode data into codeword, adding NPAR parity bytes */
-  encode_data(msg, sizeof(msg), codeword);
+  /* Encode data into codeword, adding RS_ECC_NPARITY parity bytes */
+  encode_data(&ecc, msg, sizeof(msg), codeword);
  
   printf("Encoded data is: \"%s\"\n", codeword);
  
-#define ML (sizeof (msg) + NPAR)
+#define ML (sizeof (msg) + RS_ECC_NPARITY)
 
 
   /* Add one error and two erasures */
@@ -111,11 +112,11 @@ main (int argc, char *argv[])
 
  
   /* Now decode -- encoded codeword size must be passed */
-  decode_data(codeword, ML);
+  decode_data(&ecc, codeword, ML);
 
   /* check if syndrome is all zeros */
-  if (check_syndrome () != 0) {
-    correct_errors_erasures (codeword, 
+  if (check_syndrome (&ecc) != 0) {
+    correct_errors_erasures (&ecc, codeword, 
 			     ML,
 			     nerasures, 
 			     erasures);
@@ -29,29 +29,22 @@
 #include <ctype.h>
 #include "ecc.h"
 
-/* Encoder parity bytes */
-int pBytes[MAXDEG];
-
-/* Decoder syndrome bytes */
-int synBytes[MAXDEG];
-
-/* generator polynomial */
-int genPoly[MAXDEG*2];
-
-int DEBUG = FALSE;
-
 static void
-compute_genpoly (int nbytes, int genpoly[]);
+compute_genpoly (int nbytes, uint8_t genpoly[]);
 
-/* Initialize lookup tables, polynomials, etc. */
+/* Initialize the polynomials of a codec */
 void
-initialize_ecc ()
+initialize_ecc (struct rs_ecc *ecc)
 {
-  /* Initialize the galois field arithmetic tables */
-    init_galois_tables();
+  int i;
+
+  /* Compute the encoder generator polynomial */
+  compute_genpoly(RS_ECC_NPARITY, ecc->genPoly);
+  for (i = 0; i < RS_ECC_NPARITY+1; i++)
+    ecc->genLog[i] = glog[ecc->genPoly[i]];
 
-    /* Compute the encoder generator polynomial */
-    compute_genpoly(RS_ECC_NPARITY, genPoly);
+  for (i = 0; i < RS_ECC_NPARITY; i++)
+    ecc->synBytes[i] = 0;
 }
 
 void
@@ -61,73 +54,46 @@ zero_fill_from (unsigned char buf[], int from, int to)
   for (i = from; i < to; i++) buf[i] = 0;
 }
 
-/* debugging routines */
-void
-print_parity (void)
-{
-#ifdef NEVER
-  int i;
-  printf("Parity Bytes: ");
-  for (i = 0; i < RS_ECC_NPARITY; i++) 
-    printf("[%d]:%x, ",i,pBytes[i]);
-  printf("\n");
-#endif
-}
-
-
-void
-print_syndrome (void)
-{
-#ifdef NEVER
-  int i;
-  printf("Syndrome Bytes: ");
-  for (i = 0; i < RS_ECC_NPARITY; i++) 
-    printf("[%d]:%x, ",i,synBytes[i]);
-  printf("\n");
-#endif
-}
-
-/* Append the parity bytes onto the end of the message */
-void
-build_codeword (unsigned char msg[], int nbytes, unsigned char dst[])
-{
-  int i;
-	
-  for (i = 0; i < nbytes; i++) dst[i] = msg[i];
-	
-  for (i = 0; i < RS_ECC_NPARITY; i++) {
-    dst[i+nbytes] = pBytes[RS_ECC_NPARITY-1-i];
-  }
-}
-	
 /**********************************************************
  * Reed Solomon Decoder 
  *
- * Computes the syndrome of a codeword. Puts the results
- * into the synBytes[] array.
+ * Computes the syndrome of a codeword, all of the syndrome
+ * bytes in a single pass over the data. Puts the results
+ * into the synBytes[] array of the codec, and returns nonzero
+ * if the codeword has errors as check_syndrome() does.
  */
  
-void
-decode_data(unsigned char data[], int nbytes)
+int
+decode_data (struct rs_ecc *ecc, const unsigned char data[], int nbytes)
 {
-  int i, j, sum;
-  for (j = 0; j < RS_ECC_NPARITY;  j++) {
-    sum	= 0;
-    for (i = 0; i < nbytes; i++) {
-      sum = data[i] ^ gmult(gexp[j+1], sum);
+  int i, j;
+  uint8_t syn[RS_ECC_NPARITY], nz = 0;
+
+  for (j = 0; j < RS_ECC_NPARITY; j++) syn[j] = 0;
+
+  /* S[j] = S[j] * a^(j+1) + data, the multiplication by a^(j+1) is
+   * an addition of j+1 to the log */
+  for (i = 0; i < nbytes; i++) {
+    for (j = 0; j < RS_ECC_NPARITY; j++) {
+      syn[j] = data[i] ^ (syn[j] ? gexp[glog[syn[j]] + j + 1] : 0);
     }
-    synBytes[j]  = sum;
   }
+
+  for (j = 0; j < RS_ECC_NPARITY; j++) {
+    ecc->synBytes[j] = syn[j];
+    nz |= syn[j];
+  }
+  return (nz != 0);
 }
 
 
 /* Check if the syndrome is zero */
 int
-check_syndrome (void)
+check_syndrome (const struct rs_ecc *ecc)
 {
  int i, nz = 0;
  for (i =0 ; i < RS_ECC_NPARITY; i++) {
-  if (synBytes[i] != 0) {
+  if (ecc->synBytes[i] != 0) {
       nz = 1;
       break;
   }
@@ -136,20 +102,6 @@ check_syndrome (void)
 }
 
 
-void
-debug_check_syndrome (void)
-{	
-#ifdef NEVER
-  int i;
-	
-  for (i = 0; i < 3; i++) {
-    printf(" inv log S[%d]/S[%d] = %d\n", i, i+1, 
-	   glog[gmult(synBytes[i], ginv(synBytes[i+1]))]);
-  }
-#endif
-}
-
-
 /* Create a generator polynomial for an n byte RS code. 
  * The coefficients are returned in the genPoly arg.
  * Make sure that the genPoly array which is passed in is 
@@ -157,51 +109,63 @@ debug_check_syndrome (void)
  */
 
 static void
-compute_genpoly (int nbytes, int genpoly[])
+compute_genpoly (int nbytes, uint8_t genpoly[])
 {
-  int i, tp[MAXDEG], tp1[MAXDEG];
+  int i, j;
+  uint8_t tp[MAXDEG+1];
 	
   /* multiply (x + a^n) for n = 1 to nbytes */
 
-  zero_poly(tp1);
-  tp1[0] = 1;
+  for (j = 0; j <= nbytes; j++) tp[j] = 0;
+  tp[0] = 1;
 
   for (i = 1; i <= nbytes; i++) {
-    zero_poly(tp);
-    tp[0] = gexp[i];		/* set up x+a^n */
-    tp[1] = 1;
-	  
-    mult_polys(genpoly, tp, tp1);
-    copy_poly(tp1, genpoly);
+    for (j = i; j > 0; j--) {
+      tp[j] = tp[j-1] ^ gmult(gexp[i], tp[j]);
+    }
+    tp[0] = gmult(gexp[i], tp[0]);
   }
+
+  for (j = 0; j <= nbytes; j++) genpoly[j] = tp[j];
 }
 
 /* Simulate a LFSR with generator polynomial for n byte RS code. 
  * Pass in a pointer to the data array, and amount of data. 
  *
- * The parity bytes are deposited into pBytes[], and the whole message
- * and parity are copied to dest to make a codeword.
+ * The message and the parity bytes are written to dest to make a
+ * codeword, dest may be the message itself when it has room for the
+ * parity bytes.
  * 
  */
 
 void
-encode_data (unsigned char msg[], int nbytes, unsigned char dst[])
+encode_data (const struct rs_ecc *ecc, const unsigned char msg[], int nbytes, unsigned char dst[])
 {
-  int i, LFSR[RS_ECC_NPARITY+1],dbyte, j;
+  int i, j;
+  uint8_t LFSR[RS_ECC_NPARITY+1], dbyte, dlog;
 	
   for(i=0; i < RS_ECC_NPARITY+1; i++) LFSR[i]=0;
 
+  /* the log of the feedback byte is looked up once for all of the taps */
   for (i = 0; i < nbytes; i++) {
     dbyte = msg[i] ^ LFSR[RS_ECC_NPARITY-1];
+    if (dbyte == 0) {
+      for (j = RS_ECC_NPARITY-1; j > 0; j--) LFSR[j] = LFSR[j-1];
+      LFSR[0] = 0;
+      continue;
+    }
+    dlog = glog[dbyte];
     for (j = RS_ECC_NPARITY-1; j > 0; j--) {
-      LFSR[j] = LFSR[j-1] ^ gmult(genPoly[j], dbyte);
+      LFSR[j] = LFSR[j-1] ^ (ecc->genPoly[j] ? gexp[ecc->genLog[j] + dlog] : 0);
     }
-    LFSR[0] = gmult(genPoly[0], dbyte);
+    LFSR[0] = ecc->genPoly[0] ? gexp[ecc->genLog[0] + dlog] : 0;
   }
 
-  for (i = 0; i < RS_ECC_NPARITY; i++) 
-    pBytes[i] = LFSR[i];
-	
-  build_codeword(msg, nbytes, dst);
+  /* Append the parity bytes onto the end of the message */
+  if (dst != msg) {
+    for (i = 0; i < nbytes; i++) dst[i] = msg[i];
+  }
+  for (i = 0; i < RS_ECC_NPARITY; i++) {
+    dst[i+nbytes] = LFSR[RS_ECC_NPARITY-1-i];
+  }
 }
-
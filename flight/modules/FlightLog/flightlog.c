@@ -0,0 +1,556 @@
+/**
+ ******************************************************************************
+ * @addtogroup OpenPilotModules OpenPilot Modules
+ * @{
+ * @addtogroup FlightLogModule FlightLog Module
+ * @brief Records object updates to the onboard flash
+ * @{
+ *
+ * @file       flightlog.c
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2013.
+ * @brief      Records object updates to the onboard flash.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/**
+ * Input objects: the objects selected by FlightLogSettings, FlightStatus, FlightLogControl
+ * Output objects: FlightLogStatus, FlightLogEntry
+ *
+ * The log task samples the selected objects at their log period, so fast objects
+ * cost the tasks setting them nothing and cannot flood any queue. Only the objects
+ * logged at every update (log period 1), which are expected to change slowly, are
+ * connected to the queue of the log task.
+ * The log task packs the records into the current block, every full block is
+ * handed to the writer task which appends it to the flash log while the other
+ * block is being filled. Records are dropped, never waited for, when the writer
+ * has not finished with the other block yet, and counted in FlightLogStatus.
+ *
+ * A record is made of the time in ms, the object id (uint32), the instance id
+ * (uint16), the data length (uint16) and the packed object data, little endian.
+ * The GCS reads the log back a FlightLogEntry at a time through FlightLogControl.
+ */
+
+#include "openpilot.h"
+#include "flightlog.h"
+#include "flightlogsettings.h"
+#include "flightlogstatus.h"
+#include "flightlogcontrol.h"
+#include "flightlogentry.h"
+#include "flightstatus.h"
+#include "gyros.h"
+#include "accels.h"
+#include "magnetometer.h"
+#include "baroaltitude.h"
+#include "airspeedactual.h"
+#include "attitudeactual.h"
+#include "positionactual.h"
+#include "velocityactual.h"
+#include "gpsposition.h"
+#include "manualcontrolcommand.h"
+#include "stabilizationdesired.h"
+#include "ratedesired.h"
+#include "actuatordesired.h"
+#include "actuatorcommand.h"
+#include "taskinfo.h"
+
+// Private constants
+#define QUEUE_SIZE              16
+#define LOG_STACK_SIZE_BYTES    1000
+#define WRITER_STACK_SIZE_BYTES 600
+#define LOG_TASK_PRIORITY       (tskIDLE_PRIORITY + 1)
+#define WRITER_TASK_PRIORITY    (tskIDLE_PRIORITY + 1)
+#define STATUS_PERIOD_MS        1000
+
+// Private types
+struct loggedObject {
+    int32_t (*initialize)(void);
+    UAVObjHandle (*handle)(void);
+};
+
+struct recordHeader {
+    uint32_t timestamp;
+    uint32_t objId;
+    uint16_t instId;
+    uint16_t length;
+} __attribute__((packed));
+
+enum writerOperation {
+    WRITER_APPEND,
+    WRITER_ERASE,
+};
+
+struct writerRequest {
+    enum writerOperation operation;
+    uint8_t  block;
+    uint16_t length;
+    uint16_t records;
+    uint16_t flight;
+};
+
+// Private variables
+static const struct loggedObject loggedObjects[FLIGHTLOGSETTINGS_LOGPERIOD_NUMELEM] = {
+    [FLIGHTLOGSETTINGS_LOGPERIOD_GYROS]                = { GyrosInitialize,                GyrosHandle                },
+    [FLIGHTLOGSETTINGS_LOGPERIOD_ACCELS]               = { AccelsInitialize,               AccelsHandle               },
+    [FLIGHTLOGSETTINGS_LOGPERIOD_MAGNETOMETER]         = { MagnetometerInitialize,         MagnetometerHandle         },
+    [FLIGHTLOGSETTINGS_LOGPERIOD_BAROALTITUDE]         = { BaroAltitudeInitialize,         BaroAltitudeHandle         },
+    [FLIGHTLOGSETTINGS_LOGPERIOD_AIRSPEEDACTUAL]       = { AirspeedActualInitialize,       AirspeedActualHandle       },
+    [FLIGHTLOGSETTINGS_LOGPERIOD_ATTITUDEACTUAL]       = { AttitudeActualInitialize,       AttitudeActualHandle       },
+    [FLIGHTLOGSETTINGS_LOGPERIOD_POSITIONACTUAL]       = { PositionActualInitialize,       PositionActualHandle       },
+    [FLIGHTLOGSETTINGS_LOGPERIOD_VELOCITYACTUAL]       = { VelocityActualInitialize,       VelocityActualHandle       },
+    [FLIGHTLOGSETTINGS_LOGPERIOD_GPSPOSITION]          = { GPSPositionInitialize,          GPSPositionHandle          },
+    [FLIGHTLOGSETTINGS_LOGPERIOD_MANUALCONTROLCOMMAND] = { ManualControlCommandInitialize, ManualControlCommandHandle },
+    [FLIGHTLOGSETTINGS_LOGPERIOD_STABILIZATIONDESIRED] = { StabilizationDesiredInitialize, StabilizationDesiredHandle },
+    [FLIGHTLOGSETTINGS_LOGPERIOD_RATEDESIRED]          = { RateDesiredInitialize,          RateDesiredHandle          },
+    [FLIGHTLOGSETTINGS_LOGPERIOD_ACTUATORDESIRED]      = { ActuatorDesiredInitialize,      ActuatorDesiredHandle      },
+    [FLIGHTLOGSETTINGS_LOGPERIOD_ACTUATORCOMMAND]      = { ActuatorCommandInitialize,      ActuatorCommandHandle      },
+    [FLIGHTLOGSETTINGS_LOGPERIOD_FLIGHTSTATUS]         = { FlightStatusInitialize,         FlightStatusHandle         },
+};
+
+static xTaskHandle logTaskHandle;
+static xTaskHandle writerTaskHandle;
+static xQueueHandle queue;
+static xQueueHandle writerQueue;
+static bool available;
+
+static FlightLogSettingsData settings;
+static portTickType lastLogged[FLIGHTLOGSETTINGS_LOGPERIOD_NUMELEM];
+static bool logging;
+static uint16_t flight;
+static uint32_t droppedUpdates;
+
+// Double buffered blocks, a block handed to the writer is busy until it is written
+static uint8_t *blocks[2];
+static uint16_t blockDataSize;
+static uint8_t activeBlock;
+static uint16_t activeLength;
+static uint16_t activeRecords;
+static volatile bool blockBusy[2];
+static volatile bool erasing;
+static volatile uint32_t writerDroppedUpdates;
+
+static FlightLogEntryData entry;
+
+extern uintptr_t pios_flight_log_id;
+
+// Private functions
+static void logTask(void *parameters);
+static void writerTask(void *parameters);
+static void settingsUpdated(void);
+static void updateLogging(void);
+static portTickType sampleObjects(portTickType now);
+static void logObject(uint8_t index, portTickType now);
+static void flushBlock(void);
+static void handleControl(void);
+static void updateStatus(void);
+
+/**
+ * Initialise the module, called on startup
+ * \returns 0 on success or -1 if initialisation failed
+ */
+int32_t FlightLogInitialize(void)
+{
+    struct PIOS_FLASHLOG_Stats stats;
+
+    FlightLogSettingsInitialize();
+    FlightLogStatusInitialize();
+    FlightLogControlInitialize();
+    FlightLogEntryInitialize();
+    FlightStatusInitialize();
+
+    // Without a log in flash the status tells so and nothing else happens
+    if (!pios_flight_log_id || PIOS_FLASHLOG_GetStats(pios_flight_log_id, &stats) != 0) {
+        updateStatus();
+        return 0;
+    }
+
+    blockDataSize = stats.block_size - PIOS_FLASHLOG_BLOCK_HEADER_SIZE;
+    blocks[0]     = (uint8_t *)pvPortMalloc(2 * blockDataSize);
+    if (!blocks[0]) {
+        return -1;
+    }
+    blocks[1]   = blocks[0] + blockDataSize;
+
+    queue       = xQueueCreate(QUEUE_SIZE, sizeof(UAVObjEvent));
+    writerQueue = xQueueCreate(2, sizeof(struct writerRequest));
+    if (!queue || !writerQueue) {
+        return -1;
+    }
+
+    flight    = stats.last_flight;
+    available = true;
+
+    FlightLogSettingsConnectQueue(queue);
+    FlightLogControlConnectQueue(queue);
+    FlightStatusConnectQueue(queue);
+
+    return 0;
+}
+
+/**
+ * Start the module tasks
+ * \returns 0 on success or -1 if initialisation failed
+ */
+int32_t FlightLogStart(void)
+{
+    if (!available) {
+        return 0;
+    }
+
+    xTaskCreate(logTask, (signed char *)"FlightLog", LOG_STACK_SIZE_BYTES / 4, NULL, LOG_TASK_PRIORITY, &logTaskHandle);
+    PIOS_TASK_MONITOR_RegisterTask(TASKINFO_RUNNING_FLIGHTLOG, logTaskHandle);
+    xTaskCreate(writerTask, (signed char *)"FlightLogWr", WRITER_STACK_SIZE_BYTES / 4, NULL, WRITER_TASK_PRIORITY, &writerTaskHandle);
+    PIOS_TASK_MONITOR_RegisterTask(TASKINFO_RUNNING_FLIGHTLOGWR, writerTaskHandle);
+
+    return 0;
+}
+
+MODULE_INITCALL(FlightLogInitialize, FlightLogStart);
+
+/**
+ * Packs the object updates into blocks and handles the commands
+ */
+static void logTask(__attribute__((unused)) void *parameters)
+{
+    UAVObjEvent ev;
+    portTickType lastStatus = xTaskGetTickCount();
+    portTickType wait = 0;
+
+    settingsUpdated();
+    updateStatus();
+
+    while (1) {
+        if (xQueueReceive(queue, &ev, wait) == pdTRUE) {
+            if (ev.obj == FlightLogSettingsHandle()) {
+                settingsUpdated();
+            } else if (ev.obj == FlightLogControlHandle()) {
+                handleControl();
+            } else {
+                if (ev.obj == FlightStatusHandle()) {
+                    updateLogging();
+                }
+                for (uint8_t i = 0; logging && i < FLIGHTLOGSETTINGS_LOGPERIOD_NUMELEM; i++) {
+                    if (ev.obj == loggedObjects[i].handle()) {
+                        if (settings.LogPeriod[i] == 1) {
+                            logObject(i, xTaskGetTickCount());
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+
+        portTickType now = xTaskGetTickCount();
+        if (now - lastStatus >= STATUS_PERIOD_MS / portTICK_RATE_MS) {
+            lastStatus = now;
+            updateStatus();
+        }
+
+        // Sleep until the next sample or status update is due
+        wait = STATUS_PERIOD_MS / portTICK_RATE_MS - (now - lastStatus);
+        if (logging) {
+            portTickType sampleWait = sampleObjects(now);
+            if (sampleWait < wait) {
+                wait = sampleWait;
+            }
+        }
+    }
+}
+
+/**
+ * Log the objects sampled at their log period whose period elapsed
+ * \param[in] now The current time
+ * \returns The time until the next sample is due
+ */
+static portTickType sampleObjects(portTickType now)
+{
+    portTickType wait = STATUS_PERIOD_MS / portTICK_RATE_MS;
+
+    for (uint8_t i = 0; i < FLIGHTLOGSETTINGS_LOGPERIOD_NUMELEM; i++) {
+        if (settings.LogPeriod[i] <= 1) {
+            continue;
+        }
+        portTickType period  = settings.LogPeriod[i] / portTICK_RATE_MS;
+        portTickType elapsed = now - lastLogged[i];
+        if (period == 0) {
+            period = 1;
+        }
+        if (elapsed >= period) {
+            logObject(i, now);
+            elapsed = 0;
+        }
+        if (period - elapsed < wait) {
+            wait = period - elapsed;
+        }
+    }
+
+    return wait;
+}
+
+/**
+ * Writes the blocks to flash and erases the log, which both take a while
+ */
+static void writerTask(__attribute__((unused)) void *parameters)
+{
+    struct writerRequest request;
+
+    while (1) {
+        if (xQueueReceive(writerQueue, &request, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        switch (request.operation) {
+        case WRITER_APPEND:
+            if (PIOS_FLASHLOG_Append(pios_flight_log_id, request.flight, blocks[request.block], request.length) != 0) {
+                writerDroppedUpdates += request.records;
+            }
+            blockBusy[request.block] = false;
+            break;
+        case WRITER_ERASE:
+            PIOS_FLASHLOG_Erase(pios_flight_log_id);
+            erasing = false;
+            break;
+        }
+    }
+}
+
+/**
+ * Connect the objects to log and start or stop logging
+ */
+static void settingsUpdated(void)
+{
+    FlightLogSettingsGet(&settings);
+
+    for (uint8_t i = 0; i < FLIGHTLOGSETTINGS_LOGPERIOD_NUMELEM; i++) {
+        if (i == FLIGHTLOGSETTINGS_LOGPERIOD_FLIGHTSTATUS) {
+            // Always connected to follow the arming state
+            continue;
+        }
+        if (settings.LogPeriod[i] > 0) {
+            loggedObjects[i].initialize();
+        }
+        // Only the objects logged at every update need their updates
+        if (settings.LogPeriod[i] == 1) {
+            UAVObjConnectQueue(loggedObjects[i].handle(), queue, EV_MASK_ALL_UPDATES);
+        } else if (loggedObjects[i].handle()) {
+            UAVObjDisconnectQueue(loggedObjects[i].handle(), queue);
+        }
+    }
+
+    updateLogging();
+}
+
+/**
+ * Start or stop logging according to the settings and the arming state
+ */
+static void updateLogging(void)
+{
+    bool enabled;
+
+    switch (settings.LoggingEnabled) {
+    case FLIGHTLOGSETTINGS_LOGGINGENABLED_ALWAYS:
+        enabled = true;
+        break;
+    case FLIGHTLOGSETTINGS_LOGGINGENABLED_ONLYWHENARMED:
+    {
+        uint8_t armed;
+        FlightStatusArmedGet(&armed);
+        enabled = (armed == FLIGHTSTATUS_ARMED_ARMED);
+        break;
+    }
+    default:
+        enabled = false;
+        break;
+    }
+
+    if (erasing) {
+        enabled = false;
+    }
+
+    if (enabled == logging) {
+        return;
+    }
+
+    if (enabled) {
+        // Every logging session is a new flight, starting with the state of all the objects
+        flight++;
+        logging = true;
+        portTickType now = xTaskGetTickCount();
+        for (uint8_t i = 0; i < FLIGHTLOGSETTINGS_LOGPERIOD_NUMELEM; i++) {
+            if (settings.LogPeriod[i] > 0) {
+                logObject(i, now);
+            }
+        }
+    } else {
+        logging = false;
+        flushBlock();
+    }
+
+    updateStatus();
+}
+
+/**
+ * Append a record of an object to the current block
+ */
+static void logObject(uint8_t index, portTickType now)
+{
+    UAVObjHandle obj = loggedObjects[index].handle();
+    struct recordHeader header = {
+        .timestamp = now * portTICK_RATE_MS,
+        .objId     = UAVObjGetID(obj),
+        .instId    = 0,
+        .length    = UAVObjGetNumBytes(obj),
+    };
+    uint16_t recordLength = sizeof(header) + header.length;
+
+    lastLogged[index] = now;
+
+    if (recordLength > blockDataSize) {
+        droppedUpdates++;
+        return;
+    }
+
+    if (activeLength + recordLength > blockDataSize) {
+        flushBlock();
+    }
+
+    // The writer is late, the update is lost
+    if (blockBusy[activeBlock]) {
+        droppedUpdates++;
+        return;
+    }
+
+    uint8_t *record = &blocks[activeBlock][activeLength];
+    memcpy(record, &header, sizeof(header));
+    UAVObjPack(obj, header.instId, record + sizeof(header));
+    activeLength += recordLength;
+    activeRecords++;
+}
+
+/**
+ * Hand the current block to the writer and switch to the other block
+ */
+static void flushBlock(void)
+{
+    if (activeLength == 0 || blockBusy[activeBlock]) {
+        return;
+    }
+
+    struct writerRequest request = {
+        .operation = WRITER_APPEND,
+        .block     = activeBlock,
+        .length    = activeLength,
+        .records   = activeRecords,
+        .flight    = flight,
+    };
+
+    blockBusy[activeBlock] = true;
+    if (xQueueSend(writerQueue, &request, 0) != pdTRUE) {
+        blockBusy[activeBlock] = false;
+        droppedUpdates += activeRecords;
+    }
+
+    activeBlock  ^= 1;
+    activeLength  = 0;
+    activeRecords = 0;
+}
+
+/**
+ * Execute a command of the GCS
+ */
+static void handleControl(void)
+{
+    FlightLogControlData control;
+    struct PIOS_FLASHLOG_Stats stats;
+
+    FlightLogControlGet(&control);
+
+    switch (control.Operation) {
+    case FLIGHTLOGCONTROL_OPERATION_READ:
+        PIOS_FLASHLOG_GetStats(pios_flight_log_id, &stats);
+        entry.Offset = control.Offset;
+        memset(entry.Data, 0xFF, sizeof(entry.Data));
+        if (control.Offset < stats.total_size) {
+            uint32_t length = stats.total_size - control.Offset;
+            if (length > sizeof(entry.Data)) {
+                length = sizeof(entry.Data);
+            }
+            PIOS_FLASHLOG_Read(pios_flight_log_id, control.Offset, entry.Data, length);
+        }
+        FlightLogEntrySet(&entry);
+        break;
+    case FLIGHTLOGCONTROL_OPERATION_ERASE:
+    {
+        // Not while a flight is being logged
+        struct writerRequest request = {
+            .operation = WRITER_ERASE,
+        };
+        if (!logging && !erasing) {
+            erasing = true;
+            flight  = 0;
+            if (xQueueSend(writerQueue, &request, 0) != pdTRUE) {
+                erasing = false;
+            }
+            updateStatus();
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static void updateStatus(void)
+{
+    FlightLogStatusData status;
+    struct PIOS_FLASHLOG_Stats stats;
+
+    memset(&status, 0, sizeof(status));
+
+    if (!available || PIOS_FLASHLOG_GetStats(pios_flight_log_id, &stats) != 0) {
+        status.Status = FLIGHTLOGSTATUS_STATUS_UNAVAILABLE;
+        FlightLogStatusSet(&status);
+        return;
+    }
+
+    if (erasing) {
+        status.Status = FLIGHTLOGSTATUS_STATUS_ERASING;
+    } else if (stats.used_size >= stats.total_size) {
+        status.Status = FLIGHTLOGSTATUS_STATUS_FULL;
+    } else if (logging) {
+        status.Status = FLIGHTLOGSTATUS_STATUS_LOGGING;
+    } else if (settings.LoggingEnabled != FLIGHTLOGSETTINGS_LOGGINGENABLED_DISABLED) {
+        status.Status = FLIGHTLOGSTATUS_STATUS_IDLE;
+    } else {
+        status.Status = FLIGHTLOGSTATUS_STATUS_DISABLED;
+    }
+
+    status.Flight         = flight;
+    status.UsedBytes      = stats.used_size;
+    status.TotalBytes     = stats.total_size;
+    status.BlockSize      = stats.block_size;
+    status.DroppedUpdates = droppedUpdates + writerDroppedUpdates;
+
+    FlightLogStatusSet(&status);
+}
+
+/**
+ * @}
+ * @}
+ */
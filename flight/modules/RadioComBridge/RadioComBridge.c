@@ -48,14 +48,15 @@
 // ****************
 // Private constants
 
-#define STACK_SIZE_BYTES  150
-#define TASK_PRIORITY     (tskIDLE_PRIORITY + 1)
-#define MAX_RETRIES       2
-#define RETRY_TIMEOUT_MS  20
-#define EVENT_QUEUE_SIZE  10
-#define MAX_PORT_DELAY    200
-#define SERIAL_RX_BUF_LEN 100
-#define PPM_INPUT_TIMEOUT 100
+#define STACK_SIZE_BYTES   150
+#define TASK_PRIORITY      (tskIDLE_PRIORITY + 1)
+#define MAX_RETRIES        2
+#define RETRY_TIMEOUT_MS   20
+#define EVENT_QUEUE_SIZE   10
+#define MAX_PORT_DELAY     200
+#define SERIAL_RX_BUF_LEN  100
+#define UAVTALK_RX_BUF_LEN 16
+#define PPM_INPUT_TIMEOUT  100
 
 // ****************
 // Private types
@@ -80,6 +81,10 @@ typedef struct {
     // The raw serial Rx buffer
     uint8_t  serialRxBuf[SERIAL_RX_BUF_LEN];
 
+    // The Rx buffers of the UAVTalk parsers
+    uint8_t  telemetryRxBuf[UAVTALK_RX_BUF_LEN];
+    uint8_t  radioRxBuf[UAVTALK_RX_BUF_LEN];
+
     // Error statistics.
     uint32_t comTxErrors;
     uint32_t comTxRetries;
@@ -104,8 +109,8 @@ static void radioRxTask(void *parameters);
 static void PPMInputTask(void *parameters);
 static int32_t UAVTalkSendHandler(uint8_t *buf, int32_t length);
 static int32_t RadioSendHandler(uint8_t *buf, int32_t length);
-static void ProcessTelemetryStream(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle, uint8_t rxbyte);
-static void ProcessRadioStream(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle, uint8_t rxbyte);
+static void ProcessTelemetryStream(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle, uint8_t *rxbuffer, int32_t length);
+static void ProcessRadioStream(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle, uint8_t *rxbuffer, int32_t length);
 static void objectPersistenceUpdatedCb(UAVObjEvent *objEv);
 
 // ****************
@@ -323,17 +328,14 @@ static void radioRxTask(__attribute__((unused)) void *parameters)
         PIOS_WDG_UpdateFlag(PIOS_WDG_RADIORX);
 #endif
         if (PIOS_COM_RADIO) {
-            uint8_t serial_data[1];
-            uint16_t bytes_to_process = PIOS_COM_ReceiveBuffer(PIOS_COM_RADIO, serial_data, sizeof(serial_data), MAX_PORT_DELAY);
+            uint16_t bytes_to_process = PIOS_COM_ReceiveBuffer(PIOS_COM_RADIO, data->radioRxBuf, sizeof(data->radioRxBuf), MAX_PORT_DELAY);
             if (bytes_to_process > 0) {
                 if (data->parseUAVTalk) {
                     // Pass the data through the UAVTalk parser.
-                    for (uint8_t i = 0; i < bytes_to_process; i++) {
-                        ProcessRadioStream(data->radioUAVTalkCon, data->telemUAVTalkCon, serial_data[i]);
-                    }
+                    ProcessRadioStream(data->radioUAVTalkCon, data->telemUAVTalkCon, data->radioRxBuf, bytes_to_process);
                 } else if (PIOS_COM_TELEMETRY) {
                     // Send the data straight to the telemetry port.
-                    PIOS_COM_SendBufferNonBlocking(PIOS_COM_TELEMETRY, serial_data, bytes_to_process);
+                    PIOS_COM_SendBufferNonBlocking(PIOS_COM_TELEMETRY, data->radioRxBuf, bytes_to_process);
                 }
             }
         } else {
@@ -362,12 +364,9 @@ static void telemetryRxTask(__attribute__((unused)) void *parameters)
         }
 #endif /* PIOS_INCLUDE_USB */
         if (inputPort) {
-            uint8_t serial_data[1];
-            uint16_t bytes_to_process = PIOS_COM_ReceiveBuffer(inputPort, serial_data, sizeof(serial_data), MAX_PORT_DELAY);
+            uint16_t bytes_to_process = PIOS_COM_ReceiveBuffer(inputPort, data->telemetryRxBuf, sizeof(data->telemetryRxBuf), MAX_PORT_DELAY);
             if (bytes_to_process > 0) {
-                for (uint8_t i = 0; i < bytes_to_process; i++) {
-                    ProcessTelemetryStream(data->telemUAVTalkCon, data->radioUAVTalkCon, serial_data[i]);
-                }
+                ProcessTelemetryStream(data->telemUAVTalkCon, data->radioUAVTalkCon, data->telemetryRxBuf, bytes_to_process);
             }
         } else {
             vTaskDelay(5);
@@ -485,52 +484,73 @@ static int32_t RadioSendHandler(uint8_t *buf, int32_t length)
 }
 
 /**
- * @brief Process a byte of data received on the telemetry stream
+ * @brief Process a buffer of data received on the telemetry stream
  *
  * @param[in] inConnectionHandle  The UAVTalk connection handle on the telemetry port
  * @param[in] outConnectionHandle  The UAVTalk connection handle on the radio port.
- * @param[in] rxbyte  The received byte.
+ * @param[in] rxbuffer  The received bytes.
+ * @param[in] length  The number of received bytes.
  */
-static void ProcessTelemetryStream(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle, uint8_t rxbyte)
+static void ProcessTelemetryStream(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle, uint8_t *rxbuffer, int32_t length)
 {
-    // Keep reading until we receive a completed packet.
-    UAVTalkRxState state = UAVTalkProcessInputStream(inConnectionHandle, rxbyte);
+    UAVTalkRxState state;
 
-    if (state == UAVTALK_STATE_ERROR) {
-        data->UAVTalkErrors++;
-    } else if (state == UAVTALK_STATE_COMPLETE) {
-        UAVTalkRelayPacket(inConnectionHandle, outConnectionHandle);
+    while (length > 0) {
+        // Keep reading until we receive a completed packet.
+        int32_t count = UAVTalkProcessInputBufferQuiet(inConnectionHandle, rxbuffer, length, &state);
+        if (count < 0) {
+            break;
+        }
+        rxbuffer += count;
+        length   -= count;
+
+        if (state == UAVTALK_STATE_ERROR) {
+            data->UAVTalkErrors++;
+        } else if (state == UAVTALK_STATE_COMPLETE) {
+            UAVTalkReceiveObject(inConnectionHandle);
+            UAVTalkRelayPacket(inConnectionHandle, outConnectionHandle);
+        }
     }
 }
 
 /**
- * @brief Process a byte of data received on the radio data stream.
+ * @brief Process a buffer of data received on the radio data stream.
  *
  * @param[in] inConnectionHandle  The UAVTalk connection handle on the radio port.
  * @param[in] outConnectionHandle  The UAVTalk connection handle on the telemetry port.
- * @param[in] rxbyte  The received byte.
+ * @param[in] rxbuffer  The received bytes.
+ * @param[in] length  The number of received bytes.
  */
-static void ProcessRadioStream(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle, uint8_t rxbyte)
+static void ProcessRadioStream(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle, uint8_t *rxbuffer, int32_t length)
 {
-    // Keep reading until we receive a completed packet.
-    UAVTalkRxState state = UAVTalkProcessInputStreamQuiet(inConnectionHandle, rxbyte);
-
-    if (state == UAVTALK_STATE_ERROR) {
-        data->UAVTalkErrors++;
-    } else if (state == UAVTALK_STATE_COMPLETE) {
-        // We only want to unpack certain objects from the remote modem.
-        uint32_t objId = UAVTalkGetPacketObjId(inConnectionHandle);
-        switch (objId) {
-        case OPLINKSTATUS_OBJID:
-        case OPLINKSETTINGS_OBJID:
-            break;
-        case OPLINKRECEIVER_OBJID:
-            UAVTalkReceiveObject(inConnectionHandle);
-            break;
-        default:
-            UAVTalkRelayPacket(inConnectionHandle, outConnectionHandle);
+    UAVTalkRxState state;
+
+    while (length > 0) {
+        // Keep reading until we receive a completed packet.
+        int32_t count = UAVTalkProcessInputBufferQuiet(inConnectionHandle, rxbuffer, length, &state);
+        if (count < 0) {
             break;
         }
+        rxbuffer += count;
+        length   -= count;
+
+        if (state == UAVTALK_STATE_ERROR) {
+            data->UAVTalkErrors++;
+        } else if (state == UAVTALK_STATE_COMPLETE) {
+            // We only want to unpack certain objects from the remote modem.
+            uint32_t objId = UAVTalkGetPacketObjId(inConnectionHandle);
+            switch (objId) {
+            case OPLINKSTATUS_OBJID:
+            case OPLINKSETTINGS_OBJID:
+                break;
+            case OPLINKRECEIVER_OBJID:
+                UAVTalkReceiveObject(inConnectionHandle);
+                break;
+            default:
+                UAVTalkRelayPacket(inConnectionHandle, outConnectionHandle);
+                break;
+            }
+        }
     }
 }
 
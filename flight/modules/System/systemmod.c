@@ -51,6 +51,7 @@
 #include <i2cstats.h>
 #include <taskinfo.h>
 #include <watchdogstatus.h>
+#include <callbackinfo.h>
 #include <taskinfo.h>
 #include <hwsettings.h>
 #include <pios_flashfs.h>
@@ -104,6 +105,7 @@ static void objectUpdatedCb(UAVObjEvent *ev);
 static void hwSettingsUpdatedCb(UAVObjEvent *ev);
 #ifdef DIAG_TASKS
 static void taskMonitorForEachCallback(uint16_t task_id, const struct pios_task_info *task_info, void *context);
+static void callbackSchedulerForEachCallback(uint16_t callback_id, const DelayedCallbackStats *stats, void *context);
 #endif
 static void updateStats();
 static void updateSystemAlarms();
@@ -146,6 +148,7 @@ int32_t SystemModInitialize(void)
     ObjectPersistenceInitialize();
 #ifdef DIAG_TASKS
     TaskInfoInitialize();
+    CallbackInfoInitialize();
 #endif
 #ifdef DIAG_I2C_WDG_STATS
     I2CStatsInitialize();
@@ -220,6 +223,8 @@ static void systemTask(__attribute__((unused)) void *parameters)
         // Update the task status object
         PIOS_TASK_MONITOR_ForEachTask(taskMonitorForEachCallback, &taskInfoData);
         TaskInfoSet(&taskInfoData);
+        // Update the callback statistics, one instance per callback
+        CallbackSchedulerForEachCallback(callbackSchedulerForEachCallback, NULL);
 #endif
 
         // Flash the heartbeat LED
@@ -430,6 +435,29 @@ static void taskMonitorForEachCallback(uint16_t task_id, const struct pios_task_
     taskData->StackRemaining[task_id] = task_info->stack_remaining;
     taskData->RunningTime[task_id]    = task_info->running_time_percentage;
 }
+
+static void callbackSchedulerForEachCallback(uint16_t callback_id, const DelayedCallbackStats *stats, __attribute__((unused)) void *context)
+{
+    CallbackInfoData callbackData;
+
+    // Instances are created the first time a callback shows up
+    if (callback_id >= UAVObjGetNumInstances(CallbackInfoHandle())) {
+        CallbackInfoCreateInstance();
+        if (callback_id >= UAVObjGetNumInstances(CallbackInfoHandle())) {
+            return;
+        }
+    }
+
+    // By convention, the CallbackInfoPriorityOptions match the DelayedCallbackPriority values
+    callbackData.SchedulerTask = stats->schedulerTask;
+    callbackData.Priority      = stats->priority;
+    callbackData.RunCount      = stats->runCount;
+    callbackData.MaxRunTime    = stats->maxRunTime;
+    callbackData.MaxLatency    = stats->maxLatency;
+    memcpy(callbackData.RunTime, stats->runTime, sizeof(callbackData.RunTime));
+    memcpy(callbackData.Latency, stats->latency, sizeof(callbackData.Latency));
+    CallbackInfoInstSet(callback_id, &callbackData);
+}
 #endif
 
 /**
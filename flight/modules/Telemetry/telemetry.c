@@ -38,6 +38,9 @@
 #include "gcstelemetrystats.h"
 #include "hwsettings.h"
 #include "taskinfo.h"
+#if defined(PIOS_TELEM_BANDWIDTH_SCHEDULER)
+#include "telemetryschedule.h"
+#endif
 
 // Private constants
 #define MAX_QUEUE_SIZE         TELEM_QUEUE_SIZE
@@ -50,8 +53,25 @@
 #define MAX_RETRIES            2
 #define STATS_UPDATE_PERIOD_MS 4000
 #define CONNECTION_TIMEOUT_MS  8000
+#define RX_BUFFER_SIZE         16
+#define SCHEDULE_PACKET_BYTES  11  // UAVTalk header and checksum of an update
+#define SCHEDULE_LOAD_PERCENT  80  // Share of the link budget given to periodic updates
+#define SCHEDULE_BUSY_PERCENT  25  // Share of the time blocked in transmitData() at which the link is full
+#define SCHEDULE_MAX_STRETCH   8   // Periods are stretched at most this many times
+#define SCHEDULE_GROW_DIVIDER  8   // The measured budget grows by 1/8 per stats period while the link is not full
+#define SCHEDULE_LOW_PERIOD_MS 1000 // Unacked objects updated at this period or slower have a low priority
 
 // Private types
+#if defined(PIOS_TELEM_BANDWIDTH_SCHEDULER)
+typedef struct TelemetryScheduleEntryStruct {
+    UAVObjHandle obj;
+    uint16_t     requestedPeriod; // ms, from the metadata, 0 if not periodic
+    uint16_t     period; // ms, requested period stretched to fit the link budget
+    uint16_t     updates; // periodic updates sent in the current stats period
+    uint8_t      priority; // TELEMETRYSCHEDULE_PRIORITY_*
+    struct TelemetryScheduleEntryStruct *next;
+} TelemetryScheduleEntry;
+#endif
 
 // Private variables
 static uint32_t telemetryPort;
@@ -77,6 +97,15 @@ static UAVTalkConnection uavTalkCon;
 #ifdef PIOS_INCLUDE_RFM22B
 static UAVTalkConnection radioUavTalkCon;
 #endif
+#if defined(PIOS_TELEM_BANDWIDTH_SCHEDULER)
+static TelemetryScheduleEntry *schedule;
+static xSemaphoreHandle scheduleLock;
+static uint32_t portBudget; // bytes/s of the telemetry port, 0 if unknown
+static uint32_t txBudget;   // bytes/s the link is believed to carry, 0 if unlimited
+static portTickType txBusyTicks;
+static uint16_t lowStretch; // stretch of the low and the normal priority periods, in 1/16
+static uint16_t normalStretch;
+#endif
 
 // Private functions
 static void telemetryTxTask(void *parameters);
@@ -93,6 +122,11 @@ static void updateTelemetryStats();
 static void gcsTelemetryStatsUpdated();
 static void updateSettings();
 static uint32_t getComPort(bool input);
+#if defined(PIOS_TELEM_BANDWIDTH_SCHEDULER)
+static TelemetryScheduleEntry *getScheduleEntry(UAVObjHandle obj);
+static uint16_t scheduledPeriod(TelemetryScheduleEntry *entry);
+static void updateSchedule(uint32_t txBytes);
+#endif
 
 /**
  * Initialise the telemetry module
@@ -145,6 +179,17 @@ int32_t TelemetryInitialize(void)
     priorityQueue = xQueueCreate(MAX_QUEUE_SIZE, sizeof(UAVObjEvent));
 #endif
 
+#if defined(PIOS_TELEM_BANDWIDTH_SCHEDULER)
+    TelemetryScheduleInitialize();
+    schedule      = NULL;
+    scheduleLock  = xSemaphoreCreateRecursiveMutex();
+    portBudget    = 0;
+    txBudget      = 0;
+    txBusyTicks   = 0;
+    lowStretch    = 16;
+    normalStretch = 16;
+#endif
+
     // Update telemetry settings
     telemetryPort = PIOS_COM_TELEM_RF;
     HwSettingsInitialize();
@@ -152,6 +197,9 @@ int32_t TelemetryInitialize(void)
 
     // Initialise UAVTalk
     uavTalkCon = UAVTalkInitialize(&transmitData);
+#if defined(PIOS_TELEM_DELTA_ENCODING)
+    UAVTalkEnableDeltaEncoding(uavTalkCon);
+#endif
 #ifdef PIOS_INCLUDE_RFM22B
     radioUavTalkCon = UAVTalkInitialize(&transmitData);
 #endif
@@ -289,24 +337,35 @@ static void processObjEvent(UAVObjEvent *ev)
         retries    = 0;
         success    = -1;
         if (ev->event == EV_UPDATED || ev->event == EV_UPDATED_MANUAL || ((ev->event == EV_UPDATED_PERIODIC) && (updateMode != UPDATEMODE_THROTTLED))) {
-            // Send update to GCS (with retries)
-            while (retries < MAX_RETRIES && success == -1) {
-                success = UAVTalkSendObject(uavTalkCon, ev->obj, ev->instId, UAVObjGetTelemetryAcked(&metadata), REQ_TIMEOUT_MS); // call blocks until ack is received or timeout
-                ++retries;
+#if defined(PIOS_TELEM_BANDWIDTH_SCHEDULER)
+            if (ev->event == EV_UPDATED_PERIODIC) {
+                xSemaphoreTakeRecursive(scheduleLock, portMAX_DELAY);
+                TelemetryScheduleEntry *entry = getScheduleEntry(ev->obj);
+                if (entry) {
+                    ++entry->updates;
+                }
+                xSemaphoreGiveRecursive(scheduleLock);
+            }
+#endif
+            if (UAVObjGetTelemetryAcked(&metadata)) {
+                // Send update to GCS, the ack is matched and retries are sent while the tx tasks wait for events
+                success = UAVTalkSendObjectWindowed(uavTalkCon, ev->obj, ev->instId, REQ_TIMEOUT_MS, MAX_RETRIES - 1);
+            } else {
+                // Send update to GCS (with retries), aggregated with the other updates sent at the same time
+                while (retries < MAX_RETRIES && success == -1) {
+                    success = UAVTalkSendObjectAggregated(uavTalkCon, ev->obj, ev->instId);
+                    ++retries;
+                }
+                txRetries += (retries - 1);
             }
             // Update stats
-            txRetries += (retries - 1);
             if (success == -1) {
                 ++txErrors;
             }
         } else if (ev->event == EV_UPDATE_REQ) {
-            // Request object update from GCS (with retries)
-            while (retries < MAX_RETRIES && success == -1) {
-                success = UAVTalkSendObjectRequest(uavTalkCon, ev->obj, ev->instId, REQ_TIMEOUT_MS); // call blocks until update is received or timeout
-                ++retries;
-            }
+            // Request object update from GCS, the update is matched and retries are sent like for acked updates
+            success = UAVTalkSendObjectRequestWindowed(uavTalkCon, ev->obj, ev->instId, REQ_TIMEOUT_MS, MAX_RETRIES - 1);
             // Update stats
-            txRetries += (retries - 1);
             if (success == -1) {
                 ++txErrors;
             }
@@ -332,10 +391,15 @@ static void telemetryTxTask(__attribute__((unused)) void *parameters)
 
     // Loop forever
     while (1) {
-        // Wait for queue message
-        if (xQueueReceive(queue, &ev, portMAX_DELAY) == pdTRUE) {
-            // Process event
-            processObjEvent(&ev);
+        // Wait for queue message, or until a windowed transaction has to be sent again
+        portTickType wait = UAVTalkProcessTransactions(uavTalkCon, &txRetries, &txErrors);
+        if (xQueueReceive(queue, &ev, wait) == pdTRUE) {
+            // Process the event and those queued with it, their updates go in one aggregate packet
+            uint32_t count = 0;
+            do {
+                processObjEvent(&ev);
+            } while (++count < MAX_QUEUE_SIZE && xQueueReceive(queue, &ev, 0) == pdTRUE);
+            UAVTalkFlushAggregate(uavTalkCon);
         }
     }
 }
@@ -350,10 +414,15 @@ static void telemetryTxPriTask(__attribute__((unused)) void *parameters)
 
     // Loop forever
     while (1) {
-        // Wait for queue message
-        if (xQueueReceive(priorityQueue, &ev, portMAX_DELAY) == pdTRUE) {
-            // Process event
-            processObjEvent(&ev);
+        // Wait for queue message, or until a windowed transaction has to be sent again
+        portTickType wait = UAVTalkProcessTransactions(uavTalkCon, &txRetries, &txErrors);
+        if (xQueueReceive(priorityQueue, &ev, wait) == pdTRUE) {
+            // Process the event and those queued with it, their updates go in one aggregate packet
+            uint32_t count = 0;
+            do {
+                processObjEvent(&ev);
+            } while (++count < MAX_QUEUE_SIZE && xQueueReceive(priorityQueue, &ev, 0) == pdTRUE);
+            UAVTalkFlushAggregate(uavTalkCon);
         }
     }
 }
@@ -370,14 +439,12 @@ static void telemetryRxTask(__attribute__((unused)) void *parameters)
 
         if (inputPort) {
             // Block until data are available
-            uint8_t serial_data[1];
+            uint8_t serial_data[RX_BUFFER_SIZE];
             uint16_t bytes_to_process;
 
             bytes_to_process = PIOS_COM_ReceiveBuffer(inputPort, serial_data, sizeof(serial_data), 500);
             if (bytes_to_process > 0) {
-                for (uint8_t i = 0; i < bytes_to_process; i++) {
-                    UAVTalkProcessInputStream(uavTalkCon, serial_data[i]);
-                }
+                UAVTalkProcessInputBuffer(uavTalkCon, serial_data, bytes_to_process);
             }
         } else {
             vTaskDelay(5);
@@ -395,14 +462,12 @@ static void radioRxTask(__attribute__((unused)) void *parameters)
     while (1) {
         if (telemetryPort) {
             // Block until data are available
-            uint8_t serial_data[1];
+            uint8_t serial_data[RX_BUFFER_SIZE];
             uint16_t bytes_to_process;
 
             bytes_to_process = PIOS_COM_ReceiveBuffer(telemetryPort, serial_data, sizeof(serial_data), 500);
             if (bytes_to_process > 0) {
-                for (uint8_t i = 0; i < bytes_to_process; i++) {
-                    UAVTalkProcessInputStream(radioUavTalkCon, serial_data[i]);
-                }
+                UAVTalkProcessInputBuffer(radioUavTalkCon, serial_data, bytes_to_process);
             }
         } else {
             vTaskDelay(5);
@@ -423,7 +488,19 @@ static int32_t transmitData(uint8_t *data, int32_t length)
     uint32_t outputPort = getComPort(false);
 
     if (outputPort) {
+#if defined(PIOS_TELEM_BANDWIDTH_SCHEDULER)
+        // The time spent waiting for room in the port buffer tells whether the link is full
+        portTickType start = xTaskGetTickCount();
+        int32_t rc = PIOS_COM_SendBuffer(outputPort, data, length);
+        portTickType busy  = xTaskGetTickCount() - start;
+        // The tx, the priority tx and the rx tasks all send
+        portENTER_CRITICAL();
+        txBusyTicks += busy;
+        portEXIT_CRITICAL();
+        return rc;
+#else
         return PIOS_COM_SendBuffer(outputPort, data, length);
+#endif
     }
 
     return -1;
@@ -440,6 +517,36 @@ static int32_t setUpdatePeriod(UAVObjHandle obj, int32_t updatePeriodMs)
 {
     UAVObjEvent ev;
 
+#if defined(PIOS_TELEM_BANDWIDTH_SCHEDULER)
+    // Remember the period requested by the metadata, the event gets it stretched to fit the link
+    xSemaphoreTakeRecursive(scheduleLock, portMAX_DELAY);
+    TelemetryScheduleEntry *entry = getScheduleEntry(obj);
+    if (!entry && updatePeriodMs > 0) {
+        entry = (TelemetryScheduleEntry *)pvPortMalloc(sizeof(TelemetryScheduleEntry));
+        if (entry) {
+            memset(entry, 0, sizeof(TelemetryScheduleEntry));
+            entry->obj  = obj;
+            entry->next = schedule;
+            schedule    = entry;
+        }
+    }
+    if (entry) {
+        UAVObjMetadata metadata;
+        UAVObjGetMetadata(obj, &metadata);
+        entry->requestedPeriod = (updatePeriodMs > 0xFFFF) ? 0xFFFF : updatePeriodMs;
+        if (UAVObjGetTelemetryAcked(&metadata)) {
+            entry->priority = TELEMETRYSCHEDULE_PRIORITY_HIGH;
+        } else if (entry->requestedPeriod >= SCHEDULE_LOW_PERIOD_MS) {
+            entry->priority = TELEMETRYSCHEDULE_PRIORITY_LOW;
+        } else {
+            entry->priority = TELEMETRYSCHEDULE_PRIORITY_NORMAL;
+        }
+        entry->period  = scheduledPeriod(entry);
+        updatePeriodMs = entry->period;
+    }
+    xSemaphoreGiveRecursive(scheduleLock);
+#endif
+
     // Add object for periodic updates
     ev.obj    = obj;
     ev.instId = UAVOBJ_ALL_INSTANCES;
@@ -475,14 +582,28 @@ static void updateTelemetryStats()
     uint8_t forceUpdate;
     uint8_t connectionTimeout;
     uint32_t timeNow;
+    uint32_t deltaObjects[FLIGHTTELEMETRYSTATS_DELTAOBJECTS_NUMELEM];
+    uint8_t deltaRatio[FLIGHTTELEMETRYSTATS_DELTARATIO_NUMELEM];
 
     // Get stats
     UAVTalkGetStats(uavTalkCon, &utalkStats);
+    for (uint8_t n = 0; n < FLIGHTTELEMETRYSTATS_DELTAOBJECTS_NUMELEM; n++) {
+        uint32_t rawBytes;
+        uint32_t sentBytes;
+        if (UAVTalkGetDeltaStats(uavTalkCon, n, &deltaObjects[n], &rawBytes, &sentBytes) != 0) {
+            deltaObjects[n] = 0;
+            rawBytes = 0;
+        }
+        deltaRatio[n] = (rawBytes > 0) ? (uint8_t)((uint64_t)sentBytes * 100 / rawBytes) : 0;
+    }
 #ifdef PIOS_INCLUDE_RFM22B
     UAVTalkAddStats(radioUavTalkCon, &utalkStats);
     UAVTalkResetStats(radioUavTalkCon);
 #endif
     UAVTalkResetStats(uavTalkCon);
+#if defined(PIOS_TELEM_BANDWIDTH_SCHEDULER)
+    updateSchedule(utalkStats.txBytes);
+#endif
 
     // Get object data
     FlightTelemetryStatsGet(&flightStats);
@@ -495,6 +616,11 @@ static void updateTelemetryStats()
         flightStats.RxFailures += utalkStats.rxErrors;
         flightStats.TxFailures += txErrors;
         flightStats.TxRetries  += txRetries;
+        memcpy(flightStats.DeltaObjects, deltaObjects, sizeof(deltaObjects));
+        memcpy(flightStats.DeltaRatio, deltaRatio, sizeof(deltaRatio));
+#if defined(PIOS_TELEM_BANDWIDTH_SCHEDULER)
+        flightStats.TxBudget = txBudget;
+#endif
         txErrors = 0;
         txRetries = 0;
     } else {
@@ -503,6 +629,9 @@ static void updateTelemetryStats()
         flightStats.RxFailures = 0;
         flightStats.TxFailures = 0;
         flightStats.TxRetries  = 0;
+        memset(flightStats.DeltaObjects, 0, sizeof(flightStats.DeltaObjects));
+        memset(flightStats.DeltaRatio, 0, sizeof(flightStats.DeltaRatio));
+        flightStats.TxBudget = 0;
         txErrors = 0;
         txRetries = 0;
     }
@@ -542,6 +671,13 @@ static void updateTelemetryStats()
         flightStats.Status = FLIGHTTELEMETRYSTATS_STATUS_DISCONNECTED;
     }
 
+    // Offer aggregate packets to the GCS while connecting, GCS versions which do not know them drop the offer
+    if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_DISCONNECTED) {
+        UAVTalkResetAggregation(uavTalkCon);
+    } else if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_HANDSHAKEACK) {
+        UAVTalkOfferAggregation(uavTalkCon);
+    }
+
     // Update the telemetry alarm
     if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED) {
         AlarmsClear(SYSTEMALARMS_ALARM_TELEMETRY);
@@ -573,29 +709,37 @@ static void updateSettings()
         HwSettingsTelemetrySpeedGet(&speed);
 
         // Set port speed
+        uint32_t baud = 0;
         switch (speed) {
         case HWSETTINGS_TELEMETRYSPEED_2400:
-            PIOS_COM_ChangeBaud(telemetryPort, 2400);
+            baud = 2400;
             break;
         case HWSETTINGS_TELEMETRYSPEED_4800:
-            PIOS_COM_ChangeBaud(telemetryPort, 4800);
+            baud = 4800;
             break;
         case HWSETTINGS_TELEMETRYSPEED_9600:
-            PIOS_COM_ChangeBaud(telemetryPort, 9600);
+            baud = 9600;
             break;
         case HWSETTINGS_TELEMETRYSPEED_19200:
-            PIOS_COM_ChangeBaud(telemetryPort, 19200);
+            baud = 19200;
             break;
         case HWSETTINGS_TELEMETRYSPEED_38400:
-            PIOS_COM_ChangeBaud(telemetryPort, 38400);
+            baud = 38400;
             break;
         case HWSETTINGS_TELEMETRYSPEED_57600:
-            PIOS_COM_ChangeBaud(telemetryPort, 57600);
+            baud = 57600;
             break;
         case HWSETTINGS_TELEMETRYSPEED_115200:
-            PIOS_COM_ChangeBaud(telemetryPort, 115200);
+            baud = 115200;
             break;
         }
+        if (baud) {
+            PIOS_COM_ChangeBaud(telemetryPort, baud);
+        }
+#if defined(PIOS_TELEM_BANDWIDTH_SCHEDULER)
+        // 8N1, ten bits per byte
+        portBudget = baud / 10;
+#endif
     }
 }
 
@@ -620,6 +764,129 @@ static uint32_t getComPort(bool input)
     }
 }
 
+#if defined(PIOS_TELEM_BANDWIDTH_SCHEDULER)
+/**
+ * Find the schedule entry of an object, the schedule lock must be held
+ * \param[in] obj The object
+ * \return The entry or NULL if the object was never periodic
+ */
+static TelemetryScheduleEntry *getScheduleEntry(UAVObjHandle obj)
+{
+    TelemetryScheduleEntry *entry;
+
+    for (entry = schedule; entry; entry = entry->next) {
+        if (entry->obj == obj) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Period of an object stretched according to its priority
+ * \param[in] entry The schedule entry of the object
+ * \return The period in ms, 0 if the object is not periodic
+ */
+static uint16_t scheduledPeriod(TelemetryScheduleEntry *entry)
+{
+    uint32_t period = entry->requestedPeriod;
+
+    if (entry->priority == TELEMETRYSCHEDULE_PRIORITY_LOW) {
+        period = period * lowStretch / 16;
+    } else if (entry->priority == TELEMETRYSCHEDULE_PRIORITY_NORMAL) {
+        period = period * normalStretch / 16;
+    }
+    return (period > 0xFFFF) ? 0xFFFF : period;
+}
+
+/**
+ * Update the link budget and stretch the periods of the low, then of the normal
+ * priority objects until the periodic updates fit in it. High priority (acked)
+ * objects keep their period. Called every STATS_UPDATE_PERIOD_MS.
+ * \param[in] txBytes Bytes sent since the last call
+ */
+static void updateSchedule(uint32_t txBytes)
+{
+    uint32_t txRate = txBytes * 1000 / STATS_UPDATE_PERIOD_MS;
+    uint32_t busyMs;
+    uint32_t demand[TELEMETRYSCHEDULE_PRIORITY_LOW + 1] = { 0 };
+    TelemetryScheduleEntry *entry;
+    uint16_t instId = 0;
+
+    portENTER_CRITICAL();
+    busyMs = txBusyTicks * portTICK_RATE_MS;
+    txBusyTicks = 0;
+    portEXIT_CRITICAL();
+
+    // Nothing limits USB, measure the serial and radio links while they are full
+    if (getComPort(false) != telemetryPort) {
+        txBudget = 0;
+    } else if (busyMs * 100 >= STATS_UPDATE_PERIOD_MS * SCHEDULE_BUSY_PERCENT) {
+        txBudget = (txRate > 0) ? txRate : 1;
+    } else if (txBudget == 0) {
+        txBudget = portBudget;
+    } else {
+        txBudget += txBudget / SCHEDULE_GROW_DIVIDER + 1;
+        if (portBudget && txBudget > portBudget) {
+            txBudget = portBudget;
+        }
+    }
+
+    xSemaphoreTakeRecursive(scheduleLock, portMAX_DELAY);
+
+    // Bytes per second of each priority at the requested periods
+    for (entry = schedule; entry; entry = entry->next) {
+        if (entry->requestedPeriod > 0) {
+            uint32_t bytes = (SCHEDULE_PACKET_BYTES + UAVObjGetNumBytes(entry->obj)) * UAVObjGetNumInstances(entry->obj);
+            demand[entry->priority] += bytes * 1000 / entry->requestedPeriod;
+        }
+    }
+
+    lowStretch    = 16;
+    normalStretch = 16;
+    if (txBudget > 0) {
+        int32_t available = (int32_t)(txBudget * SCHEDULE_LOAD_PERCENT / 100) - (int32_t)demand[TELEMETRYSCHEDULE_PRIORITY_HIGH];
+        int32_t normal    = demand[TELEMETRYSCHEDULE_PRIORITY_NORMAL];
+        int32_t low = demand[TELEMETRYSCHEDULE_PRIORITY_LOW];
+        if (normal + low <= available) {
+            // Everything fits
+        } else if (normal + low / SCHEDULE_MAX_STRETCH < available) {
+            lowStretch = (16 * low + available - normal - 1) / (available - normal);
+        } else {
+            int32_t left = available - low / SCHEDULE_MAX_STRETCH;
+            lowStretch    = 16 * SCHEDULE_MAX_STRETCH;
+            normalStretch = (left > 0) ? (16 * normal + left - 1) / left : 16 * SCHEDULE_MAX_STRETCH;
+            if (normalStretch > 16 * SCHEDULE_MAX_STRETCH) {
+                normalStretch = 16 * SCHEDULE_MAX_STRETCH;
+            }
+        }
+    }
+
+    // Apply the new periods and report the achieved ones
+    for (entry = schedule; entry; entry = entry->next) {
+        TelemetryScheduleData data;
+
+        if (scheduledPeriod(entry) != entry->period) {
+            setUpdatePeriod(entry->obj, entry->requestedPeriod);
+        }
+
+        if (instId >= UAVObjGetNumInstances(TelemetryScheduleHandle()) && TelemetryScheduleCreateInstance() == 0) {
+            entry->updates = 0;
+            continue;
+        }
+        data.ObjectID        = UAVObjGetID(entry->obj);
+        data.RequestedPeriod = entry->requestedPeriod;
+        data.ScheduledPeriod = entry->period;
+        data.AchievedPeriod  = entry->updates ? STATS_UPDATE_PERIOD_MS / entry->updates : 0;
+        data.Priority = entry->priority;
+        TelemetryScheduleInstSet(instId++, &data);
+        entry->updates = 0;
+    }
+
+    xSemaphoreGiveRecursive(scheduleLock);
+}
+#endif /* PIOS_TELEM_BANDWIDTH_SCHEDULER */
+
 /**
  * @}
  * @}
@@ -0,0 +1,320 @@
+/**
+ ******************************************************************************
+ *
+ * @file       uavobjbench.c
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2013.
+ * @brief      UAVObject manager benchmark for the simposix target.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/**
+ *
+ * Benchmark of the UAVObject manager locking, to be run on the simposix target
+ * (make fw_simposix UAVOBJBENCH=YES).
+ *
+ * A sensor, an attitude and a stabilization task exchange data through
+ * Gyros, Accels, AttitudeActual and RateDesired at a high rate while a
+ * telemetry task packs every registered object in a loop. At the end of the
+ * run the lock statistics of every object are printed and the program exits.
+ * Build once with and once without PIOS_UAVOBJ_PER_OBJECT_LOCK to compare.
+ *
+ * Afterwards the instance lookup of a multi instance object (Waypoint) is
+ * timed with 1, 16, 64 and 255 instances and compared with a walk of a linked
+ * list holding the same data, which is how instances used to be stored.
+ *
+ */
+
+#include "openpilot.h"
+#include "uavobjectsinit.h"
+#include "gyros.h"
+#include "accels.h"
+#include "attitudeactual.h"
+#include "ratedesired.h"
+#include "waypoint.h"
+
+// Private constants
+#define STACK_SIZE           configMINIMAL_STACK_SIZE
+#define SENSOR_PRIORITY      (tskIDLE_PRIORITY + 4)
+#define ATTITUDE_PRIORITY    (tskIDLE_PRIORITY + 3)
+#define STABI_PRIORITY       (tskIDLE_PRIORITY + 3)
+#define TELEMETRY_PRIORITY   (tskIDLE_PRIORITY + 2)
+#define REPORT_PRIORITY      (tskIDLE_PRIORITY + 5)
+#define BENCH_DURATION_MS    10000
+#define LOOPS_PER_YIELD      100
+#define LOOKUP_ITERATIONS    100000
+#define LOOKUP_MAX_INSTANCES 255
+
+// Private types
+struct listInstance {
+    struct listInstance *next;
+    WaypointData data;
+};
+
+// Private variables
+static volatile bool running;
+static volatile uint32_t sensorLoops;
+static volatile uint32_t attitudeLoops;
+static volatile uint32_t stabiLoops;
+static volatile uint32_t telemetryPacks;
+static uint8_t packBuffer[UAVOBJECTS_LARGEST];
+static UAVObjLockStats totalStats;
+static const uint16_t lookupInstances[] = { 1, 16, 64, LOOKUP_MAX_INSTANCES };
+
+// Private functions
+static void sensorTask(void *parameters);
+static void attitudeTask(void *parameters);
+static void stabiTask(void *parameters);
+static void telemetryTask(void *parameters);
+static void reportTask(void *parameters);
+static void packObject(UAVObjHandle obj);
+static void reportObject(UAVObjHandle obj);
+static void lookupBenchmark(void);
+
+/**
+ * Initialise the module, called on startup.
+ * \returns 0 on success or -1 if initialisation failed
+ */
+int32_t UAVObjBenchInitialize()
+{
+    GyrosInitialize();
+    AccelsInitialize();
+    AttitudeActualInitialize();
+    RateDesiredInitialize();
+    WaypointInitialize();
+
+    return 0;
+}
+
+/**
+ * Start the benchmark tasks
+ * \returns 0 on success or -1 if initialisation failed
+ */
+int32_t UAVObjBenchStart()
+{
+    running = true;
+
+    xTaskCreate(sensorTask, (signed char *)"BenchSensors", STACK_SIZE, NULL, SENSOR_PRIORITY, NULL);
+    xTaskCreate(attitudeTask, (signed char *)"BenchAttitude", STACK_SIZE, NULL, ATTITUDE_PRIORITY, NULL);
+    xTaskCreate(stabiTask, (signed char *)"BenchStabi", STACK_SIZE, NULL, STABI_PRIORITY, NULL);
+    xTaskCreate(telemetryTask, (signed char *)"BenchTelem", STACK_SIZE, NULL, TELEMETRY_PRIORITY, NULL);
+    xTaskCreate(reportTask, (signed char *)"BenchReport", STACK_SIZE, NULL, REPORT_PRIORITY, NULL);
+
+    return 0;
+}
+
+MODULE_INITCALL(UAVObjBenchInitialize, UAVObjBenchStart);
+
+/**
+ * Writer of the raw sensor objects
+ */
+static void sensorTask(__attribute__((unused)) void *parameters)
+{
+    GyrosData gyros;
+    AccelsData accels;
+
+    memset(&gyros, 0, sizeof(gyros));
+    memset(&accels, 0, sizeof(accels));
+
+    while (running) {
+        for (uint32_t i = 0; i < LOOPS_PER_YIELD; i++) {
+            gyros.x  += 0.1f;
+            accels.z -= 0.1f;
+            GyrosSet(&gyros);
+            AccelsSet(&accels);
+            sensorLoops++;
+        }
+        vTaskDelay(1);
+    }
+    vTaskDelete(NULL);
+}
+
+/**
+ * Reader of the sensors, writer of the attitude
+ */
+static void attitudeTask(__attribute__((unused)) void *parameters)
+{
+    GyrosData gyros;
+    AccelsData accels;
+    AttitudeActualData attitude;
+
+    memset(&attitude, 0, sizeof(attitude));
+
+    while (running) {
+        for (uint32_t i = 0; i < LOOPS_PER_YIELD; i++) {
+            GyrosGet(&gyros);
+            AccelsGet(&accels);
+            attitude.Roll  = gyros.x;
+            attitude.Pitch = accels.z;
+            AttitudeActualSet(&attitude);
+            attitudeLoops++;
+        }
+        vTaskDelay(1);
+    }
+    vTaskDelete(NULL);
+}
+
+/**
+ * Reader of the attitude and the gyros, writer of the desired rates
+ */
+static void stabiTask(__attribute__((unused)) void *parameters)
+{
+    GyrosData gyros;
+    AttitudeActualData attitude;
+    RateDesiredData rate;
+
+    memset(&rate, 0, sizeof(rate));
+
+    while (running) {
+        for (uint32_t i = 0; i < LOOPS_PER_YIELD; i++) {
+            AttitudeActualGet(&attitude);
+            GyrosGet(&gyros);
+            rate.Roll = attitude.Roll - gyros.x;
+            RateDesiredSet(&rate);
+            stabiLoops++;
+        }
+        vTaskDelay(1);
+    }
+    vTaskDelete(NULL);
+}
+
+/**
+ * Packs every object like the telemetry module does
+ */
+static void telemetryTask(__attribute__((unused)) void *parameters)
+{
+    while (running) {
+        UAVObjIterate(&packObject);
+        vTaskDelay(1);
+    }
+    vTaskDelete(NULL);
+}
+
+static void packObject(UAVObjHandle obj)
+{
+    for (uint16_t instId = 0; instId < UAVObjGetNumInstances(obj); instId++) {
+        UAVObjPack(obj, instId, packBuffer);
+        telemetryPacks++;
+    }
+}
+
+/**
+ * Stops the benchmark after BENCH_DURATION_MS and prints the results
+ */
+static void reportTask(__attribute__((unused)) void *parameters)
+{
+    vTaskDelay(BENCH_DURATION_MS / portTICK_RATE_MS);
+    running = false;
+
+    fprintf(stderr, "UAVObjBench: %u ms, sensors %u, attitude %u, stabilization %u loops, %u packs\n",
+            BENCH_DURATION_MS, sensorLoops, attitudeLoops, stabiLoops, telemetryPacks);
+
+    memset(&totalStats, 0, sizeof(totalStats));
+    UAVObjIterate(&reportObject);
+
+    fprintf(stderr, "UAVObjBench: total locks %u contended %u wait %u us\n",
+            totalStats.lockCount, totalStats.contendedCount, totalStats.waitTimeUs);
+
+    lookupBenchmark();
+
+    exit(0);
+}
+
+static void reportObject(UAVObjHandle obj)
+{
+    UAVObjLockStats lockStats;
+
+    // Metaobjects share the lock of their parent
+    if (UAVObjIsMetaobject(obj)) {
+        return;
+    }
+
+    if (UAVObjGetLockStats(obj, &lockStats) != 0) {
+        return;
+    }
+
+    if (lockStats.contendedCount > 0) {
+        fprintf(stderr, "UAVObjBench: object 0x%08X locks %u contended %u wait %u us (max %u us)\n",
+                UAVObjGetID(obj), lockStats.lockCount, lockStats.contendedCount,
+                lockStats.waitTimeUs, lockStats.maxWaitTimeUs);
+    }
+
+    totalStats.lockCount      += lockStats.lockCount;
+    totalStats.contendedCount += lockStats.contendedCount;
+    totalStats.waitTimeUs     += lockStats.waitTimeUs;
+}
+
+/**
+ * Times WaypointInstGet() against the walk of a linked list of instances
+ */
+static void lookupBenchmark(void)
+{
+    WaypointData waypoint;
+    struct listInstance *list = NULL;
+    struct listInstance *tail = NULL;
+    uint16_t numInstances    = 1;
+    uint16_t listLength = 0;
+
+    memset(&waypoint, 0, sizeof(waypoint));
+
+    for (uint8_t n = 0; n < NELEMENTS(lookupInstances); n++) {
+        // Grow both the object and the list to the instance count under test
+        while (numInstances < lookupInstances[n]) {
+            if (WaypointCreateInstance() == 0) {
+                fprintf(stderr, "UAVObjBench: could not create waypoint instance %u\n", numInstances);
+                return;
+            }
+            numInstances++;
+        }
+        while (listLength < numInstances) {
+            struct listInstance *entry = (struct listInstance *)pvPortMalloc(sizeof(struct listInstance));
+            if (!entry) {
+                return;
+            }
+            memset(entry, 0, sizeof(struct listInstance));
+            listLength++;
+            if (tail) {
+                tail->next = entry;
+            } else {
+                list = entry;
+            }
+            tail = entry;
+        }
+
+        uint32_t start = PIOS_DELAY_GetRaw();
+        for (uint32_t i = 0; i < LOOKUP_ITERATIONS; i++) {
+            WaypointInstGet(i % numInstances, &waypoint);
+        }
+        uint32_t objectUs = PIOS_DELAY_DiffuS(start);
+
+        start = PIOS_DELAY_GetRaw();
+        for (uint32_t i = 0; i < LOOKUP_ITERATIONS; i++) {
+            struct listInstance *entry = list;
+            for (uint16_t instId = i % numInstances; instId > 0; instId--) {
+                entry = entry->next;
+            }
+            memcpy(&waypoint, &entry->data, sizeof(waypoint));
+        }
+        uint32_t listUs = PIOS_DELAY_DiffuS(start);
+
+        fprintf(stderr, "UAVObjBench: %3u instances, %u ns per instance get, %u ns per linked list get\n",
+                numInstances, (uint32_t)((uint64_t)objectUs * 1000 / LOOKUP_ITERATIONS),
+                (uint32_t)((uint64_t)listUs * 1000 / LOOKUP_ITERATIONS));
+    }
+}
@@ -0,0 +1,501 @@
+/**
+ ******************************************************************************
+ *
+ * @file       uavtalkbench.c
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2013.
+ * @brief      UAVTalk receive path benchmark for the simposix target.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/**
+ *
+ * Benchmark of the UAVTalk receive path, to be run on the simposix target
+ * (add UAVTalkBench to MODULES).
+ *
+ * A stream holding every registered object is generated with a loopback
+ * connection, then parsed by UAVTalkProcessInputStreamQuiet() one byte at a
+ * time and by UAVTalkProcessInputBufferQuiet() in chunks of the sizes the
+ * telemetry tasks receive. The throughput and the time per packet of each
+ * run are printed.
+ *
+ * Afterwards two connections are linked through delay lines adding a fixed
+ * latency in each direction, and instances of an acked object (Waypoint)
+ * are sent over them one transaction at a time with UAVTalkSendObject() and
+ * pipelined with UAVTalkSendObjectWindowed(). The objects per second of
+ * both are printed for each latency.
+ *
+ * Finally telemetry ticks of small high rate objects (Gyros, Accels and
+ * AttitudeActual) are sent over the link in single packets, then in aggregate
+ * packets once the receiving end offered them. The bytes per tick and the
+ * ticks per second a 57600 baud link can carry are printed.
+ *
+ * Then ticks of larger slowly changing objects (SystemStats, GPSPosition and
+ * StabilizationSettings) are sent in aggregate packets and delta encoded once
+ * both ends enabled delta encoding. The bytes per tick and the compression
+ * ratio of each object are printed and the program exits.
+ *
+ */
+
+#include "openpilot.h"
+#include "uavobjectsinit.h"
+#include "waypoint.h"
+#include "gyros.h"
+#include "accels.h"
+#include "attitudeactual.h"
+#include "systemstats.h"
+#include "gpsposition.h"
+#include "stabilizationsettings.h"
+
+// Private constants
+#define STACK_SIZE        (configMINIMAL_STACK_SIZE * 4)
+#define TASK_PRIORITY     (tskIDLE_PRIORITY + 1)
+#define STREAM_SIZE       32768
+#define BENCH_REPETITIONS 50
+#define LINK_PRIORITY     (tskIDLE_PRIORITY + 2)
+#define LINK_QUEUE_SIZE   64
+#define LINK_CHUNK_SIZE   64
+#define LINK_OBJECTS      32
+#define LINK_RETRIES      2
+#define AGGREGATE_TICKS   100
+#define RADIO_BYTES_PER_S (57600 / 10)
+
+// Private types
+struct linkChunk {
+    portTickType deliveryTime;
+    uint8_t length;
+    uint8_t data[LINK_CHUNK_SIZE];
+};
+
+struct link {
+    xQueueHandle queue;
+    UAVTalkConnection *destination;
+};
+
+// Private variables
+static UAVTalkConnection txCon;
+static UAVTalkConnection rxCon;
+static uint8_t stream[STREAM_SIZE];
+static int32_t streamLength;
+static bool streamFull;
+static const uint16_t chunkSizes[] = { 1, 16, 64, 1024 };
+static UAVTalkConnection flightCon;
+static UAVTalkConnection gcsCon;
+static struct link toGcs    = { .destination = &gcsCon };
+static struct link toFlight = { .destination = &flightCon };
+static portTickType linkLatency;
+static const uint16_t linkLatenciesMs[] = { 0, 50, 250 };
+
+// Private functions
+static void benchTask(void *parameters);
+static int32_t captureStream(uint8_t *data, int32_t length);
+static void sendObject(UAVObjHandle obj);
+static uint32_t parseBytes(uint32_t *packets);
+static uint32_t parseBuffer(uint16_t chunkSize, uint32_t *packets);
+static void report(const char *name, uint32_t us, uint32_t packets);
+static void linkTask(void *parameters);
+static void linkSend(struct link *link, uint8_t *data, int32_t length);
+static int32_t flightOutput(uint8_t *data, int32_t length);
+static int32_t gcsOutput(uint8_t *data, int32_t length);
+static void linkBenchmark(void);
+static uint32_t sendTicks(UAVObjHandle *objects, uint8_t numObjects, uint32_t *objectBytes);
+static void aggregateBenchmark(void);
+static uint32_t sendDeltaTicks(UAVObjHandle *objects, uint8_t numObjects);
+static void deltaBenchmark(void);
+
+/**
+ * Initialise the module, called on startup.
+ * \returns 0 on success or -1 if initialisation failed
+ */
+int32_t UAVTalkBenchInitialize()
+{
+    txCon = UAVTalkInitialize(&captureStream);
+    rxCon = UAVTalkInitialize(NULL);
+    flightCon      = UAVTalkInitialize(&flightOutput);
+    gcsCon         = UAVTalkInitialize(&gcsOutput);
+    toGcs.queue    = xQueueCreate(LINK_QUEUE_SIZE, sizeof(struct linkChunk));
+    toFlight.queue = xQueueCreate(LINK_QUEUE_SIZE, sizeof(struct linkChunk));
+    WaypointInitialize();
+    GyrosInitialize();
+    AccelsInitialize();
+    AttitudeActualInitialize();
+    SystemStatsInitialize();
+    GPSPositionInitialize();
+    StabilizationSettingsInitialize();
+
+    return (txCon && rxCon && flightCon && gcsCon && toGcs.queue && toFlight.queue) ? 0 : -1;
+}
+
+/**
+ * Start the benchmark task
+ * \returns 0 on success or -1 if initialisation failed
+ */
+int32_t UAVTalkBenchStart()
+{
+    xTaskCreate(benchTask, (signed char *)"BenchUAVTalk", STACK_SIZE, NULL, TASK_PRIORITY, NULL);
+    xTaskCreate(linkTask, (signed char *)"BenchToGcs", STACK_SIZE, &toGcs, LINK_PRIORITY, NULL);
+    xTaskCreate(linkTask, (signed char *)"BenchToFlight", STACK_SIZE, &toFlight, LINK_PRIORITY, NULL);
+
+    return 0;
+}
+
+MODULE_INITCALL(UAVTalkBenchInitialize, UAVTalkBenchStart);
+
+/**
+ * Generates the stream and times the parsers
+ */
+static void benchTask(__attribute__((unused)) void *parameters)
+{
+    uint32_t packets;
+    uint32_t us;
+
+    // Let the other modules register their objects first
+    vTaskDelay(1000 / portTICK_RATE_MS);
+
+    // Fill the stream with whole packets of all objects
+    streamLength = 0;
+    streamFull   = false;
+    while (!streamFull) {
+        UAVObjIterate(&sendObject);
+    }
+
+    us = parseBytes(&packets);
+    report("byte", us, packets);
+
+    for (uint8_t n = 0; n < NELEMENTS(chunkSizes); n++) {
+        char name[16];
+        snprintf(name, sizeof(name), "buffer %u", chunkSizes[n]);
+        us = parseBuffer(chunkSizes[n], &packets);
+        report(name, us, packets);
+    }
+
+    linkBenchmark();
+    aggregateBenchmark();
+    deltaBenchmark();
+
+    exit(0);
+}
+
+static int32_t captureStream(uint8_t *data, int32_t length)
+{
+    if (streamLength + length > STREAM_SIZE) {
+        streamFull = true;
+        return length;
+    }
+    memcpy(&stream[streamLength], data, length);
+    streamLength += length;
+    return length;
+}
+
+static void sendObject(UAVObjHandle obj)
+{
+    if (!streamFull && !UAVObjIsMetaobject(obj)) {
+        UAVTalkSendObject(txCon, obj, 0, 0, 0);
+    }
+}
+
+/**
+ * Parses the stream one byte at a time
+ * \param[out] packets Number of packets parsed per repetition
+ * \return Time taken in us
+ */
+static uint32_t parseBytes(uint32_t *packets)
+{
+    uint32_t start = PIOS_DELAY_GetRaw();
+
+    for (uint32_t r = 0; r < BENCH_REPETITIONS; r++) {
+        *packets = 0;
+        for (int32_t i = 0; i < streamLength; i++) {
+            if (UAVTalkProcessInputStreamQuiet(rxCon, stream[i]) == UAVTALK_STATE_COMPLETE) {
+                (*packets)++;
+            }
+        }
+    }
+    return PIOS_DELAY_DiffuS(start);
+}
+
+/**
+ * Parses the stream in chunks of chunkSize bytes
+ * \param[in] chunkSize The number of bytes handed to the parser at once
+ * \param[out] packets Number of packets parsed per repetition
+ * \return Time taken in us
+ */
+static uint32_t parseBuffer(uint16_t chunkSize, uint32_t *packets)
+{
+    uint32_t start = PIOS_DELAY_GetRaw();
+
+    for (uint32_t r = 0; r < BENCH_REPETITIONS; r++) {
+        *packets = 0;
+        for (int32_t i = 0; i < streamLength; i += chunkSize) {
+            const uint8_t *chunk = &stream[i];
+            int32_t length = (streamLength - i < chunkSize) ? streamLength - i : chunkSize;
+            while (length > 0) {
+                UAVTalkRxState state;
+                int32_t count = UAVTalkProcessInputBufferQuiet(rxCon, chunk, length, &state);
+                if (state == UAVTALK_STATE_COMPLETE) {
+                    (*packets)++;
+                }
+                chunk  += count;
+                length -= count;
+            }
+        }
+    }
+    return PIOS_DELAY_DiffuS(start);
+}
+
+static void report(const char *name, uint32_t us, uint32_t packets)
+{
+    uint64_t bytes = (uint64_t)streamLength * BENCH_REPETITIONS;
+
+    if (us == 0) {
+        us = 1;
+    }
+    fprintf(stderr, "UAVTalkBench: %-12s %u packets, %u kB/s, %u ns per packet\n",
+            name, packets, (uint32_t)(bytes * 1000000 / us / 1024),
+            (uint32_t)((uint64_t)us * 1000 / ((uint64_t)packets * BENCH_REPETITIONS)));
+}
+
+/**
+ * Delivers the chunks of a link to its destination once their latency has passed
+ */
+static void linkTask(void *parameters)
+{
+    struct link *link = (struct link *)parameters;
+    struct linkChunk chunk;
+
+    while (1) {
+        if (xQueueReceive(link->queue, &chunk, portMAX_DELAY) == pdTRUE) {
+            portTickType now = xTaskGetTickCount();
+            if ((int32_t)(chunk.deliveryTime - now) > 0) {
+                vTaskDelay(chunk.deliveryTime - now);
+            }
+            UAVTalkProcessInputBuffer(*link->destination, chunk.data, chunk.length);
+        }
+    }
+}
+
+static void linkSend(struct link *link, uint8_t *data, int32_t length)
+{
+    struct linkChunk chunk;
+
+    chunk.deliveryTime = xTaskGetTickCount() + linkLatency;
+    while (length > 0) {
+        chunk.length = (length > LINK_CHUNK_SIZE) ? LINK_CHUNK_SIZE : length;
+        memcpy(chunk.data, data, chunk.length);
+        xQueueSend(link->queue, &chunk, portMAX_DELAY);
+        data   += chunk.length;
+        length -= chunk.length;
+    }
+}
+
+static int32_t flightOutput(uint8_t *data, int32_t length)
+{
+    linkSend(&toGcs, data, length);
+    return length;
+}
+
+static int32_t gcsOutput(uint8_t *data, int32_t length)
+{
+    linkSend(&toFlight, data, length);
+    return length;
+}
+
+/**
+ * Sends LINK_OBJECTS waypoints with acks over the delayed link, one at a time
+ * and windowed
+ */
+static void linkBenchmark(void)
+{
+    uint16_t numInstances = 1;
+
+    while (numInstances < LINK_OBJECTS) {
+        if (WaypointCreateInstance() == 0) {
+            fprintf(stderr, "UAVTalkBench: could not create waypoint instance %u\n", numInstances);
+            return;
+        }
+        numInstances++;
+    }
+
+    for (uint8_t n = 0; n < NELEMENTS(linkLatenciesMs); n++) {
+        int32_t timeoutMs = 2 * linkLatenciesMs[n] + 100;
+        uint32_t failures = 0;
+        uint32_t retries  = 0;
+
+        linkLatency = linkLatenciesMs[n] / portTICK_RATE_MS;
+
+        uint32_t start = PIOS_DELAY_GetRaw();
+        for (uint16_t instId = 0; instId < LINK_OBJECTS; instId++) {
+            if (UAVTalkSendObject(flightCon, WaypointHandle(), instId, 1, timeoutMs) != 0) {
+                failures++;
+            }
+        }
+        uint32_t serialUs = PIOS_DELAY_DiffuS(start);
+
+        start = PIOS_DELAY_GetRaw();
+        for (uint16_t instId = 0; instId < LINK_OBJECTS; instId++) {
+            if (UAVTalkSendObjectWindowed(flightCon, WaypointHandle(), instId, timeoutMs, LINK_RETRIES) != 0) {
+                failures++;
+            }
+        }
+        while (UAVTalkProcessTransactions(flightCon, &retries, &failures) != portMAX_DELAY) {
+            vTaskDelay(1);
+        }
+        uint32_t windowedUs = PIOS_DELAY_DiffuS(start);
+
+        fprintf(stderr, "UAVTalkBench: latency %3u ms, %u objects/s one at a time, %u objects/s windowed (%u retries, %u failures)\n",
+                linkLatenciesMs[n], (uint32_t)((uint64_t)LINK_OBJECTS * 1000000 / (serialUs ? serialUs : 1)),
+                (uint32_t)((uint64_t)LINK_OBJECTS * 1000000 / (windowedUs ? windowedUs : 1)), retries, failures);
+    }
+}
+
+/**
+ * Sends AGGREGATE_TICKS ticks of the objects from the flight end of the link
+ * \param[in] objects The objects updated in each tick
+ * \param[in] numObjects Number of objects
+ * \param[out] objectBytes Object data bytes sent
+ * \return Bytes sent
+ */
+static uint32_t sendTicks(UAVObjHandle *objects, uint8_t numObjects, uint32_t *objectBytes)
+{
+    UAVTalkStats stats;
+
+    UAVTalkResetStats(flightCon);
+    for (uint32_t tick = 0; tick < AGGREGATE_TICKS; tick++) {
+        for (uint8_t n = 0; n < numObjects; n++) {
+            UAVTalkSendObjectAggregated(flightCon, objects[n], 0);
+        }
+        UAVTalkFlushAggregate(flightCon);
+    }
+    UAVTalkGetStats(flightCon, &stats);
+
+    *objectBytes = stats.txObjectBytes;
+    return stats.txBytes;
+}
+
+/**
+ * Counts the bytes of telemetry ticks in single and in aggregate packets
+ */
+static void aggregateBenchmark(void)
+{
+    UAVObjHandle objects[] = { GyrosHandle(), AccelsHandle(), AttitudeActualHandle() };
+    UAVTalkStats stats;
+    uint32_t objectBytes;
+
+    linkLatency = 0;
+
+    UAVTalkResetAggregation(flightCon);
+    uint32_t singleBytes = sendTicks(objects, NELEMENTS(objects), &objectBytes);
+
+    // The offer and its answer cross the link before the flight end aggregates
+    UAVTalkOfferAggregation(gcsCon);
+    vTaskDelay(100 / portTICK_RATE_MS);
+
+    UAVTalkResetStats(gcsCon);
+    uint32_t aggregateBytes = sendTicks(objects, NELEMENTS(objects), &objectBytes);
+    vTaskDelay(100 / portTICK_RATE_MS);
+    UAVTalkGetStats(gcsCon, &stats);
+
+    fprintf(stderr, "UAVTalkBench: Gyros, Accels and AttitudeActual, %u data bytes per tick\n", objectBytes / AGGREGATE_TICKS);
+    fprintf(stderr, "UAVTalkBench: single packets    %u bytes per tick, %u%% overhead, %u ticks/s at 57600 baud\n",
+            singleBytes / AGGREGATE_TICKS, (singleBytes - objectBytes) * 100 / singleBytes,
+            RADIO_BYTES_PER_S * AGGREGATE_TICKS / singleBytes);
+    fprintf(stderr, "UAVTalkBench: aggregate packets %u bytes per tick, %u%% overhead, %u ticks/s at 57600 baud (%u packets received, %u errors)\n",
+            aggregateBytes / AGGREGATE_TICKS, (aggregateBytes - objectBytes) * 100 / aggregateBytes,
+            RADIO_BYTES_PER_S * AGGREGATE_TICKS / aggregateBytes, stats.rxObjects, stats.rxErrors);
+}
+
+/**
+ * Sends AGGREGATE_TICKS ticks of the objects, SystemStats and GPSPosition change a little in each tick
+ * \param[in] objects The objects sent in each tick
+ * \param[in] numObjects Number of objects
+ * \return Bytes sent
+ */
+static uint32_t sendDeltaTicks(UAVObjHandle *objects, uint8_t numObjects)
+{
+    SystemStatsData systemStats;
+    GPSPositionData gpsPosition;
+    UAVTalkStats stats;
+
+    SystemStatsGet(&systemStats);
+    GPSPositionGet(&gpsPosition);
+    UAVTalkResetStats(flightCon);
+    for (uint32_t tick = 0; tick < AGGREGATE_TICKS; tick++) {
+        systemStats.FlightTime     = tick * 100;
+        systemStats.CPULoad        = 20 + tick % 8;
+        systemStats.HeapRemaining  = 4000 - tick % 3;
+        SystemStatsSet(&systemStats);
+        gpsPosition.Latitude       = 473765432 + tick;
+        gpsPosition.Longitude      = 85432109 - tick;
+        gpsPosition.Altitude       = 410.0f + (float)(tick % 4);
+        GPSPositionSet(&gpsPosition);
+        for (uint8_t n = 0; n < numObjects; n++) {
+            UAVTalkSendObjectAggregated(flightCon, objects[n], 0);
+        }
+        UAVTalkFlushAggregate(flightCon);
+    }
+    UAVTalkGetStats(flightCon, &stats);
+
+    return stats.txBytes;
+}
+
+/**
+ * Counts the bytes of telemetry ticks in aggregate packets and delta encoded
+ */
+static void deltaBenchmark(void)
+{
+    UAVObjHandle objects[] = { SystemStatsHandle(), GPSPositionHandle(), StabilizationSettingsHandle() };
+    UAVTalkStats stats;
+    uint32_t objectBytes = 0;
+    int32_t latitude;
+
+    linkLatency = 0;
+
+    for (uint8_t n = 0; n < NELEMENTS(objects); n++) {
+        objectBytes += UAVObjGetNumBytes(objects[n]);
+    }
+    uint32_t aggregateBytes = sendDeltaTicks(objects, NELEMENTS(objects));
+
+    // Both ends have to enable delta encoding, the offer tells the flight end
+    UAVTalkEnableDeltaEncoding(flightCon);
+    UAVTalkEnableDeltaEncoding(gcsCon);
+    UAVTalkOfferAggregation(gcsCon);
+    vTaskDelay(100 / portTICK_RATE_MS);
+
+    UAVTalkResetStats(gcsCon);
+    uint32_t deltaBytes = sendDeltaTicks(objects, NELEMENTS(objects));
+    vTaskDelay(100 / portTICK_RATE_MS);
+    UAVTalkGetStats(gcsCon, &stats);
+    GPSPositionLatitudeGet(&latitude);
+
+    fprintf(stderr, "UAVTalkBench: SystemStats, GPSPosition and StabilizationSettings, %u data bytes per tick\n", objectBytes);
+    fprintf(stderr, "UAVTalkBench: aggregate packets %u bytes per tick, %u ticks/s at 57600 baud\n",
+            aggregateBytes / AGGREGATE_TICKS, RADIO_BYTES_PER_S * AGGREGATE_TICKS / aggregateBytes);
+    fprintf(stderr, "UAVTalkBench: delta encoded     %u bytes per tick, %u ticks/s at 57600 baud (%u packets received, %u errors, last Latitude %s)\n",
+            deltaBytes / AGGREGATE_TICKS, RADIO_BYTES_PER_S * AGGREGATE_TICKS / deltaBytes, stats.rxObjects, stats.rxErrors,
+            (latitude == 473765432 + AGGREGATE_TICKS - 1) ? "ok" : "wrong");
+    uint32_t objId;
+    uint32_t rawBytes;
+    uint32_t sentBytes;
+    for (uint8_t n = 0; UAVTalkGetDeltaStats(flightCon, n, &objId, &rawBytes, &sentBytes) == 0; n++) {
+        if (objId != 0) {
+            fprintf(stderr, "UAVTalkBench: object 0x%08X delta encoded to %u%% of %u bytes\n",
+                    objId, (uint32_t)((uint64_t)sentBytes * 100 / (rawBytes ? rawBytes : 1)), rawBytes);
+        }
+    }
+}
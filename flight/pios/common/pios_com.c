@@ -101,9 +101,20 @@ static struct pios_com_dev *PIOS_COM_alloc(void)
 
 static uint16_t PIOS_COM_TxOutCallback(uint32_t context, uint8_t *buf, uint16_t buf_len, uint16_t *headroom, bool *need_yield);
 static uint16_t PIOS_COM_RxInCallback(uint32_t context, uint8_t *buf, uint16_t buf_len, uint16_t *headroom, bool *need_yield);
+static uint16_t PIOS_COM_RxInSpan(uint32_t context, uint8_t **buf);
+static uint16_t PIOS_COM_RxInCommit(uint32_t context, uint16_t len, uint16_t *headroom, bool *need_yield);
+static uint16_t PIOS_COM_TxOutSpan(uint32_t context, uint8_t **buf);
+static uint16_t PIOS_COM_TxOutRelease(uint32_t context, uint16_t len, uint16_t *headroom, bool *need_yield);
 static void PIOS_COM_UnblockRx(struct pios_com_dev *com_dev, bool *need_yield);
 static void PIOS_COM_UnblockTx(struct pios_com_dev *com_dev, bool *need_yield);
 
+static const struct pios_com_span_ops pios_com_span_ops = {
+    .rx_in_span     = PIOS_COM_RxInSpan,
+    .rx_in_commit   = PIOS_COM_RxInCommit,
+    .tx_out_span    = PIOS_COM_TxOutSpan,
+    .tx_out_release = PIOS_COM_TxOutRelease,
+};
+
 /**
  * Initialises COM layer
  * \param[out] handle
@@ -156,6 +167,11 @@ int32_t PIOS_COM_Init(uint32_t *com_id, const struct pios_com_driver *driver, ui
         (com_dev->driver->bind_tx_cb)(lower_id, PIOS_COM_TxOutCallback, (uint32_t)com_dev);
     }
 
+    if (com_dev->driver->bind_span_ops && has_rx && has_tx) {
+        /* Let the driver use the fifos in place, its callbacks are all ours */
+        (com_dev->driver->bind_span_ops)(lower_id, &pios_com_span_ops);
+    }
+
     *com_id = (uint32_t)com_dev;
     return 0;
 
@@ -229,6 +245,7 @@ static uint16_t PIOS_COM_TxOutCallback(uint32_t context, uint8_t *buf, uint16_t
     PIOS_Assert(buf_len);
     PIOS_Assert(com_dev->has_tx);
 
+    fifoBuf_applyClear(&com_dev->tx);
     uint16_t bytes_from_fifo = fifoBuf_getData(&com_dev->tx, buf, buf_len);
 
     if (bytes_from_fifo > 0) {
@@ -243,6 +260,85 @@ static uint16_t PIOS_COM_TxOutCallback(uint32_t context, uint8_t *buf, uint16_t
     return bytes_from_fifo;
 }
 
+static uint16_t PIOS_COM_RxInSpan(uint32_t context, uint8_t **buf)
+{
+    struct pios_com_dev *com_dev = (struct pios_com_dev *)context;
+
+    bool valid = PIOS_COM_validate(com_dev);
+
+    PIOS_Assert(valid);
+    PIOS_Assert(com_dev->has_rx);
+
+    return fifoBuf_getWriteSpan(&com_dev->rx, buf);
+}
+
+static uint16_t PIOS_COM_RxInCommit(uint32_t context, uint16_t len, uint16_t *headroom, bool *need_yield)
+{
+    struct pios_com_dev *com_dev = (struct pios_com_dev *)context;
+
+    bool valid = PIOS_COM_validate(com_dev);
+
+    PIOS_Assert(valid);
+    PIOS_Assert(com_dev->has_rx);
+
+    uint16_t bytes_into_fifo = fifoBuf_getFree(&com_dev->rx);
+    if (bytes_into_fifo > len) {
+        bytes_into_fifo = len;
+    }
+    fifoBuf_commitData(&com_dev->rx, bytes_into_fifo);
+
+    if (bytes_into_fifo > 0) {
+        /* Data has been added to the buffer */
+        PIOS_COM_UnblockRx(com_dev, need_yield);
+    }
+
+    if (headroom) {
+        *headroom = fifoBuf_getFree(&com_dev->rx);
+    }
+
+    return bytes_into_fifo;
+}
+
+static uint16_t PIOS_COM_TxOutSpan(uint32_t context, uint8_t **buf)
+{
+    struct pios_com_dev *com_dev = (struct pios_com_dev *)context;
+
+    bool valid = PIOS_COM_validate(com_dev);
+
+    PIOS_Assert(valid);
+    PIOS_Assert(com_dev->has_tx);
+
+    fifoBuf_applyClear(&com_dev->tx);
+    return fifoBuf_getReadSpan(&com_dev->tx, buf);
+}
+
+static uint16_t PIOS_COM_TxOutRelease(uint32_t context, uint16_t len, uint16_t *headroom, bool *need_yield)
+{
+    struct pios_com_dev *com_dev = (struct pios_com_dev *)context;
+
+    bool valid = PIOS_COM_validate(com_dev);
+
+    PIOS_Assert(valid);
+    PIOS_Assert(com_dev->has_tx);
+
+    uint16_t bytes_from_fifo = fifoBuf_getUsed(&com_dev->tx);
+    if (bytes_from_fifo > len) {
+        bytes_from_fifo = len;
+    }
+    fifoBuf_removeData(&com_dev->tx, bytes_from_fifo);
+
+    if (bytes_from_fifo > 0) {
+        /* More space has been made in the buffer */
+        PIOS_COM_UnblockTx(com_dev, need_yield);
+    }
+
+    if (headroom) {
+        *headroom = fifoBuf_getUsed(&com_dev->tx);
+    }
+
+    return bytes_from_fifo;
+}
+
 /**
  * Change the port speed without re-initializing
  * \param[in] port COM port
@@ -295,13 +391,20 @@ int32_t PIOS_COM_SendBufferNonBlocking(uint32_t com_id, const uint8_t *buffer, u
          * Failure to do this results in stale data in the fifo as well as
          * possibly having the caller block trying to send to a device that's
          * no longer accepting data.
+         * The driver may still be sending from the fifo, so the data are
+         * dropped on its side the next time it takes data.
          */
-        fifoBuf_clearData(&com_dev->tx);
+        fifoBuf_requestClear(&com_dev->tx);
         return len;
     }
 
     if (len > fifoBuf_getFree(&com_dev->tx)) {
-        /* Buffer cannot accept all requested bytes (retry) */
+        /* Buffer cannot accept all requested bytes (retry), make sure the
+         * tx is running to free it, also of the data dropped on request */
+        if (com_dev->driver->tx_start) {
+            com_dev->driver->tx_start(com_dev->lower_id,
+                                      fifoBuf_getUsed(&com_dev->tx));
+        }
         return -2;
     }
 
@@ -30,6 +30,7 @@
 #ifdef PIOS_INCLUDE_FLASH
 
 #include <stdbool.h>
+#include <string.h> /* memset */
 #include <openpilot.h>
 #include <pios_math.h>
 #include <pios_wdg.h>
@@ -59,12 +60,43 @@ struct logfs_state {
     /* Underlying flash driver glue */
     const struct pios_flash_driver *driver;
     uintptr_t flash_id;
+
+    /* Key of the object held by every slot of the active arena, indexed
+     * by slot_id.  Only active slots carry a key (LOGFS_KEY_NONE otherwise)
+     * so object lookups only read the slot headers which match the key
+     * instead of walking the whole log in flash.  NULL when no RAM could
+     * be spared, in which case every lookup scans the log.
+     */
+    uint16_t *slot_keys;
 };
 
+#define LOGFS_KEY_NONE 0
+
 /*
  * Internal Utility functions
  */
 
+/**
+ * @brief Fold an object id and instance into the key stored in the slot index
+ * @return key of the object instance, never LOGFS_KEY_NONE
+ */
+static uint16_t logfs_object_key(uint32_t obj_id, uint16_t obj_inst_id)
+{
+    uint16_t key = (uint16_t)(obj_id ^ (obj_id >> 16)) ^ (uint16_t)(obj_inst_id * 0x9E37);
+
+    return (key == LOGFS_KEY_NONE) ? 1 : key;
+}
+
+/**
+ * @brief Record the key of the object held by a slot of the active arena
+ */
+static void logfs_set_slot_key(struct logfs_state *logfs, uint16_t slot_id, uint16_t key)
+{
+    if (logfs->slot_keys) {
+        logfs->slot_keys[slot_id] = key;
+    }
+}
+
 /**
  * @brief Return the offset in flash of a particular slot within an arena
  * @return address of the requested slot
@@ -435,7 +467,11 @@ static int32_t logfs_mount_log(struct logfs_state *logfs, uint8_t arena_id)
     logfs->num_free_slots   = 0;
     logfs->active_arena_id  = arena_id;
 
-    /* Scan the log to find out how full it is */
+    if (logfs->slot_keys) {
+        memset(logfs->slot_keys, LOGFS_KEY_NONE, (logfs->cfg->arena_size / logfs->cfg->slot_size) * sizeof(*logfs->slot_keys));
+    }
+
+    /* Scan the log to find out how full it is and rebuild the slot index */
     for (uint16_t slot_id = 1;
          slot_id < (logfs->cfg->arena_size / logfs->cfg->slot_size);
          slot_id++) {
@@ -461,6 +497,7 @@ static int32_t logfs_mount_log(struct logfs_state *logfs, uint8_t arena_id)
             break;
         case SLOT_STATE_ACTIVE:
             logfs->num_active_slots++;
+            logfs_set_slot_key(logfs, slot_id, logfs_object_key(slot_hdr.obj_id, slot_hdr.obj_inst_id));
             break;
         case SLOT_STATE_RESERVED:
         case SLOT_STATE_OBSOLETE:
@@ -490,13 +527,22 @@ static struct logfs_state *PIOS_FLASHFS_Logfs_alloc(void)
         return NULL;
     }
 
-    logfs->magic = PIOS_FLASHFS_LOGFS_DEV_MAGIC;
+    logfs->magic     = PIOS_FLASHFS_LOGFS_DEV_MAGIC;
+    logfs->slot_keys = NULL;
     return logfs;
 }
+static void PIOS_FLASHFS_Logfs_alloc_index(struct logfs_state *logfs)
+{
+    /* The index is an optimization only, carry on without it if the heap is short */
+    logfs->slot_keys = (uint16_t *)pvPortMalloc((logfs->cfg->arena_size / logfs->cfg->slot_size) * sizeof(*logfs->slot_keys));
+}
 static void PIOS_FLASHFS_Logfs_free(struct logfs_state *logfs)
 {
     /* Invalidate the magic */
     logfs->magic = ~PIOS_FLASHFS_LOGFS_DEV_MAGIC;
+    if (logfs->slot_keys) {
+        vPortFree(logfs->slot_keys);
+    }
     vPortFree(logfs);
 }
 #else
@@ -511,10 +557,15 @@ static struct logfs_state *PIOS_FLASHFS_Logfs_alloc(void)
     }
 
     logfs = &pios_flashfs_logfs_devs[pios_flashfs_logfs_num_devs++];
-    logfs->magic = PIOS_FLASHFS_LOGFS_DEV_MAGIC;
+    logfs->magic     = PIOS_FLASHFS_LOGFS_DEV_MAGIC;
+    logfs->slot_keys = NULL;
 
     return logfs;
 }
+static void PIOS_FLASHFS_Logfs_alloc_index(__attribute__((unused)) struct logfs_state *logfs)
+{
+    /* No heap to size the index from the configuration, lookups scan the log */
+}
 static void PIOS_FLASHFS_Logfs_free(struct logfs_state *logfs)
 {
     /* Invalidate the magic */
@@ -560,6 +611,8 @@ int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t *fs_id, const struct flashfs_logfs_cfg
     logfs->flash_id = flash_id; /* lower-level flash device id */
     logfs->mounted  = false;
 
+    PIOS_FLASHFS_Logfs_alloc_index(logfs);
+
     if (logfs->driver->start_transaction(logfs->flash_id) != 0) {
         rc = -1;
         goto out_exit;
@@ -714,9 +767,16 @@ static int16_t logfs_object_find_next(const struct logfs_state *logfs, struct sl
         *curr_slot = 1;
     }
 
-    for (uint16_t slot_id = *curr_slot;
-         slot_id < (logfs->cfg->arena_size / logfs->cfg->slot_size);
-         slot_id++) {
+    /* Slots past the end of the log are all empty */
+    uint16_t end_slot = (logfs->cfg->arena_size / logfs->cfg->slot_size) - logfs->num_free_slots;
+    uint16_t key = logfs_object_key(obj_id, obj_inst_id);
+
+    for (uint16_t slot_id = *curr_slot; slot_id < end_slot; slot_id++) {
+        if (logfs->slot_keys && logfs->slot_keys[slot_id] != key) {
+            /* Not active or holding another object, no need to look at the header */
+            continue;
+        }
+
         uintptr_t slot_addr = logfs_get_addr(logfs, logfs->active_arena_id, slot_id);
 
         if (logfs->driver->read_data(logfs->flash_id,
@@ -771,6 +831,7 @@ static int8_t logfs_delete_object(struct logfs_state *logfs, uint32_t obj_id, ui
             }
             /* Object has been successfully obsoleted and is no longer active */
             logfs->num_active_slots--;
+            logfs_set_slot_key(logfs, curr_slot_id, LOGFS_KEY_NONE);
             break;
         case -1:
             /* Search completed, object not found */
@@ -891,6 +952,7 @@ static int8_t logfs_append_to_log(struct logfs_state *logfs, uint32_t obj_id, ui
 
     /* Object has been successfully written to the slot */
     logfs->num_active_slots++;
+    logfs_set_slot_key(logfs, free_slot_id, logfs_object_key(obj_id, obj_inst_id));
     return 0;
 }
 
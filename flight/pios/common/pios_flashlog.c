@@ -0,0 +1,502 @@
+/**
+ ******************************************************************************
+ * @file       pios_flashlog.c
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2013.
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_FLASHLOG Flash Log Functions
+ * @{
+ * @brief Sequential block log for external NOR Flash
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#include "pios.h"
+
+#ifdef PIOS_INCLUDE_FLASH
+
+#include <stdbool.h>
+#include <openpilot.h>
+#include <pios_crc.h>
+#include "pios_flashlog.h"
+#include "pios_flashlog_priv.h"
+
+/*
+ * Log state data tracked in RAM
+ */
+
+enum pios_flashlog_dev_magic {
+    PIOS_FLASHLOG_DEV_MAGIC = 0x3A27C4D1,
+};
+
+struct flashlog_state {
+    enum pios_flashlog_dev_magic magic;
+    const struct flashlog_cfg    *cfg;
+
+    uint32_t num_blocks;
+    uint32_t next_block; /* first free block, num_blocks when the log is full */
+    uint16_t last_flight;
+
+    /* Underlying flash driver glue */
+    const struct pios_flash_driver *driver;
+    uintptr_t flash_id;
+};
+
+struct flashlog_block_header {
+    uint32_t magic;
+    uint16_t flight;
+    uint16_t length;
+    uint8_t  crc;
+    uint8_t  padding[3];
+} __attribute__((packed));
+
+/*
+ * Internal Utility functions
+ */
+
+/**
+ * @brief Return the offset in flash of a block
+ */
+static uintptr_t flashlog_block_addr(const struct flashlog_state *log, uint32_t block)
+{
+    PIOS_Assert(block < log->num_blocks);
+
+    return log->cfg->start_offset + block * log->cfg->block_size;
+}
+
+static bool flashlog_is_erased(const uint8_t *data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++) {
+        if (data[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Check that a whole block is erased
+ * @return 1 if erased, 0 if not or -1 if the flash could not be read
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t flashlog_block_erased(const struct flashlog_state *log, uint32_t block)
+{
+    uint8_t buf[32];
+    uintptr_t addr = flashlog_block_addr(log, block);
+
+    for (uint16_t offset = 0; offset < log->cfg->block_size; offset += sizeof(buf)) {
+        uint16_t len = log->cfg->block_size - offset;
+        if (len > sizeof(buf)) {
+            len = sizeof(buf);
+        }
+
+        if (log->driver->read_data(log->flash_id, addr + offset, buf, len) != 0) {
+            return -1;
+        }
+
+        if (!flashlog_is_erased(buf, len)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Find the end of the log, the first fully erased block. Blocks
+ * without a valid header, torn by a power loss while their header was
+ * written or left over by another user of the flash, are skipped.
+ * @return 0 if success or -1 if the flash could not be read
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t flashlog_scan(struct flashlog_state *log)
+{
+    struct flashlog_block_header header;
+    uint32_t block;
+
+    log->last_flight = 0;
+
+    for (block = 0; block < log->num_blocks; block++) {
+        if (log->driver->read_data(log->flash_id, flashlog_block_addr(log, block), (uint8_t *)&header, sizeof(header)) != 0) {
+            return -1;
+        }
+
+        if (header.magic == PIOS_FLASHLOG_BLOCK_MAGIC && header.length <= log->cfg->block_size - sizeof(header)) {
+            log->last_flight = header.flight;
+            continue;
+        }
+
+        if (flashlog_is_erased((uint8_t *)&header, sizeof(header))) {
+            int32_t erased = flashlog_block_erased(log, block);
+            if (erased < 0) {
+                return -1;
+            }
+            if (erased) {
+                break;
+            }
+        }
+    }
+
+    log->next_block = block;
+
+    return 0;
+}
+
+/**
+ * @brief Write data to flash without crossing page boundaries
+ * @return 0 if success or -1 if the flash could not be written
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t flashlog_write(const struct flashlog_state *log, uintptr_t addr, uint8_t *data, uint16_t len)
+{
+    while (len > 0) {
+        uint16_t chunk = log->cfg->page_size - (addr % log->cfg->page_size);
+        if (chunk > len) {
+            chunk = len;
+        }
+
+        if (log->driver->write_data(log->flash_id, addr, data, chunk) != 0) {
+            return -1;
+        }
+
+        addr += chunk;
+        data += chunk;
+        len  -= chunk;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Write a block, the header first so that a block torn by a power loss
+ * is still skipped when the log is scanned
+ * @return 0 if success or -1 if the flash could not be written
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t flashlog_write_block(const struct flashlog_state *log, uintptr_t addr, struct flashlog_block_header *header, uint8_t *data)
+{
+    if (log->driver->write_data(log->flash_id, addr, (uint8_t *)header, sizeof(*header)) != 0) {
+        return -1;
+    }
+
+    return flashlog_write(log, addr + sizeof(*header), data, header->length);
+}
+
+static bool PIOS_FLASHLOG_validate(const struct flashlog_state *log)
+{
+    return log && (log->magic == PIOS_FLASHLOG_DEV_MAGIC);
+}
+
+#if defined(PIOS_INCLUDE_FREERTOS)
+static struct flashlog_state *PIOS_FLASHLOG_alloc(void)
+{
+    struct flashlog_state *log;
+
+    log = (struct flashlog_state *)pvPortMalloc(sizeof(*log));
+    if (!log) {
+        return NULL;
+    }
+
+    log->magic = PIOS_FLASHLOG_DEV_MAGIC;
+    return log;
+}
+static void PIOS_FLASHLOG_free(struct flashlog_state *log)
+{
+    /* Invalidate the magic */
+    log->magic = ~PIOS_FLASHLOG_DEV_MAGIC;
+    vPortFree(log);
+}
+#else
+static struct flashlog_state pios_flashlog_dev;
+static struct flashlog_state *PIOS_FLASHLOG_alloc(void)
+{
+    if (pios_flashlog_dev.magic == PIOS_FLASHLOG_DEV_MAGIC) {
+        return NULL;
+    }
+
+    pios_flashlog_dev.magic = PIOS_FLASHLOG_DEV_MAGIC;
+    return &pios_flashlog_dev;
+}
+static void PIOS_FLASHLOG_free(struct flashlog_state *log)
+{
+    /* Invalidate the magic */
+    log->magic = ~PIOS_FLASHLOG_DEV_MAGIC;
+}
+#endif /* if defined(PIOS_INCLUDE_FREERTOS) */
+
+/**
+ * @brief Initialize the flight log and find its end
+ * @return 0 if success or error code
+ * @retval -1 if the log could not be allocated
+ * @retval -2 if the flash could not be read
+ */
+int32_t PIOS_FLASHLOG_Init(uintptr_t *log_id, const struct flashlog_cfg *cfg, const struct pios_flash_driver *driver, uintptr_t flash_id)
+{
+    PIOS_Assert(cfg);
+    PIOS_Assert(log_id);
+    PIOS_Assert(driver);
+
+    /* Blocks start on a page and never straddle two sectors */
+    PIOS_Assert(cfg->block_size > sizeof(struct flashlog_block_header));
+    PIOS_Assert((cfg->block_size % cfg->page_size) == 0);
+    PIOS_Assert((cfg->sector_size % cfg->block_size) == 0);
+    PIOS_Assert((cfg->start_offset % cfg->sector_size) == 0);
+    PIOS_Assert((cfg->total_size % cfg->sector_size) == 0);
+
+    /* Make sure the underlying flash driver provides the minimal set of required methods */
+    PIOS_Assert(driver->start_transaction);
+    PIOS_Assert(driver->end_transaction);
+    PIOS_Assert(driver->erase_sector);
+    PIOS_Assert(driver->write_data);
+    PIOS_Assert(driver->read_data);
+
+    int32_t rc;
+
+    struct flashlog_state *log;
+
+    log = PIOS_FLASHLOG_alloc();
+    if (!log) {
+        rc = -1;
+        goto out_exit;
+    }
+
+    /* Bind configuration parameters to this log instance */
+    log->cfg        = cfg;
+    log->driver     = driver;
+    log->flash_id   = flash_id;
+    log->num_blocks = cfg->total_size / cfg->block_size;
+
+    if (log->driver->start_transaction(log->flash_id) != 0) {
+        rc = -2;
+        goto out_free;
+    }
+
+    rc = flashlog_scan(log);
+
+    log->driver->end_transaction(log->flash_id);
+
+    if (rc != 0) {
+        rc = -2;
+        goto out_free;
+    }
+
+    *log_id = (uintptr_t)log;
+
+    return 0;
+
+out_free:
+    PIOS_FLASHLOG_free(log);
+
+out_exit:
+    return rc;
+}
+
+int32_t PIOS_FLASHLOG_Destroy(uintptr_t log_id)
+{
+    struct flashlog_state *log = (struct flashlog_state *)log_id;
+
+    if (!PIOS_FLASHLOG_validate(log)) {
+        return -1;
+    }
+
+    PIOS_FLASHLOG_free(log);
+
+    return 0;
+}
+
+/**
+ * @brief Write a block of data at the end of the log
+ * @param[in] log_id the log to write to
+ * @param[in] flight the flight the data belongs to
+ * @param[in] data the data to write
+ * @param[in] len the length of the data, at most the block size less the block header
+ * @return 0 if success or error code
+ * @retval -1 if log_id is not a valid log instance
+ * @retval -2 if the data does not fit in a block
+ * @retval -3 if the log is full
+ * @retval -4 if the flash could not be written, the block is lost
+ * @note The flash transaction lock is taken for one block only
+ */
+int32_t PIOS_FLASHLOG_Append(uintptr_t log_id, uint16_t flight, uint8_t *data, uint16_t len)
+{
+    struct flashlog_state *log = (struct flashlog_state *)log_id;
+
+    if (!PIOS_FLASHLOG_validate(log)) {
+        return -1;
+    }
+
+    if (len > log->cfg->block_size - sizeof(struct flashlog_block_header)) {
+        return -2;
+    }
+
+    if (log->next_block >= log->num_blocks) {
+        return -3;
+    }
+
+    struct flashlog_block_header header = {
+        .magic   = PIOS_FLASHLOG_BLOCK_MAGIC,
+        .flight  = flight,
+        .length  = len,
+        .crc     = PIOS_CRC_updateCRC(0, data, len),
+        .padding = { 0xFF, 0xFF, 0xFF },
+    };
+
+    if (log->driver->start_transaction(log->flash_id) != 0) {
+        return -4;
+    }
+
+    /* Blocks after the end of the log may hold left overs, skip them */
+    int32_t erased;
+    while ((erased = flashlog_block_erased(log, log->next_block)) == 0) {
+        if (++log->next_block >= log->num_blocks) {
+            log->driver->end_transaction(log->flash_id);
+            return -3;
+        }
+    }
+
+    /* A block that fails to be written is not erased, skip it */
+    int32_t rc = -1;
+    if (erased > 0) {
+        rc = flashlog_write_block(log, flashlog_block_addr(log, log->next_block++), &header, data);
+    }
+
+    log->driver->end_transaction(log->flash_id);
+
+    if (rc != 0) {
+        return -4;
+    }
+
+    log->last_flight = flight;
+
+    return 0;
+}
+
+/**
+ * @brief Read raw data from the log
+ * @param[in] log_id the log to read from
+ * @param[in] offset offset from the start of the log
+ * @param[out] data buffer for the data
+ * @param[in] len the length of the data to read
+ * @return 0 if success or error code
+ * @retval -1 if log_id is not a valid log instance
+ * @retval -2 if the data is out of the log
+ * @retval -3 if the flash could not be read
+ */
+int32_t PIOS_FLASHLOG_Read(uintptr_t log_id, uint32_t offset, uint8_t *data, uint16_t len)
+{
+    PIOS_Assert(data);
+
+    struct flashlog_state *log = (struct flashlog_state *)log_id;
+
+    if (!PIOS_FLASHLOG_validate(log)) {
+        return -1;
+    }
+
+    if (offset > log->cfg->total_size || len > log->cfg->total_size - offset) {
+        return -2;
+    }
+
+    if (log->driver->start_transaction(log->flash_id) != 0) {
+        return -3;
+    }
+
+    int32_t rc = log->driver->read_data(log->flash_id, log->cfg->start_offset + offset, data, len);
+
+    log->driver->end_transaction(log->flash_id);
+
+    return (rc == 0) ? 0 : -3;
+}
+
+/**
+ * @brief Erase the log
+ * @param[in] log_id the log to erase
+ * @return 0 if success or error code
+ * @retval -1 if log_id is not a valid log instance
+ * @retval -2 if the flash could not be erased
+ * @note Only the sectors holding blocks are erased, the flash transaction
+ * lock is taken for one sector at a time. The sectors are erased from the
+ * last one down, a power loss during the erase leaves a shorter log that
+ * ends in erased blocks instead of erased blocks followed by stale ones.
+ */
+int32_t PIOS_FLASHLOG_Erase(uintptr_t log_id)
+{
+    struct flashlog_state *log = (struct flashlog_state *)log_id;
+
+    if (!PIOS_FLASHLOG_validate(log)) {
+        return -1;
+    }
+
+    uint32_t used   = log->next_block * log->cfg->block_size;
+    uint32_t offset = ((used + log->cfg->sector_size - 1) / log->cfg->sector_size) * log->cfg->sector_size;
+
+    while (offset > 0) {
+        offset -= log->cfg->sector_size;
+
+        if (log->driver->start_transaction(log->flash_id) != 0) {
+            return -2;
+        }
+
+        int32_t rc = log->driver->erase_sector(log->flash_id, log->cfg->start_offset + offset);
+
+        log->driver->end_transaction(log->flash_id);
+
+        if (rc != 0) {
+            return -2;
+        }
+
+        /* The log now ends at the start of this sector */
+        if (log->next_block > offset / log->cfg->block_size) {
+            log->next_block = offset / log->cfg->block_size;
+        }
+    }
+
+    log->next_block  = 0;
+    log->last_flight = 0;
+
+    return 0;
+}
+
+/**
+ * @brief Get statistics about the log
+ * @param[in] log_id the log to query
+ * @param[out] stats the statistics
+ * @return 0 if success or -1 if log_id is not a valid log instance
+ */
+int32_t PIOS_FLASHLOG_GetStats(uintptr_t log_id, struct PIOS_FLASHLOG_Stats *stats)
+{
+    PIOS_Assert(stats);
+
+    struct flashlog_state *log = (struct flashlog_state *)log_id;
+
+    if (!PIOS_FLASHLOG_validate(log)) {
+        return -1;
+    }
+
+    stats->total_size  = log->num_blocks * log->cfg->block_size;
+    stats->used_size   = log->next_block * log->cfg->block_size;
+    stats->block_size  = log->cfg->block_size;
+    stats->last_flight = log->last_flight;
+
+    return 0;
+}
+
+#endif /* PIOS_INCLUDE_FLASH */
+
+/**
+ * @}
+ * @}
+ */
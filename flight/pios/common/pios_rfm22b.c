@@ -439,7 +439,7 @@ int32_t PIOS_RFM22B_Init(uint32_t *rfm22b_id, uint32_t spi_id, uint32_t slave_nu
 #endif /* PIOS_WDG_RFM22B */
 
     // Initialize the ECC library.
-    initialize_ecc();
+    initialize_ecc(&rfm22b_dev->ecc);
 
     // Set the state to initializing.
     rfm22b_dev->state = RADIO_STATE_UNINITIALIZED;
@@ -1794,7 +1794,7 @@ static enum pios_radio_event radio_txStart(struct pios_rfm22b_dev *radio_dev)
     // Add the error correcting code.
     if (!radio_dev->ppm_only_mode) {
         if (len != 0) {
-            encode_data((unsigned char *)p, len, (unsigned char *)p);
+            encode_data(&radio_dev->ecc, (unsigned char *)p, len, (unsigned char *)p);
         }
         len += RS_ECC_NPARITY;
     }
@@ -1872,11 +1872,10 @@ static enum pios_radio_event radio_receivePacket(struct pios_rfm22b_dev *radio_d
 
         // Attempt to correct any errors in the packet.
         if (data_len > 0) {
-            decode_data((unsigned char *)p, rx_len);
-            good_packet = check_syndrome() == 0;
+            good_packet = decode_data(&radio_dev->ecc, (unsigned char *)p, rx_len) == 0;
 
             // We have an error.  Try to correct it.
-            if (!good_packet && (correct_errors_erasures((unsigned char *)p, rx_len, 0, 0) != 0)) {
+            if (!good_packet && (correct_errors_erasures(&radio_dev->ecc, (unsigned char *)p, rx_len, 0, 0) != 0)) {
                 // We corrected it
                 corrected_packet = true;
             }
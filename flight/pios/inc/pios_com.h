@@ -36,6 +36,20 @@
 
 typedef uint16_t (*pios_com_callback)(uint32_t context, uint8_t *buf, uint16_t buf_len, uint16_t *headroom, bool *task_woken);
 
+/*
+ * Zero copy access of a driver to the buffers of the layer it is bound to, called with the
+ * context of its callbacks. The driver receives straight into the span returned by rx_in_span()
+ * and adds the bytes with rx_in_commit(), it transmits straight from the span returned by
+ * tx_out_span() and removes the bytes with tx_out_release(). They are only bound to drivers
+ * carrying both directions of the layer, so that all the callbacks of the driver are its own.
+ */
+struct pios_com_span_ops {
+    uint16_t (*rx_in_span)(uint32_t context, uint8_t **buf);
+    uint16_t (*rx_in_commit)(uint32_t context, uint16_t len, uint16_t *headroom, bool *task_woken);
+    uint16_t (*tx_out_span)(uint32_t context, uint8_t **buf);
+    uint16_t (*tx_out_release)(uint32_t context, uint16_t len, uint16_t *headroom, bool *task_woken);
+};
+
 struct pios_com_driver {
     void (*init)(uint32_t id);
     void (*set_baud)(uint32_t id, uint32_t baud);
@@ -44,6 +58,7 @@ struct pios_com_driver {
     void (*bind_rx_cb)(uint32_t id, pios_com_callback rx_in_cb, uint32_t context);
     void (*bind_tx_cb)(uint32_t id, pios_com_callback tx_out_cb, uint32_t context);
     bool (*available)(uint32_t id);
+    void (*bind_span_ops)(uint32_t id, const struct pios_com_span_ops *span_ops);
 };
 
 /* Public Functions */
@@ -0,0 +1,59 @@
+/**
+ ******************************************************************************
+ * @file       pios_flashlog.h
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2013.
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_FLASHLOG Flash Log Functions
+ * @{
+ * @brief Sequential block log for external NOR Flash
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PIOS_FLASHLOG_H
+#define PIOS_FLASHLOG_H
+
+#include <stdint.h>
+
+/*
+ * The log is a sequence of blocks of block_size bytes, each one starting on a
+ * page boundary with a header followed by the data. The header is little endian:
+ *   uint32 magic (PIOS_FLASHLOG_BLOCK_MAGIC), uint16 flight, uint16 data length,
+ *   uint8 crc8 of the data, 3 bytes of padding
+ * The first block whose header is erased is the end of the log.
+ */
+#define PIOS_FLASHLOG_BLOCK_MAGIC       0x4C46504F /* "OPFL" */
+#define PIOS_FLASHLOG_BLOCK_HEADER_SIZE 12
+
+struct PIOS_FLASHLOG_Stats {
+    uint32_t total_size; /* bytes available for blocks */
+    uint32_t used_size; /* bytes taken by the blocks written */
+    uint16_t block_size; /* size of a block, header included */
+    uint16_t last_flight; /* flight of the last block written, 0 if the log is empty */
+};
+
+int32_t PIOS_FLASHLOG_Append(uintptr_t log_id, uint16_t flight, uint8_t *data, uint16_t len);
+int32_t PIOS_FLASHLOG_Read(uintptr_t log_id, uint32_t offset, uint8_t *data, uint16_t len);
+int32_t PIOS_FLASHLOG_Erase(uintptr_t log_id);
+int32_t PIOS_FLASHLOG_GetStats(uintptr_t log_id, struct PIOS_FLASHLOG_Stats *stats);
+
+#endif /* PIOS_FLASHLOG_H */
+
+/**
+ * @}
+ * @}
+ */
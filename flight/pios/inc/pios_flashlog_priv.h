@@ -0,0 +1,51 @@
+/**
+ ******************************************************************************
+ * @file       pios_flashlog_priv.h
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2013.
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_FLASHLOG Flash Log Functions
+ * @{
+ * @brief Sequential block log for external NOR Flash
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PIOS_FLASHLOG_PRIV_H
+#define PIOS_FLASHLOG_PRIV_H
+
+#include <stdint.h>
+#include "pios_flash.h" /* struct pios_flash_driver */
+
+struct flashlog_cfg {
+    uint32_t start_offset; /* Offset into flash where the log starts, sector aligned */
+    uint32_t total_size; /* Size of the log, a multiple of the sector size */
+    uint32_t block_size; /* Size of a log block, a multiple of the page size */
+
+    uint32_t sector_size; /* Size of a flash erase block */
+    uint32_t page_size; /* Maximum flash burst write size */
+};
+
+int32_t PIOS_FLASHLOG_Init(uintptr_t *log_id, const struct flashlog_cfg *cfg, const struct pios_flash_driver *driver, uintptr_t flash_id);
+
+int32_t PIOS_FLASHLOG_Destroy(uintptr_t log_id);
+
+#endif /* PIOS_FLASHLOG_PRIV_H */
+
+/**
+ * @}
+ * @}
+ */
@@ -35,6 +35,7 @@
 #include <fifo_buffer.h>
 #include <uavobjectmanager.h>
 #include <oplinkstatus.h>
+#include <ecc.h>
 #include "pios_rfm22b.h"
 
 // ************************************
@@ -734,6 +735,9 @@ struct pios_rfm22b_dev {
     // The tx packet sequence number
     uint16_t tx_seq;
 
+    // The error correcting code of the packets
+    struct rs_ecc ecc;
+
     // The rx data packet
     uint8_t  rx_packet[RFM22B_MAX_PACKET_LEN];
     // The rx data packet
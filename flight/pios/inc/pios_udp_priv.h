@@ -63,6 +63,8 @@ typedef struct {
     uint32_t tx_out_context;
     pios_com_callback  rx_in_cb;
     uint32_t rx_in_context;
+    const struct pios_com_span_ops *span_ops;
+    uint32_t tx_busy;
 
     uint8_t  rx_buffer[PIOS_UDP_RX_BUFFER_SIZE];
     uint8_t  tx_buffer[PIOS_UDP_RX_BUFFER_SIZE];
@@ -277,8 +277,10 @@
 #ifdef PIOS_INCLUDE_FLASH
 /* #define PIOS_INCLUDE_FLASH_LOGFS_SETTINGS */
 /* #define FLASH_FREERTOS */
+/* #define PIOS_INCLUDE_FLASH_LOG */
 #include <pios_flash.h>
 #include <pios_flashfs.h>
+#include <pios_flashlog.h>
 #endif
 
 /* driver for storage on internal flash */
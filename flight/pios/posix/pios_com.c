@@ -108,9 +108,20 @@ static struct pios_com_dev *PIOS_COM_find_dev(uint32_t com_dev_id)
 
 static uint16_t PIOS_COM_TxOutCallback(uint32_t context, uint8_t *buf, uint16_t buf_len, uint16_t *headroom, bool *need_yield);
 static uint16_t PIOS_COM_RxInCallback(uint32_t context, uint8_t *buf, uint16_t buf_len, uint16_t *headroom, bool *need_yield);
+static uint16_t PIOS_COM_RxInSpan(uint32_t context, uint8_t **buf);
+static uint16_t PIOS_COM_RxInCommit(uint32_t context, uint16_t len, uint16_t *headroom, bool *need_yield);
+static uint16_t PIOS_COM_TxOutSpan(uint32_t context, uint8_t **buf);
+static uint16_t PIOS_COM_TxOutRelease(uint32_t context, uint16_t len, uint16_t *headroom, bool *need_yield);
 static void PIOS_COM_UnblockRx(struct pios_com_dev *com_dev, bool *need_yield);
 static void PIOS_COM_UnblockTx(struct pios_com_dev *com_dev, bool *need_yield);
 
+static const struct pios_com_span_ops pios_com_span_ops = {
+    .rx_in_span     = PIOS_COM_RxInSpan,
+    .rx_in_commit   = PIOS_COM_RxInCommit,
+    .tx_out_span    = PIOS_COM_TxOutSpan,
+    .tx_out_release = PIOS_COM_TxOutRelease,
+};
+
 /**
  * Initialises COM layer
  * \param[out] handle
@@ -165,6 +176,11 @@ int32_t PIOS_COM_Init(uint32_t *com_id, const struct pios_com_driver *driver, ui
         (com_dev->driver->bind_tx_cb)(lower_id, PIOS_COM_TxOutCallback, com_dev_id);
     }
 
+    if (com_dev->driver->bind_span_ops && has_rx && has_tx) {
+        /* Let the driver use the fifos in place, its callbacks are all ours */
+        (com_dev->driver->bind_span_ops)(lower_id, &pios_com_span_ops);
+    }
+
     *com_id = com_dev_id;
     return 0;
 
@@ -213,9 +229,7 @@ static uint16_t PIOS_COM_RxInCallback(uint32_t context, uint8_t *buf, uint16_t b
     PIOS_Assert(valid);
     PIOS_Assert(com_dev->has_rx);
 
-    PIOS_IRQ_Disable();
     uint16_t bytes_into_fifo = fifoBuf_putData(&com_dev->rx, buf, buf_len);
-    PIOS_IRQ_Enable();
 
     if (bytes_into_fifo > 0) {
         /* Data has been added to the buffer */
@@ -256,6 +270,84 @@ static uint16_t PIOS_COM_TxOutCallback(uint32_t context, uint8_t *buf, uint16_t
     return bytes_from_fifo;
 }
 
+static uint16_t PIOS_COM_RxInSpan(uint32_t context, uint8_t **buf)
+{
+    struct pios_com_dev *com_dev = PIOS_COM_find_dev(context);
+
+    bool valid = PIOS_COM_validate(com_dev);
+
+    PIOS_Assert(valid);
+    PIOS_Assert(com_dev->has_rx);
+
+    return fifoBuf_getWriteSpan(&com_dev->rx, buf);
+}
+
+static uint16_t PIOS_COM_RxInCommit(uint32_t context, uint16_t len, uint16_t *headroom, bool *need_yield)
+{
+    struct pios_com_dev *com_dev = PIOS_COM_find_dev(context);
+
+    bool valid = PIOS_COM_validate(com_dev);
+
+    PIOS_Assert(valid);
+    PIOS_Assert(com_dev->has_rx);
+
+    uint16_t bytes_into_fifo = fifoBuf_getFree(&com_dev->rx);
+    if (bytes_into_fifo > len) {
+        bytes_into_fifo = len;
+    }
+    fifoBuf_commitData(&com_dev->rx, bytes_into_fifo);
+
+    if (bytes_into_fifo > 0) {
+        /* Data has been added to the buffer */
+        PIOS_COM_UnblockRx(com_dev, need_yield);
+    }
+
+    if (headroom) {
+        *headroom = fifoBuf_getFree(&com_dev->rx);
+    }
+
+    return bytes_into_fifo;
+}
+
+static uint16_t PIOS_COM_TxOutSpan(uint32_t context, uint8_t **buf)
+{
+    struct pios_com_dev *com_dev = PIOS_COM_find_dev(context);
+
+    bool valid = PIOS_COM_validate(com_dev);
+
+    PIOS_Assert(valid);
+    PIOS_Assert(com_dev->has_tx);
+
+    return fifoBuf_getReadSpan(&com_dev->tx, buf);
+}
+
+static uint16_t PIOS_COM_TxOutRelease(uint32_t context, uint16_t len, uint16_t *headroom, bool *need_yield)
+{
+    struct pios_com_dev *com_dev = PIOS_COM_find_dev(context);
+
+    bool valid = PIOS_COM_validate(com_dev);
+
+    PIOS_Assert(valid);
+    PIOS_Assert(com_dev->has_tx);
+
+    uint16_t bytes_from_fifo = fifoBuf_getUsed(&com_dev->tx);
+    if (bytes_from_fifo > len) {
+        bytes_from_fifo = len;
+    }
+    fifoBuf_removeData(&com_dev->tx, bytes_from_fifo);
+
+    if (bytes_from_fifo > 0) {
+        /* More space has been made in the buffer */
+        PIOS_COM_UnblockTx(com_dev, need_yield);
+    }
+
+    if (headroom) {
+        *headroom = fifoBuf_getUsed(&com_dev->tx);
+    }
+
+    return bytes_from_fifo;
+}
+
 /**
  * Change the port speed without re-initializing
  * \param[in] port COM port
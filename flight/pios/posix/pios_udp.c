@@ -47,6 +47,7 @@ static pios_udp_dev pios_udp_devices[PIOS_UDP_MAX_DEV];
 static void PIOS_UDP_ChangeBaud(uint32_t udp_id, uint32_t baud);
 static void PIOS_UDP_RegisterRxCallback(uint32_t udp_id, pios_com_callback rx_in_cb, uint32_t context);
 static void PIOS_UDP_RegisterTxCallback(uint32_t udp_id, pios_com_callback tx_out_cb, uint32_t context);
+static void PIOS_UDP_RegisterSpanOps(uint32_t udp_id, const struct pios_com_span_ops *span_ops);
 static void PIOS_UDP_TxStart(uint32_t udp_id, uint16_t tx_bytes_avail);
 static void PIOS_UDP_RxStart(uint32_t udp_id, uint16_t rx_bytes_avail);
 
@@ -56,6 +57,7 @@ const struct pios_com_driver pios_udp_com_driver = {
     .rx_start   = PIOS_UDP_RxStart,
     .bind_tx_cb = PIOS_UDP_RegisterTxCallback,
     .bind_rx_cb = PIOS_UDP_RegisterRxCallback,
+    .bind_span_ops = PIOS_UDP_RegisterSpanOps,
 };
 
 
@@ -87,27 +89,57 @@ void *PIOS_UDP_RxThread(void *udp_dev_n)
          * receive
          */
         int received;
-        udp_dev->clientLength = sizeof(udp_dev->client);
-        if ((received = recvfrom(udp_dev->socket,
-                                 &udp_dev->rx_buffer,
-                                 PIOS_UDP_RX_BUFFER_SIZE,
-                                 0,
-                                 (struct sockaddr *)&udp_dev->client,
-                                 (socklen_t *)&udp_dev->clientLength)) >= 0) {
-            /* copy received data to buffer if possible */
-            /* we do NOT buffer data locally. If the com buffer can't receive, data is discarded! */
-            /* (thats what the USART driver does too!) */
-            bool rx_need_yield = false;
-            if (udp_dev->rx_in_cb) {
-                (void)(udp_dev->rx_in_cb)(udp_dev->rx_in_context, udp_dev->rx_buffer, received, NULL, &rx_need_yield);
+        bool rx_need_yield = false;
+        const struct pios_com_span_ops *span_ops = udp_dev->span_ops;
+        if (span_ops && udp_dev->rx_in_cb) {
+            /*
+             * receive straight into the com buffer, what does not fit in its contiguous
+             * free space ends up in our buffer and is copied after it
+             */
+            struct iovec iov[2];
+            struct msghdr msg;
+            uint8_t *span;
+            uint16_t span_len = (span_ops->rx_in_span)(udp_dev->rx_in_context, &span);
+            iov[0].iov_base    = span;
+            iov[0].iov_len     = span_len;
+            iov[1].iov_base    = udp_dev->rx_buffer;
+            iov[1].iov_len     = PIOS_UDP_RX_BUFFER_SIZE;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_name       = &udp_dev->client;
+            msg.msg_namelen    = sizeof(udp_dev->client);
+            msg.msg_iov        = iov;
+            msg.msg_iovlen     = 2;
+            if ((received = recvmsg(udp_dev->socket, &msg, 0)) >= 0) {
+                udp_dev->clientLength = msg.msg_namelen;
+                if (received > span_len) {
+                    (void)(span_ops->rx_in_commit)(udp_dev->rx_in_context, span_len, NULL, &rx_need_yield);
+                    (void)(udp_dev->rx_in_cb)(udp_dev->rx_in_context, udp_dev->rx_buffer, received - span_len, NULL, &rx_need_yield);
+                } else {
+                    (void)(span_ops->rx_in_commit)(udp_dev->rx_in_context, received, NULL, &rx_need_yield);
+                }
+            }
+        } else {
+            udp_dev->clientLength = sizeof(udp_dev->client);
+            if ((received = recvfrom(udp_dev->socket,
+                                     &udp_dev->rx_buffer,
+                                     PIOS_UDP_RX_BUFFER_SIZE,
+                                     0,
+                                     (struct sockaddr *)&udp_dev->client,
+                                     (socklen_t *)&udp_dev->clientLength)) >= 0) {
+                /* copy received data to buffer if possible */
+                /* we do NOT buffer data locally. If the com buffer can't receive, data is discarded! */
+                /* (thats what the USART driver does too!) */
+                if (udp_dev->rx_in_cb) {
+                    (void)(udp_dev->rx_in_cb)(udp_dev->rx_in_context, udp_dev->rx_buffer, received, NULL, &rx_need_yield);
+                }
             }
+        }
 
 #if defined(PIOS_INCLUDE_FREERTOS)
-            if (rx_need_yield) {
-                vPortYieldFromISR();
-            }
-#endif /* PIOS_INCLUDE_FREERTOS */
+        if (rx_need_yield) {
+            vPortYieldFromISR();
         }
+#endif /* PIOS_INCLUDE_FREERTOS */
     }
 }
 
@@ -125,6 +157,8 @@ int32_t PIOS_UDP_Init(uint32_t *udp_id, const struct pios_udp_cfg *cfg)
     /* initialize */
     udp_dev->rx_in_cb  = NULL;
     udp_dev->tx_out_cb = NULL;
+    udp_dev->span_ops  = NULL;
+    udp_dev->tx_busy   = 0;
     udp_dev->cfg    = cfg;
 
     /* assign socket */
@@ -180,7 +214,30 @@ static void PIOS_UDP_TxStart(uint32_t udp_id, uint16_t tx_bytes_avail)
     /**
      * we send everything directly whenever notified of data to send (lazy!)
      */
-    if (udp_dev->tx_out_cb) {
+    const struct pios_com_span_ops *span_ops = udp_dev->span_ops;
+    if (span_ops && udp_dev->tx_out_cb) {
+        /*
+         * send straight from the com buffer, one task at a time: a task finding another
+         * one sending leaves its data to it, the sender checks for more before leaving
+         */
+        while (!__sync_lock_test_and_set(&udp_dev->tx_busy, 1)) {
+            uint8_t *span;
+            while ((length = (span_ops->tx_out_span)(udp_dev->tx_out_context, &span)) > 0) {
+                bool tx_need_yield = false;
+                if (length > PIOS_UDP_RX_BUFFER_SIZE) {
+                    length = PIOS_UDP_RX_BUFFER_SIZE;
+                }
+                (void)sendto(udp_dev->socket, span, length, 0,
+                             (struct sockaddr *)&udp_dev->client,
+                             sizeof(udp_dev->client));
+                (void)(span_ops->tx_out_release)(udp_dev->tx_out_context, length, NULL, &tx_need_yield);
+            }
+            __sync_lock_release(&udp_dev->tx_busy);
+            if ((span_ops->tx_out_span)(udp_dev->tx_out_context, &span) == 0) {
+                break;
+            }
+        }
+    } else if (udp_dev->tx_out_cb) {
         while (tx_bytes_avail > 0) {
             bool tx_need_yield = false;
             length = (udp_dev->tx_out_cb)(udp_dev->tx_out_context, udp_dev->tx_buffer, PIOS_UDP_RX_BUFFER_SIZE, NULL, &tx_need_yield);
@@ -228,5 +285,14 @@ static void PIOS_UDP_RegisterTxCallback(uint32_t udp_id, pios_com_callback tx_ou
     udp_dev->tx_out_cb = tx_out_cb;
 }
 
+static void PIOS_UDP_RegisterSpanOps(uint32_t udp_id, const struct pios_com_span_ops *span_ops)
+{
+    pios_udp_dev *udp_dev = find_udp_dev_by_id(udp_id);
+
+    PIOS_Assert(udp_dev);
+
+    udp_dev->span_ops = span_ops;
+}
+
 
 #endif /* if defined(PIOS_INCLUDE_UDP) */
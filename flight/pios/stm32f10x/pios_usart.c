@@ -38,15 +38,17 @@
 static void PIOS_USART_ChangeBaud(uint32_t usart_id, uint32_t baud);
 static void PIOS_USART_RegisterRxCallback(uint32_t usart_id, pios_com_callback rx_in_cb, uint32_t context);
 static void PIOS_USART_RegisterTxCallback(uint32_t usart_id, pios_com_callback tx_out_cb, uint32_t context);
+static void PIOS_USART_RegisterSpanOps(uint32_t usart_id, const struct pios_com_span_ops *span_ops);
 static void PIOS_USART_TxStart(uint32_t usart_id, uint16_t tx_bytes_avail);
 static void PIOS_USART_RxStart(uint32_t usart_id, uint16_t rx_bytes_avail);
 
 const struct pios_com_driver pios_usart_com_driver = {
-    .set_baud   = PIOS_USART_ChangeBaud,
-    .tx_start   = PIOS_USART_TxStart,
-    .rx_start   = PIOS_USART_RxStart,
-    .bind_tx_cb = PIOS_USART_RegisterTxCallback,
-    .bind_rx_cb = PIOS_USART_RegisterRxCallback,
+    .set_baud      = PIOS_USART_ChangeBaud,
+    .tx_start      = PIOS_USART_TxStart,
+    .rx_start      = PIOS_USART_RxStart,
+    .bind_tx_cb    = PIOS_USART_RegisterTxCallback,
+    .bind_rx_cb    = PIOS_USART_RegisterRxCallback,
+    .bind_span_ops = PIOS_USART_RegisterSpanOps,
 };
 
 enum pios_usart_dev_magic {
@@ -61,6 +63,7 @@ struct pios_usart_dev {
     uint32_t rx_in_context;
     pios_com_callback tx_out_cb;
     uint32_t tx_out_context;
+    const struct pios_com_span_ops *span_ops;
 
     uint32_t rx_dropped;
 };
@@ -281,6 +284,17 @@ static void PIOS_USART_RegisterTxCallback(uint32_t usart_id, pios_com_callback t
     usart_dev->tx_out_cb = tx_out_cb;
 }
 
+static void PIOS_USART_RegisterSpanOps(uint32_t usart_id, const struct pios_com_span_ops *span_ops)
+{
+    struct pios_usart_dev *usart_dev = (struct pios_usart_dev *)usart_id;
+
+    bool valid = PIOS_USART_validate(usart_dev);
+
+    PIOS_Assert(valid);
+
+    usart_dev->span_ops = span_ops;
+}
+
 static void PIOS_USART_generic_irq_handler(uint32_t usart_id)
 {
     struct pios_usart_dev *usart_dev = (struct pios_usart_dev *)usart_id;
@@ -298,8 +312,15 @@ static void PIOS_USART_generic_irq_handler(uint32_t usart_id)
     if (sr & USART_SR_RXNE) {
         uint8_t byte = dr;
         if (usart_dev->rx_in_cb) {
-            uint16_t rc;
-            rc = (usart_dev->rx_in_cb)(usart_dev->rx_in_context, &byte, 1, NULL, &rx_need_yield);
+            uint16_t rc = 0;
+            uint8_t *span;
+            if (!usart_dev->span_ops) {
+                rc = (usart_dev->rx_in_cb)(usart_dev->rx_in_context, &byte, 1, NULL, &rx_need_yield);
+            } else if ((usart_dev->span_ops->rx_in_span)(usart_dev->rx_in_context, &span) > 0) {
+                /* Store the byte straight into the com buffer */
+                *span = byte;
+                rc = (usart_dev->span_ops->rx_in_commit)(usart_dev->rx_in_context, 1, NULL, &rx_need_yield);
+            }
             if (rc < 1) {
                 /* Lost bytes on rx */
                 usart_dev->rx_dropped += 1;
@@ -314,7 +335,17 @@ static void PIOS_USART_generic_irq_handler(uint32_t usart_id)
             uint8_t b;
             uint16_t bytes_to_send;
 
-            bytes_to_send = (usart_dev->tx_out_cb)(usart_dev->tx_out_context, &b, 1, NULL, &tx_need_yield);
+            if (usart_dev->span_ops) {
+                /* Take the byte straight from the com buffer */
+                uint8_t *span;
+                bytes_to_send = (usart_dev->span_ops->tx_out_span)(usart_dev->tx_out_context, &span);
+                if (bytes_to_send > 0) {
+                    b = *span;
+                    bytes_to_send = (usart_dev->span_ops->tx_out_release)(usart_dev->tx_out_context, 1, NULL, &tx_need_yield);
+                }
+            } else {
+                bytes_to_send = (usart_dev->tx_out_cb)(usart_dev->tx_out_context, &b, 1, NULL, &tx_need_yield);
+            }
 
             if (bytes_to_send > 0) {
                 /* Send the byte we've been given */
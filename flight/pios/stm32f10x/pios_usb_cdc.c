@@ -44,13 +44,15 @@ static void PIOS_USB_CDC_RegisterRxCallback(uint32_t usbcdc_id, pios_com_callbac
 static void PIOS_USB_CDC_TxStart(uint32_t usbcdc_id, uint16_t tx_bytes_avail);
 static void PIOS_USB_CDC_RxStart(uint32_t usbcdc_id, uint16_t rx_bytes_avail);
 static bool PIOS_USB_CDC_Available(uint32_t usbcdc_id);
+static void PIOS_USB_CDC_RegisterSpanOps(uint32_t usbcdc_id, const struct pios_com_span_ops *span_ops);
 
 const struct pios_com_driver pios_usb_cdc_com_driver = {
-    .tx_start   = PIOS_USB_CDC_TxStart,
-    .rx_start   = PIOS_USB_CDC_RxStart,
-    .bind_tx_cb = PIOS_USB_CDC_RegisterTxCallback,
-    .bind_rx_cb = PIOS_USB_CDC_RegisterRxCallback,
-    .available  = PIOS_USB_CDC_Available,
+    .tx_start      = PIOS_USB_CDC_TxStart,
+    .rx_start      = PIOS_USB_CDC_RxStart,
+    .bind_tx_cb    = PIOS_USB_CDC_RegisterTxCallback,
+    .bind_rx_cb    = PIOS_USB_CDC_RegisterRxCallback,
+    .available     = PIOS_USB_CDC_Available,
+    .bind_span_ops = PIOS_USB_CDC_RegisterSpanOps,
 };
 
 enum pios_usb_cdc_dev_magic {
@@ -67,6 +69,7 @@ struct pios_usb_cdc_dev {
     uint32_t rx_in_context;
     pios_com_callback tx_out_cb;
     uint32_t tx_out_context;
+    const struct pios_com_span_ops *span_ops;
 
     uint8_t  rx_packet_buffer[PIOS_USB_BOARD_CDC_DATA_LENGTH];
     /*
@@ -193,6 +196,17 @@ static void PIOS_USB_CDC_RegisterTxCallback(uint32_t usbcdc_id, pios_com_callbac
     usb_cdc_dev->tx_out_cb = tx_out_cb;
 }
 
+static void PIOS_USB_CDC_RegisterSpanOps(uint32_t usbcdc_id, const struct pios_com_span_ops *span_ops)
+{
+    struct pios_usb_cdc_dev *usb_cdc_dev = (struct pios_usb_cdc_dev *)usbcdc_id;
+
+    bool valid = PIOS_USB_CDC_validate(usb_cdc_dev);
+
+    PIOS_Assert(valid);
+
+    usb_cdc_dev->span_ops = span_ops;
+}
+
 static void PIOS_USB_CDC_RxStart(uint32_t usbcdc_id, uint16_t rx_bytes_avail)
 {
     struct pios_usb_cdc_dev *usb_cdc_dev = (struct pios_usb_cdc_dev *)usbcdc_id;
@@ -223,18 +237,35 @@ static void PIOS_USB_CDC_SendData(struct pios_usb_cdc_dev *usb_cdc_dev)
     }
 
     bool need_yield = false;
-    bytes_to_tx = (usb_cdc_dev->tx_out_cb)(usb_cdc_dev->tx_out_context,
-                                           usb_cdc_dev->tx_packet_buffer,
-                                           sizeof(usb_cdc_dev->tx_packet_buffer),
-                                           NULL,
-                                           &need_yield);
-    if (bytes_to_tx == 0) {
-        return;
+    if (usb_cdc_dev->span_ops) {
+        /* Copy straight from the com buffer to the packet memory */
+        uint8_t *span;
+        bytes_to_tx = (usb_cdc_dev->span_ops->tx_out_span)(usb_cdc_dev->tx_out_context, &span);
+        if (bytes_to_tx > sizeof(usb_cdc_dev->tx_packet_buffer)) {
+            bytes_to_tx = sizeof(usb_cdc_dev->tx_packet_buffer);
+        }
+        if (bytes_to_tx == 0) {
+            return;
+        }
+
+        UserToPMABufferCopy(span,
+                            GetEPTxAddr(usb_cdc_dev->cfg->data_tx_ep),
+                            bytes_to_tx);
+        (void)(usb_cdc_dev->span_ops->tx_out_release)(usb_cdc_dev->tx_out_context, bytes_to_tx, NULL, &need_yield);
+    } else {
+        bytes_to_tx = (usb_cdc_dev->tx_out_cb)(usb_cdc_dev->tx_out_context,
+                                               usb_cdc_dev->tx_packet_buffer,
+                                               sizeof(usb_cdc_dev->tx_packet_buffer),
+                                               NULL,
+                                               &need_yield);
+        if (bytes_to_tx == 0) {
+            return;
+        }
+
+        UserToPMABufferCopy(usb_cdc_dev->tx_packet_buffer,
+                            GetEPTxAddr(usb_cdc_dev->cfg->data_tx_ep),
+                            bytes_to_tx);
     }
-
-    UserToPMABufferCopy(usb_cdc_dev->tx_packet_buffer,
-                        GetEPTxAddr(usb_cdc_dev->cfg->data_tx_ep),
-                        bytes_to_tx);
     SetEPTxCount(usb_cdc_dev->cfg->data_tx_ep, bytes_to_tx);
     SetEPTxValid(usb_cdc_dev->cfg->data_tx_ep);
 
@@ -293,11 +324,6 @@ static void PIOS_USB_CDC_DATA_EP_OUT_Callback(void)
         DataLength = sizeof(usb_cdc_dev->rx_packet_buffer);
     }
 
-    /* Use the memory interface function to read from the selected endpoint */
-    PMAToUserBufferCopy((uint8_t *)usb_cdc_dev->rx_packet_buffer,
-                        GetEPRxAddr(usb_cdc_dev->cfg->data_rx_ep),
-                        DataLength);
-
     if (!usb_cdc_dev->rx_in_cb) {
         /* No Rx call back registered, disable the receiver */
         SetEPRxStatus(usb_cdc_dev->cfg->data_rx_ep, EP_RX_NAK);
@@ -307,11 +333,28 @@ static void PIOS_USB_CDC_DATA_EP_OUT_Callback(void)
     uint16_t headroom;
     bool need_yield = false;
     uint16_t rc;
-    rc = (usb_cdc_dev->rx_in_cb)(usb_cdc_dev->rx_in_context,
-                                 usb_cdc_dev->rx_packet_buffer,
-                                 DataLength,
-                                 &headroom,
-                                 &need_yield);
+    uint8_t *span;
+    if (usb_cdc_dev->span_ops &&
+        (usb_cdc_dev->span_ops->rx_in_span)(usb_cdc_dev->rx_in_context, &span) >= sizeof(usb_cdc_dev->rx_packet_buffer)) {
+        /* Copy straight from the packet memory to the com buffer, which may take a whole packet */
+        PMAToUserBufferCopy(span,
+                            GetEPRxAddr(usb_cdc_dev->cfg->data_rx_ep),
+                            DataLength);
+        rc = (usb_cdc_dev->span_ops->rx_in_commit)(usb_cdc_dev->rx_in_context,
+                                                   DataLength,
+                                                   &headroom,
+                                                   &need_yield);
+    } else {
+        /* Use the memory interface function to read from the selected endpoint */
+        PMAToUserBufferCopy((uint8_t *)usb_cdc_dev->rx_packet_buffer,
+                            GetEPRxAddr(usb_cdc_dev->cfg->data_rx_ep),
+                            DataLength);
+        rc = (usb_cdc_dev->rx_in_cb)(usb_cdc_dev->rx_in_context,
+                                     usb_cdc_dev->rx_packet_buffer,
+                                     DataLength,
+                                     &headroom,
+                                     &need_yield);
+    }
 
     if (rc < DataLength) {
         /* Lost bytes on rx */
@@ -43,13 +43,15 @@ static void PIOS_USB_CDC_RegisterRxCallback(uint32_t usbcdc_id, pios_com_callbac
 static void PIOS_USB_CDC_TxStart(uint32_t usbcdc_id, uint16_t tx_bytes_avail);
 static void PIOS_USB_CDC_RxStart(uint32_t usbcdc_id, uint16_t rx_bytes_avail);
 static bool PIOS_USB_CDC_Available(uint32_t usbcdc_id);
+static void PIOS_USB_CDC_RegisterSpanOps(uint32_t usbcdc_id, const struct pios_com_span_ops *span_ops);
 
 const struct pios_com_driver pios_usb_cdc_com_driver = {
-    .tx_start   = PIOS_USB_CDC_TxStart,
-    .rx_start   = PIOS_USB_CDC_RxStart,
-    .bind_tx_cb = PIOS_USB_CDC_RegisterTxCallback,
-    .bind_rx_cb = PIOS_USB_CDC_RegisterRxCallback,
-    .available  = PIOS_USB_CDC_Available,
+    .tx_start      = PIOS_USB_CDC_TxStart,
+    .rx_start      = PIOS_USB_CDC_RxStart,
+    .bind_tx_cb    = PIOS_USB_CDC_RegisterTxCallback,
+    .bind_rx_cb    = PIOS_USB_CDC_RegisterRxCallback,
+    .available     = PIOS_USB_CDC_Available,
+    .bind_span_ops = PIOS_USB_CDC_RegisterSpanOps,
 };
 
 enum pios_usb_cdc_dev_magic {
@@ -66,12 +68,14 @@ struct pios_usb_cdc_dev {
     uint32_t rx_in_context;
     pios_com_callback tx_out_cb;
     uint32_t tx_out_context;
+    const struct pios_com_span_ops *span_ops;
 
     bool     usb_ctrl_if_enabled;
     bool     usb_data_if_enabled;
 
     uint8_t  rx_packet_buffer[PIOS_USB_BOARD_CDC_DATA_LENGTH] __attribute__((aligned(4)));
     volatile bool rx_active;
+    bool     rx_in_span; /* receiving straight into the buffer of the com layer */
 
     /*
      * NOTE: This is -1 as somewhat of a hack.  It ensures that we always send packets
@@ -80,6 +84,7 @@ struct pios_usb_cdc_dev {
      */
     uint8_t  tx_packet_buffer[PIOS_USB_BOARD_CDC_DATA_LENGTH - 1] __attribute__((aligned(4)));
     volatile bool tx_active;
+    uint16_t tx_span_len; /* bytes sent straight from the buffer of the com layer */
 
     uint8_t  ctrl_tx_packet_buffer[PIOS_USB_BOARD_CDC_MGMT_LENGTH] __attribute__((aligned(4)));
 
@@ -208,17 +213,28 @@ out_fail:
 static bool PIOS_USB_CDC_SendData(struct pios_usb_cdc_dev *usb_cdc_dev)
 {
     uint16_t bytes_to_tx;
+    uint8_t *tx_buffer;
 
     if (!usb_cdc_dev->tx_out_cb) {
         return false;
     }
 
     bool need_yield = false;
-    bytes_to_tx = (usb_cdc_dev->tx_out_cb)(usb_cdc_dev->tx_out_context,
-                                           usb_cdc_dev->tx_packet_buffer,
-                                           sizeof(usb_cdc_dev->tx_packet_buffer),
-                                           NULL,
-                                           &need_yield);
+    if (usb_cdc_dev->span_ops) {
+        /* Send straight from the com buffer, the bytes are released once sent */
+        bytes_to_tx = (usb_cdc_dev->span_ops->tx_out_span)(usb_cdc_dev->tx_out_context, &tx_buffer);
+        if (bytes_to_tx > sizeof(usb_cdc_dev->tx_packet_buffer)) {
+            bytes_to_tx = sizeof(usb_cdc_dev->tx_packet_buffer);
+        }
+        usb_cdc_dev->tx_span_len = bytes_to_tx;
+    } else {
+        tx_buffer   = usb_cdc_dev->tx_packet_buffer;
+        bytes_to_tx = (usb_cdc_dev->tx_out_cb)(usb_cdc_dev->tx_out_context,
+                                               tx_buffer,
+                                               sizeof(usb_cdc_dev->tx_packet_buffer),
+                                               NULL,
+                                               &need_yield);
+    }
     if (bytes_to_tx == 0) {
         return false;
     }
@@ -230,7 +246,7 @@ static bool PIOS_USB_CDC_SendData(struct pios_usb_cdc_dev *usb_cdc_dev)
     usb_cdc_dev->tx_active = true;
 
     PIOS_USBHOOK_EndpointTx(usb_cdc_dev->cfg->data_tx_ep,
-                            usb_cdc_dev->tx_packet_buffer,
+                            tx_buffer,
                             bytes_to_tx);
 
 #if defined(PIOS_INCLUDE_FREERTOS)
@@ -242,6 +258,28 @@ static bool PIOS_USB_CDC_SendData(struct pios_usb_cdc_dev *usb_cdc_dev)
     return true;
 }
 
+/**
+ * Give the rx endpoint a buffer for a maximum length packet, the free space of the
+ * com buffer when it is contiguous and large enough
+ */
+static void PIOS_USB_CDC_PrepareRx(struct pios_usb_cdc_dev *usb_cdc_dev)
+{
+    uint8_t *rx_buffer = usb_cdc_dev->rx_packet_buffer;
+
+    usb_cdc_dev->rx_in_span = false;
+    if (usb_cdc_dev->span_ops) {
+        uint8_t *span;
+        if ((usb_cdc_dev->span_ops->rx_in_span)(usb_cdc_dev->rx_in_context, &span) >= sizeof(usb_cdc_dev->rx_packet_buffer)) {
+            rx_buffer = span;
+            usb_cdc_dev->rx_in_span = true;
+        }
+    }
+
+    PIOS_USBHOOK_EndpointRx(usb_cdc_dev->cfg->data_rx_ep,
+                            rx_buffer,
+                            sizeof(usb_cdc_dev->rx_packet_buffer));
+}
+
 static void PIOS_USB_CDC_RxStart(uint32_t usbcdc_id, uint16_t rx_bytes_avail)
 {
     struct pios_usb_cdc_dev *usb_cdc_dev = (struct pios_usb_cdc_dev *)usbcdc_id;
@@ -261,9 +299,7 @@ static void PIOS_USB_CDC_RxStart(uint32_t usbcdc_id, uint16_t rx_bytes_avail)
 
     // If endpoint was stalled and there is now space make it valid
     if (!usb_cdc_dev->rx_active && (rx_bytes_avail >= PIOS_USB_BOARD_CDC_DATA_LENGTH)) {
-        PIOS_USBHOOK_EndpointRx(usb_cdc_dev->cfg->data_rx_ep,
-                                usb_cdc_dev->rx_packet_buffer,
-                                sizeof(usb_cdc_dev->rx_packet_buffer));
+        PIOS_USB_CDC_PrepareRx(usb_cdc_dev);
         usb_cdc_dev->rx_active = true;
     }
 }
@@ -323,6 +359,17 @@ static void PIOS_USB_CDC_RegisterTxCallback(uint32_t usbcdc_id, pios_com_callbac
     usb_cdc_dev->tx_out_cb = tx_out_cb;
 }
 
+static void PIOS_USB_CDC_RegisterSpanOps(uint32_t usbcdc_id, const struct pios_com_span_ops *span_ops)
+{
+    struct pios_usb_cdc_dev *usb_cdc_dev = (struct pios_usb_cdc_dev *)usbcdc_id;
+
+    bool valid = PIOS_USB_CDC_validate(usb_cdc_dev);
+
+    PIOS_Assert(valid);
+
+    usb_cdc_dev->span_ops = span_ops;
+}
+
 static bool PIOS_USB_CDC_CTRL_EP_IN_Callback(uint32_t usb_cdc_id, uint8_t epnum, uint16_t len);
 
 static void PIOS_USB_CDC_CTRL_IF_Init(uint32_t usb_cdc_id)
@@ -560,6 +607,10 @@ static void PIOS_USB_CDC_DATA_IF_Init(uint32_t usb_cdc_id)
                                        sizeof(usb_cdc_dev->rx_packet_buffer),
                                        PIOS_USB_CDC_DATA_EP_OUT_Callback,
                                        (uint32_t)usb_cdc_dev);
+
+    /* Nothing is in flight on a newly configured interface */
+    usb_cdc_dev->tx_span_len = 0;
+    usb_cdc_dev->tx_active   = false;
     usb_cdc_dev->usb_data_if_enabled = true;
 }
 
@@ -575,6 +626,14 @@ static void PIOS_USB_CDC_DATA_IF_DeInit(uint32_t usb_cdc_id)
     usb_cdc_dev->usb_data_if_enabled = false;
     PIOS_USBHOOK_DeRegisterEpInCallback(usb_cdc_dev->cfg->data_tx_ep);
     PIOS_USBHOOK_DeRegisterEpOutCallback(usb_cdc_dev->cfg->data_rx_ep);
+
+    /*
+     * A packet sent from the com buffer will not complete, it is not released
+     * later on: the bytes stay in the buffer, to be sent again or dropped by
+     * the com layer, and no newer bytes are released in their place
+     */
+    usb_cdc_dev->tx_span_len = 0;
+    usb_cdc_dev->tx_active   = false;
 }
 
 static bool PIOS_USB_CDC_DATA_IF_Setup(
@@ -614,12 +673,25 @@ static bool PIOS_USB_CDC_DATA_EP_IN_Callback(
 
     PIOS_Assert(valid);
 
+    bool need_yield = false;
+    if (usb_cdc_dev->tx_span_len > 0) {
+        /* The packet sent from the com buffer is through, release it */
+        (void)(usb_cdc_dev->span_ops->tx_out_release)(usb_cdc_dev->tx_out_context, usb_cdc_dev->tx_span_len, NULL, &need_yield);
+        usb_cdc_dev->tx_span_len = 0;
+    }
+
     bool rc = PIOS_USB_CDC_SendData(usb_cdc_dev);
     if (!rc) {
         /* No additional data was transmitted, note that tx is no longer active */
         usb_cdc_dev->tx_active = false;
     }
 
+#if defined(PIOS_INCLUDE_FREERTOS)
+    if (need_yield) {
+        vPortYieldFromISR();
+    }
+#endif /* PIOS_INCLUDE_FREERTOS */
+
     return rc;
 }
 
@@ -647,11 +719,19 @@ static bool PIOS_USB_CDC_DATA_EP_OUT_Callback(
     uint16_t headroom;
     bool need_yield = false;
     uint16_t bytes_rxed;
-    bytes_rxed = (usb_cdc_dev->rx_in_cb)(usb_cdc_dev->rx_in_context,
-                                         usb_cdc_dev->rx_packet_buffer,
-                                         len,
-                                         &headroom,
-                                         &need_yield);
+    if (usb_cdc_dev->rx_in_span) {
+        /* Received straight into the com buffer */
+        bytes_rxed = (usb_cdc_dev->span_ops->rx_in_commit)(usb_cdc_dev->rx_in_context,
+                                                           len,
+                                                           &headroom,
+                                                           &need_yield);
+    } else {
+        bytes_rxed = (usb_cdc_dev->rx_in_cb)(usb_cdc_dev->rx_in_context,
+                                             usb_cdc_dev->rx_packet_buffer,
+                                             len,
+                                             &headroom,
+                                             &need_yield);
+    }
 
     if (bytes_rxed < len) {
         /* Lost bytes on rx */
@@ -661,9 +741,7 @@ static bool PIOS_USB_CDC_DATA_EP_OUT_Callback(
     bool rc;
     if (headroom >= sizeof(usb_cdc_dev->rx_packet_buffer)) {
         /* We have room for a maximum length message */
-        PIOS_USBHOOK_EndpointRx(usb_cdc_dev->cfg->data_rx_ep,
-                                usb_cdc_dev->rx_packet_buffer,
-                                sizeof(usb_cdc_dev->rx_packet_buffer));
+        PIOS_USB_CDC_PrepareRx(usb_cdc_dev);
         rc = true;
     } else {
         /* Not enough room left for a message, apply backpressure */
@@ -132,6 +132,8 @@
 /* #define PIOS_INCLUDE_COM_FLEXI */
 /* #define PIOS_INCLUDE_COM_AUX */
 /* #define PIOS_TELEM_PRIORITY_QUEUE */
+/* #define PIOS_TELEM_DELTA_ENCODING */
+/* #define PIOS_TELEM_BANDWIDTH_SCHEDULER */
 #define PIOS_INCLUDE_GPS
 #define PIOS_GPS_MINIMAL
 #define PIOS_INCLUDE_GPS_NMEA_PARSER
@@ -141,6 +143,9 @@
 /* Stabilization options */
 /* #define PIOS_QUATERNION_STABILIZATION */
 
+/* UAVObject manager options */
+/* #define PIOS_UAVOBJ_PER_OBJECT_LOCK */
+
 /* Performance counters */
 #define IDLE_COUNTS_PER_SEC_AT_NO_LOAD  1995998
 
@@ -676,10 +676,11 @@ const struct pios_rfm22b_cfg *PIOS_BOARD_HW_DEFS_GetRfm22Cfg(uint32_t board_revi
 #include "pios_flashfs_logfs_priv.h"
 #include "pios_flash_jedec_priv.h"
 #include "pios_flash_internal_priv.h"
+#include "pios_flashlog_priv.h"
 
 static const struct flashfs_logfs_cfg flashfs_external_user_cfg = {
-    .fs_magic      = 0x99abcdef,
-    .total_fs_size = 0x001C0000, /* 2M bytes (32 sectors = entire chip) */
+    .fs_magic      = 0x99abcdf0,
+    .total_fs_size = 0x00040000, /* 256K bytes (4 sectors) */
     .arena_size    = 0x00010000, /* 256 * slot size */
     .slot_size     = 0x00000100, /* 256 bytes */
 
@@ -699,6 +700,15 @@ static const struct flashfs_logfs_cfg flashfs_external_system_cfg = {
     .page_size     = 0x00000100, /* 256 bytes */
 };
 
+static const struct flashlog_cfg flashlog_external_cfg = {
+    .start_offset = 0x80000,    /* after the user filesystem */
+    .total_size   = 0x00180000, /* 1.5M bytes (24 sectors = rest of the chip) */
+    .block_size   = 0x00000400, /* 1K bytes */
+
+    .sector_size  = 0x00010000, /* 64K bytes */
+    .page_size    = 0x00000100, /* 256 bytes */
+};
+
 
 static const struct pios_flash_internal_cfg flash_internal_cfg = {};
 
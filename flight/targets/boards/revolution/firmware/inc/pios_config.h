@@ -110,6 +110,7 @@
 #define PIOS_INCLUDE_FLASH
 #define PIOS_INCLUDE_FLASH_INTERNAL
 #define PIOS_INCLUDE_FLASH_LOGFS_SETTINGS
+#define PIOS_INCLUDE_FLASH_LOG
 #define FLASH_FREERTOS
 /* #define PIOS_INCLUDE_FLASH_EEPROM */
 
@@ -132,6 +133,8 @@
 #define PIOS_INCLUDE_COM_FLEXI
 /* #define PIOS_INCLUDE_COM_AUX */
 #define PIOS_TELEM_PRIORITY_QUEUE
+#define PIOS_TELEM_DELTA_ENCODING
+#define PIOS_TELEM_BANDWIDTH_SCHEDULER
 #define PIOS_INCLUDE_GPS
 /* #define PIOS_GPS_MINIMAL */
 #define PIOS_INCLUDE_GPS_NMEA_PARSER
@@ -141,6 +144,9 @@
 /* Stabilization options */
 /* #define PIOS_QUATERNION_STABILIZATION */
 
+/* UAVObject manager options */
+#define PIOS_UAVOBJ_PER_OBJECT_LOCK
+
 /* Performance counters */
 #define IDLE_COUNTS_PER_SEC_AT_NO_LOAD 8379692
 
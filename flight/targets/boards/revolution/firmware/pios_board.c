@@ -236,6 +236,7 @@ uint32_t pios_rfm22b_id = 0;
 
 uintptr_t pios_uavo_settings_fs_id;
 uintptr_t pios_user_fs_id;
+uintptr_t pios_flight_log_id;
 
 /*
  * Setup a com port based on the passed cfg, driver and buffer sizes. tx size of -1 make the port rx only
@@ -378,6 +379,13 @@ void PIOS_Board_Init(void)
         PIOS_DEBUG_Assert(0);
     }
 
+#if defined(PIOS_INCLUDE_FLASH_LOG)
+    // A flight log which fails to mount is left out, FlightLog reports it unavailable
+    if (PIOS_FLASHLOG_Init(&pios_flight_log_id, &flashlog_external_cfg, &pios_jedec_flash_driver, flash_id)) {
+        pios_flight_log_id = 0;
+    }
+#endif
+
 #endif /* if defined(PIOS_INCLUDE_FLASH) */
 
 #if defined(PIOS_INCLUDE_RTC)
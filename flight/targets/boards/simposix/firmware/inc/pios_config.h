@@ -100,7 +100,10 @@
 /* Flags that alter behaviors - mostly to lower resources for CC */
 #define PIOS_INCLUDE_INITCALL          /* Include init call structures */
 #define PIOS_TELEM_PRIORITY_QUEUE      /* Enable a priority queue in telemetry */
+#define PIOS_TELEM_DELTA_ENCODING      /* Delta encode large periodic objects in telemetry */
+#define PIOS_TELEM_BANDWIDTH_SCHEDULER /* Stretch telemetry update periods to fit the link */
 #define PIOS_QUATERNION_STABILIZATION  /* Stabilization options */
+#define PIOS_UAVOBJ_PER_OBJECT_LOCK    /* One lock per UAVObject instead of a global one */
 // #define PIOS_GPS_SETS_HOMELOCATION      /* GPS options */
 
 /* Alarm Thresholds */
@@ -0,0 +1,278 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <string.h> /* memset */
+#include <pthread.h> /* pthread_* */
+#include <sched.h> /* sched_yield */
+#include <sys/time.h> /* gettimeofday */
+
+extern "C" {
+#include "fifo_buffer.h"
+}
+
+#define BUFFER_SIZE     16
+
+#define STREAM_BYTES    (16 * 1024 * 1024)
+#define STREAM_BUF_SIZE 512
+#define STREAM_CHUNK    64
+
+// To use a test fixture, derive a class from testing::Test.
+class FifoBufferTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        memset(storage, 0xFF, sizeof(storage));
+        fifoBuf_init(&fifo, storage, BUFFER_SIZE);
+
+        for (uint32_t i = 0; i < sizeof(pattern); i++) {
+            pattern[i] = 0x10 + i;
+        }
+    }
+
+    virtual void TearDown() {}
+
+    t_fifo_buffer fifo;
+    uint8_t storage[BUFFER_SIZE];
+    uint8_t pattern[BUFFER_SIZE];
+};
+
+TEST_F(FifoBufferTest, Empty) {
+    uint8_t *span;
+
+    EXPECT_EQ(BUFFER_SIZE - 1, fifoBuf_getSize(&fifo));
+    EXPECT_EQ(0, fifoBuf_getUsed(&fifo));
+    EXPECT_EQ(BUFFER_SIZE - 1, fifoBuf_getFree(&fifo));
+    EXPECT_EQ(-1, fifoBuf_getByte(&fifo));
+    EXPECT_EQ(0, fifoBuf_getReadSpan(&fifo, &span));
+    EXPECT_EQ(BUFFER_SIZE - 1, fifoBuf_getWriteSpan(&fifo, &span));
+    EXPECT_EQ(storage, span);
+}
+
+TEST_F(FifoBufferTest, PutGetWrapping) {
+    uint8_t data[BUFFER_SIZE];
+
+    // Move the indexes close to the end of the buffer
+    EXPECT_EQ(12, fifoBuf_putData(&fifo, pattern, 12));
+    fifoBuf_removeData(&fifo, 12);
+
+    EXPECT_EQ(BUFFER_SIZE - 1, fifoBuf_putData(&fifo, pattern, BUFFER_SIZE));
+    EXPECT_EQ(0, fifoBuf_getFree(&fifo));
+    EXPECT_EQ(0, fifoBuf_putByte(&fifo, 0xAA));
+
+    memset(data, 0, sizeof(data));
+    EXPECT_EQ(5, fifoBuf_getDataPeek(&fifo, data, 5));
+    EXPECT_EQ(0, memcmp(data, pattern, 5));
+    EXPECT_EQ(BUFFER_SIZE - 1, fifoBuf_getUsed(&fifo));
+
+    memset(data, 0, sizeof(data));
+    EXPECT_EQ(BUFFER_SIZE - 1, fifoBuf_getData(&fifo, data, sizeof(data)));
+    EXPECT_EQ(0, memcmp(data, pattern, BUFFER_SIZE - 1));
+    EXPECT_EQ(0, fifoBuf_getUsed(&fifo));
+}
+
+TEST_F(FifoBufferTest, ReadSpanStopsAtEnd) {
+    uint8_t *span;
+
+    EXPECT_EQ(12, fifoBuf_putData(&fifo, pattern, 12));
+    fifoBuf_removeData(&fifo, 12);
+    EXPECT_EQ(10, fifoBuf_putData(&fifo, pattern, 10));
+
+    // The data wraps, the first span ends with the buffer
+    EXPECT_EQ(4, fifoBuf_getReadSpan(&fifo, &span));
+    EXPECT_EQ(&storage[12], span);
+    EXPECT_EQ(0, memcmp(span, pattern, 4));
+    fifoBuf_removeData(&fifo, 4);
+
+    EXPECT_EQ(6, fifoBuf_getReadSpan(&fifo, &span));
+    EXPECT_EQ(storage, span);
+    EXPECT_EQ(0, memcmp(span, &pattern[4], 6));
+    fifoBuf_removeData(&fifo, 6);
+
+    EXPECT_EQ(0, fifoBuf_getReadSpan(&fifo, &span));
+}
+
+TEST_F(FifoBufferTest, WriteSpanKeepsOneFree) {
+    uint8_t *span;
+    uint8_t data[BUFFER_SIZE];
+
+    EXPECT_EQ(12, fifoBuf_putData(&fifo, pattern, 12));
+    fifoBuf_removeData(&fifo, 12);
+
+    // The free space wraps, the first span ends with the buffer
+    EXPECT_EQ(4, fifoBuf_getWriteSpan(&fifo, &span));
+    EXPECT_EQ(&storage[12], span);
+    memcpy(span, pattern, 4);
+    fifoBuf_commitData(&fifo, 4);
+
+    // The second one stops one byte before the data
+    EXPECT_EQ(11, fifoBuf_getWriteSpan(&fifo, &span));
+    EXPECT_EQ(storage, span);
+    memcpy(span, &pattern[4], 11);
+    fifoBuf_commitData(&fifo, 11);
+
+    EXPECT_EQ(0, fifoBuf_getWriteSpan(&fifo, &span));
+    EXPECT_EQ(BUFFER_SIZE - 1, fifoBuf_getData(&fifo, data, sizeof(data)));
+    EXPECT_EQ(0, memcmp(data, pattern, BUFFER_SIZE - 1));
+}
+
+TEST_F(FifoBufferTest, CommitIsClamped) {
+    uint8_t *span;
+
+    EXPECT_EQ(10, fifoBuf_putData(&fifo, pattern, 10));
+    EXPECT_EQ(5, fifoBuf_getWriteSpan(&fifo, &span));
+
+    // More than the free space only fills the buffer
+    fifoBuf_commitData(&fifo, 100);
+    EXPECT_EQ(BUFFER_SIZE - 1, fifoBuf_getUsed(&fifo));
+    EXPECT_EQ(0, fifoBuf_getFree(&fifo));
+}
+
+TEST_F(FifoBufferTest, ClearRequestKeepsLaterData) {
+    uint8_t *span;
+    uint8_t data[BUFFER_SIZE];
+
+    // The consumer is still using a span when the producer asks for a clear
+    EXPECT_EQ(8, fifoBuf_putData(&fifo, pattern, 8));
+    EXPECT_EQ(8, fifoBuf_getReadSpan(&fifo, &span));
+    fifoBuf_requestClear(&fifo);
+
+    // Only the consumer moves rd, the span is not written over
+    EXPECT_EQ(8, fifoBuf_getUsed(&fifo));
+    EXPECT_EQ(4, fifoBuf_putData(&fifo, &pattern[8], 4));
+    EXPECT_EQ(0, memcmp(span, pattern, 8));
+
+    // The span is released, then the clear drops the rest of the old data only
+    fifoBuf_removeData(&fifo, 3);
+    fifoBuf_applyClear(&fifo);
+    EXPECT_EQ(4, fifoBuf_getUsed(&fifo));
+
+    // A request is applied once
+    EXPECT_EQ(2, fifoBuf_getData(&fifo, data, 2));
+    fifoBuf_applyClear(&fifo);
+    EXPECT_EQ(2, fifoBuf_getData(&fifo, &data[2], sizeof(data)));
+    EXPECT_EQ(0, memcmp(data, &pattern[8], 4));
+
+    // A request for data the consumer already took does not move rd back
+    EXPECT_EQ(6, fifoBuf_putData(&fifo, pattern, 6));
+    fifoBuf_requestClear(&fifo);
+    EXPECT_EQ(6, fifoBuf_getData(&fifo, data, sizeof(data)));
+    EXPECT_EQ(3, fifoBuf_putData(&fifo, pattern, 3));
+    fifoBuf_applyClear(&fifo);
+    EXPECT_EQ(3, fifoBuf_getUsed(&fifo));
+}
+
+struct stream {
+    t_fifo_buffer fifo;
+    uint8_t storage[STREAM_BUF_SIZE];
+    bool    spans;
+    uint32_t errors;
+};
+
+static void *streamProducer(void *arg)
+{
+    struct stream *s = (struct stream *)arg;
+    uint8_t chunk[STREAM_CHUNK];
+    uint32_t sent    = 0;
+
+    while (sent < STREAM_BYTES) {
+        uint8_t *span;
+        uint16_t len;
+
+        if (s->spans) {
+            len = fifoBuf_getWriteSpan(&s->fifo, &span);
+            if (len > STREAM_BYTES - sent) {
+                len = STREAM_BYTES - sent;
+            }
+            for (uint16_t i = 0; i < len; i++) {
+                span[i] = (uint8_t)(sent + i);
+            }
+            fifoBuf_commitData(&s->fifo, len);
+        } else {
+            len = STREAM_CHUNK;
+            if (len > STREAM_BYTES - sent) {
+                len = STREAM_BYTES - sent;
+            }
+            for (uint16_t i = 0; i < len; i++) {
+                chunk[i] = (uint8_t)(sent + i);
+            }
+            len = fifoBuf_putData(&s->fifo, chunk, len);
+        }
+        sent += len;
+        if (len == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *streamConsumer(void *arg)
+{
+    struct stream *s = (struct stream *)arg;
+    uint8_t chunk[STREAM_CHUNK];
+    uint32_t received = 0;
+
+    while (received < STREAM_BYTES) {
+        uint8_t *span;
+        uint16_t len;
+
+        if (s->spans) {
+            len = fifoBuf_getReadSpan(&s->fifo, &span);
+            for (uint16_t i = 0; i < len; i++) {
+                if (span[i] != (uint8_t)(received + i)) {
+                    s->errors++;
+                }
+            }
+            fifoBuf_removeData(&s->fifo, len);
+        } else {
+            len = fifoBuf_getData(&s->fifo, chunk, sizeof(chunk));
+            for (uint16_t i = 0; i < len; i++) {
+                if (chunk[i] != (uint8_t)(received + i)) {
+                    s->errors++;
+                }
+            }
+        }
+        received += len;
+        if (len == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static double streamMegabytesPerSecond(bool spans, uint32_t *errors)
+{
+    struct stream s;
+    pthread_t producer, consumer;
+    struct timeval start, end;
+
+    memset(&s, 0, sizeof(s));
+    fifoBuf_init(&s.fifo, s.storage, sizeof(s.storage));
+    s.spans = spans;
+
+    gettimeofday(&start, NULL);
+    pthread_create(&consumer, NULL, streamConsumer, &s);
+    pthread_create(&producer, NULL, streamProducer, &s);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+    gettimeofday(&end, NULL);
+
+    *errors = s.errors;
+    double us = (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_usec - start.tv_usec);
+    return STREAM_BYTES / (us > 0 ? us : 1);
+}
+
+TEST(FifoBufferStream, ProducerConsumerThreads) {
+    uint32_t errors;
+
+    // A producer and a consumer thread without any lock, once copying chunks in and
+    // out of the fifo and once using the fifo in place
+    double copy_rate = streamMegabytesPerSecond(false, &errors);
+
+    EXPECT_EQ(0u, errors);
+
+    double span_rate = streamMegabytesPerSecond(true, &errors);
+    EXPECT_EQ(0u, errors);
+
+    printf("fifo_buffer: %u bytes, %.1f MB/s with putData/getData, %.1f MB/s with spans\n",
+           STREAM_BYTES, copy_rate, span_rate);
+}
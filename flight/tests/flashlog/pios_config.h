@@ -0,0 +1,8 @@
+#ifndef PIOS_CONFIG_H
+#define PIOS_CONFIG_H
+
+/* Enable/Disable PiOS modules */
+#define PIOS_INCLUDE_FLASH
+#define PIOS_INCLUDE_FREERTOS
+
+#endif /* PIOS_CONFIG_H */
@@ -0,0 +1,346 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+
+extern "C" {
+#include "pios_flash.h" /* PIOS_FLASH_* API */
+#include "pios_flash_ut_priv.h"
+
+extern struct pios_flash_ut_cfg flash_config;
+
+#include "pios_flashlog_priv.h"
+
+extern struct flashlog_cfg flashlog_config;
+
+#include "pios_flashlog.h" /* PIOS_FLASHLOG_* */
+#include "pios_crc.h" /* PIOS_CRC_updateCRC */
+}
+
+#define BLOCK_DATA_SIZE (0x400 - PIOS_FLASHLOG_BLOCK_HEADER_SIZE)
+
+// To use a test fixture, derive a class from testing::Test.
+class FlashlogTestRaw : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        /* create an empty, appropriately sized flash */
+        FILE *theflash = fopen(FLASH_IMAGE_FILE, "wb");
+        uint8_t sector[flash_config.size_of_sector];
+
+        memset(sector, 0xFF, sizeof(sector));
+        for (uint32_t i = 0; i < flash_config.size_of_flash / flash_config.size_of_sector; i++) {
+            fwrite(sector, sizeof(sector), 1, theflash);
+        }
+        fclose(theflash);
+
+        for (uint32_t i = 0; i < sizeof(data); i++) {
+            data[i] = 0x10 + (i % 100);
+        }
+
+        EXPECT_EQ(0, PIOS_Flash_UT_Init(&flash_id, &flash_config));
+    }
+
+    virtual void TearDown()
+    {
+        PIOS_Flash_UT_Destroy(flash_id);
+    }
+
+    /* Write straight to the flash, behind the back of the log */
+    void writeFlash(uint32_t addr, uint8_t *buf, uint16_t len)
+    {
+        pios_ut_flash_driver.start_transaction(flash_id);
+        pios_ut_flash_driver.write_data(flash_id, addr, buf, len);
+        pios_ut_flash_driver.end_transaction(flash_id);
+    }
+
+    void readFlash(uint32_t addr, uint8_t *buf, uint16_t len)
+    {
+        pios_ut_flash_driver.start_transaction(flash_id);
+        pios_ut_flash_driver.read_data(flash_id, addr, buf, len);
+        pios_ut_flash_driver.end_transaction(flash_id);
+    }
+
+    uintptr_t flash_id;
+    uint8_t data[BLOCK_DATA_SIZE];
+};
+
+TEST_F(FlashlogTestRaw, InitEmpty) {
+    uintptr_t log_id;
+    struct PIOS_FLASHLOG_Stats stats;
+
+    EXPECT_EQ(0, PIOS_FLASHLOG_Init(&log_id, &flashlog_config, &pios_ut_flash_driver, flash_id));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(flashlog_config.total_size, stats.total_size);
+    EXPECT_EQ(0u, stats.used_size);
+    EXPECT_EQ(flashlog_config.block_size, stats.block_size);
+    EXPECT_EQ(0, stats.last_flight);
+    PIOS_FLASHLOG_Destroy(log_id);
+}
+
+TEST_F(FlashlogTestRaw, RemountFindsEnd) {
+    uintptr_t log_id;
+    struct PIOS_FLASHLOG_Stats stats;
+
+    EXPECT_EQ(0, PIOS_FLASHLOG_Init(&log_id, &flashlog_config, &pios_ut_flash_driver, flash_id));
+    EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 3, data, sizeof(data)));
+    EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 4, data, 10));
+    PIOS_FLASHLOG_Destroy(log_id);
+
+    /* A reboot carries on after the last block */
+    EXPECT_EQ(0, PIOS_FLASHLOG_Init(&log_id, &flashlog_config, &pios_ut_flash_driver, flash_id));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(2 * flashlog_config.block_size, stats.used_size);
+    EXPECT_EQ(4, stats.last_flight);
+
+    EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 5, data, 20));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(3 * flashlog_config.block_size, stats.used_size);
+    PIOS_FLASHLOG_Destroy(log_id);
+}
+
+TEST_F(FlashlogTestRaw, TornHeaderIsSkipped) {
+    uintptr_t log_id;
+    struct PIOS_FLASHLOG_Stats stats;
+
+    EXPECT_EQ(0, PIOS_FLASHLOG_Init(&log_id, &flashlog_config, &pios_ut_flash_driver, flash_id));
+    EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 1, data, sizeof(data)));
+    PIOS_FLASHLOG_Destroy(log_id);
+
+    /* Power lost while the header of the next block was written */
+    writeFlash(flashlog_config.start_offset + flashlog_config.block_size, data, 4);
+
+    EXPECT_EQ(0, PIOS_FLASHLOG_Init(&log_id, &flashlog_config, &pios_ut_flash_driver, flash_id));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(2 * flashlog_config.block_size, stats.used_size);
+    EXPECT_EQ(1, stats.last_flight);
+
+    EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 2, data, sizeof(data)));
+    PIOS_FLASHLOG_Destroy(log_id);
+
+    EXPECT_EQ(0, PIOS_FLASHLOG_Init(&log_id, &flashlog_config, &pios_ut_flash_driver, flash_id));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(3 * flashlog_config.block_size, stats.used_size);
+    EXPECT_EQ(2, stats.last_flight);
+    PIOS_FLASHLOG_Destroy(log_id);
+}
+
+TEST_F(FlashlogTestRaw, LeftOversAreSkipped) {
+    uintptr_t log_id;
+    struct PIOS_FLASHLOG_Stats stats;
+    uint32_t leftover = flashlog_config.start_offset + 2 * flashlog_config.block_size + 100;
+
+    /* Left over data from another user of the flash */
+    writeFlash(leftover, data, 100);
+
+    EXPECT_EQ(0, PIOS_FLASHLOG_Init(&log_id, &flashlog_config, &pios_ut_flash_driver, flash_id));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(0u, stats.used_size);
+
+    /* Nothing is written over it */
+    EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 1, data, sizeof(data)));
+    EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 1, data, sizeof(data)));
+    EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 1, data, sizeof(data)));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(4 * flashlog_config.block_size, stats.used_size);
+    PIOS_FLASHLOG_Destroy(log_id);
+
+    EXPECT_EQ(0, PIOS_FLASHLOG_Init(&log_id, &flashlog_config, &pios_ut_flash_driver, flash_id));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(4 * flashlog_config.block_size, stats.used_size);
+
+    /* Until the log is erased */
+    EXPECT_EQ(0, PIOS_FLASHLOG_Erase(log_id));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(0u, stats.used_size);
+
+    uint8_t check[100];
+    uint8_t erased[100];
+    memset(erased, 0xFF, sizeof(erased));
+    readFlash(leftover, check, sizeof(check));
+    EXPECT_EQ(0, memcmp(erased, check, sizeof(check)));
+    PIOS_FLASHLOG_Destroy(log_id);
+}
+
+/* Flash driver losing power after a number of sector erases */
+static uint32_t erases_left;
+
+static int32_t erase_until_power_loss(uintptr_t flash_id, uint32_t addr)
+{
+    if (erases_left == 0) {
+        return -1;
+    }
+    erases_left--;
+    return pios_ut_flash_driver.erase_sector(flash_id, addr);
+}
+
+TEST_F(FlashlogTestRaw, InterruptedEraseKeepsPrefix) {
+    uintptr_t log_id;
+    struct PIOS_FLASHLOG_Stats stats;
+    uint32_t blocks_per_sector = flashlog_config.sector_size / flashlog_config.block_size;
+    struct pios_flash_driver driver = pios_ut_flash_driver;
+
+    driver.erase_sector = erase_until_power_loss;
+
+    /* One flight per sector, the last one only partly used */
+    EXPECT_EQ(0, PIOS_FLASHLOG_Init(&log_id, &flashlog_config, &driver, flash_id));
+    for (uint32_t i = 0; i < 2 * blocks_per_sector + 2; i++) {
+        EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 1 + i / blocks_per_sector, data, sizeof(data)));
+    }
+
+    /* Power lost after the first sector was erased */
+    erases_left = 1;
+    EXPECT_EQ(-2, PIOS_FLASHLOG_Erase(log_id));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(2 * flashlog_config.sector_size, stats.used_size);
+    PIOS_FLASHLOG_Destroy(log_id);
+
+    /* The reboot finds the flights of the sectors not yet erased */
+    EXPECT_EQ(0, PIOS_FLASHLOG_Init(&log_id, &flashlog_config, &pios_ut_flash_driver, flash_id));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(2 * flashlog_config.sector_size, stats.used_size);
+    EXPECT_EQ(2, stats.last_flight);
+
+    /* And appends to erased flash only */
+    uint8_t block[0x400];
+    EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 4, &data[1], 300));
+    EXPECT_EQ(0, PIOS_FLASHLOG_Read(log_id, 2 * flashlog_config.sector_size, block, sizeof(block)));
+    EXPECT_EQ(4, block[4] | (block[5] << 8));
+    EXPECT_EQ(300, block[6] | (block[7] << 8));
+    EXPECT_EQ(0, memcmp(&data[1], &block[PIOS_FLASHLOG_BLOCK_HEADER_SIZE], 300));
+    EXPECT_EQ(0xFF, block[PIOS_FLASHLOG_BLOCK_HEADER_SIZE + 300]);
+    EXPECT_EQ(0, PIOS_FLASHLOG_Read(log_id, 2 * flashlog_config.sector_size + flashlog_config.block_size, block, sizeof(block)));
+    EXPECT_EQ(0xFF, block[0]);
+
+    /* A second erase finishes the job */
+    EXPECT_EQ(0, PIOS_FLASHLOG_Erase(log_id));
+    PIOS_FLASHLOG_Destroy(log_id);
+
+    EXPECT_EQ(0, PIOS_FLASHLOG_Init(&log_id, &flashlog_config, &pios_ut_flash_driver, flash_id));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(0u, stats.used_size);
+    EXPECT_EQ(0, stats.last_flight);
+    PIOS_FLASHLOG_Destroy(log_id);
+}
+
+class FlashlogTestCooked : public FlashlogTestRaw {
+protected:
+    virtual void SetUp()
+    {
+        /* First, we need to set up the super fixture (FlashlogTestRaw) */
+        FlashlogTestRaw::SetUp();
+
+        /* Init the log so we don't need to repeat this in every test */
+        EXPECT_EQ(0, PIOS_FLASHLOG_Init(&log_id, &flashlog_config, &pios_ut_flash_driver, flash_id));
+    }
+
+    virtual void TearDown()
+    {
+        PIOS_FLASHLOG_Destroy(log_id);
+        FlashlogTestRaw::TearDown();
+    }
+
+    uintptr_t log_id;
+};
+
+TEST_F(FlashlogTestCooked, BadId) {
+    struct PIOS_FLASHLOG_Stats stats;
+
+    EXPECT_EQ(-1, PIOS_FLASHLOG_Append(log_id + 1, 1, data, sizeof(data)));
+    EXPECT_EQ(-1, PIOS_FLASHLOG_Read(log_id + 1, 0, data, sizeof(data)));
+    EXPECT_EQ(-1, PIOS_FLASHLOG_Erase(log_id + 1));
+    EXPECT_EQ(-1, PIOS_FLASHLOG_GetStats(log_id + 1, &stats));
+}
+
+TEST_F(FlashlogTestCooked, AppendTooLarge) {
+    uint8_t large[BLOCK_DATA_SIZE + 1];
+
+    memset(large, 0, sizeof(large));
+    EXPECT_EQ(-2, PIOS_FLASHLOG_Append(log_id, 1, large, sizeof(large)));
+}
+
+TEST_F(FlashlogTestCooked, AppendVerify) {
+    uint8_t block[0x400];
+
+    EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 7, data, sizeof(data)));
+    EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 8, &data[1], 300));
+
+    /* First block, full */
+    EXPECT_EQ(0, PIOS_FLASHLOG_Read(log_id, 0, block, sizeof(block)));
+    EXPECT_EQ(PIOS_FLASHLOG_BLOCK_MAGIC, block[0] | (block[1] << 8) | (block[2] << 16) | (block[3] << 24));
+    EXPECT_EQ(7, block[4] | (block[5] << 8));
+    EXPECT_EQ(BLOCK_DATA_SIZE, block[6] | (block[7] << 8));
+    EXPECT_EQ(PIOS_CRC_updateCRC(0, data, sizeof(data)), block[8]);
+    EXPECT_EQ(0, memcmp(data, &block[PIOS_FLASHLOG_BLOCK_HEADER_SIZE], sizeof(data)));
+
+    /* Second block, the end of the block is left erased */
+    EXPECT_EQ(0, PIOS_FLASHLOG_Read(log_id, flashlog_config.block_size, block, sizeof(block)));
+    EXPECT_EQ(8, block[4] | (block[5] << 8));
+    EXPECT_EQ(300, block[6] | (block[7] << 8));
+    EXPECT_EQ(PIOS_CRC_updateCRC(0, &data[1], 300), block[8]);
+    EXPECT_EQ(0, memcmp(&data[1], &block[PIOS_FLASHLOG_BLOCK_HEADER_SIZE], 300));
+    EXPECT_EQ(0xFF, block[PIOS_FLASHLOG_BLOCK_HEADER_SIZE + 300]);
+}
+
+TEST_F(FlashlogTestCooked, ReadOutOfLog) {
+    EXPECT_EQ(0, PIOS_FLASHLOG_Read(log_id, flashlog_config.total_size - 10, data, 10));
+    EXPECT_EQ(-2, PIOS_FLASHLOG_Read(log_id, flashlog_config.total_size - 10, data, 11));
+    EXPECT_EQ(-2, PIOS_FLASHLOG_Read(log_id, flashlog_config.total_size + 1, data, 0));
+}
+
+TEST_F(FlashlogTestCooked, FillEraseKeepsNeighbours) {
+    struct PIOS_FLASHLOG_Stats stats;
+    uint8_t before[16];
+    uint8_t after[16];
+    uint8_t check[16];
+
+    /* Data around the log must survive */
+    memset(before, 0x5A, sizeof(before));
+    memset(after, 0xA5, sizeof(after));
+    writeFlash(flashlog_config.start_offset - sizeof(before), before, sizeof(before));
+    writeFlash(flashlog_config.start_offset + flashlog_config.total_size, after, sizeof(after));
+
+    uint32_t num_blocks = flashlog_config.total_size / flashlog_config.block_size;
+    for (uint32_t i = 0; i < num_blocks; i++) {
+        EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 1, data, sizeof(data)));
+    }
+    EXPECT_EQ(-3, PIOS_FLASHLOG_Append(log_id, 1, data, sizeof(data)));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(stats.total_size, stats.used_size);
+
+    EXPECT_EQ(0, PIOS_FLASHLOG_Erase(log_id));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(0u, stats.used_size);
+    EXPECT_EQ(0, stats.last_flight);
+
+    readFlash(flashlog_config.start_offset - sizeof(before), check, sizeof(check));
+    EXPECT_EQ(0, memcmp(before, check, sizeof(check)));
+    readFlash(flashlog_config.start_offset + flashlog_config.total_size, check, sizeof(check));
+    EXPECT_EQ(0, memcmp(after, check, sizeof(check)));
+}
+
+TEST_F(FlashlogTestCooked, EraseOnlyUsedSectors) {
+    struct PIOS_FLASHLOG_Stats stats;
+
+    EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 1, data, sizeof(data)));
+    EXPECT_EQ(0, PIOS_FLASHLOG_Append(log_id, 1, data, sizeof(data)));
+
+    /* A marker in the last sector is left alone, the log never got there */
+    uint8_t marker = 0x42;
+    uint8_t check;
+    writeFlash(flashlog_config.start_offset + flashlog_config.total_size - 1, &marker, 1);
+
+    EXPECT_EQ(0, PIOS_FLASHLOG_Erase(log_id));
+    readFlash(flashlog_config.start_offset + flashlog_config.total_size - 1, &check, 1);
+    EXPECT_EQ(marker, check);
+
+    /* And the blocks are gone */
+    uint8_t header[PIOS_FLASHLOG_BLOCK_HEADER_SIZE];
+    uint8_t erased[PIOS_FLASHLOG_BLOCK_HEADER_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    EXPECT_EQ(0, PIOS_FLASHLOG_Read(log_id, flashlog_config.block_size, header, sizeof(header)));
+    EXPECT_EQ(0, memcmp(erased, header, sizeof(header)));
+    EXPECT_EQ(0, PIOS_FLASHLOG_GetStats(log_id, &stats));
+    EXPECT_EQ(0u, stats.used_size);
+}
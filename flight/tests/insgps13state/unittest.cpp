@@ -0,0 +1,205 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* rand_r */
+#include <string.h> /* memcmp */
+#include <sys/time.h> /* gettimeofday */
+
+#define NUMX 13
+#define NUMW 9
+
+extern "C" {
+void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
+                          float Q[NUMW], float dT, float P[NUMX][NUMX]);
+}
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+#define RANDOM_RUNS 2000
+#define BENCH_RUNS  100000
+
+// The covariance prediction as it was before it was restructured, the
+// current implementation has to give the very same bits.
+static const int8_t FrowMin[NUMX] = { 3, 4, 5, 6, 6, 6, 7, 6, 6, 6, 13, 13, 13 };
+static const int8_t FrowMax[NUMX] = { 3, 4, 5, 9, 9, 9, 12, 12, 12, 12, -1, -1, -1 };
+
+static const int8_t GrowMin[NUMX] = { 9, 9, 9, 3, 3, 3, 0, 0, 0, 0, 6, 7, 8 };
+static const int8_t GrowMax[NUMX] = { -1, -1, -1, 5, 5, 5, 2, 2, 2, 2, 6, 7, 8 };
+
+__attribute__((optimize("O3")))
+static void ReferenceCovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
+                                          float Q[NUMW], float dT, float P[NUMX][NUMX])
+{
+    float dT1  = 1.0f / dT;
+    float dTsq = dT * dT;
+
+    float Dummy[NUMX][NUMX];
+    int8_t i;
+
+    for (i = 0; i < NUMX; i++) {
+        float *Firow   = F[i];
+        float *Pirow   = P[i];
+        float *Dirow   = Dummy[i];
+        int8_t Fistart = FrowMin[i];
+        int8_t Fiend   = FrowMax[i];
+        int8_t j;
+        for (j = 0; j < NUMX; j++) {
+            Dirow[j] = Pirow[j] * dT1;
+            int8_t k;
+            for (k = Fistart; k <= Fiend; k++) {
+                Dirow[j] += Firow[k] * P[k][j];
+            }
+        }
+    }
+    for (i = 0; i < NUMX; i++) {
+        float *Dirow   = Dummy[i];
+        float *Girow   = G[i];
+        float *Pirow   = P[i];
+        int8_t Gistart = GrowMin[i];
+        int8_t Giend   = GrowMax[i];
+        int8_t j;
+        for (j = i; j < NUMX; j++) {
+            float Ptmp = Dirow[j] * dT1;
+
+            {
+                float *Fjrow   = F[j];
+                int8_t Fjstart = FrowMin[j];
+                int8_t Fjend   = FrowMax[j];
+                int8_t k;
+                for (k = Fjstart; k <= Fjend; k++) {
+                    Ptmp += Dirow[k] * Fjrow[k];
+                }
+            }
+
+            {
+                float *Gjrow   = G[j];
+                int8_t Gjstart = MAX(Gistart, GrowMin[j]);
+                int8_t Gjend   = MIN(Giend, GrowMax[j]);
+                int8_t k;
+                for (k = Gjstart; k <= Gjend; k++) {
+                    Ptmp += Q[k] * Girow[k] * Gjrow[k];
+                }
+            }
+
+            P[j][i] = Pirow[j] = Ptmp * dTsq;
+        }
+    }
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class CovariancePredictionTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        seed = 1;
+    }
+
+    virtual void TearDown() {}
+
+    float Random(float scale)
+    {
+        return scale * ((float)rand_r(&seed) / RAND_MAX - 0.5f);
+    }
+
+    // All of F and G is filled, the elements outside the blocks must be ignored by both
+    void RandomSystem(float scale)
+    {
+        for (int i = 0; i < NUMX; i++) {
+            for (int j = 0; j < NUMX; j++) {
+                F[i][j] = Random(scale);
+            }
+            for (int j = 0; j < NUMW; j++) {
+                G[i][j] = Random(scale);
+            }
+        }
+        for (int j = 0; j < NUMW; j++) {
+            Q[j] = Random(scale) + scale;
+        }
+        for (int i = 0; i < NUMX; i++) {
+            for (int j = i; j < NUMX; j++) {
+                P[i][j] = P[j][i] = Random(scale);
+            }
+            P[i][i] += scale;
+        }
+        memcpy(Pref, P, sizeof(P));
+    }
+
+    unsigned int seed;
+    float F[NUMX][NUMX];
+    float G[NUMX][NUMW];
+    float Q[NUMW];
+    float P[NUMX][NUMX];
+    float Pref[NUMX][NUMX];
+};
+
+TEST_F(CovariancePredictionTest, SameBitsAsReference) {
+    static const float scales[] = { 1e-6f, 1e-2f, 1.0f, 100.0f };
+    static const float dTs[]    = { 0.001f, 0.002f, 0.01f, 0.1f };
+
+    for (int n = 0; n < RANDOM_RUNS; n++) {
+        float dT = dTs[n % 4];
+        RandomSystem(scales[(n / 4) % 4]);
+
+        CovariancePrediction(F, G, Q, dT, P);
+        ReferenceCovariancePrediction(F, G, Q, dT, Pref);
+        ASSERT_EQ(0, memcmp(P, Pref, sizeof(P))) << "run " << n;
+    }
+}
+
+TEST_F(CovariancePredictionTest, SameBitsOverManySteps) {
+    RandomSystem(1e-2f);
+
+    // Errors would add up as the covariance is propagated
+    for (int n = 0; n < RANDOM_RUNS; n++) {
+        CovariancePrediction(F, G, Q, 0.002f, P);
+        ReferenceCovariancePrediction(F, G, Q, 0.002f, Pref);
+    }
+    EXPECT_EQ(0, memcmp(P, Pref, sizeof(P)));
+}
+
+TEST_F(CovariancePredictionTest, StaysSymmetric) {
+    RandomSystem(1.0f);
+
+    CovariancePrediction(F, G, Q, 0.002f, P);
+    for (int i = 0; i < NUMX; i++) {
+        for (int j = 0; j < NUMX; j++) {
+            EXPECT_EQ(P[i][j], P[j][i]);
+        }
+    }
+}
+
+static double Elapsed(struct timeval *start)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1e6;
+}
+
+TEST_F(CovariancePredictionTest, Throughput) {
+    struct timeval start;
+    float reference[NUMX][NUMX];
+
+    RandomSystem(1e-2f);
+    memcpy(reference, P, sizeof(P));
+
+    // Restarting from the same P keeps the values from drifting into denormals
+    gettimeofday(&start, NULL);
+    for (int n = 0; n < BENCH_RUNS; n++) {
+        memcpy(Pref, reference, sizeof(Pref));
+        ReferenceCovariancePrediction(F, G, Q, 0.002f, Pref);
+    }
+    double referenceTime = Elapsed(&start);
+
+    gettimeofday(&start, NULL);
+    for (int n = 0; n < BENCH_RUNS; n++) {
+        memcpy(P, reference, sizeof(P));
+        CovariancePrediction(F, G, Q, 0.002f, P);
+    }
+    double currentTime = Elapsed(&start);
+
+    EXPECT_EQ(0, memcmp(P, Pref, sizeof(P)));
+    printf("insgps13state: CovariancePrediction %.0f ns before, %.0f ns now\n",
+           referenceTime / BENCH_RUNS * 1e9, currentTime / BENCH_RUNS * 1e9);
+}
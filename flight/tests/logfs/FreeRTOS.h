@@ -1,3 +1,16 @@
 #include <stdlib.h>
-#define pvPortMalloc(xSize) (malloc(xSize))
+#include <stdint.h>
+
+/* Allocations left before the next one fails, negative for none to fail */
+extern int32_t pvPortMalloc_fail_countdown;
+
+static inline void *pvPortMalloc_ut(size_t xSize)
+{
+    if (pvPortMalloc_fail_countdown >= 0 && pvPortMalloc_fail_countdown-- == 0) {
+        return NULL;
+    }
+    return malloc(xSize);
+}
+
+#define pvPortMalloc(xSize) (pvPortMalloc_ut(xSize))
 #define vPortFree(pv)       (free(pv))
@@ -14,6 +14,7 @@ extern struct pios_flash_ut_cfg flash_config;
 
 extern struct flashfs_logfs_cfg flashfs_config_partition_a;
 extern struct flashfs_logfs_cfg flashfs_config_partition_b;
+extern int32_t pvPortMalloc_fail_countdown;
 
 #include "pios_flashfs.h" /* PIOS_FLASHFS_* */
 }
@@ -297,6 +298,64 @@ TEST_F(LogfsTestCooked, WriteManyVerify) {
     EXPECT_EQ(0, memcmp(obj3, obj3_check, sizeof(obj3)));
 }
 
+#define BENCH_NUM_OBJS 100
+
+TEST_F(LogfsTestCooked, LoadSettingsReadCount) {
+    /* Save a set of settings objects twice so that the log also holds obsolete slots */
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        for (uint32_t i = 0; i < BENCH_NUM_OBJS; i++) {
+            EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID + i, 0, pass ? obj1_alt : obj1, sizeof(obj1)));
+        }
+    }
+
+    /* Remount the filesystem like a reboot does */
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    uint32_t reads = PIOS_Flash_UT_GetReadCount(flash_id);
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_partition_a, &pios_ut_flash_driver, flash_id));
+    uint32_t mount_reads = PIOS_Flash_UT_GetReadCount(flash_id) - reads;
+
+    /* Load every object, one slot header and one data read each */
+    reads = PIOS_Flash_UT_GetReadCount(flash_id);
+    for (uint32_t i = 0; i < BENCH_NUM_OBJS; i++) {
+        unsigned char obj1_check[OBJ1_SIZE];
+        memset(obj1_check, 0, sizeof(obj1_check));
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID + i, 0, obj1_check, sizeof(obj1_check)));
+        EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+    }
+    uint32_t load_reads = PIOS_Flash_UT_GetReadCount(flash_id) - reads;
+    EXPECT_EQ((uint32_t)(2 * BENCH_NUM_OBJS), load_reads);
+
+    /* Objects which aren't in the filesystem are rejected without touching the flash */
+    reads = PIOS_Flash_UT_GetReadCount(flash_id);
+    EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj2, sizeof(obj2)));
+    EXPECT_EQ(0u, PIOS_Flash_UT_GetReadCount(flash_id) - reads);
+
+    /* Replacing an object reads the old header to obsolete it and the free slot header */
+    reads = PIOS_Flash_UT_GetReadCount(flash_id);
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1, sizeof(obj1)));
+    uint32_t save_reads = PIOS_Flash_UT_GetReadCount(flash_id) - reads;
+    EXPECT_EQ(2u, save_reads);
+
+    /* Remount without the index, its allocation failing, to measure the linear scan */
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    pvPortMalloc_fail_countdown = 1;
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_partition_a, &pios_ut_flash_driver, flash_id));
+    EXPECT_EQ(-1, pvPortMalloc_fail_countdown);
+
+    reads = PIOS_Flash_UT_GetReadCount(flash_id);
+    for (uint32_t i = 0; i < BENCH_NUM_OBJS; i++) {
+        unsigned char obj1_check[OBJ1_SIZE];
+        memset(obj1_check, 0, sizeof(obj1_check));
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID + i, 0, obj1_check, sizeof(obj1_check)));
+        EXPECT_EQ(0, memcmp(i ? obj1_alt : obj1, obj1_check, sizeof(obj1_check)));
+    }
+    uint32_t scan_reads = PIOS_Flash_UT_GetReadCount(flash_id) - reads;
+    EXPECT_GT(scan_reads, load_reads);
+
+    printf("logfs: %u objects, mount %u reads, load %u reads (linear scan %u), save %u reads\n",
+           BENCH_NUM_OBJS, mount_reads, load_reads, scan_reads, save_reads);
+}
+
 class LogfsTestCookedMultiPart : public LogfsTestRaw {
 protected:
     virtual void SetUp()
@@ -0,0 +1,21 @@
+#ifndef PIOS_H
+#define PIOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+/* PIOS Feature Selection */
+#include "pios_config.h"
+
+#define PIOS_Assert(x) \
+    if (!(x)) { while (1) {; } \
+    }
+
+#ifdef PIOS_INCLUDE_COM
+#include <pios_com.h>
+#endif
+
+#endif /* PIOS_H */
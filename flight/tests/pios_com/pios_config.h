@@ -0,0 +1,10 @@
+#ifndef PIOS_CONFIG_H
+#define PIOS_CONFIG_H
+
+/* Enable/Disable PiOS modules */
+#define PIOS_INCLUDE_COM
+
+/* Com devices can not be freed, each test makes its own */
+#define PIOS_COM_MAX_DEVS 16
+
+#endif /* PIOS_CONFIG_H */
@@ -0,0 +1,106 @@
+/**
+ * @file       plat.c
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2013.
+ * @brief      PyMite platform functions for the host unit test
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#undef __FILE_ID__
+#define __FILE_ID__ 0x70
+
+#include <sys/time.h>
+#include "pm.h"
+
+PmReturn_t plat_init(void)
+{
+    return PM_RET_OK;
+}
+
+PmReturn_t plat_deinit(void)
+{
+    return PM_RET_OK;
+}
+
+/*
+ * Gets a byte from the address in the designated memory space
+ * Post-increments *paddr.
+ */
+uint8_t plat_memGetByte(PmMemSpace_t memspace, uint8_t const **paddr)
+{
+    uint8_t b = 0;
+
+    switch (memspace) {
+    case MEMSPACE_RAM:
+    case MEMSPACE_PROG:
+        b = **paddr;
+        *paddr += 1;
+        return b;
+
+    default:
+        return 0;
+    }
+}
+
+PmReturn_t plat_getByte(uint8_t *b)
+{
+    int c;
+    PmReturn_t retval = PM_RET_OK;
+
+    c  = getchar();
+    *b = c & 0xFF;
+
+    if (c == EOF) {
+        PM_RAISE(retval, PM_RET_EX_IO);
+    }
+
+    return retval;
+}
+
+PmReturn_t plat_putByte(uint8_t b)
+{
+    int i;
+    PmReturn_t retval = PM_RET_OK;
+
+    i = putchar(b);
+    fflush(stdout);
+
+    if ((i != b) || (i == EOF)) {
+        PM_RAISE(retval, PM_RET_EX_IO);
+    }
+
+    return retval;
+}
+
+PmReturn_t plat_getMsTicks(uint32_t *r_ticks)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    *r_ticks = tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    return PM_RET_OK;
+}
+
+void plat_reportError(PmReturn_t result)
+{
+    printf("Error:     0x%02X\n", result);
+    printf("  Release: 0x%02X\n", gVmGlobal.errVmRelease);
+    printf("  FileId:  0x%02X\n", gVmGlobal.errFileId);
+    printf("  LineNum: %d\n", gVmGlobal.errLineNum);
+}
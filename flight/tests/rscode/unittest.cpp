@@ -0,0 +1,319 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* rand_r */
+#include <string.h> /* memcmp */
+#include <sys/time.h> /* gettimeofday */
+
+extern "C" {
+#include "ecc.h"
+}
+
+// As sent by the RFM22B driver
+#define PACKET_LEN  64
+#define CODEWORD_LEN (PACKET_LEN + RS_ECC_NPARITY)
+
+#define RANDOM_RUNS 2000
+#define BENCH_RUNS  20000
+
+// GF(256) multiplication by shifts and adds, independent of the tables
+static uint8_t ReferenceMult(uint8_t a, uint8_t b)
+{
+    uint8_t p = 0;
+
+    while (b) {
+        if (b & 1) {
+            p ^= a;
+        }
+        a  = (a << 1) ^ ((a & 0x80) ? 0x1d : 0);
+        b >>= 1;
+    }
+    return p;
+}
+
+// The parity as the remainder of msg(x) * x^n divided by the generator
+// (x + a)(x + a^2)...(x + a^n), highest power first as sent on the air
+static void ReferenceParity(const uint8_t *msg, int len, uint8_t parity[RS_ECC_NPARITY])
+{
+    uint8_t gen[RS_ECC_NPARITY + 1] = { 1 };
+    uint8_t root = 1;
+
+    // gen[0] is the coefficient of the highest power
+    for (int i = 1; i <= RS_ECC_NPARITY; i++) {
+        root = ReferenceMult(root, 2);
+        for (int j = i; j > 0; j--) {
+            gen[j] ^= ReferenceMult(gen[j - 1], root);
+        }
+    }
+
+    uint8_t rem[CODEWORD_LEN] = { 0 };
+    memcpy(rem, msg, len);
+    for (int i = 0; i < len; i++) {
+        uint8_t coef = rem[i];
+        for (int j = 1; j <= RS_ECC_NPARITY; j++) {
+            rem[i + j] ^= ReferenceMult(gen[j], coef);
+        }
+    }
+    memcpy(parity, rem + len, RS_ECC_NPARITY);
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class RSCodeTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        seed = 1;
+        initialize_ecc(&ecc);
+    }
+
+    virtual void TearDown() {}
+
+    void RandomPacket(uint8_t *p, int len)
+    {
+        for (int i = 0; i < len; i++) {
+            p[i] = rand_r(&seed);
+        }
+    }
+
+    // Adds errors at distinct random locations, returns the number added
+    int AddErrors(uint8_t *p, int len, int count)
+    {
+        bool hit[CODEWORD_LEN] = { false };
+
+        for (int n = 0; n < count; n++) {
+            int loc;
+            do {
+                loc = rand_r(&seed) % len;
+            } while (hit[loc]);
+            hit[loc] = true;
+            p[loc]  ^= 1 + rand_r(&seed) % 255;
+        }
+        return count;
+    }
+
+    unsigned int seed;
+    struct rs_ecc ecc;
+};
+
+TEST_F(RSCodeTest, ParityMatchesReference) {
+    uint8_t msg[PACKET_LEN];
+    uint8_t codeword[CODEWORD_LEN];
+    uint8_t parity[RS_ECC_NPARITY];
+
+    for (int n = 0; n < RANDOM_RUNS; n++) {
+        int len = 1 + n % PACKET_LEN;
+        RandomPacket(msg, len);
+
+        encode_data(&ecc, msg, len, codeword);
+        ReferenceParity(msg, len, parity);
+        ASSERT_EQ(0, memcmp(codeword, msg, len)) << "run " << n;
+        ASSERT_EQ(0, memcmp(codeword + len, parity, RS_ECC_NPARITY)) << "run " << n;
+    }
+}
+
+TEST_F(RSCodeTest, EncodesInPlace) {
+    uint8_t msg[PACKET_LEN];
+    uint8_t codeword[CODEWORD_LEN];
+    uint8_t packet[CODEWORD_LEN];
+
+    RandomPacket(msg, PACKET_LEN);
+    memcpy(packet, msg, PACKET_LEN);
+
+    encode_data(&ecc, msg, PACKET_LEN, codeword);
+    encode_data(&ecc, packet, PACKET_LEN, packet);
+    EXPECT_EQ(0, memcmp(codeword, packet, CODEWORD_LEN));
+}
+
+TEST_F(RSCodeTest, CleanPacketPasses) {
+    uint8_t packet[CODEWORD_LEN];
+
+    for (int n = 0; n < RANDOM_RUNS; n++) {
+        int len = 1 + n % PACKET_LEN;
+        RandomPacket(packet, len);
+        encode_data(&ecc, packet, len, packet);
+
+        ASSERT_EQ(0, decode_data(&ecc, packet, len + RS_ECC_NPARITY)) << "run " << n;
+        ASSERT_EQ(0, check_syndrome(&ecc)) << "run " << n;
+    }
+
+    // A corrupted packet is seen by both
+    packet[0] ^= 1;
+    EXPECT_NE(0, decode_data(&ecc, packet, PACKET_LEN + RS_ECC_NPARITY));
+    EXPECT_NE(0, check_syndrome(&ecc));
+}
+
+TEST_F(RSCodeTest, CorrectsEverySingleError) {
+    uint8_t packet[CODEWORD_LEN];
+    uint8_t sent[CODEWORD_LEN];
+
+    RandomPacket(sent, PACKET_LEN);
+    encode_data(&ecc, sent, PACKET_LEN, sent);
+
+    for (int loc = 0; loc < CODEWORD_LEN; loc++) {
+        for (int err = 1; err < 256; err++) {
+            memcpy(packet, sent, CODEWORD_LEN);
+            packet[loc] ^= err;
+
+            ASSERT_NE(0, decode_data(&ecc, packet, CODEWORD_LEN));
+            ASSERT_EQ(1, correct_errors_erasures(&ecc, packet, CODEWORD_LEN, 0, 0)) << "loc " << loc << " err " << err;
+            ASSERT_EQ(0, memcmp(packet, sent, CODEWORD_LEN)) << "loc " << loc << " err " << err;
+        }
+    }
+}
+
+TEST_F(RSCodeTest, CorrectsEveryPairOfErrors) {
+    uint8_t packet[CODEWORD_LEN];
+    uint8_t sent[CODEWORD_LEN];
+
+    RandomPacket(sent, PACKET_LEN);
+    encode_data(&ecc, sent, PACKET_LEN, sent);
+
+    for (int loc1 = 0; loc1 < CODEWORD_LEN; loc1++) {
+        for (int loc2 = loc1 + 1; loc2 < CODEWORD_LEN; loc2++) {
+            memcpy(packet, sent, CODEWORD_LEN);
+            packet[loc1] ^= 1 + rand_r(&seed) % 255;
+            packet[loc2] ^= 1 + rand_r(&seed) % 255;
+
+            ASSERT_NE(0, decode_data(&ecc, packet, CODEWORD_LEN));
+            ASSERT_EQ(1, correct_errors_erasures(&ecc, packet, CODEWORD_LEN, 0, 0)) << "locs " << loc1 << ", " << loc2;
+            ASSERT_EQ(0, memcmp(packet, sent, CODEWORD_LEN)) << "locs " << loc1 << ", " << loc2;
+        }
+    }
+}
+
+TEST_F(RSCodeTest, CorrectsErasures) {
+    uint8_t packet[CODEWORD_LEN];
+    uint8_t sent[CODEWORD_LEN];
+    int erasures[RS_ECC_NPARITY];
+
+    for (int n = 0; n < RANDOM_RUNS; n++) {
+        RandomPacket(sent, PACKET_LEN);
+        encode_data(&ecc, sent, PACKET_LEN, sent);
+        memcpy(packet, sent, CODEWORD_LEN);
+
+        // As many erasures as parity bytes, counted from the end of the codeword
+        for (int e = 0; e < RS_ECC_NPARITY; e++) {
+            int loc = (n + e * 17) % CODEWORD_LEN;
+            packet[loc] = 0;
+            erasures[e] = CODEWORD_LEN - loc - 1;
+        }
+
+        if (decode_data(&ecc, packet, CODEWORD_LEN)) {
+            ASSERT_EQ(1, correct_errors_erasures(&ecc, packet, CODEWORD_LEN, RS_ECC_NPARITY, erasures)) << "run " << n;
+        }
+        ASSERT_EQ(0, memcmp(packet, sent, CODEWORD_LEN)) << "run " << n;
+    }
+}
+
+TEST_F(RSCodeTest, DetectsMostUncorrectablePackets) {
+    uint8_t packet[CODEWORD_LEN];
+    uint8_t sent[CODEWORD_LEN];
+    int detected = 0;
+
+    for (int n = 0; n < RANDOM_RUNS; n++) {
+        RandomPacket(sent, PACKET_LEN);
+        encode_data(&ecc, sent, PACKET_LEN, sent);
+        memcpy(packet, sent, CODEWORD_LEN);
+        AddErrors(packet, CODEWORD_LEN, 3);
+
+        ASSERT_NE(0, decode_data(&ecc, packet, CODEWORD_LEN));
+        if (correct_errors_erasures(&ecc, packet, CODEWORD_LEN, 0, 0) == 0) {
+            detected++;
+        } else {
+            // A miscorrection never gives back the packet that was sent
+            ASSERT_NE(0, memcmp(packet, sent, CODEWORD_LEN));
+        }
+    }
+    EXPECT_GT(detected, RANDOM_RUNS * 9 / 10);
+}
+
+TEST_F(RSCodeTest, CodecsAreIndependent) {
+    struct rs_ecc other;
+    uint8_t packet1[CODEWORD_LEN], sent1[CODEWORD_LEN];
+    uint8_t packet2[CODEWORD_LEN], sent2[CODEWORD_LEN];
+
+    initialize_ecc(&other);
+    for (int n = 0; n < RANDOM_RUNS; n++) {
+        RandomPacket(sent1, PACKET_LEN);
+        RandomPacket(sent2, PACKET_LEN);
+        encode_data(&ecc, sent1, PACKET_LEN, sent1);
+        encode_data(&other, sent2, PACKET_LEN, sent2);
+        memcpy(packet1, sent1, CODEWORD_LEN);
+        memcpy(packet2, sent2, CODEWORD_LEN);
+        AddErrors(packet1, CODEWORD_LEN, 1 + n % 2);
+        AddErrors(packet2, CODEWORD_LEN, 1 + (n + 1) % 2);
+
+        // The second packet is decoded before the first one is corrected
+        ASSERT_NE(0, decode_data(&ecc, packet1, CODEWORD_LEN));
+        ASSERT_NE(0, decode_data(&other, packet2, CODEWORD_LEN));
+        ASSERT_EQ(1, correct_errors_erasures(&ecc, packet1, CODEWORD_LEN, 0, 0)) << "run " << n;
+        ASSERT_EQ(1, correct_errors_erasures(&other, packet2, CODEWORD_LEN, 0, 0)) << "run " << n;
+        ASSERT_EQ(0, memcmp(packet1, sent1, CODEWORD_LEN)) << "run " << n;
+        ASSERT_EQ(0, memcmp(packet2, sent2, CODEWORD_LEN)) << "run " << n;
+    }
+}
+
+static double Elapsed(struct timeval *start)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1e6;
+}
+
+TEST_F(RSCodeTest, Throughput) {
+    struct timeval start;
+    static uint8_t sent[64][CODEWORD_LEN];
+    static uint8_t packets[BENCH_RUNS][CODEWORD_LEN];
+    const int npackets = sizeof(sent) / sizeof(sent[0]);
+    int corrected = 0, detected = 0, miscorrected = 0;
+
+    for (int n = 0; n < npackets; n++) {
+        RandomPacket(sent[n], PACKET_LEN);
+    }
+
+    gettimeofday(&start, NULL);
+    for (int n = 0; n < BENCH_RUNS; n++) {
+        encode_data(&ecc, sent[n % npackets], PACKET_LEN, sent[n % npackets]);
+    }
+    double encodeTime = Elapsed(&start);
+
+    gettimeofday(&start, NULL);
+    for (int n = 0; n < BENCH_RUNS; n++) {
+        ASSERT_EQ(0, decode_data(&ecc, sent[n % npackets], CODEWORD_LEN));
+    }
+    double checkTime = Elapsed(&start);
+
+    // Up to three byte errors in a packet, as many packets with each count
+    for (int n = 0; n < BENCH_RUNS; n++) {
+        memcpy(packets[n], sent[n % npackets], CODEWORD_LEN);
+        AddErrors(packets[n], CODEWORD_LEN, n % 4);
+    }
+
+    gettimeofday(&start, NULL);
+    for (int n = 0; n < BENCH_RUNS; n++) {
+        if (decode_data(&ecc, packets[n], CODEWORD_LEN)) {
+            correct_errors_erasures(&ecc, packets[n], CODEWORD_LEN, 0, 0);
+        }
+    }
+    double correctTime = Elapsed(&start);
+
+    for (int n = 0; n < BENCH_RUNS; n++) {
+        if (n % 4 == 0) {
+            continue;
+        }
+        if (memcmp(packets[n], sent[n % npackets], CODEWORD_LEN) == 0) {
+            corrected++;
+        } else if (decode_data(&ecc, packets[n], CODEWORD_LEN)) {
+            detected++;
+        } else {
+            miscorrected++;
+        }
+    }
+    EXPECT_EQ(BENCH_RUNS / 2, corrected);
+
+    printf("rscode: %.0f packets/s encoded, %.0f packets/s checked, %.0f packets/s with 0-3 errors corrected\n",
+           BENCH_RUNS / encodeTime, BENCH_RUNS / checkTime, BENCH_RUNS / correctTime);
+    printf("rscode: of %d packets with 1-3 errors %d corrected, %d detected, %d miscorrected\n",
+           BENCH_RUNS * 3 / 4, corrected, detected, miscorrected);
+}
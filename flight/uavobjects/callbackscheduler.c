@@ -29,18 +29,33 @@
 #include <taskinfo.h>
 
 // Private constants
-#define STACK_SIZE 128
-#define MAX_SLEEP  1000
+#define STACK_SIZE        128
+#define MAX_SLEEP         1000
+#define HEAP_INITIAL_SIZE 4
+#define HEAP_NONE         0xFFFF
+// Statistics copied at once by CallbackSchedulerForEachCallback(), on the stack of the caller
+#define STATS_COPY_BATCH  4
 
 // Private types
 /**
  * task information
+ * Dispatched callbacks are pushed onto the lock free pending stack, the
+ * scheduler task moves them into one FIFO ready queue per priority. Callbacks
+ * scheduled for a later time sit in a min-heap ordered by their schedule time.
  */
 struct DelayedCallbackTaskStruct {
     DelayedCallbackInfo *callbackQueue[CALLBACK_PRIORITY_LOW + 1];
-    DelayedCallbackInfo *queueCursor[CALLBACK_PRIORITY_LOW + 1];
+    DelayedCallbackInfo *readyQueue[CALLBACK_PRIORITY_LOW + 1];
+    DelayedCallbackInfo *readyTail[CALLBACK_PRIORITY_LOW + 1];
+    uint16_t readyCount[CALLBACK_PRIORITY_LOW + 1];
+    uint16_t roundRemaining[CALLBACK_PRIORITY_LOW + 1];
+    DelayedCallbackInfo *volatile pending;
+    DelayedCallbackInfo **scheduleHeap;
+    uint16_t    heapSize;
+    uint16_t    heapCapacity;
     xTaskHandle callbackSchedulerTaskHandle;
     signed char name[3];
+    uint8_t     index;
     uint32_t    stackSize;
     DelayedCallbackPriorityTask priorityTask;
     xSemaphoreHandle signal;
@@ -54,8 +69,13 @@ struct DelayedCallbackInfoStruct {
     DelayedCallback   cb;
     bool volatile     waiting;
     uint32_t volatile scheduletime;
+    uint16_t heapIndex;
+    DelayedCallbackPriority priority;
+    uint32_t readyTime;
+    DelayedCallbackStats stats;
     struct DelayedCallbackTaskStruct *task;
     struct DelayedCallbackInfoStruct *next;
+    struct DelayedCallbackInfoStruct *readyNext;
 };
 
 
@@ -66,7 +86,15 @@ static bool schedulerStarted;
 
 // Private functions
 static void CallbackSchedulerTask(void *task);
-static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority);
+static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task);
+static DelayedCallbackInfo *nextReadyCallback(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority);
+static bool markReady(DelayedCallbackInfo *cbinfo);
+static void appendReady(DelayedCallbackInfo *cbinfo);
+static int32_t heapInsert(struct DelayedCallbackTaskStruct *task, DelayedCallbackInfo *cbinfo);
+static void heapRemove(struct DelayedCallbackTaskStruct *task, DelayedCallbackInfo *cbinfo);
+static void heapSiftUp(struct DelayedCallbackTaskStruct *task, uint16_t index);
+static void heapSiftDown(struct DelayedCallbackTaskStruct *task, uint16_t index);
+static uint8_t histogramBucket(uint32_t us);
 
 /**
  * Initialize the scheduler
@@ -175,6 +203,16 @@ int32_t DelayedCallbackSchedule(
             result = 2;
         }
         cbinfo->scheduletime = new;
+        if (cbinfo->heapIndex == HEAP_NONE) {
+            if (heapInsert(cbinfo->task, cbinfo) != 0) {
+                cbinfo->scheduletime = 0;
+                xSemaphoreGiveRecursive(mutex);
+                return 0;
+            }
+        } else {
+            heapSiftUp(cbinfo->task, cbinfo->heapIndex);
+            heapSiftDown(cbinfo->task, cbinfo->heapIndex);
+        }
 
         // scheduler needs to be notified to adapt sleep times
         xSemaphoreGive(cbinfo->task->signal);
@@ -196,7 +234,7 @@ int32_t DelayedCallbackDispatch(DelayedCallbackInfo *cbinfo)
     PIOS_Assert(cbinfo);
 
     // no semaphore needed for the callback
-    cbinfo->waiting = true;
+    markReady(cbinfo);
     // but the scheduler as a whole needs to be notified
     return xSemaphoreGive(cbinfo->task->signal);
 }
@@ -219,8 +257,8 @@ int32_t DelayedCallbackDispatchFromISR(DelayedCallbackInfo *cbinfo, long *pxHigh
 {
     PIOS_Assert(cbinfo);
 
-    // no semaphore needed for the callback
-    cbinfo->waiting = true;
+    // no semaphore needed for the callback, the pending stack is lock free
+    markReady(cbinfo);
     // but the scheduler as a whole needs to be notified
     return xSemaphoreGiveFromISR(cbinfo->task->signal, pxHigherPriorityTaskWoken);
 }
@@ -265,9 +303,17 @@ DelayedCallbackInfo *DelayedCallbackCreate(
 
         // initialize structure
         for (DelayedCallbackPriority p = 0; p <= CALLBACK_PRIORITY_LOW; p++) {
-            task->callbackQueue[p] = NULL;
-            task->queueCursor[p]   = NULL;
+            task->callbackQueue[p]  = NULL;
+            task->readyQueue[p]     = NULL;
+            task->readyTail[p]      = NULL;
+            task->readyCount[p]     = 0;
+            task->roundRemaining[p] = 0;
         }
+        task->pending      = NULL;
+        task->scheduleHeap = NULL;
+        task->heapSize     = 0;
+        task->heapCapacity = 0;
+        task->index        = t;
         task->name[0]      = 'C';
         task->name[1]      = 'a' + t;
         task->name[2]      = 0;
@@ -318,11 +364,18 @@ DelayedCallbackInfo *DelayedCallbackCreate(
         xSemaphoreGiveRecursive(mutex);
         return NULL; // error - not enough memory
     }
-    info->next    = NULL;
-    info->waiting = false;
+    info->next      = NULL;
+    info->readyNext = NULL;
+    info->waiting   = false;
     info->scheduletime = 0;
-    info->task    = task;
+    info->heapIndex = HEAP_NONE;
+    info->priority  = priority;
+    info->readyTime = 0;
+    info->task      = task;
     info->cb = cb;
+    memset(&info->stats, 0, sizeof(DelayedCallbackStats));
+    info->stats.schedulerTask = task->index;
+    info->stats.priority = priority;
 
     // add to scheduling queue
     LL_APPEND(task->callbackQueue[priority], info);
@@ -332,67 +385,328 @@ DelayedCallbackInfo *DelayedCallbackCreate(
     return info;
 }
 
+/**
+ * Iterate over all registered callbacks and report their statistics.
+ * Callbacks are numbered by scheduler task and priority. The statistics are
+ * copied a few callbacks at a time with the mutex held, the callback is called
+ * with the mutex released so that it does not hold up the scheduler tasks.
+ * \param[in] callback The function to call for each callback
+ * \param[in] context Passed to callback
+ */
+void CallbackSchedulerForEachCallback(DelayedCallbackStatsCallback callback, void *context)
+{
+    DelayedCallbackStats stats[STATS_COPY_BATCH];
+    struct DelayedCallbackTaskStruct *task;
+    DelayedCallbackInfo *info;
+    uint16_t first = 0;
+    uint16_t count;
+
+    do {
+        uint16_t callback_id = 0;
+        count = 0;
+
+        // callbacks are never removed, the numbering of the previous batches holds
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+        LL_FOREACH(schedulerTasks, task) {
+            for (DelayedCallbackPriority p = 0; p <= CALLBACK_PRIORITY_LOW; p++) {
+                LL_FOREACH(task->callbackQueue[p], info) {
+                    if (callback_id >= first && count < STATS_COPY_BATCH) {
+                        portENTER_CRITICAL();
+                        stats[count++] = info->stats;
+                        portEXIT_CRITICAL();
+                    }
+                    callback_id++;
+                }
+            }
+        }
+        xSemaphoreGiveRecursive(mutex);
+
+        for (uint16_t n = 0; n < count; n++) {
+            callback(first + n, &stats[n], context);
+        }
+        first += count;
+    } while (count == STATS_COPY_BATCH);
+}
+
+/**
+ * Flag a callback for execution and push it onto the pending stack of its
+ * scheduler task. Lock free, can be called from an ISR.
+ * \param[in] cbinfo the callback handle
+ * \return true if the callback was pushed, false if it was already waiting
+ */
+static bool markReady(DelayedCallbackInfo *cbinfo)
+{
+    struct DelayedCallbackTaskStruct *task = cbinfo->task;
+    DelayedCallbackInfo *head;
+
+    // only one dispatch can win, the callback is queued at most once
+    if (__sync_lock_test_and_set(&cbinfo->waiting, true)) {
+        return false;
+    }
+    cbinfo->readyTime = PIOS_DELAY_GetRaw();
+    do {
+        head = task->pending;
+        cbinfo->readyNext = head;
+    } while (!__sync_bool_compare_and_swap(&task->pending, head, cbinfo));
+
+    return true;
+}
+
+/**
+ * Append a callback at the end of the ready queue of its priority.
+ * Must be called by the scheduler task with the mutex held.
+ * \param[in] cbinfo the callback handle
+ */
+static void appendReady(DelayedCallbackInfo *cbinfo)
+{
+    struct DelayedCallbackTaskStruct *task = cbinfo->task;
+    DelayedCallbackPriority priority = cbinfo->priority;
+
+    cbinfo->readyNext = NULL;
+    if (task->readyTail[priority]) {
+        task->readyTail[priority]->readyNext = cbinfo;
+    } else {
+        task->readyQueue[priority] = cbinfo;
+    }
+    task->readyTail[priority] = cbinfo;
+    task->readyCount[priority]++;
+}
+
+/**
+ * Take the next callback to run out of the ready queues.
+ * Callbacks of the same priority are run in a round robin way, every time a
+ * round of a priority is completed one slot is handed to the next lower
+ * priority.
+ * \param[in] task The scheduler task in question
+ * \param[in] priority The highest priority to search
+ * \return The callback to run or NULL if none is ready
+ */
+static DelayedCallbackInfo *nextReadyCallback(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority)
+{
+    DelayedCallbackInfo *current;
+
+    // no such queue
+    if (priority > CALLBACK_PRIORITY_LOW) {
+        return NULL;
+    }
+
+    // round completed, start a new one but run a callback with lower priority first
+    if (task->roundRemaining[priority] == 0) {
+        task->roundRemaining[priority] = task->readyCount[priority];
+        current = nextReadyCallback(task, priority + 1);
+        if (current) {
+            return current;
+        }
+    }
+
+    // queue is empty, search a lower priority queue
+    current = task->readyQueue[priority];
+    if (current == NULL) {
+        return nextReadyCallback(task, priority + 1);
+    }
+
+    task->readyQueue[priority] = current->readyNext;
+    if (task->readyQueue[priority] == NULL) {
+        task->readyTail[priority] = NULL;
+    }
+    task->readyCount[priority]--;
+    if (task->roundRemaining[priority] > 0) {
+        task->roundRemaining[priority]--;
+    }
+    return current;
+}
+
 /**
  * Scheduler subtask
  * \param[in] task The scheduler task in question
- * \param[in] priority The scheduling priority of the callback to search for
  * \return wait time until next scheduled callback is due - 0 if a callback has just been executed
  */
-static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority)
+static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task)
 {
+    DelayedCallbackInfo *current;
+    DelayedCallbackInfo *dispatched;
+    DelayedCallbackInfo *reversed = NULL;
     int32_t result = MAX_SLEEP;
-    int32_t diff   = 0;
 
-    // no such queue
-    if (priority > CALLBACK_PRIORITY_LOW) {
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+
+    // move the dispatched callbacks into the ready queues, in dispatch order
+    dispatched = __sync_lock_test_and_set(&task->pending, NULL);
+    while (dispatched) {
+        current    = dispatched;
+        dispatched = current->readyNext;
+        current->readyNext = reversed;
+        reversed   = current;
+    }
+    while (reversed) {
+        current  = reversed;
+        reversed = current->readyNext;
+        appendReady(current);
+    }
+
+    // callbacks whose schedule is due are ready as well
+    uint32_t now = xTaskGetTickCount();
+    while (task->heapSize > 0 && (int32_t)(task->scheduleHeap[0]->scheduletime - now) <= 0) {
+        current = task->scheduleHeap[0];
+        heapRemove(task, current);
+        current->scheduletime = 0;
+        if (!__sync_lock_test_and_set(&current->waiting, true)) {
+            current->readyTime = PIOS_DELAY_GetRaw();
+            appendReady(current);
+        }
+    }
+
+    current = nextReadyCallback(task, CALLBACK_PRIORITY_CRITICAL);
+    if (current == NULL) {
+        // nothing to do, sleep until the next schedule is due
+        if (task->heapSize > 0 && (int32_t)(task->scheduleHeap[0]->scheduletime - now) < result) {
+            result = task->scheduleHeap[0]->scheduletime - now;
+        }
+        xSemaphoreGiveRecursive(mutex);
         return result;
     }
 
-    // queue is empty, search a lower priority queue
-    if (task->callbackQueue[priority] == NULL) {
-        return runNextCallback(task, priority + 1);
+    heapRemove(task, current);
+    current->scheduletime = 0; // any schedules are reset
+    current->waiting = false; // the flag is reset just before execution.
+    xSemaphoreGiveRecursive(mutex);
+
+    uint32_t latency = PIOS_DELAY_DiffuS(current->readyTime);
+    uint32_t start   = PIOS_DELAY_GetRaw();
+    current->cb(); // call the callback
+    uint32_t runtime = PIOS_DELAY_DiffuS(start);
+    uint8_t latencyBucket = histogramBucket(latency);
+    uint8_t runtimeBucket = histogramBucket(runtime);
+
+    // the statistics are only written by this task, in a critical section so that
+    // CallbackSchedulerForEachCallback() copies them consistently
+    portENTER_CRITICAL();
+    current->stats.runCount++;
+    if (latency > current->stats.maxLatency) {
+        current->stats.maxLatency = latency;
+    }
+    if (runtime > current->stats.maxRunTime) {
+        current->stats.maxRunTime = runtime;
+    }
+    if (current->stats.latency[latencyBucket] < UINT16_MAX) {
+        current->stats.latency[latencyBucket]++;
     }
+    if (current->stats.runTime[runtimeBucket] < UINT16_MAX) {
+        current->stats.runTime[runtimeBucket]++;
+    }
+    portEXIT_CRITICAL();
 
-    DelayedCallbackInfo *current = task->queueCursor[priority];
-    DelayedCallbackInfo *next;
-    do {
-        if (current == NULL) {
-            next = task->callbackQueue[priority]; // loop around the end of the list
-            // also attempt to run a callback that has lower priority
-            // every time the queue is completely traversed
-            diff = runNextCallback(task, priority + 1);
-            if (!diff) {
-                task->queueCursor[priority] = next; // the recursive call has executed a callback
-                return 0;
-            }
-            if (diff < result) {
-                result = diff; // adjust sleep time
-            }
-        } else {
-            next = current->next;
-            xSemaphoreTakeRecursive(mutex, portMAX_DELAY); // access to scheduletime should be mutex protected
-            if (current->scheduletime) {
-                diff = current->scheduletime - xTaskGetTickCount();
-                if (diff <= 0) {
-                    current->waiting = true;
-                } else if (diff < result) {
-                    result = diff; // adjust sleep time
-                }
-            }
-            if (current->waiting) {
-                task->queueCursor[priority] = next;
-                current->scheduletime = 0; // any schedules are reset
-                current->waiting = false; // the flag is reset just before execution.
-                xSemaphoreGiveRecursive(mutex);
-                current->cb(); // call the callback
-                return 0;
-            }
-            xSemaphoreGiveRecursive(mutex);
+    return 0;
+}
+
+/**
+ * The histogram bucket of a duration, bucket n holds durations
+ * below 16 * 4^n us, the last bucket everything above.
+ */
+static uint8_t histogramBucket(uint32_t us)
+{
+    uint8_t bucket = 0;
+
+    for (us >>= 4; us && bucket < CALLBACK_HISTOGRAM_BUCKETS - 1; us >>= 2) {
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * Add a callback to the schedule heap of its task, growing the heap if it is full.
+ * Must be called with the mutex held.
+ * \return Success (0), failure (-1)
+ */
+static int32_t heapInsert(struct DelayedCallbackTaskStruct *task, DelayedCallbackInfo *cbinfo)
+{
+    if (task->heapSize == task->heapCapacity) {
+        // Grow geometrically, vPortFree() does not give the memory back with heap_1
+        uint16_t capacity = task->heapCapacity ? task->heapCapacity * 2 : HEAP_INITIAL_SIZE;
+        DelayedCallbackInfo **heap = (DelayedCallbackInfo **)pvPortMalloc(capacity * sizeof(DelayedCallbackInfo *));
+        if (heap == NULL) {
+            return -1;
         }
-        current = next;
-    } while (current != task->queueCursor[priority]);
-    // once the list has been traversed entirely without finding any to be executed task, abort (nothing to do)
-    return result;
+        if (task->scheduleHeap) {
+            memcpy(heap, task->scheduleHeap, task->heapSize * sizeof(DelayedCallbackInfo *));
+            vPortFree(task->scheduleHeap);
+        }
+        task->scheduleHeap = heap;
+        task->heapCapacity = capacity;
+    }
+
+    cbinfo->heapIndex = task->heapSize;
+    task->scheduleHeap[task->heapSize++] = cbinfo;
+    heapSiftUp(task, cbinfo->heapIndex);
+    return 0;
+}
+
+/**
+ * Remove a callback from the schedule heap of its task, if it is in there.
+ * Must be called with the mutex held.
+ */
+static void heapRemove(struct DelayedCallbackTaskStruct *task, DelayedCallbackInfo *cbinfo)
+{
+    uint16_t index = cbinfo->heapIndex;
+
+    if (index == HEAP_NONE) {
+        return;
+    }
+
+    cbinfo->heapIndex = HEAP_NONE;
+    if (index != --task->heapSize) {
+        // Move the last entry into the hole and restore the heap order
+        DelayedCallbackInfo *moved = task->scheduleHeap[task->heapSize];
+        task->scheduleHeap[index] = moved;
+        heapSiftUp(task, index);
+        heapSiftDown(task, moved->heapIndex);
+    }
+}
+
+/**
+ * Move a heap entry up until its parent is not due later than itself.
+ */
+static void heapSiftUp(struct DelayedCallbackTaskStruct *task, uint16_t index)
+{
+    DelayedCallbackInfo **heap = task->scheduleHeap;
+    DelayedCallbackInfo *cbinfo = heap[index];
+
+    while (index > 0) {
+        uint16_t parent = (index - 1) / 2;
+        if ((int32_t)(cbinfo->scheduletime - heap[parent]->scheduletime) >= 0) {
+            break;
+        }
+        heap[index] = heap[parent];
+        heap[index]->heapIndex = index;
+        index = parent;
+    }
+    heap[index] = cbinfo;
+    cbinfo->heapIndex = index;
+}
+
+/**
+ * Move a heap entry down until none of its children is due earlier than itself.
+ */
+static void heapSiftDown(struct DelayedCallbackTaskStruct *task, uint16_t index)
+{
+    DelayedCallbackInfo **heap = task->scheduleHeap;
+    DelayedCallbackInfo *cbinfo = heap[index];
+
+    while (2 * index + 1 < task->heapSize) {
+        uint16_t child = 2 * index + 1;
+        if (child + 1 < task->heapSize &&
+            (int32_t)(heap[child + 1]->scheduletime - heap[child]->scheduletime) < 0) {
+            child++;
+        }
+        if ((int32_t)(heap[child]->scheduletime - cbinfo->scheduletime) >= 0) {
+            break;
+        }
+        heap[index] = heap[child];
+        heap[index]->heapIndex = index;
+        index = child;
+    }
+    heap[index] = cbinfo;
+    cbinfo->heapIndex = index;
 }
 
 /**
@@ -404,7 +718,7 @@ static void CallbackSchedulerTask(void *task)
     uint32_t delay = 0;
 
     while (1) {
-        delay = runNextCallback((struct DelayedCallbackTaskStruct *)task, CALLBACK_PRIORITY_CRITICAL);
+        delay = runNextCallback((struct DelayedCallbackTaskStruct *)task);
         if (delay) {
             // nothing to do but sleep
             xSemaphoreTake(((struct DelayedCallbackTaskStruct *)task)->signal, delay);
@@ -43,6 +43,8 @@
 
 #define TASK_PRIORITY        (tskIDLE_PRIORITY + 3)
 #define MAX_UPDATE_PERIOD_MS 1000
+#define HEAP_INITIAL_SIZE    16
+#define HEAP_NONE            0xFFFF
 
 // Private types
 
@@ -58,17 +60,23 @@ typedef struct {
 
 /**
  * List of object properties that are needed for the periodic updates.
+ * Entries with a non zero period are also kept in a binary min-heap ordered
+ * by the time of their next update, so that a wakeup only touches the due ones.
  */
 struct PeriodicObjectListStruct {
     EventCallbackInfo evInfo; /** Event callback information */
     uint16_t updatePeriodMs; /** Update period in ms or 0 if no periodic updates are needed */
-    int32_t  timeToNextUpdateMs; /** Time delay to the next update */
+    uint16_t heapIndex; /** Position in mHeap or HEAP_NONE if not scheduled */
+    int32_t  timeToNextUpdateMs; /** System time of the next update */
     struct PeriodicObjectListStruct *next; /** Needed by linked list library (utlist.h) */
 };
 typedef struct PeriodicObjectListStruct PeriodicObjectList;
 
 // Private variables
 static PeriodicObjectList *mObjList;
+static PeriodicObjectList **mHeap;
+static uint16_t mHeapSize;
+static uint16_t mHeapCapacity;
 static xQueueHandle mQueue;
 static xTaskHandle mEventTaskHandle;
 static xSemaphoreHandle mMutex;
@@ -80,6 +88,11 @@ static void eventTask();
 static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQueueHandle queue, uint16_t periodMs);
 static int32_t eventPeriodicUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, xQueueHandle queue, uint16_t periodMs);
 static uint16_t randomizePeriod(uint16_t periodMs);
+static void schedule(PeriodicObjectList *objEntry, int32_t timeNow);
+static int32_t heapInsert(PeriodicObjectList *objEntry);
+static void heapRemove(PeriodicObjectList *objEntry);
+static void heapSiftUp(uint16_t index);
+static void heapSiftDown(uint16_t index);
 
 
 /**
@@ -89,7 +102,10 @@ static uint16_t randomizePeriod(uint16_t periodMs);
 int32_t EventDispatcherInitialize()
 {
     // Initialize variables
-    mObjList = NULL;
+    mObjList      = NULL;
+    mHeap         = NULL;
+    mHeapSize     = 0;
+    mHeapCapacity = 0;
     memset(&mStats, 0, sizeof(EventStats));
 
     // Create mMutex
@@ -225,6 +241,7 @@ static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
     // Create handle
     objEntry = (PeriodicObjectList *)pvPortMalloc(sizeof(PeriodicObjectList));
     if (objEntry == NULL) {
+        xSemaphoreGiveRecursive(mMutex);
         return -1;
     }
     objEntry->evInfo.ev.obj      = ev->obj;
@@ -233,9 +250,10 @@ static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
     objEntry->evInfo.cb = cb;
     objEntry->evInfo.queue       = queue;
     objEntry->updatePeriodMs     = periodMs;
-    objEntry->timeToNextUpdateMs = randomizePeriod(periodMs); // avoid bunching of updates
+    objEntry->heapIndex = HEAP_NONE;
     // Add to list
     LL_APPEND(mObjList, objEntry);
+    schedule(objEntry, xTaskGetTickCount() * portTICK_RATE_MS);
     // Release lock
     xSemaphoreGiveRecursive(mMutex);
     return 0;
@@ -263,8 +281,8 @@ static int32_t eventPeriodicUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
             objEntry->evInfo.ev.instId == ev->instId &&
             objEntry->evInfo.ev.event == ev->event) {
             // Object found, update period
-            objEntry->updatePeriodMs     = periodMs;
-            objEntry->timeToNextUpdateMs = randomizePeriod(periodMs); // avoid bunching of updates
+            objEntry->updatePeriodMs = periodMs;
+            schedule(objEntry, xTaskGetTickCount() * portTICK_RATE_MS);
             // Release lock
             xSemaphoreGiveRecursive(mMutex);
             return 0;
@@ -280,8 +298,8 @@ static int32_t eventPeriodicUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
  */
 static void eventTask()
 {
-    uint32_t timeToNextUpdateMs;
-    uint32_t delayMs;
+    int32_t timeToNextUpdateMs;
+    int32_t delayMs;
     EventCallbackInfo evInfo;
 
     /* Must do this in task context to ensure that TaskMonitor has already finished its init */
@@ -292,8 +310,11 @@ static void eventTask()
 
     // Loop forever
     while (1) {
-        // Calculate delay time
-        delayMs = timeToNextUpdateMs - (xTaskGetTickCount() * portTICK_RATE_MS);
+        // Calculate delay time, an update may already be due
+        delayMs = timeToNextUpdateMs - (int32_t)(xTaskGetTickCount() * portTICK_RATE_MS);
+        if (delayMs < 0) {
+            delayMs = 0;
+        }
 
         // Wait for queue message
         if (xQueueReceive(mQueue, &evInfo, delayMs / portTICK_RATE_MS) == pdTRUE) {
@@ -304,64 +325,192 @@ static void eventTask()
         }
 
         // Process periodic updates
-        if ((xTaskGetTickCount() * portTICK_RATE_MS) >= timeToNextUpdateMs) {
+        if ((int32_t)(xTaskGetTickCount() * portTICK_RATE_MS) - timeToNextUpdateMs >= 0) {
             timeToNextUpdateMs = processPeriodicUpdates();
         }
     }
 }
 
 /**
- * Handle periodic updates for all objects.
- * \return The system time until the next update (in ms) or -1 if failed
+ * Handle periodic updates for all objects that are due.
+ * \return The system time of the next update (in ms)
  */
 static int32_t processPeriodicUpdates()
 {
     PeriodicObjectList *objEntry;
     int32_t timeNow;
     int32_t timeToNextUpdate;
-    int32_t offset;
+    int32_t lateMs;
 
     // Get lock
     xSemaphoreTakeRecursive(mMutex, portMAX_DELAY);
 
-    // Iterate through each object and update its timer, if zero then transmit object.
-    // Also calculate smallest delay to next update.
-    timeToNextUpdate = xTaskGetTickCount() * portTICK_RATE_MS + MAX_UPDATE_PERIOD_MS;
-    LL_FOREACH(mObjList, objEntry) {
-        // If object is configured for periodic updates
-        if (objEntry->updatePeriodMs > 0) {
-            // Check if time for the next update
-            timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
-            if (objEntry->timeToNextUpdateMs <= timeNow) {
-                // Reset timer
-                offset = (timeNow - objEntry->timeToNextUpdateMs) % objEntry->updatePeriodMs;
-                objEntry->timeToNextUpdateMs = timeNow + objEntry->updatePeriodMs - offset;
-                // Invoke callback, if one
-                if (objEntry->evInfo.cb != 0) {
-                    objEntry->evInfo.cb(&objEntry->evInfo.ev); // the function is expected to copy the event information
-                }
-                // Push event to queue, if one
-                if (objEntry->evInfo.queue != 0) {
-                    if (xQueueSend(objEntry->evInfo.queue, &objEntry->evInfo.ev, 0) != pdTRUE) { // do not block if queue is full
-                        if (objEntry->evInfo.ev.obj != NULL) {
-                            mStats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
-                        }
-                        ++mStats.eventErrors;
-                    }
+    // Pop the due objects off the top of the heap, reschedule and dispatch them.
+    timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
+    while (mHeapSize > 0 && timeNow - mHeap[0]->timeToNextUpdateMs >= 0) {
+        objEntry = mHeap[0];
+
+        // Keep track of how late the update is
+        lateMs   = timeNow - objEntry->timeToNextUpdateMs;
+        if ((uint32_t)lateMs > mStats.maxJitterMs) {
+            mStats.maxJitterMs = lateMs;
+        }
+        if (lateMs >= objEntry->updatePeriodMs) {
+            ++mStats.lateUpdates;
+        }
+
+        // Reset timer, keeping the phase of the updates
+        objEntry->timeToNextUpdateMs = timeNow + objEntry->updatePeriodMs - lateMs % objEntry->updatePeriodMs;
+        heapSiftDown(0);
+
+        // Invoke callback, if one
+        if (objEntry->evInfo.cb != 0) {
+            objEntry->evInfo.cb(&objEntry->evInfo.ev); // the function is expected to copy the event information
+        }
+        // Push event to queue, if one
+        if (objEntry->evInfo.queue != 0) {
+            if (xQueueSend(objEntry->evInfo.queue, &objEntry->evInfo.ev, 0) != pdTRUE) { // do not block if queue is full
+                if (objEntry->evInfo.ev.obj != NULL) {
+                    mStats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
                 }
-            }
-            // Update minimum delay
-            if (objEntry->timeToNextUpdateMs < timeToNextUpdate) {
-                timeToNextUpdate = objEntry->timeToNextUpdateMs;
+                ++mStats.eventErrors;
             }
         }
     }
 
+    // The next update is the one on top of the heap
+    if (mHeapSize > 0 && mHeap[0]->timeToNextUpdateMs - timeNow < MAX_UPDATE_PERIOD_MS) {
+        timeToNextUpdate = mHeap[0]->timeToNextUpdateMs;
+    } else {
+        timeToNextUpdate = timeNow + MAX_UPDATE_PERIOD_MS;
+    }
+
     // Done
     xSemaphoreGiveRecursive(mMutex);
     return timeToNextUpdate;
 }
 
+/**
+ * (Re)schedule the periodic updates of an object after its period changed.
+ * Must be called with mMutex held.
+ * \param[in] objEntry The object entry
+ * \param[in] timeNow The current system time (in ms)
+ */
+static void schedule(PeriodicObjectList *objEntry, int32_t timeNow)
+{
+    if (objEntry->updatePeriodMs == 0) {
+        heapRemove(objEntry);
+        return;
+    }
+
+    objEntry->timeToNextUpdateMs = timeNow + randomizePeriod(objEntry->updatePeriodMs); // avoid bunching of updates
+    if (objEntry->heapIndex == HEAP_NONE) {
+        if (heapInsert(objEntry) != 0) {
+            if (objEntry->evInfo.ev.obj != NULL) {
+                mStats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
+            }
+            ++mStats.eventErrors;
+        }
+    } else {
+        heapSiftUp(objEntry->heapIndex);
+        heapSiftDown(objEntry->heapIndex);
+    }
+}
+
+/**
+ * Add an object entry to the heap, growing the heap if it is full.
+ * \param[in] objEntry The object entry
+ * \return Success (0), failure (-1)
+ */
+static int32_t heapInsert(PeriodicObjectList *objEntry)
+{
+    if (mHeapSize == mHeapCapacity) {
+        // Grow geometrically, vPortFree() does not give the memory back with heap_1
+        uint16_t capacity = mHeapCapacity ? mHeapCapacity * 2 : HEAP_INITIAL_SIZE;
+        PeriodicObjectList **heap = (PeriodicObjectList **)pvPortMalloc(capacity * sizeof(PeriodicObjectList *));
+        if (heap == NULL) {
+            return -1;
+        }
+        if (mHeap) {
+            memcpy(heap, mHeap, mHeapSize * sizeof(PeriodicObjectList *));
+            vPortFree(mHeap);
+        }
+        mHeap = heap;
+        mHeapCapacity = capacity;
+    }
+
+    objEntry->heapIndex = mHeapSize;
+    mHeap[mHeapSize++]  = objEntry;
+    heapSiftUp(objEntry->heapIndex);
+    return 0;
+}
+
+/**
+ * Remove an object entry from the heap, if it is in there.
+ * \param[in] objEntry The object entry
+ */
+static void heapRemove(PeriodicObjectList *objEntry)
+{
+    uint16_t index = objEntry->heapIndex;
+
+    if (index == HEAP_NONE) {
+        return;
+    }
+
+    objEntry->heapIndex = HEAP_NONE;
+    if (index != --mHeapSize) {
+        // Move the last entry into the hole and restore the heap order
+        PeriodicObjectList *moved = mHeap[mHeapSize];
+        mHeap[index] = moved;
+        heapSiftUp(index);
+        heapSiftDown(moved->heapIndex);
+    }
+}
+
+/**
+ * Move a heap entry up until its parent is not due later than itself.
+ */
+static void heapSiftUp(uint16_t index)
+{
+    PeriodicObjectList *objEntry = mHeap[index];
+
+    while (index > 0) {
+        uint16_t parent = (index - 1) / 2;
+        if (objEntry->timeToNextUpdateMs - mHeap[parent]->timeToNextUpdateMs >= 0) {
+            break;
+        }
+        mHeap[index] = mHeap[parent];
+        mHeap[index]->heapIndex = index;
+        index = parent;
+    }
+    mHeap[index] = objEntry;
+    objEntry->heapIndex = index;
+}
+
+/**
+ * Move a heap entry down until none of its children is due earlier than itself.
+ */
+static void heapSiftDown(uint16_t index)
+{
+    PeriodicObjectList *objEntry = mHeap[index];
+
+    while (2 * index + 1 < mHeapSize) {
+        uint16_t child = 2 * index + 1;
+        if (child + 1 < mHeapSize &&
+            mHeap[child + 1]->timeToNextUpdateMs - mHeap[child]->timeToNextUpdateMs < 0) {
+            child++;
+        }
+        if (mHeap[child]->timeToNextUpdateMs - objEntry->timeToNextUpdateMs >= 0) {
+            break;
+        }
+        mHeap[index] = mHeap[child];
+        mHeap[index]->heapIndex = index;
+        index = child;
+    }
+    mHeap[index] = objEntry;
+    objEntry->heapIndex = index;
+}
+
 /**
  * Return a psedorandom integer from 0 to periodMs
  * Based on the Park-Miller-Carta Pseudo-Random Number Generator
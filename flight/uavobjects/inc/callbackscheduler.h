@@ -96,6 +96,24 @@ typedef enum {
 typedef void (*DelayedCallback)(void);
 // Use this type for the callback function.
 
+#define CALLBACK_HISTOGRAM_BUCKETS 8
+typedef struct {
+    uint8_t  schedulerTask;
+    DelayedCallbackPriority priority;
+    uint32_t runCount;
+    uint32_t maxRunTime;
+    uint32_t maxLatency;
+    uint16_t runTime[CALLBACK_HISTOGRAM_BUCKETS];
+    uint16_t latency[CALLBACK_HISTOGRAM_BUCKETS];
+} DelayedCallbackStats;
+// Run time and latency statistics of a callback, times are in us.
+// Latency is measured from the dispatch, or the moment the schedule is due,
+// until the callback starts. Histogram bucket n counts durations below
+// 16 * 4^n us, the last bucket counts everything above.
+
+typedef void (*DelayedCallbackStatsCallback)(uint16_t callback_id, const DelayedCallbackStats *stats, void *context);
+// Iterator callback, called for each registered callback by CallbackSchedulerForEachCallback().
+
 struct DelayedCallbackInfoStruct;
 typedef struct DelayedCallbackInfoStruct DelayedCallbackInfo;
 // Use a pointer to DelayedCallbackInfo as a handle to identify registered callbacks.
@@ -184,4 +202,12 @@ int32_t DelayedCallbackDispatch(DelayedCallbackInfo *cbinfo);
  */
 int32_t DelayedCallbackDispatchFromISR(DelayedCallbackInfo *cbinfo, long *pxHigherPriorityTaskWoken);
 
+/**
+ * Iterate over all registered callbacks and report their statistics.
+ * Callbacks are numbered by scheduler task and priority.
+ * \param[in] callback The function to call for each callback
+ * \param[in] context Passed to callback
+ */
+void CallbackSchedulerForEachCallback(DelayedCallbackStatsCallback callback, void *context);
+
 #endif // CALLBACKSCHEDULER_H
@@ -33,6 +33,8 @@
 typedef struct {
     uint32_t lastErrorID;
     uint32_t eventErrors;
+    uint32_t maxJitterMs; /** Largest delay of a periodic update past its due time */
+    uint32_t lateUpdates; /** Number of periodic updates delayed by a whole period or more */
 } EventStats;
 
 // Public functions
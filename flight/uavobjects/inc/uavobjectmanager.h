@@ -138,12 +138,27 @@ typedef struct {
     uint32_t lastQueueErrorID;
 } UAVObjStats;
 
+/**
+ * Per object lock statistics, only collected with PIOS_UAVOBJ_PER_OBJECT_LOCK
+ */
+typedef struct {
+    uint32_t lockCount; /** Number of times the object was locked */
+    uint32_t contendedCount; /** Number of times the lock was held by another task */
+    uint32_t waitTimeUs; /** Total time spent waiting for the lock (us) */
+    uint32_t maxWaitTimeUs; /** Longest single wait for the lock (us) */
+} UAVObjLockStats;
+
 int32_t UAVObjInitialize();
 void UAVObjGetStats(UAVObjStats *statsOut);
 void UAVObjClearStats();
+int32_t UAVObjGetLockStats(UAVObjHandle obj_handle, UAVObjLockStats *statsOut);
+void UAVObjClearLockStats(UAVObjHandle obj_handle);
 UAVObjHandle UAVObjRegister(uint32_t id,
                             int32_t isSingleInstance, int32_t isSettings, uint32_t numBytes, UAVObjInitializeCallback initCb);
 UAVObjHandle UAVObjGetByID(uint32_t id);
+uint16_t UAVObjGetNumIndexes();
+int32_t UAVObjGetIndex(UAVObjHandle obj);
+UAVObjHandle UAVObjGetByIndex(uint16_t index);
 uint32_t UAVObjGetID(UAVObjHandle obj);
 uint32_t UAVObjGetNumBytes(UAVObjHandle obj);
 uint16_t UAVObjGetNumInstances(UAVObjHandle obj);
@@ -87,11 +87,11 @@ struct ObjectEventEntry {
 /*
    MetaInstance   == [UAVOBase [UAVObjMetadata]]
    SingleInstance == [UAVOBase [UAVOData [InstanceData]]]
-   MultiInstance  == [UAVOBase [UAVOData [NumInstances [InstanceData0 [next]]]]
-                                                  ____________________/
-   \-->[InstanceData1 [next]]
-                                                  _________...________/
-   \-->[InstanceDataN [next]]
+   MultiInstance  == [UAVOBase [UAVOData [NumInstances [Blocks[0..N] [InstanceData0]]]]
+                                                         |
+                                                         +-->[InstanceData1 InstanceData2]
+                                                         +-->[InstanceData3 ... InstanceData6]
+                                                         +-->[InstanceData(2^N-1) ... InstanceData(2^(N+1)-2)]
  */
 
 /*
@@ -127,6 +127,14 @@ struct UAVOData {
      */
     struct UAVOMeta metaObj;
     uint16_t instance_size;
+#if defined(PIOS_UAVOBJ_PER_OBJECT_LOCK)
+    /*
+     * Protects the instance data, the embedded metadata and the
+     * event lists of this object and of its meta object.
+     */
+    xSemaphoreHandle lock;
+    UAVObjLockStats  lockStats;
+#endif
 } __attribute__((packed, aligned(4)));
 
 /* Augmented type for Single Instance Data UAVO */
@@ -140,21 +148,32 @@ struct UAVOSingle {
      */
 } __attribute__((packed));
 
-/* Part of a linked list of instances chained off of a multi instance UAVO. */
-struct UAVOMultiInst {
-    struct UAVOMultiInst *next;
-    uint8_t instance[];
-    /*
-     * Additional space will be malloc'd here to hold the
-     * the data for this instance.
-     */
-} __attribute__((packed));
+/*
+ * Instances of a multi instance UAVO are stored in blocks of contiguous
+ * memory. Block N < UAVO_INSTANCE_BLOCKS holds 2^N instances, block 0 is
+ * instance 0 which is embedded in the UAVO, so the first
+ * UAVO_INSTANCE_BLOCKS_FIRST instances are found with a single log2.
+ * Block sizes stop growing at UAVO_INSTANCE_BLOCK_MAX instances, further
+ * blocks of that size are chained: a directory of pointers to them, which
+ * doubles when full, finds any of them with a single division. Blocks and
+ * directories are allocated on demand and never move, as heap_1 can't free
+ * them, so a directory that was outgrown is left behind.
+ *
+ * At worst UAVO_INSTANCE_BLOCK_MAX - 1 instances of an object are
+ * allocated but not used, plus up to four pointers per chained block.
+ */
+#define UAVO_INSTANCE_BLOCKS       5
+#define UAVO_INSTANCE_BLOCKS_FIRST ((1 << UAVO_INSTANCE_BLOCKS) - 1)
+#define UAVO_INSTANCE_BLOCK_MAX    (1 << (UAVO_INSTANCE_BLOCKS - 1))
 
 /* Augmented type for Multi Instance Data UAVO */
 struct UAVOMulti {
     struct UAVOData uavo;
     uint16_t num_instances;
-    struct UAVOMultiInst instance0 __attribute__((aligned(4)));
+    uint8_t  *instance_blocks[UAVO_INSTANCE_BLOCKS];
+    uint8_t  **chained_blocks;
+    uint16_t chained_capacity;
+    uint8_t  instance0[] __attribute__((aligned(4)));
     /*
      * Additional space will be malloc'd here to hold the
      * the data for instance 0.
@@ -171,8 +190,11 @@ struct UAVOMulti {
 
 /** all information about instances are dependant on object type **/
 #define ObjSingleInstanceDataOffset(obj) ((void *)(&(((struct UAVOSingle *)obj)->instance0)))
-#define InstanceDataOffset(inst)         ((void *)&(((struct UAVOMultiInst *)inst)->instance))
 #define InstanceData(instance)           (void *)instance
+/* Instances in a block are kept 4 byte aligned, like instance 0 */
+#define InstanceStride(obj)              (((obj)->instance_size + 3) & ~3)
+#define InstanceBlock(instId)            (31 - __builtin_clz((uint32_t)(instId) + 1))
+#define InstanceBlockIndex(instId, block) ((uint32_t)(instId) + 1 - (1 << (block)))
 
 // Private functions
 static int32_t sendEvent(struct UAVOBase *obj, uint16_t instId,
@@ -183,6 +205,11 @@ static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue,
                           UAVObjEventCallback cb, uint8_t eventMask);
 static int32_t disconnectObj(UAVObjHandle obj_handle, xQueueHandle queue,
                              UAVObjEventCallback cb);
+static void lockObj(UAVObjHandle obj_handle);
+static void unlockObj(UAVObjHandle obj_handle);
+#if defined(PIOS_UAVOBJ_PER_OBJECT_LOCK)
+static struct UAVOData *lockOwner(UAVObjHandle obj_handle);
+#endif
 
 #if defined(PIOS_USE_SETTINGS_ON_SDCARD) && defined(PIOS_INCLUDE_FLASH_LOGFS_SETTINGS)
 #error Both PIOS_USE_SETTINGS_ON_SDCARD and PIOS_INCLUDE_FLASH_LOGFS_SETTINGS. Only one settings storage allowed.
@@ -250,9 +277,10 @@ int32_t UAVObjInitialize()
  */
 void UAVObjGetStats(UAVObjStats *statsOut)
 {
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    // The counters are updated by sendEvent() without the global lock
+    portENTER_CRITICAL();
     memcpy(statsOut, &stats, sizeof(UAVObjStats));
-    xSemaphoreGiveRecursive(mutex);
+    portEXIT_CRITICAL();
 }
 
 /**
@@ -260,9 +288,49 @@ void UAVObjGetStats(UAVObjStats *statsOut)
  */
 void UAVObjClearStats()
 {
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    portENTER_CRITICAL();
     memset(&stats, 0, sizeof(UAVObjStats));
-    xSemaphoreGiveRecursive(mutex);
+    portEXIT_CRITICAL();
+}
+
+/**
+ * Get the lock statistics of an object (shared with its metaobject)
+ * @param[in] obj_handle The object handle
+ * @param[out] statsOut The lock statistics will be copied there
+ * @return 0 if success or -1 if per object locking is not enabled
+ */
+int32_t UAVObjGetLockStats(__attribute__((unused)) UAVObjHandle obj_handle, __attribute__((unused)) UAVObjLockStats *statsOut)
+{
+#if defined(PIOS_UAVOBJ_PER_OBJECT_LOCK)
+    PIOS_Assert(obj_handle);
+    PIOS_Assert(statsOut);
+
+    struct UAVOData *uavo = lockOwner(obj_handle);
+
+    xSemaphoreTakeRecursive(uavo->lock, portMAX_DELAY);
+    memcpy(statsOut, &uavo->lockStats, sizeof(UAVObjLockStats));
+    xSemaphoreGiveRecursive(uavo->lock);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/**
+ * Clear the lock statistics of an object
+ * @param[in] obj_handle The object handle
+ */
+void UAVObjClearLockStats(__attribute__((unused)) UAVObjHandle obj_handle)
+{
+#if defined(PIOS_UAVOBJ_PER_OBJECT_LOCK)
+    PIOS_Assert(obj_handle);
+
+    struct UAVOData *uavo = lockOwner(obj_handle);
+
+    xSemaphoreTakeRecursive(uavo->lock, portMAX_DELAY);
+    memset(&uavo->lockStats, 0, sizeof(UAVObjLockStats));
+    xSemaphoreGiveRecursive(uavo->lock);
+#endif
 }
 
 /************************
@@ -328,9 +396,13 @@ static struct UAVOData *UAVObjAllocMulti(uint32_t num_bytes)
 
     /* Set up the type-specific part of the UAVO */
     uavo_multi->num_instances = 1;
+    memset(uavo_multi->instance_blocks, 0, sizeof(uavo_multi->instance_blocks));
+    uavo_multi->instance_blocks[0] = uavo_multi->instance0;
+    uavo_multi->chained_blocks     = NULL;
+    uavo_multi->chained_capacity   = 0;
 
     /* Clear the multi instance data carried in the UAVO */
-    memset(&(uavo_multi->instance0), 0, sizeof(struct UAVOMultiInst) + num_bytes);
+    memset(uavo_multi->instance0, 0, num_bytes);
 
     /* Give back the generic UAVO part */
     return &(uavo_multi->uavo);
@@ -375,6 +447,17 @@ UAVObjHandle UAVObjRegister(uint32_t id,
         goto unlock_exit;
     }
 
+#if defined(PIOS_UAVOBJ_PER_OBJECT_LOCK)
+    /* Every data object gets its own lock, shared with its meta object */
+    uavo_data->lock = xSemaphoreCreateRecursiveMutex();
+    if (!uavo_data->lock) {
+        vPortFree(uavo_data);
+        uavo_data = NULL;
+        goto unlock_exit;
+    }
+    memset(&uavo_data->lockStats, 0, sizeof(UAVObjLockStats));
+#endif
+
     /* Fill in the details about this UAVO */
     uavo_data->id = id;
     uavo_data->instance_size = num_bytes;
@@ -436,6 +519,66 @@ xSemaphoreGiveRecursive(mutex);
 return found_obj;
 }
 
+/**
+ * Get the number of slots of the object list, UAVObjGetByIndex() takes
+ * indexes from 0 to this number - 1.
+ * \return The number of slots
+ */
+uint16_t UAVObjGetNumIndexes()
+{
+    if (!__start__uavo_handles) {
+        return 0;
+    }
+    return (uint16_t)(__stop__uavo_handles - __start__uavo_handles);
+}
+
+/**
+ * Get the index of an object in the object list. The index is fixed when
+ * the firmware is linked, it does not change while the firmware runs.
+ * \param[in] obj The object handle
+ * \return The index or -1 if not found, metaobjects are not in the list
+ */
+int32_t UAVObjGetIndex(UAVObjHandle obj_handle)
+{
+    int32_t index = -1;
+
+    PIOS_Assert(obj_handle);
+
+    // Get lock
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+
+    // Look for object
+    UAVO_LIST_ITERATE(tmp_obj)
+    if ((UAVObjHandle)tmp_obj == obj_handle) {
+        index = (int32_t)(_uavo_slot - __start__uavo_handles);
+        break;
+    }
+}
+
+xSemaphoreGiveRecursive(mutex);
+return index;
+}
+
+/**
+ * Retrieve an object from the list given its index
+ * \param[in] index The index, see UAVObjGetIndex()
+ * \return The object or NULL if no object was registered in this slot
+ */
+UAVObjHandle UAVObjGetByIndex(uint16_t index)
+{
+    UAVObjHandle found_obj = (UAVObjHandle)NULL;
+
+    // Get lock
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+
+    if (index < UAVObjGetNumIndexes()) {
+        found_obj = (UAVObjHandle)__start__uavo_handles[index];
+    }
+
+    xSemaphoreGiveRecursive(mutex);
+    return found_obj;
+}
+
 /**
  * Get the object's ID
  * \param[in] obj The object handle
@@ -549,7 +692,7 @@ uint16_t UAVObjCreateInstance(UAVObjHandle obj_handle,
     }
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
 
     InstanceHandle instEntry;
     uint16_t instId = 0;
@@ -567,7 +710,7 @@ uint16_t UAVObjCreateInstance(UAVObjHandle obj_handle,
     }
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
 
     return instId;
 }
@@ -630,7 +773,7 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId,
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
 
     int32_t rc = -1;
 
@@ -665,7 +808,7 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId,
     rc = 0;
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
     return rc;
 }
 
@@ -681,7 +824,7 @@ int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t *dataOut)
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
 
     int32_t rc = -1;
 
@@ -709,7 +852,7 @@ int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t *dataOut)
     rc = 0;
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
     return rc;
 }
 
@@ -734,12 +877,12 @@ int32_t UAVObjSaveToFile(UAVObjHandle obj_handle, uint16_t instId,
         return -1;
     }
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
 
     if (UAVObjIsMetaobject(obj_handle)) {
         // Get the instance information
         if (instId != 0) {
-            xSemaphoreGiveRecursive(mutex);
+            unlockObj(obj_handle);
             return -1;
         }
         // Write the object ID
@@ -751,7 +894,7 @@ int32_t UAVObjSaveToFile(UAVObjHandle obj_handle, uint16_t instId,
         PIOS_FWRITE(file, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes,
                     &bytesWritten);
         if (bytesWritten != MetaNumBytes) {
-            xSemaphoreGiveRecursive(mutex);
+            unlockObj(obj_handle);
             return -1;
         }
     } else {
@@ -764,7 +907,7 @@ int32_t UAVObjSaveToFile(UAVObjHandle obj_handle, uint16_t instId,
         // Get the instance information
         instEntry = getInstance(uavo, instId);
         if (instEntry == NULL) {
-            xSemaphoreGiveRecursive(mutex);
+            unlockObj(obj_handle);
             return -1;
         }
         // Write the object ID
@@ -780,12 +923,12 @@ int32_t UAVObjSaveToFile(UAVObjHandle obj_handle, uint16_t instId,
         PIOS_FWRITE(file, InstanceData(instEntry), uavo->instance_size,
                     &bytesWritten);
         if (bytesWritten != uavo->instance_size) {
-            xSemaphoreGiveRecursive(mutex);
+            unlockObj(obj_handle);
             return -1;
         }
     }
     // Done
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
     return 0;
 }
 #endif /* PIOS_USE_SETTINGS_ON_SDCARD */
@@ -887,17 +1030,17 @@ int32_t UAVObjLoadFromFile(UAVObjHandle obj_handle, FILEINFO *file)
     objEntry = (struct UAVOBase *)obj_handle;
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
 
     // Read the object ID
     if (PIOS_FREAD(file, &objId, sizeof(objId), &bytesRead)) {
-        xSemaphoreGiveRecursive(mutex);
+        unlockObj(obj_handle);
         return -1;
     }
 
     // Check that the IDs match
     if (objId != UAVObjGetID(obj_handle)) {
-        xSemaphoreGiveRecursive(mutex);
+        unlockObj(obj_handle);
         return -1;
     }
 
@@ -906,7 +1049,7 @@ int32_t UAVObjLoadFromFile(UAVObjHandle obj_handle, FILEINFO *file)
     if (!UAVObjIsSingleInstance(obj_handle)) {
         if (PIOS_FREAD
                 (file, &instId, sizeof(instId), &bytesRead)) {
-            xSemaphoreGiveRecursive(mutex);
+            unlockObj(obj_handle);
             return -1;
         }
     }
@@ -915,13 +1058,13 @@ int32_t UAVObjLoadFromFile(UAVObjHandle obj_handle, FILEINFO *file)
         // If the instance does not exist create it and any other instances before it
         if (instId != 0) {
             // Error, unlock and return
-            xSemaphoreGiveRecursive(mutex);
+            unlockObj(obj_handle);
             return -1;
         }
         // Read the instance data
         if (PIOS_FREAD
                 (file, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes, &bytesRead)) {
-            xSemaphoreGiveRecursive(mutex);
+            unlockObj(obj_handle);
             return -1;
         }
     } else {
@@ -933,14 +1076,14 @@ int32_t UAVObjLoadFromFile(UAVObjHandle obj_handle, FILEINFO *file)
             instEntry = createInstance((struct UAVOData *)objEntry, instId);
             if (instEntry == NULL) {
                 // Error, unlock and return
-                xSemaphoreGiveRecursive(mutex);
+                unlockObj(obj_handle);
                 return -1;
             }
         }
         // Read the instance data
         if (PIOS_FREAD
                 (file, InstanceData(instEntry), ((struct UAVOData *)objEntry)->instance_size, &bytesRead)) {
-            xSemaphoreGiveRecursive(mutex);
+            unlockObj(obj_handle);
             return -1;
         }
     }
@@ -949,7 +1092,7 @@ int32_t UAVObjLoadFromFile(UAVObjHandle obj_handle, FILEINFO *file)
     sendEvent(objEntry, instId, EV_UNPACKED);
 
     // Unlock
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
     return 0;
 }
 #endif /* PIOS_USE_SETTINGS_ON_SDCARD */
@@ -1289,7 +1432,7 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
 
     int32_t rc = -1;
 
@@ -1323,7 +1466,7 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
     rc = 0;
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
     return rc;
 }
 
@@ -1339,7 +1482,7 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
 
     int32_t rc = -1;
 
@@ -1389,7 +1532,7 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
     rc = 0;
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
     return rc;
 }
 
@@ -1406,7 +1549,7 @@ int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
 
     int32_t rc = -1;
 
@@ -1436,7 +1579,7 @@ int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
     rc = 0;
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
     return rc;
 }
 
@@ -1452,7 +1595,7 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
 
     int32_t rc = -1;
 
@@ -1494,7 +1637,7 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
     rc = 0;
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
     return rc;
 }
 
@@ -1513,11 +1656,11 @@ int32_t UAVObjSetMetadata(UAVObjHandle obj_handle, const UAVObjMetadata *dataIn)
         return -1;
     }
 
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
 
     UAVObjSetData((UAVObjHandle)MetaObjectPtr((struct UAVOData *)obj_handle), dataIn);
 
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
     return 0;
 }
 
@@ -1532,7 +1675,7 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata *dataOut)
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
 
     // Get metadata
     if (UAVObjIsMetaobject(obj_handle)) {
@@ -1543,7 +1686,7 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata *dataOut)
     }
 
     // Unlock
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
     return 0;
 }
 
@@ -1715,9 +1858,9 @@ int32_t UAVObjConnectQueue(UAVObjHandle obj_handle, xQueueHandle queue,
     PIOS_Assert(obj_handle);
     PIOS_Assert(queue);
     int32_t res;
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
     res = connectObj(obj_handle, queue, 0, eventMask);
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
     return res;
 }
 
@@ -1732,9 +1875,9 @@ int32_t UAVObjDisconnectQueue(UAVObjHandle obj_handle, xQueueHandle queue)
     PIOS_Assert(obj_handle);
     PIOS_Assert(queue);
     int32_t res;
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
     res = disconnectObj(obj_handle, queue, 0);
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
     return res;
 }
 
@@ -1751,9 +1894,9 @@ int32_t UAVObjConnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb,
 {
     PIOS_Assert(obj_handle);
     int32_t res;
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
     res = connectObj(obj_handle, 0, cb, eventMask);
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
     return res;
 }
 
@@ -1767,9 +1910,9 @@ int32_t UAVObjDisconnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb
 {
     PIOS_Assert(obj_handle);
     int32_t res;
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
     res = disconnectObj(obj_handle, 0, cb);
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
     return res;
 }
 
@@ -1792,9 +1935,9 @@ void UAVObjRequestUpdate(UAVObjHandle obj_handle)
 void UAVObjRequestInstanceUpdate(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
     sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATE_REQ);
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
 }
 
 /**
@@ -1814,9 +1957,9 @@ void UAVObjUpdated(UAVObjHandle obj_handle)
 void UAVObjInstanceUpdated(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockObj(obj_handle);
     sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED_MANUAL);
-    xSemaphoreGiveRecursive(mutex);
+    unlockObj(obj_handle);
 }
 
 /**
@@ -1864,8 +2007,12 @@ static int32_t sendEvent(struct UAVOBase *obj, uint16_t instId,
             if (event->queue) {
                 // will not block
                 if (xQueueSend(event->queue, &msg, 0) != pdTRUE) {
-                    stats.lastQueueErrorID = UAVObjGetID(obj);
+                    uint32_t objId = UAVObjGetID(obj);
+                    // Events of different objects are sent concurrently with per object locks
+                    portENTER_CRITICAL();
+                    stats.lastQueueErrorID = objId;
                     ++stats.eventQueueErrors;
+                    portEXIT_CRITICAL();
                 }
             }
 
@@ -1873,8 +2020,11 @@ static int32_t sendEvent(struct UAVOBase *obj, uint16_t instId,
             if (event->cb) {
                 // invoke callback from the event task, will not block
                 if (EventCallbackDispatch(&msg, event->cb) != pdTRUE) {
+                    uint32_t objId = UAVObjGetID(obj);
+                    portENTER_CRITICAL();
                     ++stats.eventCallbackErrors;
-                    stats.lastCallbackErrorID = UAVObjGetID(obj);
+                    stats.lastCallbackErrorID = objId;
+                    portEXIT_CRITICAL();
                 }
             }
         }
@@ -1888,7 +2038,7 @@ static int32_t sendEvent(struct UAVOBase *obj, uint16_t instId,
  */
 static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId)
 {
-    struct UAVOMultiInst *instEntry;
+    struct UAVOMulti *uavo_multi = (struct UAVOMulti *)obj;
 
     /* Don't allow more than one instance for single instance objects */
     if (UAVObjIsSingleInstance(&(obj->base))) {
@@ -1913,22 +2063,51 @@ static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId)
         }
     }
 
-    /* Create the actual instance */
-    uint32_t size = sizeof(struct UAVOMultiInst) + obj->instance_size;
-    instEntry = (struct UAVOMultiInst *)pvPortMalloc(size);
-    if (!instEntry) {
-        return NULL;
+    /* Allocate the block holding this instance the first time it is used */
+    if (instId < UAVO_INSTANCE_BLOCKS_FIRST) {
+        uint8_t block = InstanceBlock(instId);
+        if (!uavo_multi->instance_blocks[block]) {
+            uint32_t size = (1 << block) * InstanceStride(obj);
+            uint8_t *data = (uint8_t *)pvPortMalloc(size);
+            if (!data) {
+                return NULL;
+            }
+            memset(data, 0, size);
+            uavo_multi->instance_blocks[block] = data;
+        }
+    } else if ((instId - UAVO_INSTANCE_BLOCKS_FIRST) % UAVO_INSTANCE_BLOCK_MAX == 0) {
+        uint16_t chained = (instId - UAVO_INSTANCE_BLOCKS_FIRST) / UAVO_INSTANCE_BLOCK_MAX;
+
+        // Double the directory when it is full, the old one stays valid
+        if (chained >= uavo_multi->chained_capacity) {
+            uint16_t capacity = uavo_multi->chained_capacity ? 2 * uavo_multi->chained_capacity : 1;
+            uint8_t **directory = (uint8_t **)pvPortMalloc(capacity * sizeof(uint8_t *));
+            if (!directory) {
+                return NULL;
+            }
+            if (chained > 0) {
+                memcpy(directory, uavo_multi->chained_blocks, chained * sizeof(uint8_t *));
+            }
+            uavo_multi->chained_blocks   = directory;
+            uavo_multi->chained_capacity = capacity;
+        }
+
+        uint32_t size = UAVO_INSTANCE_BLOCK_MAX * InstanceStride(obj);
+        uint8_t *data = (uint8_t *)pvPortMalloc(size);
+        if (!data) {
+            return NULL;
+        }
+        memset(data, 0, size);
+        uavo_multi->chained_blocks[chained] = data;
     }
-    memset(instEntry, 0, size);
-    LL_APPEND(((struct UAVOMulti *)obj)->instance0.next, instEntry);
 
-    ((struct UAVOMulti *)obj)->num_instances++;
+    uavo_multi->num_instances++;
 
     // Fire event
     UAVObjInstanceUpdated((UAVObjHandle)obj, instId);
 
     // Done
-    return InstanceDataOffset(instEntry);
+    return getInstance(obj, instId);
 }
 
 /**
@@ -1964,17 +2143,15 @@ static InstanceHandle getInstance(struct UAVOData *obj, uint16_t instId)
             return NULL;
         }
 
-        // Look for specified instance ID
-        uint16_t instance = 0;
-        struct UAVOMultiInst *instEntry;
-        LL_FOREACH(&(uavo_multi->instance0), instEntry) {
-            if (instance++ == instId) {
-                /* Found it */
-                return &(instEntry->instance);
-            }
+        // Index straight into the block holding the instance
+        if (instId < UAVO_INSTANCE_BLOCKS_FIRST) {
+            uint8_t block = InstanceBlock(instId);
+            return uavo_multi->instance_blocks[block] + InstanceBlockIndex(instId, block) * InstanceStride(obj);
         }
-        /* Instance was not found */
-        return NULL;
+
+        // Or look up its chained block in the directory
+        uint16_t index = instId - UAVO_INSTANCE_BLOCKS_FIRST;
+        return uavo_multi->chained_blocks[index / UAVO_INSTANCE_BLOCK_MAX] + (index % UAVO_INSTANCE_BLOCK_MAX) * InstanceStride(obj);
     }
 }
 
@@ -2044,6 +2221,63 @@ static int32_t disconnectObj(UAVObjHandle obj_handle, xQueueHandle queue,
     return -1;
 }
 
+#if defined(PIOS_UAVOBJ_PER_OBJECT_LOCK)
+/**
+ * Get the data object owning the lock of an object. Metaobjects are
+ * embedded in their parent object and share its lock.
+ */
+static struct UAVOData *lockOwner(UAVObjHandle obj_handle)
+{
+    if (UAVObjIsMetaobject(obj_handle)) {
+        return container_of((struct UAVOMeta *)obj_handle, struct UAVOData, metaObj);
+    }
+    return (struct UAVOData *)obj_handle;
+}
+#endif /* PIOS_UAVOBJ_PER_OBJECT_LOCK */
+
+/**
+ * Lock the data of an object.
+ * With PIOS_UAVOBJ_PER_OBJECT_LOCK every object has its own recursive mutex,
+ * so tasks accessing different objects never block each other. Otherwise all
+ * objects share the object manager mutex.
+ * \param[in] obj_handle The object handle
+ */
+static void lockObj(__attribute__((unused)) UAVObjHandle obj_handle)
+{
+#if defined(PIOS_UAVOBJ_PER_OBJECT_LOCK)
+    struct UAVOData *uavo = lockOwner(obj_handle);
+
+    // Only time the wait if the lock is held by another task
+    if (xSemaphoreTakeRecursive(uavo->lock, 0) != pdTRUE) {
+        uint32_t waitStart = PIOS_DELAY_GetRaw();
+        xSemaphoreTakeRecursive(uavo->lock, portMAX_DELAY);
+        uint32_t waitTime  = PIOS_DELAY_DiffuS(waitStart);
+
+        ++uavo->lockStats.contendedCount;
+        uavo->lockStats.waitTimeUs += waitTime;
+        if (waitTime > uavo->lockStats.maxWaitTimeUs) {
+            uavo->lockStats.maxWaitTimeUs = waitTime;
+        }
+    }
+    ++uavo->lockStats.lockCount;
+#else
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+#endif
+}
+
+/**
+ * Unlock the data of an object
+ * \param[in] obj_handle The object handle
+ */
+static void unlockObj(__attribute__((unused)) UAVObjHandle obj_handle)
+{
+#if defined(PIOS_UAVOBJ_PER_OBJECT_LOCK)
+    xSemaphoreGiveRecursive(lockOwner(obj_handle)->lock);
+#else
+    xSemaphoreGiveRecursive(mutex);
+#endif
+}
+
 #if defined(PIOS_USE_SETTINGS_ON_SDCARD)
 /**
  * Wrapper for the sprintf function
@@ -54,11 +54,22 @@ UAVTalkOutputStream UAVTalkGetOutputStream(UAVTalkConnection connection);
 int32_t UAVTalkSendObject(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, uint8_t acked, int32_t timeoutMs);
 int32_t UAVTalkSendObjectTimestamped(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, uint8_t acked, int32_t timeoutMs);
 int32_t UAVTalkSendObjectRequest(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs);
+int32_t UAVTalkSendObjectWindowed(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs, uint8_t retries);
+int32_t UAVTalkSendObjectRequestWindowed(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs, uint8_t retries);
+portTickType UAVTalkProcessTransactions(UAVTalkConnection connection, uint32_t *retries, uint32_t *failures);
+int32_t UAVTalkSendObjectAggregated(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId);
+int32_t UAVTalkFlushAggregate(UAVTalkConnection connection);
+int32_t UAVTalkOfferAggregation(UAVTalkConnection connection);
+void UAVTalkResetAggregation(UAVTalkConnection connection);
+int32_t UAVTalkEnableDeltaEncoding(UAVTalkConnection connection);
+int32_t UAVTalkGetDeltaStats(UAVTalkConnection connection, uint8_t slot, uint32_t *objId, uint32_t *rawBytes, uint32_t *sentBytes);
 int32_t UAVTalkSendAck(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId);
 int32_t UAVTalkSendNack(UAVTalkConnection connectionHandle, uint32_t objId);
 int32_t UAVTalkSendBuf(UAVTalkConnection connectionHandle, uint8_t *buf, uint16_t len);
 UAVTalkRxState UAVTalkProcessInputStream(UAVTalkConnection connection, uint8_t rxbyte);
 UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connection, uint8_t rxbyte);
+UAVTalkRxState UAVTalkProcessInputBuffer(UAVTalkConnection connection, const uint8_t *rxbuffer, int32_t length);
+int32_t UAVTalkProcessInputBufferQuiet(UAVTalkConnection connection, const uint8_t *rxbuffer, int32_t length, UAVTalkRxState *state);
 UAVTalkRxState UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle);
 int32_t UAVTalkReceiveObject(UAVTalkConnection connectionHandle);
 void UAVTalkGetStats(UAVTalkConnection connection, UAVTalkStats *stats);
@@ -72,6 +72,38 @@ typedef struct {
     uint16_t rxPacketLength;
 } UAVTalkInputProcessor;
 
+// Number of acked transactions which may be outstanding at once on a connection
+#ifndef UAVTALK_TRANSACTION_WINDOW
+#define UAVTALK_TRANSACTION_WINDOW 4
+#endif
+
+typedef struct {
+    UAVObjHandle obj;
+    uint16_t     instId;
+    uint8_t      type;
+    uint8_t      retriesLeft;
+    portTickType timeout;
+    portTickType sentTime;
+} UAVTalkTransaction;
+
+// Number of object instances which can be delta encoded at once on a connection, in each direction.
+// An instance keeps its slot until it was not sent for UAVTALK_DELTA_IDLE_MS.
+#ifndef UAVTALK_DELTA_SLOTS
+#define UAVTALK_DELTA_SLOTS 4
+#endif
+
+typedef struct {
+    UAVObjHandle obj;
+    uint16_t     instId;
+    uint16_t     capacity;
+    uint8_t      *baseline; // object data of the last keyframe
+    uint8_t      seq;
+    uint8_t      sinceKeyframe;
+    portTickType lastUsed;
+    uint32_t     rawBytes;
+    uint32_t     sentBytes;
+} UAVTalkDeltaSlot;
+
 typedef struct {
     uint8_t canari;
     UAVTalkOutputStream outStream;
@@ -85,6 +117,26 @@ typedef struct {
     uint8_t      *rxBuffer;
     uint32_t     txSize;
     uint8_t      *txBuffer;
+    UAVTalkTransaction window[UAVTALK_TRANSACTION_WINDOW];
+    xSemaphoreHandle   windowSema;
+    uint32_t     windowRetries;
+    uint32_t     windowFailures;
+    uint8_t      aggPeer;
+    uint8_t      aggKnown; // entries of our table the peer received
+    UAVObjHandle *aggRxTable; // objects of the peer's table, allocated when the peer sends one
+    uint8_t      aggRxCount; // entries of the peer's table received in sequence
+    uint8_t      aggRxCrc;
+    uint8_t      aggRxLimit; // entries of the peer's table which can be looked up
+    uint8_t      *aggBuffer;
+    uint16_t     aggLength;
+    uint8_t      aggCount;
+    uint16_t     aggObjectBytes;
+    UAVObjHandle aggObj;
+    uint16_t     aggInstId;
+    uint8_t      deltaPeer;
+    UAVTalkDeltaSlot *txDelta;
+    UAVTalkDeltaSlot *rxDelta;
+    uint8_t      *deltaBuffer;
 } UAVTalkConnectionData;
 
 #define UAVTALK_CANARI          0xCA
@@ -99,9 +151,44 @@ typedef struct {
 #define UAVTALK_TYPE_OBJ_ACK    (UAVTALK_TYPE_VER | 0x02)
 #define UAVTALK_TYPE_ACK        (UAVTALK_TYPE_VER | 0x03)
 #define UAVTALK_TYPE_NACK       (UAVTALK_TYPE_VER | 0x04)
+#define UAVTALK_TYPE_AGGREGATE  (UAVTALK_TYPE_VER | 0x05)
+#define UAVTALK_TYPE_OBJ_DELTA  (UAVTALK_TYPE_VER | 0x06)
 #define UAVTALK_TYPE_OBJ_TS     (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ)
 #define UAVTALK_TYPE_OBJ_ACK_TS (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ_ACK)
 
+// Aggregate packets carry the updates of several objects in a payload of entries made of
+// the object index (1), the instance ID (2, multi instance objects only) and the object data,
+// whose length is known from the object. The index is the position of the object in the table
+// of the sending end, which it sends in offer packets: flags (1), then the number (1) and the CRC (1)
+// of the table entries received from the peer so far, then optionally the index of the first
+// table entry (1) and the object IDs (4 each) of a chunk of the table, 0 for unused entries.
+// The last chunk of a table is flagged with UAVTALK_AGGREGATE_OFFER_END, the peer answers it with
+// its own offer if UAVTALK_AGGREGATE_OFFER_REPLY is set too, otherwise with an offer without table.
+// The number of entries received stops at the first object the receiving end does not know, and
+// only objects the peer acknowledged this way are aggregated.
+#define UAVTALK_AGGREGATE_OBJID        0xFFFFFFFF
+#define UAVTALK_AGGREGATE_OFFER_OBJID  0xFFFFFFFE
+#define UAVTALK_AGGREGATE_ENTRY_HEADER 1
+#define UAVTALK_AGGREGATE_MAX_LENGTH   ((UAVTALK_MAX_PAYLOAD_LENGTH - 1) < 255 ? (UAVTALK_MAX_PAYLOAD_LENGTH - 1) : 255)
+#define UAVTALK_AGGREGATE_MAX_INDEXES  255
+#define UAVTALK_AGGREGATE_OFFER_HEADER 3
+#define UAVTALK_AGGREGATE_OFFER_CHUNK  ((UAVTALK_AGGREGATE_MAX_LENGTH - UAVTALK_AGGREGATE_OFFER_HEADER - 1) / 4)
+#define UAVTALK_AGGREGATE_OFFER_REPLY  0x01
+#define UAVTALK_AGGREGATE_OFFER_DELTA  0x02
+#define UAVTALK_AGGREGATE_OFFER_END    0x04
+
+// Delta packets start with the keyframe flag and the sequence number of the keyframe, followed
+// either by the object data (keyframe) or by the object data XORed with the keyframe and run length
+// encoded in tokens: a token with the zero run flag stands for (token & 0x7F) + 1 unchanged bytes,
+// otherwise token + 1 literal bytes follow it. A delta of an unknown keyframe is answered with a NACK.
+#define UAVTALK_DELTA_KEYFRAME          0x80
+#define UAVTALK_DELTA_SEQ_MASK          0x7F
+#define UAVTALK_DELTA_ZERO_RUN          0x80
+#define UAVTALK_DELTA_MAX_RUN           128
+#define UAVTALK_DELTA_MIN_LENGTH        16
+#define UAVTALK_DELTA_KEYFRAME_INTERVAL 20
+#define UAVTALK_DELTA_IDLE_MS           5000
+
 // macros
 #define CHECKCONHANDLE(handle, variable, failcommand) \
     variable = (UAVTalkConnectionData *)handle; \
@@ -35,11 +35,31 @@
 
 // Private functions
 static int32_t objectTransaction(UAVTalkConnectionData *connection, UAVObjHandle objectId, uint16_t instId, uint8_t type, int32_t timeout);
+static int32_t windowedTransaction(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type, int32_t timeoutMs, uint8_t retries);
+static UAVTalkTransaction *getTransactionSlot(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type);
+static portTickType checkTransactions(UAVTalkConnectionData *connection);
 static int32_t sendObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type);
 static int32_t sendSingleObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type);
 static int32_t sendNack(UAVTalkConnectionData *connection, uint32_t objId);
 static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, uint8_t *data, int32_t length);
 static void updateAck(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId);
+static void updateNack(UAVTalkConnectionData *connection, UAVObjHandle obj);
+static int32_t aggregateSingleObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId);
+static int32_t flushAggregate(UAVTalkConnectionData *connection);
+static int32_t sendAggregateOffer(UAVTalkConnectionData *connection, uint8_t flags, bool table);
+static uint16_t aggregateTableSize(void);
+static uint8_t aggregateTableCrc(uint8_t count);
+static int32_t receiveAggregateOffer(UAVTalkConnectionData *connection, uint8_t *data, int32_t length);
+static int32_t receiveAggregate(UAVTalkConnectionData *connection, uint32_t objId, uint8_t *data, int32_t length);
+static int32_t sendUnackedObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId);
+static UAVTalkDeltaSlot *getDeltaSlot(UAVTalkDeltaSlot *slots, UAVObjHandle obj, uint16_t instId, bool create);
+static int32_t encodeDelta(const uint8_t *baseline, const uint8_t *data, uint16_t length, uint8_t *out, uint16_t maxLength);
+static int32_t decodeDelta(uint8_t *data, uint16_t length, const uint8_t *delta, uint16_t deltaLength);
+static int32_t sendDeltaObject(UAVTalkConnectionData *connection, UAVTalkDeltaSlot *slot, UAVObjHandle obj, uint16_t instId);
+static int32_t receiveDelta(UAVTalkConnectionData *connection, UAVObjHandle obj, uint32_t objId, uint16_t instId, uint8_t *data, int32_t length);
+static void resetDeltaSlots(UAVTalkConnectionData *connection, UAVObjHandle obj);
+static void processInputByte(UAVTalkConnectionData *connection, uint8_t rxbyte);
+static void processObjId(UAVTalkConnectionData *connection);
 
 /**
  * Initialize the UAVTalk library
@@ -73,6 +93,25 @@ UAVTalkConnection UAVTalkInitialize(UAVTalkOutputStream outputStream)
     }
     vSemaphoreCreateBinary(connection->respSema);
     xSemaphoreTake(connection->respSema, 0); // reset to zero
+    memset(connection->window, 0, sizeof(connection->window));
+    vSemaphoreCreateBinary(connection->windowSema);
+    xSemaphoreTake(connection->windowSema, 0); // reset to zero
+    connection->windowRetries  = 0;
+    connection->windowFailures = 0;
+    connection->aggPeer   = 0;
+    connection->aggKnown  = 0;
+    connection->aggRxTable = 0;
+    connection->aggRxCount = 0;
+    connection->aggRxCrc   = 0;
+    connection->aggRxLimit = 0;
+    connection->aggBuffer = 0;
+    connection->aggLength = 0;
+    connection->aggCount  = 0;
+    connection->aggObjectBytes = 0;
+    connection->deltaPeer   = 0;
+    connection->txDelta     = 0;
+    connection->rxDelta     = 0;
+    connection->deltaBuffer = 0;
     UAVTalkResetStats((UAVTalkConnection)connection);
     return (UAVTalkConnection)connection;
 }
@@ -179,6 +218,14 @@ void UAVTalkResetStats(UAVTalkConnection connectionHandle)
 
     // Clear stats
     memset(&connection->stats, 0, sizeof(UAVTalkStats));
+    if (connection->txDelta) {
+        for (uint8_t n = 0; n < UAVTALK_DELTA_SLOTS; n++) {
+            connection->txDelta[n].rawBytes  = 0;
+            connection->txDelta[n].sentBytes = 0;
+            connection->rxDelta[n].rawBytes  = 0;
+            connection->rxDelta[n].sentBytes = 0;
+        }
+    }
 
     // Release lock
     xSemaphoreGiveRecursive(connection->lock);
@@ -262,6 +309,240 @@ int32_t UAVTalkSendObjectTimestamped(UAVTalkConnection connectionHandle, UAVObjH
     }
 }
 
+/**
+ * Send the specified object with an ack request without waiting for the ack.
+ * Up to UAVTALK_TRANSACTION_WINDOW objects can be waiting for their ack on a
+ * connection, acks are matched by object and instance and only the objects
+ * whose ack did not arrive in time are sent again by UAVTalkProcessTransactions().
+ * If the object is already waiting for an ack it is sent again with its current
+ * data, otherwise this blocks while the window is full.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to send
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances.
+ * \param[in] timeoutMs Time to wait for the ack before sending the object again
+ * \param[in] retries Number of times the object is sent again before giving up
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendObjectWindowed(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs, uint8_t retries)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+    return windowedTransaction(connection, obj, instId, UAVTALK_TYPE_OBJ_ACK, timeoutMs, retries);
+}
+
+/**
+ * Request an update for the specified object without waiting for the response,
+ * see UAVTalkSendObjectWindowed().
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to update
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances.
+ * \param[in] timeoutMs Time to wait for the response before sending the request again
+ * \param[in] retries Number of times the request is sent again before giving up
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendObjectRequestWindowed(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs, uint8_t retries)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+    return windowedTransaction(connection, obj, instId, UAVTALK_TYPE_OBJ_REQ, timeoutMs, retries);
+}
+
+/**
+ * Send again the windowed transactions whose response is overdue and drop
+ * those which ran out of retries. Must be called periodically, at the latest
+ * after the returned number of ticks.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in,out] retries Incremented by the number of objects sent again
+ * \param[in,out] failures Incremented by the number of transactions dropped
+ * \return Ticks until the next response is due, portMAX_DELAY if none is outstanding
+ */
+portTickType UAVTalkProcessTransactions(UAVTalkConnection connectionHandle, uint32_t *retries, uint32_t *failures)
+{
+    UAVTalkConnectionData *connection;
+    portTickType wait;
+
+    CHECKCONHANDLE(connectionHandle, connection, return portMAX_DELAY);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    wait = checkTransactions(connection);
+    *retries  += connection->windowRetries;
+    *failures += connection->windowFailures;
+    connection->windowRetries  = 0;
+    connection->windowFailures = 0;
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return wait;
+}
+
+/**
+ * Send the specified object without ack. If the other end accepts aggregate
+ * packets the object is added to the pending aggregate packet, which is sent
+ * when it is full or by UAVTalkFlushAggregate(), or it is delta encoded if
+ * both ends enabled delta encoding. Otherwise the object is sent right away
+ * like UAVTalkSendObject() does.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to send
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances.
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendObjectAggregated(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId)
+{
+    UAVTalkConnectionData *connection;
+    int32_t ret = 0;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    if (!connection->aggPeer) {
+        ret = sendObject(connection, obj, instId, UAVTALK_TYPE_OBJ);
+    } else if (instId == UAVOBJ_ALL_INSTANCES) {
+        uint16_t numInst = UAVObjGetNumInstances(obj);
+        for (uint16_t n = 0; n < numInst; ++n) {
+            if (sendUnackedObject(connection, obj, n) != 0) {
+                ret = -1;
+            }
+        }
+    } else {
+        ret = sendUnackedObject(connection, obj, instId);
+    }
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
+/**
+ * Send the pending aggregate packet, if any.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkFlushAggregate(UAVTalkConnection connectionHandle)
+{
+    UAVTalkConnectionData *connection;
+    int32_t ret;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    ret = flushAggregate(connection);
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
+/**
+ * Tell the other end that aggregate packets are accepted, send it the table
+ * of object indexes and ask whether it accepts them too. Peers which do not
+ * know aggregate packets drop the offer.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkOfferAggregation(UAVTalkConnection connectionHandle)
+{
+    UAVTalkConnectionData *connection;
+    int32_t ret;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    ret = sendAggregateOffer(connection, UAVTALK_AGGREGATE_OFFER_REPLY | (connection->txDelta ? UAVTALK_AGGREGATE_OFFER_DELTA : 0), true);
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
+/**
+ * Send the pending objects and stop aggregating until the other end accepts
+ * aggregate packets again, to be called when the connection is lost.
+ * \param[in] connection UAVTalkConnection to be used
+ */
+void UAVTalkResetAggregation(UAVTalkConnection connectionHandle)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return );
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    flushAggregate(connection);
+    connection->aggPeer    = 0;
+    connection->aggKnown   = 0;
+    connection->aggRxCount = 0;
+    connection->aggRxCrc   = 0;
+    connection->aggRxLimit = 0;
+    connection->deltaPeer  = 0;
+    resetDeltaSlots(connection, 0);
+    xSemaphoreGiveRecursive(connection->lock);
+}
+
+/**
+ * Enable delta encoding of large objects sent with UAVTalkSendObjectAggregated(),
+ * it is used once the other end enabled it too and answered an aggregate offer.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkEnableDeltaEncoding(UAVTalkConnection connectionHandle)
+{
+    UAVTalkConnectionData *connection;
+    int32_t ret = 0;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    if (!connection->txDelta) {
+        UAVTalkDeltaSlot *txDelta = pvPortMalloc(sizeof(UAVTalkDeltaSlot) * UAVTALK_DELTA_SLOTS);
+        UAVTalkDeltaSlot *rxDelta = pvPortMalloc(sizeof(UAVTalkDeltaSlot) * UAVTALK_DELTA_SLOTS);
+        connection->deltaBuffer = pvPortMalloc(UAVOBJECTS_LARGEST);
+        if (txDelta && rxDelta && connection->deltaBuffer) {
+            memset(txDelta, 0, sizeof(UAVTalkDeltaSlot) * UAVTALK_DELTA_SLOTS);
+            memset(rxDelta, 0, sizeof(UAVTalkDeltaSlot) * UAVTALK_DELTA_SLOTS);
+            connection->txDelta = txDelta;
+            connection->rxDelta = rxDelta;
+        } else {
+            ret = -1;
+        }
+    }
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
+/**
+ * Get the compression statistics of a transmit delta slot.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] slot Slot index, 0 to UAVTALK_DELTA_SLOTS - 1
+ * \param[out] objId ID of the object using the slot, 0 if the slot is free
+ * \param[out] rawBytes Object bytes sent since the last UAVTalkResetStats()
+ * \param[out] sentBytes Payload bytes they were encoded to
+ * \return 0 Success
+ * \return -1 Failure, delta encoding is not enabled or slot is out of range
+ */
+int32_t UAVTalkGetDeltaStats(UAVTalkConnection connectionHandle, uint8_t slot, uint32_t *objId, uint32_t *rawBytes, uint32_t *sentBytes)
+{
+    UAVTalkConnectionData *connection;
+    int32_t ret = -1;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    if (connection->txDelta && slot < UAVTALK_DELTA_SLOTS) {
+        UAVTalkDeltaSlot *deltaSlot = &connection->txDelta[slot];
+        *objId     = deltaSlot->obj ? UAVObjGetID(deltaSlot->obj) : 0;
+        *rawBytes  = deltaSlot->rawBytes;
+        *sentBytes = deltaSlot->sentBytes;
+        ret = 0;
+    }
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
 /**
  * Execute the requested transaction on an object.
  * \param[in] connection UAVTalkConnection to be used
@@ -313,6 +594,112 @@ static int32_t objectTransaction(UAVTalkConnectionData *connection, UAVObjHandle
     }
 }
 
+/**
+ * Start a windowed transaction, see UAVTalkSendObjectWindowed().
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object
+ * \param[in] instId The instance ID of UAVOBJ_ALL_INSTANCES for all instances.
+ * \param[in] type Transaction type, UAVTALK_TYPE_OBJ_ACK or UAVTALK_TYPE_OBJ_REQ
+ * \param[in] timeoutMs Time to wait for the response before sending again
+ * \param[in] retries Number of times to send again before giving up
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t windowedTransaction(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type, int32_t timeoutMs, uint8_t retries)
+{
+    UAVTalkTransaction *trans;
+    int32_t ret;
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    // Wait for a free slot, overdue transactions are sent again or dropped meanwhile
+    while ((trans = getTransactionSlot(connection, obj, instId, type)) == NULL) {
+        portTickType wait = checkTransactions(connection);
+        xSemaphoreGiveRecursive(connection->lock);
+        xSemaphoreTake(connection->windowSema, wait);
+        xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    }
+
+    trans->obj         = obj;
+    trans->instId      = instId;
+    trans->type        = type;
+    trans->retriesLeft = retries;
+    trans->timeout     = timeoutMs / portTICK_RATE_MS;
+    trans->sentTime    = xTaskGetTickCount();
+    ret = sendObject(connection, obj, instId, type);
+    if (ret != 0) {
+        trans->obj = 0;
+    }
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
+/**
+ * Find the window slot of a transaction, or a free one
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object
+ * \param[in] instId The instance ID
+ * \param[in] type Transaction type
+ * \return The slot of the pending transaction if there is one, otherwise a free slot or NULL if the window is full
+ */
+static UAVTalkTransaction *getTransactionSlot(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type)
+{
+    UAVTalkTransaction *freeSlot = NULL;
+
+    for (uint8_t n = 0; n < UAVTALK_TRANSACTION_WINDOW; n++) {
+        UAVTalkTransaction *trans = &connection->window[n];
+        if (trans->obj == obj && trans->instId == instId && trans->type == type) {
+            return trans;
+        }
+        if (trans->obj == 0 && freeSlot == NULL) {
+            freeSlot = trans;
+        }
+    }
+    return freeSlot;
+}
+
+/**
+ * Send again the windowed transactions whose response is overdue, drop those
+ * without retries left. Must be called with the connection lock held.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return Ticks until the next response is due, portMAX_DELAY if none is outstanding
+ */
+static portTickType checkTransactions(UAVTalkConnectionData *connection)
+{
+    portTickType now  = xTaskGetTickCount();
+    portTickType wait = portMAX_DELAY;
+    bool dropped = false;
+
+    for (uint8_t n = 0; n < UAVTALK_TRANSACTION_WINDOW; n++) {
+        UAVTalkTransaction *trans = &connection->window[n];
+        if (trans->obj == 0) {
+            continue;
+        }
+        portTickType elapsed = now - trans->sentTime;
+        if (elapsed >= trans->timeout) {
+            if (trans->retriesLeft == 0) {
+                trans->obj = 0;
+                ++connection->windowFailures;
+                dropped    = true;
+                continue;
+            }
+            --trans->retriesLeft;
+            ++connection->windowRetries;
+            trans->sentTime = now;
+            elapsed = 0;
+            sendObject(connection, trans->obj, trans->instId, trans->type);
+        }
+        if (trans->timeout - elapsed < wait) {
+            wait = trans->timeout - elapsed;
+        }
+    }
+
+    if (dropped) {
+        xSemaphoreGive(connection->windowSema);
+    }
+    return wait;
+}
+
 /**
  * Process an byte from the telemetry stream.
  * \param[in] connectionHandle UAVTalkConnection to be used
@@ -325,6 +712,132 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 
     CHECKCONHANDLE(connectionHandle, connection, return -1);
 
+    processInputByte(connection, rxbyte);
+
+    return connection->iproc.state;
+}
+
+/**
+ * Process a buffer from the telemetry stream, up to the end of the first packet
+ * that is completed or rejected. The sync byte is searched for and the object
+ * data is copied and checksummed in bulk, only the header fields go through the
+ * byte wise state machine.
+ * \param[in] connectionHandle UAVTalkConnection to be used
+ * \param[in] rxbuffer Received bytes
+ * \param[in] length Number of bytes in rxbuffer
+ * \param[out] state The UAVTalkRxState after the last byte consumed
+ * \return Number of bytes consumed, call again with the rest of the buffer
+ * \return -1 Failure
+ */
+int32_t UAVTalkProcessInputBufferQuiet(UAVTalkConnection connectionHandle, const uint8_t *rxbuffer, int32_t length, UAVTalkRxState *state)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    UAVTalkInputProcessor *iproc = &connection->iproc;
+    int32_t position = 0;
+
+    while (position < length) {
+        if (iproc->state == UAVTALK_STATE_ERROR || iproc->state == UAVTALK_STATE_COMPLETE) {
+            iproc->state = UAVTALK_STATE_SYNC;
+        }
+
+        if (iproc->state == UAVTALK_STATE_SYNC) {
+            // Skip everything up to the next sync byte
+            const uint8_t *sync = memchr(&rxbuffer[position], UAVTALK_SYNC_VAL, length - position);
+            if (sync == NULL) {
+                connection->stats.rxBytes += length - position;
+                position = length;
+                break;
+            }
+            connection->stats.rxBytes += sync - &rxbuffer[position];
+            position = sync - rxbuffer;
+
+            // Take the whole minimal header at once if it is there
+            if (length - position >= (int32_t)UAVTALK_MIN_HEADER_LENGTH &&
+                (rxbuffer[position + 1] & UAVTALK_TYPE_MASK) == UAVTALK_TYPE_VER) {
+                const uint8_t *header = &rxbuffer[position];
+                iproc->type        = header[1];
+                iproc->packet_size = header[2] | (header[3] << 8);
+                if (iproc->packet_size < UAVTALK_MIN_HEADER_LENGTH || iproc->packet_size > UAVTALK_MAX_HEADER_LENGTH + UAVTALK_MAX_PAYLOAD_LENGTH) {
+                    // incorrect packet size, drop the sync, type and size bytes
+                    connection->stats.rxBytes += 4;
+                    position     += 4;
+                    iproc->state  = UAVTALK_STATE_ERROR;
+                    break;
+                }
+                iproc->objId = header[4] | (header[5] << 8) | (header[6] << 16) | ((uint32_t)header[7] << 24);
+                iproc->cs    = PIOS_CRC_updateCRC(0, header, UAVTALK_MIN_HEADER_LENGTH);
+                iproc->rxPacketLength = UAVTALK_MIN_HEADER_LENGTH;
+                connection->stats.rxBytes += UAVTALK_MIN_HEADER_LENGTH;
+                position += UAVTALK_MIN_HEADER_LENGTH;
+                processObjId(connection);
+            } else {
+                processInputByte(connection, rxbuffer[position++]);
+            }
+        } else if (iproc->state == UAVTALK_STATE_DATA) {
+            // Copy as much of the object data as there is
+            int32_t count = iproc->length - iproc->rxCount;
+            if (count > length - position) {
+                count = length - position;
+            }
+            memcpy(&connection->rxBuffer[iproc->rxCount], &rxbuffer[position], count);
+            iproc->cs       = PIOS_CRC_updateCRC(iproc->cs, &rxbuffer[position], count);
+            iproc->rxCount += count;
+            iproc->rxPacketLength += count;
+            connection->stats.rxBytes += count;
+            position += count;
+            if (iproc->rxCount == iproc->length) {
+                iproc->state   = UAVTALK_STATE_CS;
+                iproc->rxCount = 0;
+            }
+        } else {
+            processInputByte(connection, rxbuffer[position++]);
+        }
+
+        if (iproc->state == UAVTALK_STATE_ERROR || iproc->state == UAVTALK_STATE_COMPLETE) {
+            break;
+        }
+    }
+
+    *state = iproc->state;
+    return position;
+}
+
+/**
+ * Process a buffer from the telemetry stream, every completed packet is received.
+ * \param[in] connectionHandle UAVTalkConnection to be used
+ * \param[in] rxbuffer Received bytes
+ * \param[in] length Number of bytes in rxbuffer
+ * \return UAVTalkRxState after the last byte
+ */
+UAVTalkRxState UAVTalkProcessInputBuffer(UAVTalkConnection connectionHandle, const uint8_t *rxbuffer, int32_t length)
+{
+    UAVTalkRxState state = UAVTALK_STATE_ERROR;
+
+    while (length > 0) {
+        int32_t count = UAVTalkProcessInputBufferQuiet(connectionHandle, rxbuffer, length, &state);
+        if (count < 0) {
+            return UAVTALK_STATE_ERROR;
+        }
+        if (state == UAVTALK_STATE_COMPLETE) {
+            UAVTalkReceiveObject(connectionHandle);
+        }
+        rxbuffer += count;
+        length   -= count;
+    }
+
+    return state;
+}
+
+/**
+ * Process an byte from the telemetry stream.
+ * \param[in] connection UAVTalkConnectionData to be used
+ * \param[in] rxbyte Received byte
+ */
+static void processInputByte(UAVTalkConnectionData *connection, uint8_t rxbyte)
+{
     UAVTalkInputProcessor *iproc = &connection->iproc;
     ++connection->stats.rxBytes;
 
@@ -402,72 +915,17 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
             break;
         }
 
-        // Search for object.
-        iproc->obj = UAVObjGetByID(iproc->objId);
+        processObjId(connection);
+        break;
 
-        // Determine data length
-        if (iproc->type == UAVTALK_TYPE_OBJ_REQ || iproc->type == UAVTALK_TYPE_ACK || iproc->type == UAVTALK_TYPE_NACK) {
-            iproc->length = 0;
-            iproc->instanceLength = 0;
-        } else {
-            if (iproc->obj) {
-                iproc->length = UAVObjGetNumBytes(iproc->obj);
-                iproc->instanceLength = (UAVObjIsSingleInstance(iproc->obj) ? 0 : 2);
-            } else {
-                // We don't know if it's a multi-instance object, so just assume it's 0.
-                iproc->instanceLength = 0;
-                iproc->length = iproc->packet_size - iproc->rxPacketLength;
-            }
-            iproc->timestampLength = (iproc->type & UAVTALK_TIMESTAMPED) ? 2 : 0;
-        }
+    case UAVTALK_STATE_INSTID:
 
-        // Check length and determine next state
-        if (iproc->length >= UAVTALK_MAX_PAYLOAD_LENGTH) {
-            connection->stats.rxErrors++;
-            iproc->state = UAVTALK_STATE_ERROR;
-            break;
-        }
+        // update the CRC
+        iproc->cs      = PIOS_CRC_updateByte(iproc->cs, rxbyte);
 
-        // Check the lengths match
-        if ((iproc->rxPacketLength + iproc->instanceLength + iproc->timestampLength + iproc->length) != iproc->packet_size) { // packet error - mismatched packet size
-            connection->stats.rxErrors++;
-            iproc->state = UAVTALK_STATE_ERROR;
-            break;
-        }
-
-        iproc->instId = 0;
-        if (iproc->type == UAVTALK_TYPE_NACK) {
-            // If this is a NACK, we skip to Checksum
-            iproc->state = UAVTALK_STATE_CS;
-        }
-        // Check if this is a single instance object (i.e. if the instance ID field is coming next)
-        else if ((iproc->obj != 0) && !UAVObjIsSingleInstance(iproc->obj)) {
-            iproc->state = UAVTALK_STATE_INSTID;
-        }
-        // Check if this is a single instance and has a timestamp in it
-        else if ((iproc->obj != 0) && (iproc->type & UAVTALK_TIMESTAMPED)) {
-            iproc->timestamp = 0;
-            iproc->state     = UAVTALK_STATE_TIMESTAMP;
-        } else {
-            // If there is a payload get it, otherwise receive checksum
-            if (iproc->length > 0) {
-                iproc->state = UAVTALK_STATE_DATA;
-            } else {
-                iproc->state = UAVTALK_STATE_CS;
-            }
-        }
-        iproc->rxCount = 0;
-
-        break;
-
-    case UAVTALK_STATE_INSTID:
-
-        // update the CRC
-        iproc->cs      = PIOS_CRC_updateByte(iproc->cs, rxbyte);
-
-        iproc->instId += rxbyte << (8 * (iproc->rxCount++));
-
-        if (iproc->rxCount < 2) {
+        iproc->instId += rxbyte << (8 * (iproc->rxCount++));
+
+        if (iproc->rxCount < 2) {
             break;
         }
 
@@ -547,8 +1005,85 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
         iproc->state = UAVTALK_STATE_ERROR;
     }
 
-    // Done
-    return iproc->state;
+}
+
+
+/**
+ * Handle a completely received object id, look up the object and
+ * determine what comes next in the packet.
+ * \param[in] connection UAVTalkConnectionData to be used
+ */
+static void processObjId(UAVTalkConnectionData *connection)
+{
+    UAVTalkInputProcessor *iproc = &connection->iproc;
+
+    // Search for object.
+    iproc->obj = UAVObjGetByID(iproc->objId);
+
+    // Determine data length
+    if (iproc->type == UAVTALK_TYPE_OBJ_DELTA && iproc->obj) {
+        // Delta packets are at most one byte longer than the object
+        iproc->instanceLength  = (UAVObjIsSingleInstance(iproc->obj) ? 0 : 2);
+        iproc->timestampLength = 0;
+        iproc->length = iproc->packet_size - iproc->rxPacketLength - iproc->instanceLength;
+        if (iproc->length < 1 || iproc->length > UAVObjGetNumBytes(iproc->obj) + 1) {
+            connection->stats.rxErrors++;
+            iproc->state = UAVTALK_STATE_ERROR;
+            return;
+        }
+    } else if (iproc->type == UAVTALK_TYPE_OBJ_REQ || iproc->type == UAVTALK_TYPE_ACK || iproc->type == UAVTALK_TYPE_NACK) {
+        iproc->length = 0;
+        // Requests and acks of multi instance objects carry the instance ID
+        iproc->instanceLength  = (iproc->obj && iproc->type != UAVTALK_TYPE_NACK && !UAVObjIsSingleInstance(iproc->obj)) ? 2 : 0;
+        iproc->timestampLength = 0;
+    } else {
+        if (iproc->obj) {
+            iproc->length = UAVObjGetNumBytes(iproc->obj);
+            iproc->instanceLength = (UAVObjIsSingleInstance(iproc->obj) ? 0 : 2);
+        } else {
+            // We don't know if it's a multi-instance object, so just assume it's 0.
+            iproc->instanceLength = 0;
+            iproc->length = iproc->packet_size - iproc->rxPacketLength;
+        }
+        iproc->timestampLength = (iproc->type & UAVTALK_TIMESTAMPED) ? 2 : 0;
+    }
+
+    // Check length and determine next state, the keyframe of a delta packet is one byte longer than its object
+    if (iproc->length > UAVTALK_MAX_PAYLOAD_LENGTH) {
+        connection->stats.rxErrors++;
+        iproc->state = UAVTALK_STATE_ERROR;
+        return;
+    }
+
+    // Check the lengths match
+    if ((iproc->rxPacketLength + iproc->instanceLength + iproc->timestampLength + iproc->length) != iproc->packet_size) { // packet error - mismatched packet size
+        connection->stats.rxErrors++;
+        iproc->state = UAVTALK_STATE_ERROR;
+        return;
+    }
+
+    iproc->instId = 0;
+    if (iproc->type == UAVTALK_TYPE_NACK) {
+        // If this is a NACK, we skip to Checksum
+        iproc->state = UAVTALK_STATE_CS;
+    }
+    // Check if this is a single instance object (i.e. if the instance ID field is coming next)
+    else if ((iproc->obj != 0) && !UAVObjIsSingleInstance(iproc->obj)) {
+        iproc->state = UAVTALK_STATE_INSTID;
+    }
+    // Check if this is a single instance and has a timestamp in it
+    else if ((iproc->obj != 0) && (iproc->type & UAVTALK_TIMESTAMPED)) {
+        iproc->timestamp = 0;
+        iproc->state     = UAVTALK_STATE_TIMESTAMP;
+    } else {
+        // If there is a payload get it, otherwise receive checksum
+        if (iproc->length > 0) {
+            iproc->state = UAVTALK_STATE_DATA;
+        } else {
+            iproc->state = UAVTALK_STATE_CS;
+        }
+    }
+    iproc->rxCount = 0;
 }
 
 /**
@@ -740,7 +1275,7 @@ uint32_t UAVTalkGetPacketObjId(UAVTalkConnection connectionHandle)
 /**
  * Receive an object. This function process objects received through the telemetry stream.
  * \param[in] connection UAVTalkConnection to be used
- * \param[in] type Type of received message (UAVTALK_TYPE_OBJ, UAVTALK_TYPE_OBJ_REQ, UAVTALK_TYPE_OBJ_ACK, UAVTALK_TYPE_ACK, UAVTALK_TYPE_NACK)
+ * \param[in] type Type of received message (UAVTALK_TYPE_OBJ, UAVTALK_TYPE_OBJ_REQ, UAVTALK_TYPE_OBJ_ACK, UAVTALK_TYPE_ACK, UAVTALK_TYPE_NACK, UAVTALK_TYPE_AGGREGATE, UAVTALK_TYPE_OBJ_DELTA)
  * \param[in] objId ID of the object to work on
  * \param[in] instId The instance ID of UAVOBJ_ALL_INSTANCES for all instances.
  * \param[in] data Data buffer
@@ -753,7 +1288,7 @@ static int32_t receiveObject(UAVTalkConnectionData *connection,
                              uint32_t objId,
                              uint16_t instId,
                              uint8_t *data,
-                             __attribute__((unused)) int32_t length)
+                             int32_t length)
 {
     UAVObjHandle obj;
     int32_t ret = 0;
@@ -804,7 +1339,10 @@ static int32_t receiveObject(UAVTalkConnectionData *connection,
         }
         break;
     case UAVTALK_TYPE_NACK:
-        // Do nothing on flight side, let it time out.
+        // Drop the windowed transactions of the object, let the others time out.
+        if (obj) {
+            updateNack(connection, obj);
+        }
         break;
     case UAVTALK_TYPE_ACK:
         // All instances, not allowed for ACK messages
@@ -815,6 +1353,12 @@ static int32_t receiveObject(UAVTalkConnectionData *connection,
             ret = -1;
         }
         break;
+    case UAVTALK_TYPE_AGGREGATE:
+        ret = receiveAggregate(connection, objId, data, length);
+        break;
+    case UAVTALK_TYPE_OBJ_DELTA:
+        ret = receiveDelta(connection, obj, objId, instId, data, length);
+        break;
     default:
         ret = -1;
     }
@@ -834,10 +1378,48 @@ static int32_t receiveObject(UAVTalkConnectionData *connection,
  */
 static void updateAck(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId)
 {
+    bool completed = false;
+
     if (connection->respObj == obj && (connection->respInstId == instId || connection->respInstId == UAVOBJ_ALL_INSTANCES)) {
         xSemaphoreGive(connection->respSema);
         connection->respObj = 0;
     }
+
+    for (uint8_t n = 0; n < UAVTALK_TRANSACTION_WINDOW; n++) {
+        UAVTalkTransaction *trans = &connection->window[n];
+        if (trans->obj == obj && (trans->instId == instId || trans->instId == UAVOBJ_ALL_INSTANCES)) {
+            trans->obj = 0;
+            completed  = true;
+        }
+    }
+    if (completed) {
+        xSemaphoreGive(connection->windowSema);
+    }
+}
+
+/**
+ * Drop the windowed transactions of an object the other end does not know and
+ * send a keyframe next if it is delta encoded
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object
+ */
+static void updateNack(UAVTalkConnectionData *connection, UAVObjHandle obj)
+{
+    bool dropped = false;
+
+    resetDeltaSlots(connection, obj);
+
+    for (uint8_t n = 0; n < UAVTALK_TRANSACTION_WINDOW; n++) {
+        UAVTalkTransaction *trans = &connection->window[n];
+        if (trans->obj == obj) {
+            trans->obj = 0;
+            ++connection->windowFailures;
+            dropped    = true;
+        }
+    }
+    if (dropped) {
+        xSemaphoreGive(connection->windowSema);
+    }
 }
 
 /**
@@ -1015,6 +1597,664 @@ static int32_t sendNack(UAVTalkConnectionData *connection, uint32_t objId)
     return 0;
 }
 
+/**
+ * Add an object instance to the pending aggregate packet, the packet is sent
+ * first if the object does not fit in it anymore. Objects the peer has no
+ * index for are sent in a regular packet.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object handle to send
+ * \param[in] instId The instance ID (can NOT be UAVOBJ_ALL_INSTANCES)
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t aggregateSingleObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId)
+{
+    uint8_t instanceLength = UAVObjIsSingleInstance(obj) ? 0 : 2;
+    uint16_t entryLength   = UAVTALK_AGGREGATE_ENTRY_HEADER + instanceLength + UAVObjGetNumBytes(obj);
+    int32_t index;
+    uint8_t *entry;
+
+    // Objects too large for an aggregate packet or unknown to the peer go alone
+    if (entryLength > UAVTALK_AGGREGATE_MAX_LENGTH) {
+        return sendSingleObject(connection, obj, instId, UAVTALK_TYPE_OBJ);
+    }
+    index = UAVObjGetIndex(obj);
+    if (index < 0 || index >= connection->aggKnown) {
+        return sendSingleObject(connection, obj, instId, UAVTALK_TYPE_OBJ);
+    }
+
+    if (!connection->aggBuffer) {
+        connection->aggBuffer = pvPortMalloc(UAVTALK_MIN_HEADER_LENGTH + UAVTALK_AGGREGATE_MAX_LENGTH + UAVTALK_CHECKSUM_LENGTH);
+        if (!connection->aggBuffer) {
+            return sendSingleObject(connection, obj, instId, UAVTALK_TYPE_OBJ);
+        }
+    }
+
+    if (connection->aggLength + entryLength > UAVTALK_AGGREGATE_MAX_LENGTH) {
+        flushAggregate(connection);
+    }
+
+    entry    = &connection->aggBuffer[UAVTALK_MIN_HEADER_LENGTH + connection->aggLength];
+    entry[0] = (uint8_t)index;
+    if (instanceLength > 0) {
+        entry[1] = (uint8_t)(instId & 0xFF);
+        entry[2] = (uint8_t)((instId >> 8) & 0xFF);
+    }
+    if (UAVObjPack(obj, instId, &entry[UAVTALK_AGGREGATE_ENTRY_HEADER + instanceLength]) < 0) {
+        return -1;
+    }
+
+    if (connection->aggCount == 0) {
+        connection->aggObj    = obj;
+        connection->aggInstId = instId;
+    }
+    connection->aggLength += entryLength;
+    connection->aggCount++;
+    connection->aggObjectBytes += entryLength - UAVTALK_AGGREGATE_ENTRY_HEADER - instanceLength;
+
+    return 0;
+}
+
+/**
+ * Send the pending aggregate packet. A single pending object is sent in a
+ * regular packet, which is shorter.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t flushAggregate(UAVTalkConnectionData *connection)
+{
+    uint8_t *buffer = connection->aggBuffer;
+    uint8_t count   = connection->aggCount;
+    uint16_t length = UAVTALK_MIN_HEADER_LENGTH + connection->aggLength;
+
+    if (count == 0) {
+        return 0;
+    }
+    uint16_t objectBytes = connection->aggObjectBytes;
+    connection->aggLength = 0;
+    connection->aggCount  = 0;
+    connection->aggObjectBytes = 0;
+
+    if (count == 1) {
+        return sendSingleObject(connection, connection->aggObj, connection->aggInstId, UAVTALK_TYPE_OBJ);
+    }
+
+    if (!connection->outStream) {
+        return -1;
+    }
+
+    buffer[0] = UAVTALK_SYNC_VAL; // sync byte
+    buffer[1] = UAVTALK_TYPE_AGGREGATE;
+    buffer[2] = (uint8_t)(length & 0xFF);
+    buffer[3] = (uint8_t)((length >> 8) & 0xFF);
+    buffer[4] = (uint8_t)(UAVTALK_AGGREGATE_OBJID & 0xFF);
+    buffer[5] = (uint8_t)((UAVTALK_AGGREGATE_OBJID >> 8) & 0xFF);
+    buffer[6] = (uint8_t)((UAVTALK_AGGREGATE_OBJID >> 16) & 0xFF);
+    buffer[7] = (uint8_t)((UAVTALK_AGGREGATE_OBJID >> 24) & 0xFF);
+
+    // Calculate checksum
+    buffer[length] = PIOS_CRC_updateCRC(0, buffer, length);
+
+    uint16_t tx_msg_len = length + UAVTALK_CHECKSUM_LENGTH;
+    int32_t rc = (*connection->outStream)(buffer, tx_msg_len);
+
+    if (rc == tx_msg_len) {
+        // Update stats
+        connection->stats.txObjects     += count;
+        connection->stats.txBytes       += tx_msg_len;
+        connection->stats.txObjectBytes += objectBytes;
+    }
+
+    // Done
+    return 0;
+}
+
+/**
+ * Send an aggregate offer. It tells the peer how many entries of its table were
+ * received and optionally sends our own table, in as many packets as needed.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] flags UAVTALK_AGGREGATE_OFFER_REPLY if the other end has to answer with its own offer
+ * \param[in] table Send the table of object indexes
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t sendAggregateOffer(UAVTalkConnectionData *connection, uint8_t flags, bool table)
+{
+    uint16_t size  = table ? aggregateTableSize() : 0;
+    uint16_t first = 0;
+    int32_t dataOffset;
+
+    if (!connection->outStream) {
+        return -1;
+    }
+
+    do {
+        uint8_t count = (size - first < UAVTALK_AGGREGATE_OFFER_CHUNK) ? (size - first) : UAVTALK_AGGREGATE_OFFER_CHUNK;
+        bool last     = (first + count == size);
+
+        connection->txBuffer[0]  = UAVTALK_SYNC_VAL; // sync byte
+        connection->txBuffer[1]  = UAVTALK_TYPE_AGGREGATE;
+        // data length inserted here below
+        connection->txBuffer[4]  = (uint8_t)(UAVTALK_AGGREGATE_OFFER_OBJID & 0xFF);
+        connection->txBuffer[5]  = (uint8_t)((UAVTALK_AGGREGATE_OFFER_OBJID >> 8) & 0xFF);
+        connection->txBuffer[6]  = (uint8_t)((UAVTALK_AGGREGATE_OFFER_OBJID >> 16) & 0xFF);
+        connection->txBuffer[7]  = (uint8_t)((UAVTALK_AGGREGATE_OFFER_OBJID >> 24) & 0xFF);
+        // The answer is only wanted once the whole table was sent
+        connection->txBuffer[8]  = table ? (last ? (flags | UAVTALK_AGGREGATE_OFFER_END) : (flags & ~UAVTALK_AGGREGATE_OFFER_REPLY)) : flags;
+        connection->txBuffer[9]  = connection->aggRxCount;
+        connection->txBuffer[10] = connection->aggRxCrc;
+
+        dataOffset = 11;
+        if (table) {
+            connection->txBuffer[dataOffset++] = (uint8_t)first;
+            for (uint8_t n = 0; n < count; n++) {
+                UAVObjHandle obj = UAVObjGetByIndex(first + n);
+                uint32_t objId   = obj ? UAVObjGetID(obj) : 0;
+                connection->txBuffer[dataOffset++] = (uint8_t)(objId & 0xFF);
+                connection->txBuffer[dataOffset++] = (uint8_t)((objId >> 8) & 0xFF);
+                connection->txBuffer[dataOffset++] = (uint8_t)((objId >> 16) & 0xFF);
+                connection->txBuffer[dataOffset++] = (uint8_t)((objId >> 24) & 0xFF);
+            }
+        }
+        first += count;
+
+        // Store the packet length
+        connection->txBuffer[2] = (uint8_t)((dataOffset) & 0xFF);
+        connection->txBuffer[3] = (uint8_t)(((dataOffset) >> 8) & 0xFF);
+
+        // Calculate checksum
+        connection->txBuffer[dataOffset] = PIOS_CRC_updateCRC(0, connection->txBuffer, dataOffset);
+
+        uint16_t tx_msg_len = dataOffset + UAVTALK_CHECKSUM_LENGTH;
+        int32_t rc = (*connection->outStream)(connection->txBuffer, tx_msg_len);
+
+        if (rc == tx_msg_len) {
+            // Update stats
+            connection->stats.txBytes += tx_msg_len;
+        }
+    } while (first < size);
+
+    // Done
+    return 0;
+}
+
+/**
+ * Get the number of entries of our table of object indexes.
+ * \return Number of entries
+ */
+static uint16_t aggregateTableSize(void)
+{
+    uint16_t size = UAVObjGetNumIndexes();
+
+    return (size < UAVTALK_AGGREGATE_MAX_INDEXES) ? size : UAVTALK_AGGREGATE_MAX_INDEXES;
+}
+
+/**
+ * Calculate the CRC of the object IDs of the first entries of our table of object indexes.
+ * \param[in] count Number of entries
+ * \return The CRC
+ */
+static uint8_t aggregateTableCrc(uint8_t count)
+{
+    uint8_t crc = 0;
+
+    for (uint8_t n = 0; n < count; n++) {
+        UAVObjHandle obj = UAVObjGetByIndex(n);
+        uint32_t objId   = obj ? UAVObjGetID(obj) : 0;
+        uint8_t id[4]    = { (uint8_t)(objId & 0xFF), (uint8_t)((objId >> 8) & 0xFF), (uint8_t)((objId >> 16) & 0xFF), (uint8_t)((objId >> 24) & 0xFF) };
+        crc = PIOS_CRC_updateCRC(crc, id, sizeof(id));
+    }
+
+    return crc;
+}
+
+/**
+ * Receive an aggregate offer. The offer acknowledges entries of our table and may carry
+ * a chunk of the peer's table. The last chunk of the peer's table is answered.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] data Payload
+ * \param[in] length Payload length
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t receiveAggregateOffer(UAVTalkConnectionData *connection, uint8_t *data, int32_t length)
+{
+    uint8_t flags = data[0];
+    uint8_t known = data[1];
+
+    if (length < UAVTALK_AGGREGATE_OFFER_HEADER ||
+        (length > UAVTALK_AGGREGATE_OFFER_HEADER && (length - UAVTALK_AGGREGATE_OFFER_HEADER - 1) % 4 != 0)) {
+        return -1;
+    }
+
+    // Only the entries the peer received in sequence with the same object IDs can be used
+    connection->aggPeer   = 1;
+    connection->aggKnown  = (known <= aggregateTableSize() && aggregateTableCrc(known) == data[2]) ? known : 0;
+    connection->deltaPeer = (connection->txDelta && (flags & UAVTALK_AGGREGATE_OFFER_DELTA)) ? 1 : 0;
+    if (length == UAVTALK_AGGREGATE_OFFER_HEADER) {
+        return 0;
+    }
+
+    // A chunk of the peer's table. A table starts over at its first chunk, the keyframes
+    // received on the previous connection are not valid anymore then.
+    uint8_t first  = data[UAVTALK_AGGREGATE_OFFER_HEADER];
+    uint16_t count = (length - UAVTALK_AGGREGATE_OFFER_HEADER - 1) / 4;
+    if (first == 0) {
+        if (connection->rxDelta) {
+            for (uint8_t n = 0; n < UAVTALK_DELTA_SLOTS; n++) {
+                connection->rxDelta[n].obj = 0;
+            }
+        }
+        connection->aggRxCount = 0;
+        connection->aggRxCrc   = 0;
+    }
+    if (count > 0 && first == connection->aggRxCount && first + count <= UAVTALK_AGGREGATE_MAX_INDEXES) {
+        if (!connection->aggRxTable) {
+            connection->aggRxTable = pvPortMalloc(sizeof(UAVObjHandle) * UAVTALK_AGGREGATE_MAX_INDEXES);
+        }
+        if (connection->aggRxTable) {
+            bool complete = true;
+            for (uint16_t n = 0; n < count; n++) {
+                uint8_t *id    = &data[UAVTALK_AGGREGATE_OFFER_HEADER + 1 + 4 * n];
+                uint32_t objId = id[0] | (id[1] << 8) | (id[2] << 16) | ((uint32_t)id[3] << 24);
+                UAVObjHandle obj = objId ? UAVObjGetByID(objId) : 0;
+                connection->aggRxTable[first + n] = obj;
+                // The peer must not aggregate the objects from the first one we do not know
+                if (complete && (obj || !objId)) {
+                    connection->aggRxCrc = PIOS_CRC_updateCRC(connection->aggRxCrc, id, 4);
+                    connection->aggRxCount++;
+                } else {
+                    complete = false;
+                }
+            }
+            if (first + count > connection->aggRxLimit) {
+                connection->aggRxLimit = first + count;
+            }
+        }
+    }
+
+    // Answer the last chunk, with our own table if the peer asks for it
+    if (flags & UAVTALK_AGGREGATE_OFFER_END) {
+        if (flags & UAVTALK_AGGREGATE_OFFER_REPLY) {
+            sendAggregateOffer(connection, connection->txDelta ? UAVTALK_AGGREGATE_OFFER_DELTA : 0, true);
+        } else if (connection->aggRxCount > 0) {
+            sendAggregateOffer(connection, connection->txDelta ? UAVTALK_AGGREGATE_OFFER_DELTA : 0, false);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Receive an aggregate packet, either an offer or the updates of several objects.
+ * The length of an entry is known from its object, so the packet is dropped from
+ * the first entry whose index is not in the peer's table.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] objId Object ID of the packet, UAVTALK_AGGREGATE_OBJID or UAVTALK_AGGREGATE_OFFER_OBJID
+ * \param[in] data Payload
+ * \param[in] length Payload length
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t receiveAggregate(UAVTalkConnectionData *connection, uint32_t objId, uint8_t *data, int32_t length)
+{
+    int32_t offset = 0;
+
+    if (objId == UAVTALK_AGGREGATE_OFFER_OBJID) {
+        return receiveAggregateOffer(connection, data, length);
+    }
+    if (objId != UAVTALK_AGGREGATE_OBJID) {
+        return -1;
+    }
+
+    while (offset + UAVTALK_AGGREGATE_ENTRY_HEADER <= length) {
+        uint8_t index    = data[offset];
+        UAVObjHandle obj = (index < connection->aggRxLimit) ? connection->aggRxTable[index] : 0;
+        if (!obj) {
+            return -1;
+        }
+        offset += UAVTALK_AGGREGATE_ENTRY_HEADER;
+
+        uint8_t instanceLength = UAVObjIsSingleInstance(obj) ? 0 : 2;
+        if (offset + instanceLength + UAVObjGetNumBytes(obj) > length) {
+            return -1;
+        }
+        uint16_t instId = instanceLength ? (data[offset] | (data[offset + 1] << 8)) : 0;
+        // Unpack object, if the instance does not exist it will be created!
+        UAVObjUnpack(obj, instId, &data[offset + instanceLength]);
+        // Check if an ack is pending
+        updateAck(connection, obj, instId);
+        offset += instanceLength + UAVObjGetNumBytes(obj);
+    }
+
+    return (offset == length) ? 0 : -1;
+}
+
+/**
+ * Send an unacked object instance to a peer accepting aggregate packets,
+ * delta encoded if it is large enough and a delta slot is available for it.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object handle to send
+ * \param[in] instId The instance ID (can NOT be UAVOBJ_ALL_INSTANCES)
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t sendUnackedObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId)
+{
+    if (connection->deltaPeer && UAVObjGetNumBytes(obj) >= UAVTALK_DELTA_MIN_LENGTH) {
+        UAVTalkDeltaSlot *slot = getDeltaSlot(connection->txDelta, obj, instId, true);
+        if (slot) {
+            return sendDeltaObject(connection, slot, obj, instId);
+        }
+    }
+    return aggregateSingleObject(connection, obj, instId);
+}
+
+/**
+ * Find the delta slot of an object instance, optionally taking a free or idle slot for it.
+ * \param[in] slots Delta slots of the connection, transmit or receive
+ * \param[in] obj Object handle
+ * \param[in] instId The instance ID
+ * \param[in] create Take a slot if the instance has none
+ * \return The slot or 0 if none is available
+ */
+static UAVTalkDeltaSlot *getDeltaSlot(UAVTalkDeltaSlot *slots, UAVObjHandle obj, uint16_t instId, bool create)
+{
+    portTickType now = xTaskGetTickCount();
+    uint16_t length  = UAVObjGetNumBytes(obj);
+    UAVTalkDeltaSlot *slot = 0;
+
+    for (uint8_t n = 0; n < UAVTALK_DELTA_SLOTS; n++) {
+        if (slots[n].obj == obj && slots[n].instId == instId) {
+            slots[n].lastUsed = now;
+            return &slots[n];
+        }
+    }
+    if (!create) {
+        return 0;
+    }
+
+    // Take a free slot, or the one idle for the longest time
+    for (uint8_t n = 0; n < UAVTALK_DELTA_SLOTS; n++) {
+        if (slots[n].capacity != 0 && slots[n].capacity < length) {
+            continue;
+        }
+        if (slots[n].obj == 0) {
+            slot = &slots[n];
+            break;
+        }
+        if ((now - slots[n].lastUsed) >= UAVTALK_DELTA_IDLE_MS / portTICK_RATE_MS &&
+            (!slot || (now - slots[n].lastUsed) > (now - slot->lastUsed))) {
+            slot = &slots[n];
+        }
+    }
+    if (!slot) {
+        return 0;
+    }
+
+    if (slot->capacity == 0) {
+        slot->baseline = pvPortMalloc(length);
+        if (!slot->baseline) {
+            return 0;
+        }
+        slot->capacity = length;
+    }
+    slot->obj           = obj;
+    slot->instId        = instId;
+    slot->seq           = 0;
+    slot->sinceKeyframe = UAVTALK_DELTA_KEYFRAME_INTERVAL;
+    slot->lastUsed      = now;
+    slot->rawBytes      = 0;
+    slot->sentBytes     = 0;
+
+    return slot;
+}
+
+/**
+ * XOR the object data with the keyframe and run length encode the result.
+ * \param[in] baseline Object data of the keyframe
+ * \param[in] data Current object data
+ * \param[in] length Object data length
+ * \param[out] out Encoded delta
+ * \param[in] maxLength Maximum length of the encoded delta
+ * \return Length of the encoded delta
+ * \return -1 The delta does not fit in maxLength
+ */
+static int32_t encodeDelta(const uint8_t *baseline, const uint8_t *data, uint16_t length, uint8_t *out, uint16_t maxLength)
+{
+    uint16_t in  = 0;
+    uint16_t pos = 0;
+
+    while (in < length) {
+        uint16_t run = 0;
+
+        // Unchanged bytes
+        while (in + run < length && run < UAVTALK_DELTA_MAX_RUN && baseline[in + run] == data[in + run]) {
+            run++;
+        }
+        if (run > 0) {
+            if (pos + 1 > maxLength) {
+                return -1;
+            }
+            out[pos++] = UAVTALK_DELTA_ZERO_RUN | (run - 1);
+            in += run;
+            continue;
+        }
+
+        // Changed bytes, a single unchanged byte is cheaper as a literal than as a run
+        while (in + run < length && run < UAVTALK_DELTA_MAX_RUN &&
+               !(baseline[in + run] == data[in + run] && (in + run + 1 >= length || baseline[in + run + 1] == data[in + run + 1]))) {
+            run++;
+        }
+        if (pos + 1 + run > maxLength) {
+            return -1;
+        }
+        out[pos++] = run - 1;
+        for (uint16_t k = 0; k < run; k++, in++) {
+            out[pos++] = baseline[in] ^ data[in];
+        }
+    }
+
+    return pos;
+}
+
+/**
+ * Apply a run length encoded delta to the keyframe data.
+ * \param[in,out] data Object data of the keyframe, the current object data on return
+ * \param[in] length Object data length
+ * \param[in] delta Encoded delta
+ * \param[in] deltaLength Length of the encoded delta
+ * \return 0 Success
+ * \return -1 The delta does not match the object length
+ */
+static int32_t decodeDelta(uint8_t *data, uint16_t length, const uint8_t *delta, uint16_t deltaLength)
+{
+    uint16_t out = 0;
+    uint16_t pos = 0;
+
+    while (pos < deltaLength) {
+        uint8_t token = delta[pos++];
+        uint16_t run  = (token & ~UAVTALK_DELTA_ZERO_RUN) + 1;
+
+        if (out + run > length) {
+            return -1;
+        }
+        if (token & UAVTALK_DELTA_ZERO_RUN) {
+            out += run;
+            continue;
+        }
+        if (pos + run > deltaLength) {
+            return -1;
+        }
+        for (uint16_t k = 0; k < run; k++) {
+            data[out++] ^= delta[pos++];
+        }
+    }
+
+    return (out == length) ? 0 : -1;
+}
+
+/**
+ * Send an object instance delta encoded against its last keyframe, or as a new keyframe
+ * if the keyframe interval is over or the delta is not shorter than the object. The
+ * pending aggregate packet is sent first, so that the delta can't overtake it.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] slot Transmit delta slot of the instance
+ * \param[in] obj Object handle to send
+ * \param[in] instId The instance ID (can NOT be UAVOBJ_ALL_INSTANCES)
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t sendDeltaObject(UAVTalkConnectionData *connection, UAVTalkDeltaSlot *slot, UAVObjHandle obj, uint16_t instId)
+{
+    uint16_t numBytes = UAVObjGetNumBytes(obj);
+    int32_t length    = -1;
+    int32_t dataOffset;
+    uint32_t objId;
+
+    if (!connection->outStream) {
+        return -1;
+    }
+
+    flushAggregate(connection);
+
+    if (UAVObjPack(obj, instId, connection->deltaBuffer) < 0) {
+        return -1;
+    }
+
+    // Setup type and object id fields
+    objId = UAVObjGetID(obj);
+    connection->txBuffer[0] = UAVTALK_SYNC_VAL; // sync byte
+    connection->txBuffer[1] = UAVTALK_TYPE_OBJ_DELTA;
+    // data length inserted here below
+    connection->txBuffer[4] = (uint8_t)(objId & 0xFF);
+    connection->txBuffer[5] = (uint8_t)((objId >> 8) & 0xFF);
+    connection->txBuffer[6] = (uint8_t)((objId >> 16) & 0xFF);
+    connection->txBuffer[7] = (uint8_t)((objId >> 24) & 0xFF);
+
+    // Setup instance ID if one is required
+    if (UAVObjIsSingleInstance(obj)) {
+        dataOffset = 8;
+    } else {
+        connection->txBuffer[8] = (uint8_t)(instId & 0xFF);
+        connection->txBuffer[9] = (uint8_t)((instId >> 8) & 0xFF);
+        dataOffset = 10;
+    }
+
+    if (slot->sinceKeyframe < UAVTALK_DELTA_KEYFRAME_INTERVAL) {
+        length = encodeDelta(slot->baseline, connection->deltaBuffer, numBytes, &connection->txBuffer[dataOffset + 1], numBytes - 1);
+    }
+    if (length < 0) {
+        slot->seq = (slot->seq + 1) & UAVTALK_DELTA_SEQ_MASK;
+        slot->sinceKeyframe = 0;
+        memcpy(slot->baseline, connection->deltaBuffer, numBytes);
+        memcpy(&connection->txBuffer[dataOffset + 1], connection->deltaBuffer, numBytes);
+        connection->txBuffer[dataOffset] = UAVTALK_DELTA_KEYFRAME | slot->seq;
+        length = numBytes;
+    } else {
+        connection->txBuffer[dataOffset] = slot->seq;
+        slot->sinceKeyframe++;
+    }
+    length += 1;
+
+    // Store the packet length
+    connection->txBuffer[2] = (uint8_t)((dataOffset + length) & 0xFF);
+    connection->txBuffer[3] = (uint8_t)(((dataOffset + length) >> 8) & 0xFF);
+
+    // Calculate checksum
+    connection->txBuffer[dataOffset + length] = PIOS_CRC_updateCRC(0, connection->txBuffer, dataOffset + length);
+
+    uint16_t tx_msg_len = dataOffset + length + UAVTALK_CHECKSUM_LENGTH;
+    int32_t rc = (*connection->outStream)(connection->txBuffer, tx_msg_len);
+
+    if (rc == tx_msg_len) {
+        // Update stats
+        ++connection->stats.txObjects;
+        connection->stats.txBytes += tx_msg_len;
+        connection->stats.txObjectBytes += length;
+        slot->rawBytes  += numBytes;
+        slot->sentBytes += length;
+    }
+
+    // Done
+    return 0;
+}
+
+/**
+ * Receive a delta encoded object, a delta of a keyframe which was not received is
+ * answered with a NACK so that the other end sends a keyframe next.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object handle, 0 if the object is unknown
+ * \param[in] objId Object ID
+ * \param[in] instId The instance ID
+ * \param[in] data Payload
+ * \param[in] length Payload length
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t receiveDelta(UAVTalkConnectionData *connection, UAVObjHandle obj, uint32_t objId, uint16_t instId, uint8_t *data, int32_t length)
+{
+    UAVTalkDeltaSlot *slot;
+    uint16_t numBytes;
+
+    if (!obj || instId == UAVOBJ_ALL_INSTANCES || !connection->rxDelta) {
+        sendNack(connection, objId);
+        return -1;
+    }
+    numBytes = UAVObjGetNumBytes(obj);
+
+    if (data[0] & UAVTALK_DELTA_KEYFRAME) {
+        if (length != numBytes + 1) {
+            return -1;
+        }
+        slot = getDeltaSlot(connection->rxDelta, obj, instId, true);
+        if (slot) {
+            memcpy(slot->baseline, &data[1], numBytes);
+            slot->seq = data[0] & UAVTALK_DELTA_SEQ_MASK;
+        }
+        // Unpack object, if the instance does not exist it will be created!
+        UAVObjUnpack(obj, instId, &data[1]);
+    } else {
+        slot = getDeltaSlot(connection->rxDelta, obj, instId, false);
+        if (!slot || slot->seq != data[0]) {
+            sendNack(connection, objId);
+            return -1;
+        }
+        memcpy(connection->deltaBuffer, slot->baseline, numBytes);
+        if (decodeDelta(connection->deltaBuffer, numBytes, &data[1], length - 1) < 0) {
+            return -1;
+        }
+        UAVObjUnpack(obj, instId, connection->deltaBuffer);
+    }
+
+    if (slot) {
+        slot->rawBytes  += numBytes;
+        slot->sentBytes += length;
+    }
+    // Check if an ack is pending
+    updateAck(connection, obj, instId);
+
+    return 0;
+}
+
+/**
+ * Send keyframes next for the delta encoded instances of an object.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object, or 0 for all objects
+ */
+static void resetDeltaSlots(UAVTalkConnectionData *connection, UAVObjHandle obj)
+{
+    if (!connection->txDelta) {
+        return;
+    }
+    for (uint8_t n = 0; n < UAVTALK_DELTA_SLOTS; n++) {
+        if (obj == 0 || connection->txDelta[n].obj == obj) {
+            connection->txDelta[n].sinceKeyframe = UAVTALK_DELTA_KEYFRAME_INTERVAL;
+        }
+    }
+}
+
 /**
  * @}
  * @}
@@ -27,17 +27,89 @@
 #include "pureimagecache.h"
 #include <QDateTime>
 #include <QSettings>
+#include <QtCore/QtConcurrentRun>
 // #define DEBUG_PUREIMAGECACHE
 namespace core {
 qlonglong PureImageCache::ConnCounter = 0;
 
-PureImageCache::PureImageCache()
+// Number of tiles written by a thread before they are committed
+static const int WRITE_BATCH = 64;
+
+/**
+ * Connection of a thread to the database, Qt connections can only be used
+ * by the thread that opened them. The connection is closed when the thread
+ * exits or when the cache is moved.
+ */
+class PureImageCache::Connection {
+public:
+    Connection(const QString &name, const QString &file, int generation);
+    ~Connection();
+
+    QString name;
+    int generation;
+    bool isOpen;
+    int pendingWrites;
+    QSqlDatabase db;
+    QSqlQuery getQuery;
+    QSqlQuery putTileQuery;
+    QSqlQuery putDataQuery;
+
+    void commit();
+};
+
+PureImageCache::Connection::Connection(const QString &name, const QString &file, int generation) :
+    name(name), generation(generation), isOpen(false), pendingWrites(0)
+{
+    db = QSqlDatabase::addDatabase("QSQLITE", name);
+    db.setDatabaseName(file);
+    if (!db.open()) {
+#ifdef DEBUG_PUREIMAGECACHE
+        qDebug() << "PureImageCache: unable to open" << file << db.lastError().driverText();
+#endif // DEBUG_PUREIMAGECACHE
+        return;
+    }
+    QSqlQuery query(db);
+    // The journal makes it safe, no need to wait for the disk on every commit
+    query.exec("PRAGMA synchronous=NORMAL");
+
+    getQuery     = QSqlQuery(db);
+    getQuery.setForwardOnly(true);
+    getQuery.prepare("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=? AND Y=? AND Zoom=? AND Type=? LIMIT 1)");
+    putTileQuery = QSqlQuery(db);
+    putTileQuery.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
+    putDataQuery = QSqlQuery(db);
+    putDataQuery.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
+    isOpen = true;
+}
+
+PureImageCache::Connection::~Connection()
+{
+    commit();
+    getQuery.clear();
+    putTileQuery.clear();
+    putDataQuery.clear();
+    db.close();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(name);
+}
+
+void PureImageCache::Connection::commit()
+{
+    if (pendingWrites > 0) {
+        db.commit();
+        pendingWrites = 0;
+    }
+}
+
+PureImageCache::PureImageCache() : generation(0)
 {}
 
 void PureImageCache::setGtileCache(const QString &value)
 {
     lock.lockForWrite();
     gtilecache = value;
+    // The connections of all the threads are reopened on the new database
+    generation++;
     QDir d;
     if (!d.exists(gtilecache)) {
         d.mkdir(gtilecache);
@@ -53,12 +125,22 @@ void PureImageCache::setGtileCache(const QString &value)
 #endif // DEBUG_PUREIMAGECACHE
             CreateEmptyDB(db);
         }
+        UpgradeDB(db);
+
+        // Building the index takes a while on a large cache, keep it off the GUI thread
+        Mcounter.lock();
+        qlonglong id = ++ConnCounter;
+        Mcounter.unlock();
+        indexing.addFuture(QtConcurrent::run(&PureImageCache::IndexDB, db, QString::number(id)));
     }
     lock.unlock();
 }
 QString PureImageCache::GtileCache()
 {
-    return gtilecache;
+    lock.lockForRead();
+    QString value = gtilecache;
+    lock.unlock();
+    return value;
 }
 
 
@@ -150,6 +232,14 @@ bool PureImageCache::CreateEmptyDB(const QString &file)
     if (query.numRowsAffected() == -1) {
 #ifdef DEBUG_PUREIMAGECACHE
         qDebug() << "CreateEmptyDB: " << query.lastError().driverText();
+#endif // DEBUG_PUREIMAGECACHE
+        db.close();
+        return false;
+    }
+    query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)");
+    if (query.lastError().isValid()) {
+#ifdef DEBUG_PUREIMAGECACHE
+        qDebug() << "CreateEmptyDB: " << query.lastError().driverText();
 #endif // DEBUG_PUREIMAGECACHE
         db.close();
         return false;
@@ -158,98 +248,164 @@ bool PureImageCache::CreateEmptyDB(const QString &file)
     QSqlDatabase::removeDatabase(QLatin1String("CreateConn"));
     return true;
 }
+
+/**
+ * Bring a database created by an older version up to date: the write ahead
+ * log lets the tiles be read while others are written. It persists in the
+ * database file.
+ */
+bool PureImageCache::UpgradeDB(const QString &file)
+{
+    bool ret = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", QLatin1String("UpgradeConn"));
+        db.setDatabaseName(file);
+        if (db.open()) {
+            QSqlQuery query(db);
+            ret = query.exec("PRAGMA journal_mode=WAL");
+#ifdef DEBUG_PUREIMAGECACHE
+            if (!ret) {
+                qDebug() << "UpgradeDB: " << query.lastError().driverText();
+            }
+#endif // DEBUG_PUREIMAGECACHE
+            query.clear();
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(QLatin1String("UpgradeConn"));
+    return ret;
+}
+
+/**
+ * Add the index which keeps the lookups fast on large caches to a database
+ * created by an older version, run on a worker thread. The tiles are still
+ * read meanwhile thanks to the write ahead log, writes wait for it.
+ */
+bool PureImageCache::IndexDB(const QString &file, const QString &name)
+{
+    bool ret = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+        db.setDatabaseName(file);
+        if (db.open()) {
+            QSqlQuery query(db);
+            ret = query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)");
+#ifdef DEBUG_PUREIMAGECACHE
+            if (!ret) {
+                qDebug() << "IndexDB: " << query.lastError().driverText();
+            }
+#endif // DEBUG_PUREIMAGECACHE
+            query.clear();
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(name);
+    return ret;
+}
+
+/**
+ * The connection of the calling thread to the current database,
+ * called with the lock held
+ */
+PureImageCache::Connection *PureImageCache::threadConnection()
+{
+    Connection *cn = connections.localData();
+
+    if (!cn || cn->generation != generation) {
+        Mcounter.lock();
+        qlonglong id = ++ConnCounter;
+        Mcounter.unlock();
+        // Replacing the connection of the thread closes the previous one
+        cn = new Connection(QString::number(id), gtilecache + "Data.qmdb", generation);
+        connections.setLocalData(cn);
+    }
+    return cn;
+}
 bool PureImageCache::PutImageToCache(const QByteArray &tile, const MapType::Types &type, const Point &pos, const int &zoom)
 {
+    lock.lockForRead();
     if (gtilecache.isEmpty() | gtilecache.isNull()) {
+        lock.unlock();
         return false;
     }
-    lock.lockForRead();
 #ifdef DEBUG_PUREIMAGECACHE
     qDebug() << "PutImageToCache Start:"; // <<pos;
 #endif // DEBUG_PUREIMAGECACHE
-    Mcounter.lock();
-    qlonglong id = ++ConnCounter;
-    Mcounter.unlock();
-    {
-        QSqlDatabase cn;
-        cn = QSqlDatabase::addDatabase("QSQLITE", QString::number(id));
-        QString db = gtilecache + "Data.qmdb";
-        cn.setDatabaseName(db);
-        cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-        if (cn.open()) {
-            {
-                QSqlQuery query(cn);
-                query.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
-                query.addBindValue(pos.X());
-                query.addBindValue(pos.Y());
-                query.addBindValue(zoom);
-
-                query.addBindValue((int)type);
-                query.addBindValue(QDateTime::currentDateTime().toString());
-                query.exec();
-            }
-            {
-                QSqlQuery query(cn);
-                query.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
-                query.addBindValue(tile);
-                query.exec();
-            }
-            cn.close();
+    Connection *cn = threadConnection();
+    bool ret = cn->isOpen;
+    if (ret) {
+        // Written in batches, see FlushCache()
+        if (cn->pendingWrites == 0) {
+            cn->db.transaction();
+        }
+        cn->putTileQuery.addBindValue(pos.X());
+        cn->putTileQuery.addBindValue(pos.Y());
+        cn->putTileQuery.addBindValue(zoom);
+        cn->putTileQuery.addBindValue((int)type);
+        cn->putTileQuery.addBindValue(QDateTime::currentDateTime().toString());
+        ret = cn->putTileQuery.exec();
+        if (ret) {
+            cn->putDataQuery.addBindValue(tile);
+            ret = cn->putDataQuery.exec();
+        }
+        if (++cn->pendingWrites >= WRITE_BATCH) {
+            cn->commit();
         }
     }
-    QSqlDatabase::removeDatabase(QString::number(id));
     lock.unlock();
-    return true;
+    return ret;
 }
-QByteArray PureImageCache::GetImageFromCache(MapType::Types type, Point pos, int zoom)
+
+/**
+ * Commit the tiles written by the calling thread, for the writer to call
+ * when it runs out of tiles to write
+ */
+void PureImageCache::FlushCache()
 {
     lock.lockForRead();
+    if (connections.hasLocalData()) {
+        connections.localData()->commit();
+    }
+    lock.unlock();
+}
+
+QByteArray PureImageCache::GetImageFromCache(MapType::Types type, Point pos, int zoom)
+{
     QByteArray ar;
+
+    lock.lockForRead();
     if (gtilecache.isEmpty() | gtilecache.isNull()) {
+        lock.unlock();
         return ar;
     }
-    QString dir  = gtilecache;
-    Mcounter.lock();
-    qlonglong id = ++ConnCounter;
-    Mcounter.unlock();
 #ifdef DEBUG_PUREIMAGECACHE
-    qDebug() << "Cache dir=" << dir << " Try to GET:" << pos.X() + "," + pos.Y();
+    qDebug() << "Cache dir=" << gtilecache << " Try to GET:" << pos.X() + "," + pos.Y();
 #endif // DEBUG_PUREIMAGECACHE
 
-    {
-        QString db = dir + "Data.qmdb";
-        {
-            QSqlDatabase cn;
-
-            cn = QSqlDatabase::addDatabase("QSQLITE", QString::number(id));
-
-            cn.setDatabaseName(db);
-            cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            if (cn.open()) {
-                {
-                    QSqlQuery query(cn);
-                    query.exec(QString("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=%1 AND Y=%2 AND Zoom=%3 AND Type=%4)").arg(pos.X()).arg(pos.Y()).arg(zoom).arg((int)type));
-                    query.next();
-                    if (query.isValid()) {
-                        ar = query.value(0).toByteArray();
-                    }
-                }
-                cn.close();
-            }
+    Connection *cn = threadConnection();
+    if (cn->isOpen) {
+        cn->getQuery.addBindValue(pos.X());
+        cn->getQuery.addBindValue(pos.Y());
+        cn->getQuery.addBindValue(zoom);
+        cn->getQuery.addBindValue((int)type);
+        if (cn->getQuery.exec() && cn->getQuery.next()) {
+            ar = cn->getQuery.value(0).toByteArray();
         }
+        // Ends the read so that the log can be checkpointed
+        cn->getQuery.finish();
     }
-    QSqlDatabase::removeDatabase(QString::number(id));
     lock.unlock();
     return ar;
 }
 void PureImageCache::deleteOlderTiles(int const & days)
 {
-    if (gtilecache.isEmpty() | gtilecache.isNull()) {
+    QString dir = GtileCache();
+
+    if (dir.isEmpty() | dir.isNull()) {
         return;
     }
     QList<long> add;
     bool ret    = true;
-    QString dir = gtilecache;
     {
         QString db = dir + "Data.qmdb";
         ret = QFileInfo(db).exists();
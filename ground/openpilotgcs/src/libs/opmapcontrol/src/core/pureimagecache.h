@@ -42,22 +42,40 @@
 #include <QList>
 #include <QMutex>
 #include <QReadWriteLock>
+#include <QThreadStorage>
+#include <QtCore/QFutureSynchronizer>
 namespace core {
+/**
+ * Tile store in an SQLite database. Every thread keeps its own connection to
+ * the database with the queries prepared, and the writes of a thread are
+ * committed in batches, see FlushCache().
+ */
 class PureImageCache {
 public:
     PureImageCache();
     static bool CreateEmptyDB(const QString &file);
     bool PutImageToCache(const QByteArray &tile, const MapType::Types &type, const core::Point &pos, const int &zoom);
     QByteArray GetImageFromCache(MapType::Types type, core::Point pos, int zoom);
+    void FlushCache();
     QString GtileCache();
     void setGtileCache(const QString &value);
     static bool ExportMapDataToDB(QString sourceFile, QString destFile);
     void deleteOlderTiles(int const & days);
 private:
+    class Connection;
+
     QString gtilecache;
+    int generation;
     QMutex Mcounter;
     QReadWriteLock lock;
+    QThreadStorage<Connection *> connections;
+    // Index builds of older databases, waited for when the cache is destroyed
+    QFutureSynchronizer<bool> indexing;
     static qlonglong ConnCounter;
+
+    static bool UpgradeDB(const QString &file);
+    static bool IndexDB(const QString &file, const QString &name);
+    Connection *threadConnection();
 };
 }
 #endif // PUREIMAGECACHE_H
@@ -85,6 +85,10 @@ void TileCacheQueue::run()
             Cache::Instance()->ImageCache.PutImageToCache(task->GetImg(), task->GetMapType(), task->GetPosition(), task->GetZoom());
             usleep(44);
             delete task;
+            // The tiles are committed in batches, write out the last one
+            if (tileCacheQueue.count() == 0) {
+                Cache::Instance()->ImageCache.FlushCache();
+            }
         } else {
             qDebug() << "Cache engine BEGIN WAIT";
             waitmutex.lock();
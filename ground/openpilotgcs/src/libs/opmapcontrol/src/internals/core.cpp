@@ -35,6 +35,7 @@ using namespace projections;
 namespace internals {
 Core::Core() : MouseWheelZooming(false), currentPosition(0, 0), currentPositionPixel(0, 0), LastLocationInBounds(-1, -1), sizeOfMapArea(0, 0)
     , minOfTiles(0, 0), maxOfTiles(0, 0), zoom(0), isDragging(false), TooltipTextPadding(10, 10), loaderLimit(5), maxzoom(21), started(false), runningThreads(0)
+    , trackVelocityNorth(0), trackVelocityEast(0)
 {
     mousewheelzoomtype = MouseWheelZoomType::MousePositionAndCenter;
     SetProjection(new MercatorProjection());
@@ -67,25 +68,37 @@ void Core::run()
 
     LoadTask task;
 
-    MtileLoadQueue.lock();
-    {
-        if (tileLoadQueue.count() > 0) {
-            task = tileLoadQueue.dequeue();
-            {
-                last = (tileLoadQueue.count() == 0);
+    if (loaderLimit.tryAcquire(1, OPMaps::Instance()->Timeout)) {
+        // Taken once a loader is free, from the tiles that are wanted by then
+        MtileLoadQueue.lock();
+        {
+            int next = -1;
+            qint64 nextRank = 0;
+            for (int i = 0; i < tileLoadQueue.count(); i++) {
+                qint64 rank = LoadRank(tileLoadQueue.at(i), i);
+                if (next < 0 || rank < nextRank) {
+                    next     = i;
+                    nextRank = rank;
+                }
+            }
+            if (next >= 0) {
+                task = tileLoadQueue.takeAt(next);
+                {
+                    last = (tileLoadQueue.count() == 0);
 #ifdef DEBUG_CORE
-                qDebug() << "TileLoadQueue: " << tileLoadQueue.count() << " Point:" << task.Pos.ToString() << " ID=" << debug;;
+                    qDebug() << "TileLoadQueue: " << tileLoadQueue.count() << " Point:" << task.Pos.ToString() << " ID=" << debug;;
 #endif // DEBUG_CORE
+                }
             }
         }
-    }
-    MtileLoadQueue.unlock();
+        MtileLoadQueue.unlock();
 
-    if (task.HasValue()) {
-        if (loaderLimit.tryAcquire(1, OPMaps::Instance()->Timeout)) {
-            MtileToload.lock();
-            --tilesToload;
-            MtileToload.unlock();
+        if (task.HasValue()) {
+            if (!task.Prefetch) {
+                MtileToload.lock();
+                --tilesToload;
+                MtileToload.unlock();
+            }
 #ifdef DEBUG_CORE
             qDebug() << "loadLimit semaphore aquired " << loaderLimit.available() << " ID=" << debug << " TASK=" << task.Pos.ToString() << " " << task.Zoom;
 #endif // DEBUG_CORE
@@ -97,7 +110,16 @@ void Core::run()
                 {
                     Tile *m = Matrix.TileAt(task.Pos);
 
-                    if (m == 0 || m->Overlays.count() == 0) {
+                    if (task.Prefetch) {
+                        // Only loaded into the caches, where it is found when it comes into view
+                        foreach(MapType::Types tl, OPMaps::Instance()->GetAllLayersOfType(GetMapType())) {
+                            if (tl == MapType::PergoTurkeyMap) {
+                                OPMaps::Instance()->GetImageFrom(tl, Point(task.Pos.X(), maxOfTiles.Height() - task.Pos.Y()), task.Zoom);
+                            } else {
+                                OPMaps::Instance()->GetImageFrom(tl, task.Pos, task.Zoom);
+                            }
+                        }
+                    } else if (m == 0 || m->Overlays.count() == 0) {
 #ifdef DEBUG_CORE
                         qDebug() << "Fill empty TileMatrix: " + task.ToString() << " ID=" << debug;;
 #endif // DEBUG_CORE
@@ -125,9 +147,16 @@ void Core::run()
                                 }
 
                                 if (img.length() != 0) {
+                                    // Decoded here so that painting never runs the codecs, in the
+                                    // format the raster engine draws without converting
+                                    QImage image = QImage::fromData(img).convertToFormat(QImage::Format_ARGB32_Premultiplied);
+                                    if (image.isNull()) {
+                                        break;
+                                    }
                                     Moverlays.lock();
                                     {
-                                        t->Overlays.append(img);
+                                        t->Overlays.append(image);
+                                        t->OverlayTypes.append(tl);
 #ifdef DEBUG_CORE
                                         qDebug() << "Core::run append img:" << img.length() << " to tile:" << t->GetPos().ToString() << " now has " << t->Overlays.count() << " overlays" << " ID=" << debug;
 #endif // DEBUG_CORE
@@ -195,8 +224,8 @@ void Core::run()
             qDebug() << "loaderLimit release:" + loaderLimit.available() << " ID=" << debug;
 #endif
             emit OnTilesStillToLoad(tilesToload < 0 ? 0 : tilesToload);
-            loaderLimit.release();
         }
+        loaderLimit.release();
     }
     MrunningThreads.lock();
     --runningThreads;
@@ -221,6 +250,7 @@ void Core::SetZoom(const int &value)
         if (started) {
             MtileLoadQueue.lock();
             tileLoadQueue.clear();
+            tilePrefetchList.clear();
             MtileLoadQueue.unlock();
             MtileToload.lock();
             tilesToload = 0;
@@ -447,6 +477,7 @@ void Core::ReloadMap()
         MtileLoadQueue.lock();
         {
             tileLoadQueue.clear();
+            tilePrefetchList.clear();
         }
         MtileLoadQueue.unlock();
         MtileToload.lock();
@@ -543,6 +574,7 @@ void Core::CancelAsyncTasks()
         MtileLoadQueue.lock();
         {
             tileLoadQueue.clear();
+            tilePrefetchList.clear();
             // tilesToload=0;
         }
         MtileLoadQueue.unlock();
@@ -554,6 +586,8 @@ void Core::CancelAsyncTasks()
 }
 void Core::UpdateBounds()
 {
+    int loaders = 0;
+
     MtileDrawingList.lock();
     {
         FindTilesAround(tileDrawingList);
@@ -564,30 +598,112 @@ void Core::UpdateBounds()
 
         emit OnTileLoadStart();
 
+        MtileLoadQueue.lock();
+        {
+            // The tiles the view moved away from are not loaded anymore
+            for (int i = tileLoadQueue.count() - 1; i >= 0; i--) {
+                if (!tileLoadQueue.at(i).Prefetch && !tileDrawingList.contains(tileLoadQueue.at(i).Pos)) {
+                    tileLoadQueue.removeAt(i);
+                    MtileToload.lock();
+                    --tilesToload;
+                    MtileToload.unlock();
+                }
+            }
 
-        foreach(Point p, tileDrawingList) {
-            LoadTask task = LoadTask(p, Zoom());
-            {
-                MtileLoadQueue.lock();
-                {
-                    if (!tileLoadQueue.contains(task)) {
-                        MtileToload.lock();
-                        ++tilesToload;
-                        MtileToload.unlock();
-                        tileLoadQueue.enqueue(task);
+            foreach(Point p, tileDrawingList) {
+                LoadTask task = LoadTask(p, Zoom());
+                int queued    = tileLoadQueue.indexOf(task);
+
+                if (queued < 0) {
+                    MtileToload.lock();
+                    ++tilesToload;
+                    MtileToload.unlock();
+                    tileLoadQueue.append(task);
+                    ++loaders;
 #ifdef DEBUG_CORE
-                        qDebug() << "Core::UpdateBounds new Task" << task.Pos.ToString();
+                    qDebug() << "Core::UpdateBounds new Task" << task.Pos.ToString();
 #endif // DEBUG_CORE
-                        ProcessLoadTaskCallback.start(this);
-                    }
+                } else if (tileLoadQueue.at(queued).Prefetch) {
+                    // Came into view before it was prefetched
+                    tileLoadQueue[queued].Prefetch = false;
+                    MtileToload.lock();
+                    ++tilesToload;
+                    MtileToload.unlock();
                 }
-                MtileLoadQueue.unlock();
             }
         }
+        MtileLoadQueue.unlock();
     }
     MtileDrawingList.unlock();
+
+    // Started once all of the view is queued, so that the nearest tiles are taken first
+    while (loaders-- > 0) {
+        ProcessLoadTaskCallback.start(this);
+    }
+    UpdatePrefetch();
     UpdateGroundResolution();
 }
+/**
+ * Rank of a queued tile, the lowest is loaded first: the visible tiles by
+ * their distance to the center of the view, then the tiles ahead of the UAV
+ * in the order it flies over them
+ */
+qint64 Core::LoadRank(LoadTask const & task, int const & index)
+{
+    const qint64 prefetchRank = Q_INT64_C(1) << 40;
+
+    if (task.Prefetch) {
+        return prefetchRank + index;
+    }
+    qint64 dx = task.Pos.X() - centerTileXYLocation.X();
+    qint64 dy = task.Pos.Y() - centerTileXYLocation.Y();
+    return dx * dx + dy * dy;
+}
+/**
+ * Sets the position and ground velocity [m/s] of the UAV, the tiles it will
+ * fly over are loaded into the caches when no visible tile is left to load
+ */
+void Core::SetPrefetchTrack(PointLatLng const & position, double const & velocityNorth, double const & velocityEast)
+{
+    trackPosition      = position;
+    trackVelocityNorth = velocityNorth;
+    trackVelocityEast  = velocityEast;
+    if (started) {
+        UpdatePrefetch();
+    }
+}
+/**
+ * Queues the tiles ahead of the UAV that were not queued yet, and drops the
+ * ones of the track that was predicted before that are still queued
+ */
+void Core::UpdatePrefetch()
+{
+    QList<Point> list;
+
+    MtileDrawingList.lock();
+    {
+        FindTilesOnTrack(list);
+    }
+    MtileDrawingList.unlock();
+
+    MtileLoadQueue.lock();
+    {
+        for (int i = tileLoadQueue.count() - 1; i >= 0; i--) {
+            if (tileLoadQueue.at(i).Prefetch && !list.contains(tileLoadQueue.at(i).Pos)) {
+                tileLoadQueue.removeAt(i);
+            }
+        }
+        foreach(Point p, list) {
+            LoadTask task = LoadTask(p, Zoom(), true);
+            if (!tilePrefetchList.contains(p) && !tileLoadQueue.contains(task)) {
+                tileLoadQueue.append(task);
+                ProcessLoadTaskCallback.start(this);
+            }
+        }
+        tilePrefetchList = list;
+    }
+    MtileLoadQueue.unlock();
+}
 void Core::FindTilesAround(QList<Point> &list)
 {
     list.clear();;
@@ -615,6 +731,33 @@ void Core::FindTilesAround(QList<Point> &list)
         }
     }
 }
+/**
+ * Finds the tiles the UAV will fly over in the next PREFETCH_SECONDS, in the
+ * order it gets there, leaving out the tiles that are in view
+ */
+void Core::FindTilesOnTrack(QList<Point> &list)
+{
+    list.clear();
+    double speed = sqrt(trackVelocityNorth * trackVelocityNorth + trackVelocityEast * trackVelocityEast);
+    if (trackPosition.IsEmpty() || speed < PREFETCH_MIN_SPEED || tileRect.Width() < 2) {
+        return;
+    }
+
+    // Followed in steps of half a tile, the pixels grow to the east and to the south
+    double length = speed * PREFETCH_SECONDS / Projection()->GetGroundResolution(Zoom(), trackPosition.Lat());
+    double step   = tileRect.Width() / 2;
+    Point start   = Projection()->FromLatLngToPixel(trackPosition, Zoom());
+    for (double distance = 0; distance <= length && list.count() < PREFETCH_MAX_TILES; distance += step) {
+        Point pixel(start.X() + (int)(trackVelocityEast / speed * distance), start.Y() - (int)(trackVelocityNorth / speed * distance));
+        Point p = Projection()->FromPixelToTileXY(pixel);
+
+        if (p.X() >= minOfTiles.Width() && p.Y() >= minOfTiles.Height() && p.X() <= maxOfTiles.Width() && p.Y() <= maxOfTiles.Height()) {
+            if (!list.contains(p) && !tileDrawingList.contains(p)) {
+                list.append(p);
+            }
+        }
+    }
+}
 void Core::UpdateGroundResolution()
 {
     double rez = Projection()->GetGroundResolution(Zoom(), CurrentPosition().Lat());
@@ -294,6 +294,10 @@ public:
 
     void FindTilesAround(QList<core::Point> &list);
 
+    void FindTilesOnTrack(QList<core::Point> &list);
+
+    void SetPrefetchTrack(PointLatLng const & position, double const & velocityNorth, double const & velocityEast);
+
     void UpdateGroundResolution();
 
     TileMatrix Matrix;
@@ -319,6 +323,8 @@ signals:
 private:
 
     void keepInBounds();
+    qint64 LoadRank(LoadTask const & task, int const & index);
+    void UpdatePrefetch();
     PointLatLng currentPosition;
     core::Point currentPositionPixel;
     core::Point renderOffset;
@@ -343,7 +349,18 @@ private:
 
     Rectangle CurrentRegion;
 
-    QQueue<LoadTask> tileLoadQueue;
+    // Not loaded in order, see LoadRank()
+    QList<LoadTask> tileLoadQueue;
+
+    // Last known position and ground velocity [m/s] of the UAV, and the tiles
+    // ahead of it that were queued
+    PointLatLng trackPosition;
+    double trackVelocityNorth;
+    double trackVelocityEast;
+    QList<core::Point> tilePrefetchList;
+    static const int PREFETCH_SECONDS   = 60;
+    static const int PREFETCH_MAX_TILES = 32;
+    static const int PREFETCH_MIN_SPEED = 1;
 
     int zoom;
 
@@ -37,17 +37,21 @@ struct LoadTask {
 public:
     core::Point Pos;
     int Zoom;
+    // Tile ahead of the UAV, only loaded into the caches
+    bool Prefetch;
 
 
-    LoadTask(Point pos, int zoom)
+    LoadTask(Point pos, int zoom, bool prefetch = false)
     {
         Pos  = pos;
         Zoom = zoom;
+        Prefetch = prefetch;
     }
     LoadTask()
     {
         Pos  = core::Point(-1, -1);
         Zoom = -1;
+        Prefetch = false;
     }
     bool HasValue()
     {
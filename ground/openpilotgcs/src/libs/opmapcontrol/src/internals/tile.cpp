@@ -39,10 +39,8 @@ void Tile::Clear()
     qDebug() << "Tile:Clear Overlays";
 #endif // DEBUG_TILE
     mutex.lock();
-    foreach(QByteArray img, Overlays) {
-        img.~QByteArray();
-    }
     Overlays.clear();
+    OverlayTypes.clear();
     mutex.unlock();
 }
 Tile::Tile() : zoom(0), pos(0, 0)
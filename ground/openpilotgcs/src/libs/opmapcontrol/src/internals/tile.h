@@ -30,6 +30,7 @@
 #include "QList"
 #include <QImage>
 #include "../core/point.h"
+#include "../core/maptype.h"
 #include <QMutex>
 #include <QDebug>
 #include "debugheader.h"
@@ -66,7 +67,9 @@ public:
     {
         return !(zoom == 0);
     }
-    QList<QByteArray> Overlays;
+    // Layers of the tile, decoded by the loader threads, and their map types
+    QList<QImage> Overlays;
+    QList<MapType::Types> OverlayTypes;
 protected:
 
     QMutex mutex;
@@ -33,6 +33,7 @@ namespace mapcontrol {
 MapGraphicItem::MapGraphicItem(internals::Core *core, Configuration *configuration) : core(core), config(configuration), MapRenderTransform(1), maxZoom(17), minZoom(2), zoomReal(0), isSelected(false), rotation(0), zoomDigi(0)
 {
     dragons.load(QString::fromUtf8(":/markers/images/dragons1.jpg"));
+    tilePixmaps.setMaxCost(TILE_PIXMAP_CACHE_KB);
     showTileGridLines = false;
     isMouseOverMarker = false;
     maprect = QRectF(0, 0, 1022, 680);
@@ -292,9 +293,60 @@ void MapGraphicItem::wheelEvent(QGraphicsSceneWheelEvent *event)
         core->MouseWheelZooming = false;
     }
 }
+/**
+ * @brief Returns a layer of a tile converted for painting. The conversion is
+ *       done once, a tile that was loaded again is converted again.
+ */
+QPixmap MapGraphicItem::GetTilePixmap(internals::Tile *tile, int layer)
+{
+    const QImage &image = tile->Overlays.at(layer);
+    core::RawTile key(tile->OverlayTypes.at(layer), tile->GetPos(), tile->GetZoom());
+    TilePixmap *cached = tilePixmaps.object(key);
+
+    if (cached != 0 && cached->imageKey == image.cacheKey()) {
+        return cached->pixmap;
+    }
+
+    TilePixmap *converted = new TilePixmap;
+    converted->imageKey = image.cacheKey();
+    converted->pixmap   = QPixmap::fromImage(image);
+    QPixmap pixmap = converted->pixmap;
+    tilePixmaps.insert(key, converted, qMax(1, image.byteCount() / 1024));
+    return pixmap;
+}
+/**
+ * @brief Draws a tile that is still loading from the converted tile of a lower
+ *       zoom that covers it, scaled up
+ *
+ * @return true if such a tile was converted
+ */
+bool MapGraphicItem::DrawParentTile(QPainter *painter, core::Point const & pos, int zoom, QRectF const & rect)
+{
+    QVector<MapType::Types> layers = OPMaps::Instance()->GetAllLayersOfType(core->GetMapType());
+
+    for (int levels = 1; levels <= PARENT_TILE_LEVELS && levels <= zoom; levels++) {
+        core::Point parent(pos.X() >> levels, pos.Y() >> levels);
+        int scale  = 1 << levels;
+        bool found = false;
+
+        foreach(MapType::Types type, layers) {
+            TilePixmap *cached = tilePixmaps.object(core::RawTile(type, parent, zoom - levels));
+            if (cached != 0) {
+                qreal width  = (qreal)cached->pixmap.width() / scale;
+                qreal height = (qreal)cached->pixmap.height() / scale;
+                painter->drawPixmap(rect, cached->pixmap, QRectF((pos.X() - parent.X() * scale) * width, (pos.Y() - parent.Y() * scale) * height, width, height));
+                found = true;
+            }
+        }
+        if (found) {
+            return true;
+        }
+    }
+    return false;
+}
 void MapGraphicItem::DrawMap2D(QPainter *painter)
 {
-    painter->drawImage(this->boundingRect(), dragons.toImage());
+    painter->drawPixmap(this->boundingRect(), dragons, dragons.rect());
     if (!lastimage.isNull()) {
         painter->drawImage(core->GetrenderOffset().X() - lastimagepoint.X(), core->GetrenderOffset().Y() - lastimagepoint.Y(), lastimage);
     }
@@ -314,15 +366,15 @@ void MapGraphicItem::DrawMap2D(QPainter *painter)
 
                         // render tile
                         // lock(t.Overlays)
-                        if (t != 0) {
-                            foreach(QByteArray img, t->Overlays) {
-                                if (img.count() != 0) {
-                                    if (!found) {
-                                        found = true;
-                                    }
-                                    {
-                                        painter->drawPixmap(core->tileRect.X(), core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height(), PureImageProxy::FromStream(img));
-                                    }
+                        if (t == 0 || t->Overlays.count() == 0) {
+                            DrawParentTile(painter, core->GettilePoint(), core->Zoom(), QRectF(core->tileRect.X(), core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height()));
+                        } else {
+                            for (int layer = 0; layer < t->Overlays.count(); layer++) {
+                                if (!found) {
+                                    found = true;
+                                }
+                                {
+                                    painter->drawPixmap(core->tileRect.X(), core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height(), GetTilePixmap(t, layer));
                                 }
                             }
                         }
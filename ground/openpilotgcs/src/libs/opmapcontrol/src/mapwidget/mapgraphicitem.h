@@ -38,6 +38,8 @@
 #include <QBrush>
 #include <QFont>
 #include <QObject>
+#include <QCache>
+#include "../core/rawtile.h"
 #include "waypointitem.h"
 // #include "uavitem.h"
 
@@ -93,6 +95,17 @@ public:
     {
         return core->IsDragging();
     }
+    /**
+     * @brief Loads the tiles ahead of the UAV into the caches
+     *
+     * @param position UAV position
+     * @param velocityNorth UAV velocity to the north [m/s]
+     * @param velocityEast UAV velocity to the east [m/s]
+     */
+    void SetPrefetchTrack(internals::PointLatLng const & position, double const & velocityNorth, double const & velocityEast)
+    {
+        core->SetPrefetchTrack(position, velocityNorth, velocityEast);
+    }
 
     QImage lastimage;
     core::Point lastimagepoint;
@@ -166,6 +179,29 @@ private:
     bool isSelected;
     bool isMouseOverMarker;
     QPixmap dragons;
+
+    /**
+     * @brief A tile layer converted for painting, along with the key of the
+     *       decoded image it was converted from
+     */
+    struct TilePixmap {
+        qint64  imageKey;
+        QPixmap pixmap;
+    };
+    /**
+     * @brief Converted tile layers, least recently painted are dropped first.
+     *       The cost of an entry is its size in KiB.
+     *
+     * @var tilePixmaps
+     */
+    QCache<core::RawTile, TilePixmap> tilePixmaps;
+    static const int TILE_PIXMAP_CACHE_KB = 64 * 1024;
+    QPixmap GetTilePixmap(internals::Tile *tile, int layer);
+    /**
+     * @brief Zoom levels looked up for a tile to show while a tile loads
+     */
+    static const int PARENT_TILE_LEVELS = 4;
+    bool DrawParentTile(QPainter *painter, core::Point const & pos, int zoom, QRectF const & rect);
     void SetIsMouseOverMarker(bool const & value)
     {
         isMouseOverMarker = value;
@@ -238,6 +238,7 @@ void UAVItem::SetGroundspeed(double vNED[3], int m_maxUpdateRate_ms)
     precalcRings     = groundspeed_mps_filt * ringTime * meters2pixels;
     boundingRectSize = groundspeed_mps_filt * ringTime * 4 * meters2pixels + 20;
     prepareGeometryChange();
+    map->SetPrefetchTrack(coord, vNED[0], vNED[1]);
 }
 
 
@@ -0,0 +1,22 @@
+# -------------------------------------------------
+# Tile store tests and benchmark, run from the build directory.
+# -------------------------------------------------
+include(../../../../openpilotgcs.pri)
+
+CONFIG += qtestlib
+CONFIG += console
+CONFIG -= app_bundle
+TEMPLATE = app
+TARGET = pureimagecachetest
+QT += sql
+
+INCLUDEPATH += ../src/core
+
+HEADERS += ../src/core/pureimagecache.h \
+    ../src/core/maptype.h \
+    ../src/core/point.h \
+    ../src/core/size.h
+SOURCES += tst_pureimagecache.cpp \
+    ../src/core/pureimagecache.cpp \
+    ../src/core/point.cpp \
+    ../src/core/size.cpp
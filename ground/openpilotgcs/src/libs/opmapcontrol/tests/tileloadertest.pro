@@ -0,0 +1,22 @@
+# -------------------------------------------------
+# Tile loader tests and latency benchmark, run from the build directory
+# after the map library was built.
+# -------------------------------------------------
+include(../../../../openpilotgcs.pri)
+
+CONFIG += qtestlib
+CONFIG += console
+CONFIG -= app_bundle
+TEMPLATE = app
+TARGET = tileloadertest
+QT += network
+QT += sql
+
+INCLUDEPATH += ../src/core \
+    ../src/internals
+
+SOURCES += tst_tileloader.cpp
+
+LIBS += -L../src/build \
+    -linternals \
+    -lcore
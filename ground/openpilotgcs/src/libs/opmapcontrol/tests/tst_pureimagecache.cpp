@@ -0,0 +1,259 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_pureimagecache.cpp
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2013.
+ * @brief      Tests and tiles/s benchmark of the tile store
+ * @see        The GNU Public License (GPL) Version 3
+ * @defgroup   OPMapWidget
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "pureimagecache.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+
+using namespace core;
+
+namespace {
+const int TILE_SIZE    = 15 * 1024;
+const int BENCH_TILES  = 2000;
+const int BENCH_WIDTH  = 50;
+const int BENCH_ZOOM   = 14;
+const MapType::Types BENCH_TYPE = MapType::GoogleSatellite;
+
+QByteArray makeTile(int x, int y)
+{
+    QByteArray tile(TILE_SIZE, 0);
+
+    for (int n = 0; n < TILE_SIZE; n++) {
+        tile[n] = (char)(x * 31 + y * 17 + n);
+    }
+    return tile;
+}
+
+/**
+ * The lookup as it was done before the store kept its connections,
+ * a connection per tile and the query built from a string
+ */
+QByteArray getWithNewConnection(const QString &file, MapType::Types type, Point pos, int zoom)
+{
+    QByteArray ar;
+    {
+        QSqlDatabase cn = QSqlDatabase::addDatabase("QSQLITE", "Reference");
+        cn.setDatabaseName(file);
+        if (cn.open()) {
+            {
+                QSqlQuery query(cn);
+                query.exec(QString("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=%1 AND Y=%2 AND Zoom=%3 AND Type=%4)").arg(pos.X()).arg(pos.Y()).arg(zoom).arg((int)type));
+                if (query.next()) {
+                    ar = query.value(0).toByteArray();
+                }
+            }
+            cn.close();
+        }
+    }
+    QSqlDatabase::removeDatabase("Reference");
+    return ar;
+}
+
+/**
+ * Reads tiles from its own thread, as the tile loaders do
+ */
+class ReaderThread : public QThread {
+public:
+    ReaderThread(PureImageCache *cache, int count) : cache(cache), count(count), found(0) {}
+
+    PureImageCache *cache;
+    int count;
+    int found;
+
+protected:
+    void run()
+    {
+        for (int n = 0; n < count; n++) {
+            int x = n % BENCH_WIDTH;
+            int y = n / BENCH_WIDTH;
+            if (cache->GetImageFromCache(BENCH_TYPE, Point(x, y), BENCH_ZOOM) == makeTile(x, y)) {
+                found++;
+            }
+        }
+    }
+};
+}
+
+class PureImageCacheTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void putGet();
+    void readFromOtherThreads();
+    void moveCache();
+    void benchmark();
+
+private:
+    QString base;
+    QString location;
+    QStringList locations;
+    PureImageCache *cache;
+
+    void removeLocation(const QString &path);
+};
+
+void PureImageCacheTest::initTestCase()
+{
+    base  = QDir::tempPath() + QString("/pureimagecachetest-%1/").arg(QCoreApplication::applicationPid());
+    cache = new PureImageCache();
+}
+
+void PureImageCacheTest::cleanupTestCase()
+{
+    delete cache;
+    foreach(QString path, locations) {
+        removeLocation(path);
+    }
+    QDir().rmdir(base);
+}
+
+/**
+ * Every test starts with an empty cache of its own, which also checks
+ * that the connections move along with the cache
+ */
+void PureImageCacheTest::init()
+{
+    location = base + QTest::currentTestFunction() + "/";
+    locations << location << location + "moved/";
+    QDir().mkpath(location);
+    cache->setGtileCache(location);
+}
+
+void PureImageCacheTest::removeLocation(const QString &path)
+{
+    QDir dir(path);
+
+    foreach(QString file, dir.entryList(QDir::Files)) {
+        dir.remove(file);
+    }
+    QDir().rmdir(path);
+}
+
+void PureImageCacheTest::putGet()
+{
+    for (int n = 0; n < 10; n++) {
+        QVERIFY(cache->PutImageToCache(makeTile(n, 1), BENCH_TYPE, Point(n, 1), BENCH_ZOOM));
+    }
+
+    // Visible to the writing thread before the batch is committed
+    QCOMPARE(cache->GetImageFromCache(BENCH_TYPE, Point(3, 1), BENCH_ZOOM), makeTile(3, 1));
+
+    cache->FlushCache();
+    for (int n = 0; n < 10; n++) {
+        QCOMPARE(cache->GetImageFromCache(BENCH_TYPE, Point(n, 1), BENCH_ZOOM), makeTile(n, 1));
+    }
+    QVERIFY(cache->GetImageFromCache(BENCH_TYPE, Point(10, 1), BENCH_ZOOM).isEmpty());
+    QVERIFY(cache->GetImageFromCache(MapType::GoogleMap, Point(3, 1), BENCH_ZOOM).isEmpty());
+    QVERIFY(cache->GetImageFromCache(BENCH_TYPE, Point(3, 1), BENCH_ZOOM + 1).isEmpty());
+}
+
+void PureImageCacheTest::readFromOtherThreads()
+{
+    const int tiles = 200;
+
+    for (int n = 0; n < tiles; n++) {
+        cache->PutImageToCache(makeTile(n % BENCH_WIDTH, n / BENCH_WIDTH), BENCH_TYPE, Point(n % BENCH_WIDTH, n / BENCH_WIDTH), BENCH_ZOOM);
+    }
+    cache->FlushCache();
+
+    ReaderThread reader1(cache, tiles);
+    ReaderThread reader2(cache, tiles);
+    reader1.start();
+    reader2.start();
+    QVERIFY(reader1.wait(60000));
+    QVERIFY(reader2.wait(60000));
+    QCOMPARE(reader1.found, tiles);
+    QCOMPARE(reader2.found, tiles);
+}
+
+void PureImageCacheTest::moveCache()
+{
+    cache->PutImageToCache(makeTile(1, 2), BENCH_TYPE, Point(1, 2), BENCH_ZOOM);
+
+    // The batch of the old location is committed when the connection is replaced
+    cache->setGtileCache(location + "moved/");
+    QVERIFY(cache->GetImageFromCache(BENCH_TYPE, Point(1, 2), BENCH_ZOOM).isEmpty());
+
+    cache->setGtileCache(location);
+    QCOMPARE(cache->GetImageFromCache(BENCH_TYPE, Point(1, 2), BENCH_ZOOM), makeTile(1, 2));
+}
+
+void PureImageCacheTest::benchmark()
+{
+    QElapsedTimer timer;
+    QString file = location + "Data.qmdb";
+    int found    = 0;
+
+    timer.start();
+    for (int n = 0; n < BENCH_TILES; n++) {
+        int x = n % BENCH_WIDTH;
+        int y = n / BENCH_WIDTH;
+        cache->PutImageToCache(makeTile(x, y), BENCH_TYPE, Point(x, y), BENCH_ZOOM);
+    }
+    cache->FlushCache();
+    double putRate = BENCH_TILES * 1000.0 / qMax((qint64)1, timer.elapsed());
+
+    timer.restart();
+    for (int n = 0; n < BENCH_TILES; n++) {
+        int x = n % BENCH_WIDTH;
+        int y = n / BENCH_WIDTH;
+        if (!cache->GetImageFromCache(BENCH_TYPE, Point(x, y), BENCH_ZOOM).isEmpty()) {
+            found++;
+        }
+    }
+    double getRate = BENCH_TILES * 1000.0 / qMax((qint64)1, timer.elapsed());
+    QCOMPARE(found, BENCH_TILES);
+
+    found = 0;
+    timer.restart();
+    for (int n = 0; n < BENCH_TILES; n++) {
+        int x = n % BENCH_WIDTH;
+        int y = n / BENCH_WIDTH;
+        if (!getWithNewConnection(file, BENCH_TYPE, Point(x, y), BENCH_ZOOM).isEmpty()) {
+            found++;
+        }
+    }
+    double referenceRate = BENCH_TILES * 1000.0 / qMax((qint64)1, timer.elapsed());
+    QCOMPARE(found, BENCH_TILES);
+
+    qDebug() << "pureimagecache:" << putRate << "tiles/s written," << getRate << "tiles/s read,"
+             << referenceRate << "tiles/s read with a connection per tile";
+}
+
+QTEST_MAIN(PureImageCacheTest)
+
+#include "tst_pureimagecache.moc"
+
+/**
+ * @}
+ */
@@ -0,0 +1,306 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_tileloader.cpp
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2013.
+ * @brief      Tests and latency benchmark of the tile loader
+ * @see        The GNU Public License (GPL) Version 3
+ * @defgroup   OPMapWidget
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "core.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QPointer>
+#include <QtCore/QQueue>
+#include <QtGui/QImage>
+#include <QtNetwork/QNetworkProxy>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QtTest/QtTest>
+
+using namespace internals;
+
+namespace {
+const int SERVER_DELAY  = 200;
+const int VIEW_WIDTH    = 1024;
+const int VIEW_HEIGHT   = 768;
+const int VIEW_ZOOM     = 12;
+const int VIEW_TIMEOUT  = 30000;
+const PointLatLng VIEW_START(46.0, 7.0);
+const PointLatLng VIEW_MOVED(47.0, 9.0);
+// Tiles loaded at the same time by the core
+const int LOADERS       = 5;
+
+qint64 Distance(core::Point a, core::Point b)
+{
+    qint64 dx = a.X() - b.X();
+    qint64 dy = a.Y() - b.Y();
+
+    return dx * dx + dy * dy;
+}
+}
+
+/**
+ * Stands in for the map servers as the proxy of the loaders, every tile is
+ * answered after SERVER_DELAY and the requested tiles are recorded
+ */
+class TileServer : public QTcpServer {
+    Q_OBJECT
+
+public:
+    TileServer()
+    {
+        QImage image(256, 256, QImage::Format_RGB32);
+        QBuffer buffer(&tile);
+
+        image.fill(0x336699);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, "PNG");
+    }
+
+    // Tiles in the order they were requested, as x, y
+    QList<core::Point> requests;
+
+protected:
+    void incomingConnection(int socketDescriptor)
+    {
+        QTcpSocket *socket = new QTcpSocket(this);
+
+        socket->setSocketDescriptor(socketDescriptor);
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+
+private slots:
+    void readRequest()
+    {
+        QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+
+        if (!socket->peek(4096).contains("\r\n\r\n")) {
+            return;
+        }
+
+        // GET http://a.tile.openstreetmap.org/zoom/x/y.png HTTP/1.1
+        QStringList path = QString(socket->readAll()).section(' ', 1, 1).split('/');
+        if (path.count() >= 3) {
+            requests.append(core::Point(path.at(path.count() - 2).toInt(), path.last().section('.', 0, 0).toInt()));
+        }
+        pending.enqueue(socket);
+        QTimer::singleShot(SERVER_DELAY, this, SLOT(reply()));
+    }
+
+    void reply()
+    {
+        QPointer<QTcpSocket> socket = pending.dequeue();
+
+        if (socket) {
+            socket->write(QString("HTTP/1.1 200 OK\r\nContent-Type: image/png\r\nContent-Length: %1\r\nConnection: close\r\n\r\n").arg(tile.size()).toAscii());
+            socket->write(tile);
+            socket->disconnectFromHost();
+        }
+    }
+
+private:
+    QByteArray tile;
+    QQueue<QPointer<QTcpSocket> > pending;
+};
+
+class TileLoaderTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void nearestFirst();
+    void staleTilesCancelled();
+    void prefetchAhead();
+
+private:
+    TileServer server;
+    Core *core;
+
+    bool waitForView(int timeout);
+    int loadedTiles();
+};
+
+void TileLoaderTest::initTestCase()
+{
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    // No cache, every tile comes from the server
+    core::OPMaps::Instance()->Proxy = QNetworkProxy(QNetworkProxy::HttpProxy, "127.0.0.1", server.serverPort());
+    core::OPMaps::Instance()->setAccessMode(core::AccessMode::ServerOnly);
+    core::OPMaps::Instance()->setUseMemoryCache(false);
+}
+
+void TileLoaderTest::init()
+{
+    server.requests.clear();
+    core = new Core();
+    core->SetMapType(core::MapType::OpenStreetMap);
+    core->SetZoom(VIEW_ZOOM);
+    core->SetCurrentRegion(Rectangle(0, 0, VIEW_WIDTH, VIEW_HEIGHT));
+    core->OnMapSizeChanged(VIEW_WIDTH, VIEW_HEIGHT);
+    core->SetCurrentPosition(VIEW_START);
+}
+
+void TileLoaderTest::cleanup()
+{
+    delete core;
+}
+
+int TileLoaderTest::loadedTiles()
+{
+    int loaded = 0;
+
+    foreach(core::Point p, core->tileDrawingList) {
+        Tile *t = core->Matrix.TileAt(p);
+        if (t != 0 && t->Overlays.count() > 0) {
+            loaded++;
+        }
+    }
+    return loaded;
+}
+
+bool TileLoaderTest::waitForView(int timeout)
+{
+    QElapsedTimer timer;
+
+    timer.start();
+    while (loadedTiles() < core->tileDrawingList.count()) {
+        if (timer.elapsed() > timeout) {
+            return false;
+        }
+        QTest::qWait(5);
+    }
+    return true;
+}
+
+/**
+ * The tiles are requested from the center of the view out, the loaders that
+ * run at the same time may only swap the order of their own requests
+ */
+void TileLoaderTest::nearestFirst()
+{
+    core->StartSystem();
+    QVERIFY(waitForView(VIEW_TIMEOUT));
+
+    core::Point center = core->GetcenterTileXYLocation();
+    QList<qint64> sorted;
+    foreach(core::Point p, core->tileDrawingList) {
+        sorted.append(Distance(p, center));
+    }
+    qSort(sorted);
+
+    QCOMPARE(server.requests.count(), core->tileDrawingList.count());
+    for (int i = 0; i < server.requests.count(); i++) {
+        QVERIFY(Distance(server.requests.at(i), center) <= sorted.at(qMin(i + LOADERS - 1, sorted.count() - 1)));
+    }
+}
+
+/**
+ * The time to the first full view after the map was moved while the tiles of
+ * the old view were loading, none of them is loaded after the move
+ */
+void TileLoaderTest::staleTilesCancelled()
+{
+    QElapsedTimer timer;
+
+    core->StartSystem();
+    QList<core::Point> startView = core->tileDrawingList;
+    QTest::qWait(SERVER_DELAY / 2);
+
+    timer.start();
+    core->SetCurrentPosition(VIEW_MOVED);
+    int requestsBefore = server.requests.count();
+    QVERIFY(waitForView(VIEW_TIMEOUT));
+    qint64 latency     = timer.elapsed();
+
+    // Only the requests already sent may be answered for the old view
+    int stale = 0;
+    for (int i = requestsBefore; i < server.requests.count(); i++) {
+        if (startView.contains(server.requests.at(i)) && !core->tileDrawingList.contains(server.requests.at(i))) {
+            stale++;
+        }
+    }
+    QCOMPARE(stale, 0);
+
+    // Without the stale tiles that are waiting, the view takes the rounds of
+    // loaders its own tiles need, and the requests that were sent
+    int rounds = (core->tileDrawingList.count() + LOADERS - 1) / LOADERS + 1;
+    qDebug() << "tileloader:" << core->tileDrawingList.count() << "tiles in view," << latency << "ms to the full view after moving,"
+             << rounds * SERVER_DELAY << "ms for its rounds of loaders," << startView.count() << "tiles were loading";
+    QVERIFY(latency < 2 * rounds * SERVER_DELAY);
+}
+
+/**
+ * The tiles ahead of the UAV are requested once the view is loaded
+ */
+void TileLoaderTest::prefetchAhead()
+{
+    core->StartSystem();
+    QVERIFY(waitForView(VIEW_TIMEOUT));
+
+    // Flying east from the center of the view, fast enough to leave it
+    int requestsBefore = server.requests.count();
+    core->SetPrefetchTrack(VIEW_START, 0, 1000);
+
+    QList<core::Point> ahead;
+    core->FindTilesOnTrack(ahead);
+    QVERIFY(ahead.count() > 0);
+    foreach(core::Point p, ahead) {
+        QCOMPARE(p.Y(), core->GetcenterTileXYLocation().Y());
+        QVERIFY(p.X() > core->GetcenterTileXYLocation().X());
+        QVERIFY(!core->tileDrawingList.contains(p));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    while (server.requests.count() < requestsBefore + ahead.count() && timer.elapsed() < VIEW_TIMEOUT) {
+        QTest::qWait(5);
+    }
+    QCOMPARE(server.requests.count(), requestsBefore + ahead.count());
+    foreach(core::Point p, ahead) {
+        QVERIFY(server.requests.mid(requestsBefore).contains(p));
+    }
+
+    // Not queued again as the UAV moves on along the same track
+    core->SetPrefetchTrack(VIEW_START, 0, 1000);
+    QTest::qWait(SERVER_DELAY * 2);
+    QCOMPARE(server.requests.count(), requestsBefore + ahead.count());
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    TileLoaderTest test;
+
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_tileloader.moc"
+
+/**
+ * @}
+ */
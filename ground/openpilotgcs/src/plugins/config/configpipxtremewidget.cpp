@@ -132,37 +132,33 @@ void ConfigPipXtremeWidget::updateStatus(UAVObject *object)
     }
 
     // Update the detected devices.
-    UAVObjectField *pairIdField = object->getField("PairIDs");
-    if (pairIdField) {
-        quint32 pairid1 = pairIdField->getValue(0).toUInt();
+    OPLinkStatus *oplinkStatus = dynamic_cast<OPLinkStatus *>(object);
+    if (oplinkStatus) {
+        quint32 pairid1 = oplinkStatus->getPairIDs(0);
         m_oplink->PairID1->setText(QString::number(pairid1, 16).toUpper());
         m_oplink->PairID1->setEnabled(false);
         m_oplink->Bind1->setEnabled(pairid1);
-        quint32 pairid2 = pairIdField->getValue(1).toUInt();
-        m_oplink->PairID2->setText(QString::number(pairIdField->getValue(1).toUInt(), 16).toUpper());
+        quint32 pairid2 = oplinkStatus->getPairIDs(1);
+        m_oplink->PairID2->setText(QString::number(pairid2, 16).toUpper());
         m_oplink->PairID2->setEnabled(false);
         m_oplink->Bind2->setEnabled(pairid2);
-        quint32 pairid3 = pairIdField->getValue(2).toUInt();
-        m_oplink->PairID3->setText(QString::number(pairIdField->getValue(2).toUInt(), 16).toUpper());
+        quint32 pairid3 = oplinkStatus->getPairIDs(2);
+        m_oplink->PairID3->setText(QString::number(pairid3, 16).toUpper());
         m_oplink->PairID3->setEnabled(false);
         m_oplink->Bind3->setEnabled(pairid3);
-        quint32 pairid4 = pairIdField->getValue(3).toUInt();
-        m_oplink->PairID4->setText(QString::number(pairIdField->getValue(3).toUInt(), 16).toUpper());
+        quint32 pairid4 = oplinkStatus->getPairIDs(3);
+        m_oplink->PairID4->setText(QString::number(pairid4, 16).toUpper());
         m_oplink->PairID4->setEnabled(false);
         m_oplink->Bind4->setEnabled(pairid4);
-    } else {
-        qDebug() << "PipXtremeGadgetWidget: Count not read PairID field.";
-    }
-    UAVObjectField *pairRssiField = object->getField("PairSignalStrengths");
-    if (pairRssiField) {
-        m_oplink->PairSignalStrengthBar1->setValue(pairRssiField->getValue(0).toInt());
-        m_oplink->PairSignalStrengthBar2->setValue(pairRssiField->getValue(1).toInt());
-        m_oplink->PairSignalStrengthBar3->setValue(pairRssiField->getValue(2).toInt());
-        m_oplink->PairSignalStrengthBar4->setValue(pairRssiField->getValue(3).toInt());
-        m_oplink->PairSignalStrengthLabel1->setText(QString("%1dB").arg(pairRssiField->getValue(0).toInt()));
-        m_oplink->PairSignalStrengthLabel2->setText(QString("%1dB").arg(pairRssiField->getValue(1).toInt()));
-        m_oplink->PairSignalStrengthLabel3->setText(QString("%1dB").arg(pairRssiField->getValue(2).toInt()));
-        m_oplink->PairSignalStrengthLabel4->setText(QString("%1dB").arg(pairRssiField->getValue(3).toInt()));
+
+        m_oplink->PairSignalStrengthBar1->setValue(oplinkStatus->getPairSignalStrengths(0));
+        m_oplink->PairSignalStrengthBar2->setValue(oplinkStatus->getPairSignalStrengths(1));
+        m_oplink->PairSignalStrengthBar3->setValue(oplinkStatus->getPairSignalStrengths(2));
+        m_oplink->PairSignalStrengthBar4->setValue(oplinkStatus->getPairSignalStrengths(3));
+        m_oplink->PairSignalStrengthLabel1->setText(QString("%1dB").arg(oplinkStatus->getPairSignalStrengths(0)));
+        m_oplink->PairSignalStrengthLabel2->setText(QString("%1dB").arg(oplinkStatus->getPairSignalStrengths(1)));
+        m_oplink->PairSignalStrengthLabel3->setText(QString("%1dB").arg(oplinkStatus->getPairSignalStrengths(2)));
+        m_oplink->PairSignalStrengthLabel4->setText(QString("%1dB").arg(oplinkStatus->getPairSignalStrengths(3)));
     } else {
         qDebug() << "PipXtremeGadgetWidget: Count not read PairID field.";
     }
@@ -199,13 +195,12 @@ void ConfigPipXtremeWidget::updateStatus(UAVObject *object)
     }
 
     // Update the serial number field
-    UAVObjectField *serialField = object->getField("CPUSerial");
-    if (serialField) {
+    if (oplinkStatus) {
         char buf[OPLinkStatus::CPUSERIAL_NUMELEM * 2 + 1];
         for (unsigned int i = 0; i < OPLinkStatus::CPUSERIAL_NUMELEM; ++i) {
-            unsigned char val = serialField->getValue(i).toUInt() >> 4;
+            unsigned char val = oplinkStatus->getCPUSerial(i) >> 4;
             buf[i * 2]     = ((val < 10) ? '0' : '7') + val;
-            val = serialField->getValue(i).toUInt() & 0xf;
+            val = oplinkStatus->getCPUSerial(i) & 0xf;
             buf[i * 2 + 1] = ((val < 10) ? '0' : '7') + val;
         }
         buf[OPLinkStatus::CPUSERIAL_NUMELEM * 2] = '\0';
@@ -495,13 +495,12 @@ void Simulator::updateUAVOs(Output2Hardware out)
 
         float dT = out.delT;
 
-        AttitudeSettings::DataFields attSettData = attSettings->getData();
-        float accelKp     = attSettData.AccelKp * 0.1666666666666667;
-        float accelKi     = attSettData.AccelKp * 0.1666666666666667;
-        float yawBiasRate = attSettData.YawBiasRate;
+        float accelKp     = attSettings->getAccelKp() * 0.1666666666666667;
+        float accelKi     = attSettings->getAccelKp() * 0.1666666666666667;
+        float yawBiasRate = attSettings->getYawBiasRate();
 
         // calibrate sensors on arming
-        if (flightStatus->getData().Armed == FlightStatus::ARMED_ARMING) {
+        if (flightStatus->getArmed() == FlightStatus::ARMED_ARMING) {
             accelKp = 2.0;
             accelKi = 0.9;
         }
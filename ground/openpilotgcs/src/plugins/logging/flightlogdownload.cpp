@@ -0,0 +1,294 @@
+/**
+ ******************************************************************************
+ *
+ * @file       flightlogdownload.cpp
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2013.
+ * @see        The GNU Public License (GPL) Version 3
+ * @brief      Reads the flight log recorded onboard and converts it to logfiles
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup   Logging
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "flightlogdownload.h"
+#include "flightlogstatus.h"
+#include "logfile.h"
+#include <uavtalk/uavtalk.h>
+#include <extensionsystem/pluginmanager.h>
+#include <QDebug>
+#include <QHash>
+#include <QMessageBox>
+#include <QtEndian>
+
+namespace {
+// Layout of the blocks and records written by the FlightLog module
+const quint32 BLOCK_MAGIC = 0x4C46504F;
+const int BLOCK_HEADER_LENGTH  = 12; // magic (4), flight (2), length (2), crc (1), padding (3)
+const int RECORD_HEADER_LENGTH = 12; // timestamp (4), object id (4), instance id (2), length (2)
+const int REQUEST_TIMEOUT = 1000;
+const int MAX_RETRIES     = 5;
+}
+
+FlightLogDownload::FlightLogDownload(QObject *parent) :
+    QObject(parent), control(NULL), entry(NULL), progress(NULL), usedBytes(0), blockSize(0), offset(0), retries(0)
+{
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+
+    objMngr = pm->getObject<UAVObjectManager>();
+    timer.setSingleShot(true);
+    connect(&timer, SIGNAL(timeout()), this, SLOT(timeout()));
+}
+
+FlightLogDownload::~FlightLogDownload()
+{
+    delete progress;
+}
+
+/**
+ * Start downloading the flight log
+ * \param[in] fileName Logfile name, the flights are written to name-flightN.opl
+ * \return false if the board has no flight log to download
+ */
+bool FlightLogDownload::start(QString fileName)
+{
+    FlightLogStatus *status = FlightLogStatus::GetInstance(objMngr);
+
+    control = FlightLogControl::GetInstance(objMngr);
+    entry   = FlightLogEntry::GetInstance(objMngr);
+    if (!status || !control || !entry) {
+        return false;
+    }
+
+    FlightLogStatus::DataFields statusData = status->getData();
+    if (statusData.Status == FlightLogStatus::STATUS_UNAVAILABLE || statusData.BlockSize <= BLOCK_HEADER_LENGTH) {
+        QMessageBox::information(NULL, tr("Flight log"), tr("The board has no flight log."));
+        return false;
+    }
+    if (statusData.UsedBytes == 0) {
+        QMessageBox::information(NULL, tr("Flight log"), tr("The flight log is empty."));
+        return false;
+    }
+
+    baseName = fileName;
+    if (baseName.endsWith(".opl", Qt::CaseInsensitive)) {
+        baseName.chop(4);
+    }
+    usedBytes = statusData.UsedBytes;
+    blockSize = statusData.BlockSize;
+    offset    = 0;
+    data.clear();
+    data.reserve(usedBytes);
+
+    progress  = new QProgressDialog(tr("Downloading the flight log..."), tr("Cancel"), 0, usedBytes);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(0);
+    connect(progress, SIGNAL(canceled()), this, SLOT(cancel()));
+
+    connect(entry, SIGNAL(objectUpdated(UAVObject *)), this, SLOT(entryUpdated(UAVObject *)));
+    requestEntry();
+    return true;
+}
+
+/**
+ * Ask the board for the entry at the current offset
+ */
+void FlightLogDownload::requestEntry()
+{
+    FlightLogControl::DataFields controlData;
+
+    controlData.Operation = FlightLogControl::OPERATION_READ;
+    controlData.Offset    = offset;
+    control->setData(controlData);
+    control->updated();
+    timer.start(REQUEST_TIMEOUT);
+}
+
+void FlightLogDownload::entryUpdated(UAVObject *obj)
+{
+    Q_UNUSED(obj);
+
+    FlightLogEntry::DataFields entryData = entry->getData();
+
+    // Late answers to a request that was repeated
+    if (entryData.Offset != offset) {
+        return;
+    }
+
+    quint32 length = qMin((quint32)sizeof(entryData.Data), usedBytes - offset);
+    data.append((const char *)entryData.Data, length);
+    offset += length;
+    retries = 0;
+    progress->setValue(offset);
+
+    if (offset < usedBytes) {
+        requestEntry();
+        return;
+    }
+
+    timer.stop();
+    int flights = convert();
+    if (flights < 0) {
+        finish(false, tr("Unable to write the logfiles."));
+    } else {
+        finish(true, tr("%1 flight(s) written to %2-flightN.opl.").arg(flights).arg(baseName));
+    }
+}
+
+void FlightLogDownload::timeout()
+{
+    if (++retries > MAX_RETRIES) {
+        finish(false, tr("The board does not answer, the download was aborted."));
+        return;
+    }
+    requestEntry();
+}
+
+void FlightLogDownload::cancel()
+{
+    finish(false, QString());
+}
+
+void FlightLogDownload::finish(bool success, QString message)
+{
+    timer.stop();
+    if (entry) {
+        disconnect(entry, SIGNAL(objectUpdated(UAVObject *)), this, SLOT(entryUpdated(UAVObject *)));
+    }
+    if (progress) {
+        progress->disconnect(this);
+        progress->hide();
+    }
+    if (!message.isEmpty()) {
+        QMessageBox::information(NULL, tr("Flight log"), message);
+    }
+    emit finished(success);
+    deleteLater();
+}
+
+/**
+ * Write the downloaded blocks to a logfile per flight. The records are
+ * unpacked into private copies of the objects, which are logged as the
+ * GCS logs the objects it receives.
+ * \return the number of flights written, -1 on error
+ */
+int FlightLogDownload::convert()
+{
+    QHash<quint64, UAVDataObject *> objects;
+    LogFile *logFile = NULL;
+    UAVTalk *uavTalk = NULL;
+    int flights     = 0;
+    int flight      = -1;
+    quint32 startTime = 0;
+    int badBlocks   = 0;
+    int badRecords  = 0;
+
+    for (quint32 blockOffset = 0; blockOffset + blockSize <= (quint32)data.size(); blockOffset += blockSize) {
+        const quint8 *block = (const quint8 *)data.constData() + blockOffset;
+        quint32 magic  = qFromLittleEndian<quint32>(block);
+        quint16 blockFlight = qFromLittleEndian<quint16>(block + 4);
+        quint16 length = qFromLittleEndian<quint16>(block + 6);
+
+        // Blocks that were torn by a power loss are skipped
+        if (magic != BLOCK_MAGIC || length > blockSize - BLOCK_HEADER_LENGTH ||
+            UAVTalk::updateCRC(0, block + BLOCK_HEADER_LENGTH, length) != block[8]) {
+            badBlocks++;
+            continue;
+        }
+
+        if (blockFlight != flight) {
+            if (logFile) {
+                logFile->close();
+                delete uavTalk;
+                delete logFile;
+            }
+            qDeleteAll(objects);
+            objects.clear();
+
+            flight  = blockFlight;
+            logFile = new LogFile();
+            logFile->setObjectManager(objMngr);
+            logFile->setFileName(QString("%1-flight%2.opl").arg(baseName).arg(flight));
+            if (!logFile->open(QIODevice::WriteOnly)) {
+                delete logFile;
+                return -1;
+            }
+            uavTalk   = new UAVTalk(logFile, objMngr);
+            startTime = qFromLittleEndian<quint32>(block + BLOCK_HEADER_LENGTH);
+            flights++;
+        }
+
+        const quint8 *record = block + BLOCK_HEADER_LENGTH;
+        const quint8 *end    = record + length;
+        while (record + RECORD_HEADER_LENGTH <= end) {
+            quint32 timeStamp = qFromLittleEndian<quint32>(record);
+            quint32 objId     = qFromLittleEndian<quint32>(record + 4);
+            quint16 instId    = qFromLittleEndian<quint16>(record + 8);
+            quint16 size = qFromLittleEndian<quint16>(record + 10);
+            if (record + RECORD_HEADER_LENGTH + size > end) {
+                badRecords++;
+                break;
+            }
+
+            // Objects unknown to this GCS or of another size are left out
+            UAVDataObject *obj = objects.value(((quint64)objId << 16) | instId);
+            if (!obj) {
+                UAVDataObject *prototype = dynamic_cast<UAVDataObject *>(objMngr->getObject(objId));
+                if (prototype && prototype->getNumBytes() == size) {
+                    obj = prototype->clone(instId);
+                    objects.insert(((quint64)objId << 16) | instId, obj);
+                }
+            }
+            if (obj) {
+                obj->unpack(record + RECORD_HEADER_LENGTH);
+                logFile->setTimeStamp(timeStamp - startTime);
+                if (logFile->isKeyframeDue()) {
+                    // Includes the update
+                    logFile->beginKeyframe();
+                    foreach(UAVDataObject * o, objects) {
+                        uavTalk->sendObject(o, false, false);
+                    }
+                    logFile->endKeyframe();
+                } else {
+                    uavTalk->sendObject(obj, false, false);
+                }
+            } else {
+                badRecords++;
+            }
+            record += RECORD_HEADER_LENGTH + size;
+        }
+    }
+
+    if (logFile) {
+        logFile->close();
+        delete uavTalk;
+        delete logFile;
+    }
+    qDeleteAll(objects);
+
+    if (badBlocks || badRecords) {
+        qDebug() << "Flight log:" << badBlocks << "damaged blocks and" << badRecords << "records were skipped";
+    }
+    return flights;
+}
+
+/**
+ * @}
+ * @}
+ */
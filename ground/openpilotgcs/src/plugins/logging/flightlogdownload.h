@@ -0,0 +1,86 @@
+/**
+ ******************************************************************************
+ *
+ * @file       flightlogdownload.h
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2013.
+ * @see        The GNU Public License (GPL) Version 3
+ * @brief      Reads the flight log recorded onboard and converts it to logfiles
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup   Logging
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef FLIGHTLOGDOWNLOAD_H
+#define FLIGHTLOGDOWNLOAD_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QTimer>
+#include <QProgressDialog>
+#include "uavobjectmanager.h"
+#include "flightlogcontrol.h"
+#include "flightlogentry.h"
+
+/**
+ * Downloads the flight log of the board a FlightLogEntry at a time and
+ * writes every flight it holds to its own logfile, which replays like a
+ * log recorded by the GCS.
+ */
+class FlightLogDownload : public QObject {
+    Q_OBJECT
+public:
+    explicit FlightLogDownload(QObject *parent = 0);
+    ~FlightLogDownload();
+
+    bool start(QString fileName);
+
+signals:
+    void finished(bool success);
+
+private slots:
+    void entryUpdated(UAVObject *obj);
+    void timeout();
+    void cancel();
+
+private:
+    UAVObjectManager *objMngr;
+    FlightLogControl *control;
+    FlightLogEntry *entry;
+    QProgressDialog *progress;
+    QTimer timer;
+
+    QString baseName;
+    QByteArray data;
+    quint32 usedBytes;
+    quint32 blockSize;
+    quint32 offset;
+    int retries;
+
+    void requestEntry();
+    void finish(bool success, QString message);
+    int convert();
+};
+
+#endif // FLIGHTLOGDOWNLOAD_H
+
+/**
+ * @}
+ * @}
+ */
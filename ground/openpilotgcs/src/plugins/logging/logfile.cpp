@@ -1,10 +1,30 @@
 #include "logfile.h"
 #include <QDebug>
+#include <QDataStream>
+#include <QtEndian>
 #include <QtGlobal>
 
+namespace {
+const char HEADER_MAGIC[8] = { 'O', 'P', 'L', 'O', 'G', 'v', '2', '\0' };
+const char INDEX_MAGIC[8]  = { 'O', 'P', 'L', 'O', 'G', 'I', 'D', 'X' };
+const qint64 RECORD_HEADER_LENGTH = 12; // timestamp (4), size (8)
+const qint64 TRAILER_LENGTH = 24; // index offset (8), index length (4), duration (4), magic (8)
+const qint64 MAX_RECORD_SIZE      = 1024 * 1024;
+const qint64 MAX_KEYFRAME_SIZE    = 64 * 1024 * 1024;
+const int MAX_TIMER_INTERVAL      = 1000;
+const int POSITION_REPORT_PERIOD  = 250;
+
+const quint8 DEFINITION_SINGLE_INSTANCE = 0x01;
+const quint8 DEFINITION_SETTINGS = 0x02;
+const quint8 DEFINITION_METAOBJECT = 0x04;
+}
+
 LogFile::LogFile(QObject *parent) :
-    QIODevice(parent)
+    QIODevice(parent), fixedTime(false), fixedTimeStamp(0), objMngr(NULL), logVersion(2), dataStart(0), dataEnd(0), duration(0),
+    inKeyframe(false), keyframeTimeStamp(0), hasRecord(false), recordTimeStamp(0), recordSize(0),
+    replayBase(0), playbackSpeed(1), paused(false), lastPositionReport(0)
 {
+    timer.setSingleShot(true);
     connect(&timer, SIGNAL(timeout()), this, SLOT(timerFired()));
 }
 
@@ -30,8 +50,30 @@ bool LogFile::open(OpenMode mode)
         return false;
     }
 
-    // TODO: Write a header at the beginng describing objects so that in future
-    // they can be read back if ID's change
+    keyframes.clear();
+    definitions.clear();
+    inKeyframe = false;
+    duration   = 0;
+    if (file.isWritable()) {
+        // The header describes the objects so that they can be read back if their IDs change
+        if (!writeHeader()) {
+            qDebug() << "Unable to write the header of " << file.fileName();
+            file.close();
+            return false;
+        }
+    } else {
+        if (!readHeader()) {
+            qDebug() << "Error: Logfile corrupted! Invalid header in " << file.fileName();
+            file.close();
+            return false;
+        }
+        // Use the index the log was closed with or rebuild it
+        if (!readIndex()) {
+            scanIndex();
+        }
+        qDebug() << "Logfile version" << logVersion << "," << definitions.length() << "object definitions,"
+                 << keyframes.length() << "keyframes," << duration << "ms";
+    }
 
     // Must call parent function for QIODevice to pass calls to writeData
     // We always open ReadWrite, because otherwise we will get tons of warnings
@@ -48,6 +90,12 @@ void LogFile::close()
     if (timer.isActive()) {
         timer.stop();
     }
+    if (file.isOpen() && file.isWritable()) {
+        if (inKeyframe) {
+            endKeyframe();
+        }
+        writeIndex();
+    }
     file.close();
     QIODevice::close();
 }
@@ -58,19 +106,276 @@ qint64 LogFile::writeData(const char *data, qint64 dataSize)
         return dataSize;
     }
 
-    quint32 timeStamp = myTime.elapsed();
-
-    file.write((char *)&timeStamp, sizeof(timeStamp));
-    file.write((char *)&dataSize, sizeof(dataSize));
+    quint32 timeStamp = currentTimeStamp();
 
-    qint64 written = file.write(data, dataSize);
-    if (written != -1) {
-        emit bytesWritten(written);
+    if (inKeyframe) {
+        // Collected until the keyframe is complete, its length goes first
+        QBuffer buffer(&keyframeBuffer);
+        buffer.open(QIODevice::WriteOnly | QIODevice::Append);
+        writeRecord(&buffer, keyframeTimeStamp, dataSize, data);
+        return dataSize;
     }
 
+    writeRecord(&file, timeStamp, dataSize, data);
+    duration = timeStamp;
+    emit bytesWritten(dataSize);
+
     return dataSize;
 }
 
+void LogFile::writeRecord(QIODevice *device, quint32 timeStamp, qint64 size, const char *data)
+{
+    char header[RECORD_HEADER_LENGTH];
+
+    qToLittleEndian<quint32>(timeStamp, (uchar *)&header[0]);
+    qToLittleEndian<qint64>(size, (uchar *)&header[4]);
+    device->write(header, RECORD_HEADER_LENGTH);
+    if (size > 0) {
+        device->write(data, size);
+    }
+}
+
+/**
+ * Stamp the following writes with a fixed time instead of the time since the
+ * log was opened, used when converting a log recorded elsewhere.
+ */
+void LogFile::setTimeStamp(quint32 timeStamp)
+{
+    fixedTime = true;
+    fixedTimeStamp = timeStamp;
+}
+
+quint32 LogFile::currentTimeStamp()
+{
+    return fixedTime ? fixedTimeStamp : (quint32)myTime.elapsed();
+}
+
+/**
+ * Check whether the logging thread should write a keyframe now
+ */
+bool LogFile::isKeyframeDue()
+{
+    if (!file.isWritable() || inKeyframe) {
+        return false;
+    }
+    return keyframes.isEmpty() || currentTimeStamp() - keyframes.last().timeStamp >= KEYFRAME_INTERVAL;
+}
+
+/**
+ * Start a keyframe, the objects written until endKeyframe() make up the state
+ * the replay restarts from when seeking.
+ */
+void LogFile::beginKeyframe()
+{
+    inKeyframe = true;
+    keyframeTimeStamp = currentTimeStamp();
+    keyframeBuffer.clear();
+}
+
+void LogFile::endKeyframe()
+{
+    IndexEntry entry;
+
+    inKeyframe      = false;
+    entry.timeStamp = keyframeTimeStamp;
+    entry.offset    = file.pos();
+    keyframes.append(entry);
+
+    // The marker record carries the length of the keyframe as a negative size
+    writeRecord(&file, keyframeTimeStamp, -(qint64)keyframeBuffer.size(), NULL);
+    file.write(keyframeBuffer);
+    duration = keyframeTimeStamp;
+    emit bytesWritten(keyframeBuffer.size());
+    keyframeBuffer.clear();
+}
+
+bool LogFile::writeHeader()
+{
+    QByteArray defs;
+    QDataStream defStream(&defs, QIODevice::WriteOnly);
+    quint32 count = 0;
+
+    defStream.setByteOrder(QDataStream::LittleEndian);
+    if (objMngr) {
+        QList< QList<UAVObject *> > objects = objMngr->getObjects();
+        for (int n = 0; n < objects.length(); ++n) {
+            UAVObject *obj = objects[n][0];
+            UAVDataObject *dobj = dynamic_cast<UAVDataObject *>(obj);
+            QByteArray name     = obj->getName().toLatin1().left(255);
+            quint8 flags = 0;
+            if (obj->isSingleInstance()) {
+                flags |= DEFINITION_SINGLE_INSTANCE;
+            }
+            if (dobj && dobj->isSettings()) {
+                flags |= DEFINITION_SETTINGS;
+            }
+            if (!dobj) {
+                flags |= DEFINITION_METAOBJECT;
+            }
+            defStream << (quint32)obj->getObjID() << (quint16)obj->getNumBytes() << flags << (quint8)name.length();
+            defStream.writeRawData(name.constData(), name.length());
+            count++;
+        }
+    }
+
+    QDataStream stream(&file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.writeRawData(HEADER_MAGIC, sizeof(HEADER_MAGIC));
+    // Length of the rest of the header, newer versions may add to it
+    stream << (quint32)(defs.length() + sizeof(count)) << count;
+    stream.writeRawData(defs.constData(), defs.length());
+
+    logVersion = 2;
+    dataStart  = file.pos();
+    return stream.status() == QDataStream::Ok;
+}
+
+bool LogFile::writeIndex()
+{
+    QDataStream stream(&file);
+    qint64 indexOffset = file.pos();
+
+    stream.setByteOrder(QDataStream::LittleEndian);
+    for (int n = 0; n < keyframes.length(); ++n) {
+        stream << keyframes[n].timeStamp << keyframes[n].offset;
+    }
+    stream << indexOffset << (quint32)keyframes.length() << duration;
+    stream.writeRawData(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    return stream.status() == QDataStream::Ok;
+}
+
+/**
+ * Read the header and the object definitions, a log without a header is a version 1 log
+ */
+bool LogFile::readHeader()
+{
+    QDataStream stream(&file);
+    char magic[sizeof(HEADER_MAGIC)];
+
+    stream.setByteOrder(QDataStream::LittleEndian);
+    if (stream.readRawData(magic, sizeof(magic)) != sizeof(magic) || memcmp(magic, HEADER_MAGIC, sizeof(magic)) != 0) {
+        logVersion = 1;
+        dataStart  = 0;
+        dataEnd    = file.size();
+        file.seek(dataStart);
+        return true;
+    }
+
+    quint32 headerLength;
+    quint32 count;
+    stream >> headerLength;
+    dataStart = file.pos() + headerLength;
+    stream >> count;
+    for (quint32 n = 0; n < count && stream.status() == QDataStream::Ok; ++n) {
+        ObjectDefinition def;
+        quint8 flags;
+        quint8 nameLength;
+        char name[256];
+        stream >> def.objId >> def.numBytes >> flags >> nameLength;
+        stream.readRawData(name, nameLength);
+        def.name = QString::fromLatin1(name, nameLength);
+        def.isSingleInstance = (flags & DEFINITION_SINGLE_INSTANCE) != 0;
+        def.isSettings   = (flags & DEFINITION_SETTINGS) != 0;
+        def.isMetaObject = (flags & DEFINITION_METAOBJECT) != 0;
+        definitions.append(def);
+    }
+    if (stream.status() != QDataStream::Ok || dataStart > file.size()) {
+        return false;
+    }
+
+    // Report objects that changed since the log was written
+    if (objMngr) {
+        for (int n = 0; n < definitions.length(); ++n) {
+            UAVObject *obj = objMngr->getObject(definitions[n].objId);
+            if (obj == NULL) {
+                qDebug() << "Logfile: object" << definitions[n].name << "is unknown, its updates will be ignored";
+            }
+        }
+    }
+
+    logVersion = 2;
+    dataEnd    = file.size();
+    file.seek(dataStart);
+    return true;
+}
+
+/**
+ * Load the keyframe index from the end of the log
+ * \return true if the log has a valid index
+ */
+bool LogFile::readIndex()
+{
+    if (logVersion < 2 || file.size() - dataStart < TRAILER_LENGTH) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    qint64 indexOffset;
+    quint32 count;
+    quint32 logDuration;
+    char magic[sizeof(INDEX_MAGIC)];
+
+    stream.setByteOrder(QDataStream::LittleEndian);
+    file.seek(file.size() - TRAILER_LENGTH);
+    stream >> indexOffset >> count >> logDuration;
+    if (stream.readRawData(magic, sizeof(magic)) != sizeof(magic) || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0 ||
+        indexOffset < dataStart || indexOffset + (qint64)count * 12 + TRAILER_LENGTH != file.size()) {
+        file.seek(dataStart);
+        return false;
+    }
+
+    file.seek(indexOffset);
+    keyframes.clear();
+    for (quint32 n = 0; n < count; ++n) {
+        IndexEntry entry;
+        stream >> entry.timeStamp >> entry.offset;
+        keyframes.append(entry);
+    }
+    duration = logDuration;
+    dataEnd  = indexOffset;
+    file.seek(dataStart);
+    return stream.status() == QDataStream::Ok;
+}
+
+/**
+ * Rebuild the index of a log that was not closed properly or predates the index,
+ * only the record headers are read.
+ */
+void LogFile::scanIndex()
+{
+    qint64 offset = dataStart;
+    quint32 lastTimeStamp = 0;
+
+    keyframes.clear();
+    while (offset + RECORD_HEADER_LENGTH <= dataEnd) {
+        char header[RECORD_HEADER_LENGTH];
+        file.seek(offset);
+        if (file.read(header, RECORD_HEADER_LENGTH) != RECORD_HEADER_LENGTH) {
+            break;
+        }
+        quint32 timeStamp = qFromLittleEndian<quint32>((const uchar *)&header[0]);
+        qint64 size = qFromLittleEndian<qint64>((const uchar *)&header[4]);
+        if (size < -MAX_KEYFRAME_SIZE || size == 0 || size > MAX_RECORD_SIZE ||
+            offset + RECORD_HEADER_LENGTH + qAbs(size) > dataEnd || timeStamp < lastTimeStamp) {
+            break;
+        }
+        if (size < 0) {
+            IndexEntry entry;
+            entry.timeStamp = timeStamp;
+            entry.offset    = offset;
+            keyframes.append(entry);
+        }
+        lastTimeStamp = timeStamp;
+        // The records of a keyframe are scanned like any other
+        offset += RECORD_HEADER_LENGTH + (size < 0 ? 0 : size);
+    }
+
+    // Anything after the last complete record is lost
+    dataEnd  = offset;
+    duration = lastTimeStamp;
+    file.seek(dataStart);
+}
+
 qint64 LogFile::readData(char *data, qint64 maxSize)
 {
     QMutexLocker locker(&mutex);
@@ -86,72 +391,132 @@ qint64 LogFile::bytesAvailable() const
     return dataBuffer.size();
 }
 
-void LogFile::timerFired()
+/**
+ * Read the header of the next record, the file is left positioned at its data.
+ * \param[in] skipKeyframes Skip keyframes, they are only needed when seeking
+ * \return true if there is a valid record
+ */
+bool LogFile::readRecordHeader(bool skipKeyframes)
 {
-    qint64 dataSize;
+    quint32 lastTimeStamp = recordTimeStamp;
 
-    if (file.bytesAvailable() > 4) {
-        int time;
-        time = myTime.elapsed();
+    hasRecord = false;
+    while (file.pos() + RECORD_HEADER_LENGTH <= dataEnd) {
+        char header[RECORD_HEADER_LENGTH];
+        if (file.read(header, RECORD_HEADER_LENGTH) != RECORD_HEADER_LENGTH) {
+            return false;
+        }
+        recordTimeStamp = qFromLittleEndian<quint32>((const uchar *)&header[0]);
+        recordSize = qFromLittleEndian<qint64>((const uchar *)&header[4]);
 
-        // TODO: going back in time will be a problem
-        while ((lastPlayed + ((time - timeOffset) * playbackSpeed) > lastTimeStamp)) {
-            lastPlayed += ((time - timeOffset) * playbackSpeed);
-            if (file.bytesAvailable() < 4) {
-                stopReplay();
-                return;
+        // some validity checks
+        if (recordTimeStamp < lastTimeStamp // logfile goes back in time
+            || (recordTimeStamp - lastTimeStamp) > (60 * 60 * 1000)) { // gap of more than 60 minutes
+            qDebug() << "Error: Logfile corrupted! Unlikely timestamp " << recordTimeStamp << " after " << lastTimeStamp << "\n";
+            return false;
+        }
+        if (recordSize < -MAX_KEYFRAME_SIZE || recordSize == 0 || recordSize > MAX_RECORD_SIZE) {
+            qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << recordSize << "\n";
+            return false;
+        }
+
+        if (recordSize > 0) {
+            if (file.pos() + recordSize > dataEnd) {
+                return false;
             }
+            hasRecord = true;
+            return true;
+        }
 
-            file.read((char *)&dataSize, sizeof(dataSize));
+        // Keyframe marker, either skip the keyframe or read on into it
+        if (skipKeyframes) {
+            file.seek(file.pos() - recordSize);
+        }
+    }
+    return false;
+}
 
-            if (dataSize < 1 || dataSize > (1024 * 1024)) {
-                qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << dataSize << "\n";
-                stopReplay();
-                return;
-            }
-            if (file.bytesAvailable() < dataSize) {
-                stopReplay();
-                return;
-            }
+/**
+ * Pass the data of the current record on to the reader
+ */
+bool LogFile::deliverRecord()
+{
+    QByteArray data = file.read(recordSize);
 
-            mutex.lock();
-            dataBuffer.append(file.read(dataSize));
-            mutex.unlock();
-            emit readyRead();
+    if (data.size() != recordSize) {
+        return false;
+    }
+    mutex.lock();
+    dataBuffer.append(data);
+    mutex.unlock();
+    emit readyRead();
+    return true;
+}
 
-            if (file.bytesAvailable() < 4) {
-                stopReplay();
-                return;
-            }
+quint32 LogFile::replayPosition()
+{
+    if (paused) {
+        return replayBase;
+    }
+    return replayBase + (quint32)(replayClock.elapsed() * playbackSpeed);
+}
 
-            int save = lastTimeStamp;
-            file.read((char *)&lastTimeStamp, sizeof(lastTimeStamp));
-            // some validity checks
-            if (lastTimeStamp < save // logfile goies back in time
-                || (lastTimeStamp - save) > (60 * 60 * 1000)) { // gap of more than 60 minutes)
-                qDebug() << "Error: Logfile corrupted! Unlikely timestamp " << lastTimeStamp << " after " << save << "\n";
-                stopReplay();
-                return;
-            }
+/**
+ * Deliver every record that is due and sleep until the next one
+ */
+void LogFile::timerFired()
+{
+    quint32 position = replayPosition();
 
-            timeOffset = time;
-            time = myTime.elapsed();
+    while (hasRecord && recordTimeStamp <= position) {
+        if (!deliverRecord() || !readRecordHeader(true)) {
+            stopReplay();
+            return;
         }
-    } else {
+    }
+    if (!hasRecord) {
         stopReplay();
+        return;
+    }
+
+    if (myTime.elapsed() - lastPositionReport >= POSITION_REPORT_PERIOD) {
+        lastPositionReport = myTime.elapsed();
+        emit replayPositionChanged(position);
     }
+    scheduleNextRecord();
+}
+
+void LogFile::scheduleNextRecord()
+{
+    if (paused || !hasRecord) {
+        return;
+    }
+
+    qint64 wait = (qint64)recordTimeStamp - replayPosition();
+    int interval = 0;
+    if (wait > 0) {
+        interval = (int)qMin((double)MAX_TIMER_INTERVAL, ceil(wait / playbackSpeed));
+    }
+    timer.start(interval);
 }
 
 bool LogFile::startReplay()
 {
     dataBuffer.clear();
     myTime.restart();
-    timeOffset    = 0;
-    lastPlayed    = 0;
-    playbackSpeed = 1;
-    file.read((char *)&lastTimeStamp, sizeof(lastTimeStamp));
-    timer.setInterval(10);
-    timer.start();
+    lastPositionReport = 0;
+    replayBase      = 0;
+    recordTimeStamp = 0;
+    paused = false;
+    file.seek(dataStart);
+    if (!readRecordHeader(true)) {
+        stopReplay();
+        return false;
+    }
+    // Start the clock at the first record
+    replayBase = recordTimeStamp;
+    replayClock.restart();
+    scheduleNextRecord();
     emit replayStarted();
     return true;
 }
@@ -163,13 +528,87 @@ bool LogFile::stopReplay()
     return true;
 }
 
+/**
+ * Jump to a position of the replay. The replay restarts from the last keyframe
+ * before the position, the records up to the position are passed on at once.
+ * \param[in] position Log time in ms
+ */
+void LogFile::seekReplay(quint32 position)
+{
+    if (!file.isOpen() || file.isWritable()) {
+        return;
+    }
+
+    timer.stop();
+
+    // Last keyframe at or before the position, the start of the log if there is none
+    qint64 offset = dataStart;
+    int first     = 0;
+    int last      = keyframes.length();
+    while (first < last) {
+        int middle = (first + last) / 2;
+        if (keyframes[middle].timeStamp <= position) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    if (first > 0) {
+        offset = keyframes[first - 1].offset;
+    }
+
+    file.seek(offset);
+    mutex.lock();
+    dataBuffer.clear();
+    mutex.unlock();
+    recordTimeStamp = (first > 0 ? keyframes[first - 1].timeStamp : 0);
+
+    // Catch up from the keyframe, reading into it
+    bool valid = readRecordHeader(false);
+    while (valid && recordTimeStamp <= position) {
+        valid = deliverRecord() && readRecordHeader(true);
+    }
+    if (!valid) {
+        stopReplay();
+        return;
+    }
+
+    replayBase = position;
+    replayClock.restart();
+    emit replayPositionChanged(position);
+    scheduleNextRecord();
+}
+
+void LogFile::setReplaySpeed(double val)
+{
+    // Keep the log time when the speed changes
+    if (val <= 0) {
+        return;
+    }
+    replayBase    = replayPosition();
+    replayClock.restart();
+    playbackSpeed = val;
+    qDebug() << playbackSpeed;
+    if (timer.isActive()) {
+        scheduleNextRecord();
+    }
+}
+
 void LogFile::pauseReplay()
 {
+    replayBase = replayPosition();
+    paused     = true;
     timer.stop();
 }
 
 void LogFile::resumeReplay()
 {
-    timeOffset = myTime.elapsed();
-    timer.start();
+    if (!paused) {
+        return;
+    }
+    paused = false;
+    replayClock.restart();
+    if (file.isOpen() && !file.isWritable()) {
+        timerFired();
+    }
 }
@@ -7,12 +7,42 @@
 #include <QMutexLocker>
 #include <QDebug>
 #include <QBuffer>
+#include <QFile>
+#include <QList>
 #include "uavobjectmanager.h"
 #include <math.h>
 
+/**
+ * Telemetry log, written by the logging thread and replayed as a connection.
+ *
+ * A log starts with a header describing the UAVObjects it was written with,
+ * followed by records made of a 32 bit timestamp in ms, a 64 bit size and the
+ * UAVTalk packets received at that time. Every KEYFRAME_INTERVAL ms a keyframe
+ * with the state of all objects is written as a run of ordinary records,
+ * announced by a marker record with a negative size, the length of the run.
+ * Closing the log appends an index of the keyframes and a trailer pointing to
+ * it, which is what makes seeking and reloading a large log fast.
+ * Logs without a header (version 1) are still replayed.
+ */
 class LogFile : public QIODevice {
     Q_OBJECT
 public:
+    typedef struct {
+        quint32 objId;
+        quint16 numBytes;
+        bool    isSingleInstance;
+        bool    isSettings;
+        bool    isMetaObject;
+        QString name;
+    } ObjectDefinition;
+
+    typedef struct {
+        quint32 timeStamp;
+        qint64  offset;
+    } IndexEntry;
+
+    static const quint32 KEYFRAME_INTERVAL = 10000;
+
     explicit LogFile(QObject *parent = 0);
     qint64 bytesAvailable() const;
     qint64 bytesToWrite()
@@ -24,18 +54,39 @@ public:
     {
         file.setFileName(name);
     };
+    void setObjectManager(UAVObjectManager *objMngr)
+    {
+        this->objMngr = objMngr;
+    };
     void close();
     qint64 writeData(const char *data, qint64 dataSize);
     qint64 readData(char *data, qint64 maxlen);
 
+    void setTimeStamp(quint32 timeStamp);
+
+    bool isKeyframeDue();
+    void beginKeyframe();
+    void endKeyframe();
+
     bool startReplay();
     bool stopReplay();
-
-public slots:
-    void setReplaySpeed(double val)
+    quint32 replayDuration() const
     {
-        playbackSpeed = val; qDebug() << playbackSpeed;
+        return duration;
     };
+    quint32 replayPosition();
+    int version() const
+    {
+        return logVersion;
+    };
+    QList<ObjectDefinition> objectDefinitions() const
+    {
+        return definitions;
+    };
+
+public slots:
+    void setReplaySpeed(double val);
+    void seekReplay(quint32 position);
     void pauseReplay();
     void resumeReplay();
 
@@ -46,19 +97,53 @@ signals:
     void readReady();
     void replayStarted();
     void replayFinished();
+    void replayPositionChanged(quint32 position);
 
 protected:
     QByteArray dataBuffer;
     QTimer timer;
     QTime myTime;
+    bool fixedTime;
+    quint32 fixedTimeStamp;
     QFile file;
-    qint32 lastTimeStamp;
-    qint32 lastPlayed;
     QMutex mutex;
+    UAVObjectManager *objMngr;
+
+    // Log structure
+    int logVersion;
+    qint64 dataStart;
+    qint64 dataEnd;
+    quint32 duration;
+    QList<ObjectDefinition> definitions;
+    QList<IndexEntry> keyframes;
 
+    // Keyframe being written
+    bool inKeyframe;
+    quint32 keyframeTimeStamp;
+    QByteArray keyframeBuffer;
 
-    int timeOffset;
+    // Next record to replay, the file is positioned at its data
+    bool hasRecord;
+    quint32 recordTimeStamp;
+    qint64 recordSize;
+
+    // Replay clock, replayBase is the log time when the clock was last restarted
+    QTime replayClock;
+    quint32 replayBase;
     double playbackSpeed;
+    bool paused;
+    int lastPositionReport;
+
+    quint32 currentTimeStamp();
+    bool writeHeader();
+    bool writeIndex();
+    void writeRecord(QIODevice *device, quint32 timeStamp, qint64 size, const char *data);
+    bool readHeader();
+    bool readIndex();
+    void scanIndex();
+    bool readRecordHeader(bool skipKeyframes);
+    bool deliverRecord();
+    void scheduleNextRecord();
 };
 
 #endif // LOGFILE_H
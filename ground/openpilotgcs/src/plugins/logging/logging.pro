@@ -6,6 +6,7 @@ include(../../openpilotgcsplugin.pri)
 include(logging_dependencies.pri)
 HEADERS += loggingplugin.h \
     logfile.h \
+    flightlogdownload.h \
     logginggadgetwidget.h \
     logginggadget.h \
     logginggadgetfactory.h
@@ -14,6 +15,7 @@ HEADERS += loggingplugin.h \
 
 SOURCES += loggingplugin.cpp \
     logfile.cpp \
+    flightlogdownload.cpp \
     logginggadgetwidget.cpp \
     logginggadget.cpp \
     logginggadgetfactory.cpp
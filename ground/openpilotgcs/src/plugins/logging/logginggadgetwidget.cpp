@@ -33,6 +33,7 @@
 #include <QtGui/QTextEdit>
 #include <QtGui/QVBoxLayout>
 #include <QtGui/QPushButton>
+#include <QTime>
 #include <loggingplugin.h>
 
 LoggingGadgetWidget::LoggingGadgetWidget(QWidget *parent) : QLabel(parent)
@@ -58,6 +59,11 @@ void LoggingGadgetWidget::setPlugin(LoggingPlugin *p)
     connect(m_logging->pauseButton, SIGNAL(clicked()), p->getLogfile(), SLOT(pauseReplay()));
     connect(m_logging->pauseButton, SIGNAL(clicked()), scpPlugin, SLOT(stopPlotting()));
     connect(m_logging->playbackSpeed, SIGNAL(valueChanged(double)), p->getLogfile(), SLOT(setReplaySpeed(double)));
+    connect(p->getLogfile(), SIGNAL(replayStarted()), this, SLOT(replayStarted()));
+    connect(p->getLogfile(), SIGNAL(replayFinished()), this, SLOT(replayStopped()));
+    connect(p->getLogfile(), SIGNAL(replayPositionChanged(quint32)), this, SLOT(replayPositionChanged(quint32)));
+    connect(m_logging->positionSlider, SIGNAL(sliderMoved(int)), this, SLOT(positionSliderMoved(int)));
+    connect(m_logging->positionSlider, SIGNAL(sliderReleased()), this, SLOT(positionSliderReleased()));
     void pauseReplay();
     void resumeReplay();
 }
@@ -68,6 +74,39 @@ void LoggingGadgetWidget::stateChanged(QString status)
     m_logging->statusLabel->setText(status);
 }
 
+/**
+ * The slider positions are seconds of the log
+ */
+void LoggingGadgetWidget::replayStarted()
+{
+    m_logging->positionSlider->setRange(0, loggingPlugin->getLogfile()->replayDuration() / 1000);
+    m_logging->positionSlider->setValue(0);
+    m_logging->positionSlider->setEnabled(true);
+}
+
+void LoggingGadgetWidget::replayStopped()
+{
+    m_logging->positionSlider->setEnabled(false);
+}
+
+void LoggingGadgetWidget::replayPositionChanged(quint32 position)
+{
+    if (!m_logging->positionSlider->isSliderDown()) {
+        m_logging->positionSlider->setValue(position / 1000);
+        positionSliderMoved(position / 1000);
+    }
+}
+
+void LoggingGadgetWidget::positionSliderMoved(int position)
+{
+    m_logging->positionLabel->setText(QTime(0, 0).addSecs(position).toString("hh:mm:ss"));
+}
+
+void LoggingGadgetWidget::positionSliderReleased()
+{
+    loggingPlugin->getLogfile()->seekReplay(m_logging->positionSlider->value() * 1000);
+}
+
 /**
  * @}
  * @}
@@ -47,6 +47,11 @@ public:
 
 protected slots:
     void stateChanged(QString status);
+    void replayStarted();
+    void replayStopped();
+    void replayPositionChanged(quint32 position);
+    void positionSliderMoved(int position);
+    void positionSliderReleased();
 
 signals:
     void pause();
@@ -29,14 +29,17 @@
 
 #include "loggingplugin.h"
 #include "logginggadgetfactory.h"
+#include "flightlogdownload.h"
 #include <QDebug>
 #include <QtPlugin>
 #include <QThread>
+#include <QCoreApplication>
 #include <QStringList>
 #include <QDir>
 #include <QFileDialog>
 #include <QList>
 #include <QErrorMessage>
+#include <QMessageBox>
 #include <QWriteLocker>
 
 #include <extensionsystem/pluginmanager.h>
@@ -82,6 +85,9 @@ QIODevice *LoggingConnection::openDevice(const QString &deviceName)
 
 void LoggingConnection::startReplay(QString file)
 {
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+
+    logFile.setObjectManager(pm->getObject<UAVObjectManager>());
     logFile.setFileName(file);
     if (logFile.open(QIODevice::ReadOnly)) {
         qDebug() << "Replaying " << file;
@@ -120,32 +126,112 @@ QString LoggingConnection::shortName()
  */
 bool LoggingThread::openFile(QString file, LoggingPlugin *parent)
 {
-    logFile.setFileName(file);
-    logFile.open(QIODevice::WriteOnly);
-
     ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
     UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
 
+    // The object manager is needed for the object definitions in the header
+    logFile.setObjectManager(objManager);
+    logFile.setFileName(file);
+    logFile.open(QIODevice::WriteOnly);
+
     uavTalk = new UAVTalk(&logFile, objManager);
+    stopped = false;
     connect(parent, SIGNAL(stopLoggingSignal()), this, SLOT(stopLogging()));
 
     return true;
 };
 
 /**
- * Logs an object update to the file.  Data format is the
+ * Records an object update. Called directly in the thread making the update,
+ * with the mutex of the object held for the unpacks of the telemetry input
+ * thread, so the data are copied right away and written by writeUpdates()
+ * in the thread of this object. The log lock is never waited for here,
+ * writeKeyframe() holds it while taking the mutexes of the objects.
+ */
+void LoggingThread::objectUpdated(UAVObject *obj)
+{
+    Update update;
+
+    update.obj = obj;
+    update.data.resize(obj->getNumBytes());
+    obj->pack((quint8 *)update.data.data());
+
+    QMutexLocker locker(&updatesLock);
+    if (stopped) {
+        return;
+    }
+    updates.append(update);
+    if (updates.size() == 1) {
+        QMetaObject::invokeMethod(this, "writeUpdates", Qt::QueuedConnection);
+    }
+};
+
+/**
+ * Logs the recorded object updates to the file.  Data format is the
  * timestamp as a 32 bit uint counting ms from start of
  * file writing (flight time will be embedded in stream),
  * then object packet size, then the packed UAVObject.
+ * A keyframe with all the objects is written first when one is due.
  */
-void LoggingThread::objectUpdated(UAVObject *obj)
+void LoggingThread::writeUpdates()
 {
+    QList<Update> pending;
+
+    updatesLock.lock();
+    pending.swap(updates);
+    updatesLock.unlock();
+
     QWriteLocker locker(&lock);
+    if (!logFile.isOpen()) {
+        return;
+    }
+    foreach(const Update &update, pending) {
+        if (logFile.isKeyframeDue()) {
+            writeKeyframe();
+        }
+        if (!uavTalk->sendObjectData(update.obj, update.data)) {
+            qDebug() << "Error logging " << update.obj->getName();
+        }
+    }
+}
+
+/**
+ * Record every update of an object: the unpacks of the telemetry input thread
+ * directly, as objectUpdated() is coalesced for them, and the changes made in
+ * the GCS.
+ */
+void LoggingThread::connectObject(UAVObject *obj)
+{
+    connect(obj, SIGNAL(objectUnpacked(UAVObject *)), this, SLOT(objectUpdated(UAVObject *)), Qt::DirectConnection);
+    connect(obj, SIGNAL(objectUpdatedAuto(UAVObject *)), this, SLOT(objectUpdated(UAVObject *)), Qt::DirectConnection);
+    connect(obj, SIGNAL(objectUpdatedManual(UAVObject *)), this, SLOT(objectUpdated(UAVObject *)), Qt::DirectConnection);
+}
+
+void LoggingThread::disconnectObject(UAVObject *obj)
+{
+    disconnect(obj, SIGNAL(objectUnpacked(UAVObject *)), this, SLOT(objectUpdated(UAVObject *)));
+    disconnect(obj, SIGNAL(objectUpdatedAuto(UAVObject *)), this, SLOT(objectUpdated(UAVObject *)));
+    disconnect(obj, SIGNAL(objectUpdatedManual(UAVObject *)), this, SLOT(objectUpdated(UAVObject *)));
+}
+
+/**
+ * Logs the current state of all the objects as a keyframe, which is
+ * where a replay restarts from when seeking.
+ */
+void LoggingThread::writeKeyframe()
+{
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+    UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
+    QList< QList<UAVObject *> > list = objManager->getObjects();
 
-    if (!uavTalk->sendObject(obj, false, false)) {
-        qDebug() << "Error logging " << obj->getName();
+    logFile.beginKeyframe();
+    for (int i = 0; i < list.length(); ++i) {
+        for (int j = 0; j < list[i].length(); ++j) {
+            uavTalk->sendObject(list[i][j], false, false);
+        }
     }
-};
+    logFile.endKeyframe();
+}
 
 /**
  * Connect signals from all the objects updates to the write routine then
@@ -164,7 +250,7 @@ void LoggingThread::run()
 
     for (i = list.constBegin(); i != list.constEnd(); ++i) {
         for (j = (*i).constBegin(); j != (*i).constEnd(); ++j) {
-            connect(*j, SIGNAL(objectUpdated(UAVObject *)), (LoggingThread *)this, SLOT(objectUpdated(UAVObject *)));
+            connectObject(*j);
             objects++;
             // qDebug() << "Detected " << j[0];
         }
@@ -189,8 +275,6 @@ void LoggingThread::run()
  */
 void LoggingThread::stopLogging()
 {
-    QWriteLocker locker(&lock);
-
     // Disconnect all objects we registered with:
     ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
     UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
@@ -202,10 +286,18 @@ void LoggingThread::stopLogging()
 
     for (i = list.constBegin(); i != list.constEnd(); ++i) {
         for (j = (*i).constBegin(); j != (*i).constEnd(); ++j) {
-            disconnect(*j, SIGNAL(objectUpdated(UAVObject *)), (LoggingThread *)this, SLOT(objectUpdated(UAVObject *)));
+            disconnectObject(*j);
         }
     }
 
+    // Write the updates recorded so far, those still being copied are dropped
+    updatesLock.lock();
+    stopped = true;
+    updatesLock.unlock();
+    writeUpdates();
+    QCoreApplication::removePostedEvents(this, QEvent::MetaCall);
+
+    QWriteLocker locker(&lock);
     logFile.close();
     qDebug() << "File closed";
     quit();
@@ -326,6 +418,23 @@ bool LoggingPlugin::initialize(const QStringList & args, QString *errMsg)
 
     connect(cmd->action(), SIGNAL(triggered(bool)), this, SLOT(toggleLogging()));
 
+    // Commands for the flight log recorded by the board
+    downloadCmd = am->registerAction(new QAction(this),
+                                     "LoggingPlugin.DownloadFlightLog",
+                                     QList<int>() <<
+                                     Core::Constants::C_GLOBAL_ID);
+    downloadCmd->action()->setText(tr("Download flight log..."));
+    ac->addAction(downloadCmd, "Logging");
+    connect(downloadCmd->action(), SIGNAL(triggered(bool)), this, SLOT(downloadFlightLog()));
+
+    eraseCmd = am->registerAction(new QAction(this),
+                                  "LoggingPlugin.EraseFlightLog",
+                                  QList<int>() <<
+                                  Core::Constants::C_GLOBAL_ID);
+    eraseCmd->action()->setText(tr("Erase flight log"));
+    ac->addAction(eraseCmd, "Logging");
+    connect(eraseCmd->action(), SIGNAL(triggered(bool)), this, SLOT(eraseFlightLog()));
+
 
     mf = new LoggingGadgetFactory(this);
     addAutoReleasedObject(mf);
@@ -428,6 +537,54 @@ void LoggingPlugin::replayStarted()
     emit stateChanged("REPLAY");
 }
 
+/**
+ * Download the flight log of the board to logfiles, one per flight
+ */
+void LoggingPlugin::downloadFlightLog()
+{
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+    UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
+    GCSTelemetryStats::DataFields gcsStats = GCSTelemetryStats::GetInstance(objManager)->getData();
+
+    if (gcsStats.Status != GCSTelemetryStats::STATUS_CONNECTED) {
+        QMessageBox::information(NULL, tr("Flight log"), tr("Connect to the board to download its flight log."));
+        return;
+    }
+
+    QString fileName = QFileDialog::getSaveFileName(NULL, tr("Download flight log"),
+                                                    tr("OP-%0.opl").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss")),
+                                                    tr("OpenPilot Log (*.opl)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    // Deletes itself when done
+    FlightLogDownload *download = new FlightLogDownload(this);
+    if (!download->start(fileName)) {
+        delete download;
+    }
+}
+
+/**
+ * Ask the board to erase its flight log, it refuses while logging
+ */
+void LoggingPlugin::eraseFlightLog()
+{
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+    UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
+    FlightLogControl *control = FlightLogControl::GetInstance(objManager);
+
+    if (!control || QMessageBox::question(NULL, tr("Erase flight log"),
+                                          tr("Erase all the flights logged by the board?"),
+                                          QMessageBox::Yes | QMessageBox::No, QMessageBox::No) != QMessageBox::Yes) {
+        return;
+    }
+
+    FlightLogControl::DataFields controlData = control->getData();
+    controlData.Operation = FlightLogControl::OPERATION_ERASE;
+    control->setData(controlData);
+    control->updated();
+}
 
 void LoggingPlugin::extensionsInitialized()
 {
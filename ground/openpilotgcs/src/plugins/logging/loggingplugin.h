@@ -40,6 +40,8 @@
 #include <QThread>
 #include <QQueue>
 #include <QReadWriteLock>
+#include <QMutex>
+#include <QByteArray>
 
 class LoggingPlugin;
 class LoggingGadgetFactory;
@@ -93,6 +95,7 @@ public:
 
 private slots:
     void objectUpdated(UAVObject *obj);
+    void writeUpdates();
     void transactionCompleted(UAVObject *obj, bool success);
 
 public slots:
@@ -107,8 +110,22 @@ protected:
 private:
     QQueue<UAVDataObject *> queue;
 
+    // An object update with the data copied when it was made
+    typedef struct {
+        UAVObject *obj;
+        QByteArray data;
+    } Update;
+
+    // Updates copied and not written yet, guarded by updatesLock
+    QMutex updatesLock;
+    QList<Update> updates;
+    bool stopped;
+
+    void connectObject(UAVObject *obj);
+    void disconnectObject(UAVObject *obj);
     void retrieveSettings();
     void retrieveNextObject();
+    void writeKeyframe();
 };
 
 class LoggingPlugin : public ExtensionSystem::IPlugin {
@@ -153,10 +170,14 @@ private slots:
     void loggingStopped();
     void replayStarted();
     void replayStopped();
+    void downloadFlightLog();
+    void eraseFlightLog();
 
 private:
     LoggingGadgetFactory *mf;
     Core::Command *cmd;
+    Core::Command *downloadCmd;
+    Core::Command *eraseCmd;
 };
 #endif /* LoggingPLUGIN_H_ */
 /**
@@ -30,6 +30,18 @@
 #include <math.h>
 #include <QDebug>
 
+void PlotBuffer::grow()
+{
+    QVector<double> grown(qMax(16, 2 * data.size()));
+
+    // Unwrap the samples to the start of the new buffer
+    for (int i = 0; i < count; i++) {
+        grown[i] = at(i);
+    }
+    data = grown;
+    head = 0;
+}
+
 PlotData::PlotData(QString p_uavObject, QString p_uavField)
 {
     uavObject = p_uavObject;
@@ -44,195 +56,216 @@ PlotData::PlotData(QString p_uavObject, QString p_uavField)
         haveSubField = false;
     }
 
-    xData           = new QVector<double>();
-    yData           = new QVector<double>();
-    yDataHistory    = new QVector<double>();
+    xData           = new PlotBuffer();
+    yData           = new PlotBuffer();
+    yDataHistory    = new PlotBuffer();
 
     curve           = 0;
     scalePower      = 0;
-    meanSamples = 1;
-    meanSum         = 0.0f;
+    meanSamples     = 1;
 // mathFunction=0;
-    correctionSum   = 0.0f;
-    correctionCount = 0;
     yMinimum        = 0;
     yMaximum        = 0;
 
     m_xWindowSize   = 0;
+
+    configured      = false;
+    objId           = 0;
+    fieldIndex      = -1;
+    elementIndex    = -1;
+    scale           = 1.0;
+    mathType        = MathNone;
+    mean            = 0.0;
+    m2              = 0.0;
+    correctionCount = 0;
 }
 
-double PlotData::valueAsDouble(UAVObject *obj, UAVObjectField *field)
+PlotData::~PlotData()
 {
-    Q_UNUSED(obj);
-    QVariant value;
+    delete xData;
+    delete yData;
+    delete yDataHistory;
+}
 
-    if (haveSubField) {
-        int indexOfSubField = field->getElementNames().indexOf(QRegExp(uavSubField, Qt::CaseSensitive, QRegExp::FixedString));
-        value = field->getValue(indexOfSubField);
-    } else {
-        value = field->getValue();
+/**
+ * Resolve the field, element, scale and math function of the curve once
+ * the plot data is set up, obj is the object the curve plots.
+ */
+void PlotData::configure(UAVObject *obj)
+{
+    QList<UAVObjectField *> fields = obj->getFields();
+
+    objId      = obj->getObjID();
+    fieldIndex = -1;
+    for (int n = 0; n < fields.length(); ++n) {
+        if (fields[n]->getName() == uavField) {
+            fieldIndex = n;
+            break;
+        }
     }
 
-    // qDebug() << "Data  (" << value.typeName() << ") " <<  value.toString();
+    elementIndex = 0;
+    if (haveSubField && fieldIndex >= 0) {
+        elementIndex = fields[fieldIndex]->getElementNames().indexOf(uavSubField);
+    }
+
+    scale = pow(10, scalePower);
+
+    if (mathFunction == "Boxcar average") {
+        mathType = MathBoxcarAverage;
+    } else if (mathFunction == "Standard deviation") {
+        mathType = MathStandardDeviation;
+    } else {
+        mathType = MathNone;
+    }
+    yDataHistory->clear();
+    yDataHistory->reserve(meanSamples + 1);
+    mean = 0.0;
+    m2   = 0.0;
+    correctionCount = 0;
 
-    return value.toDouble();
+    configured = (fieldIndex >= 0);
 }
 
-PlotData::~PlotData()
+/**
+ * Get the scaled value the curve plots from an updated object
+ * \return false if the object is not the one of the curve
+ */
+bool PlotData::currentValue(UAVObject *obj, double *value)
 {
-    delete xData;
-    delete yData;
-    delete yDataHistory;
-}
+    if (!configured || obj->getObjID() != objId) {
+        return false;
+    }
 
+    UAVObjectField *field = obj->getFields().at(fieldIndex);
 
-bool SequentialPlotData::append(UAVObject *obj)
+    // An unknown sub field gives an invalid value, plotted as 0
+    *value = field->getDouble((quint32)elementIndex) * scale;
+    return true;
+}
+
+/**
+ * Apply the scope math to a new sample. The mean and the variance of the
+ * last meanSamples samples are updated as samples enter and leave the
+ * window (Welford), and recomputed every meanSamples samples so that
+ * rounding errors do not build up.
+ */
+double PlotData::applyMath(double value)
 {
-    if (uavObject == obj->getName()) {
-        // Get the field of interest
-        UAVObjectField *field = obj->getField(uavField);
-
-        if (field) {
-            double currentValue = valueAsDouble(obj, field) * pow(10, scalePower);
-
-            // Perform scope math, if necessary
-            if (mathFunction == "Boxcar average" || mathFunction == "Standard deviation") {
-                // Put the new value at the front
-                yDataHistory->append(currentValue);
-
-                // calculate average value
-                meanSum += currentValue;
-                if (yDataHistory->size() > meanSamples) {
-                    meanSum -= yDataHistory->first();
-                    yDataHistory->pop_front();
-                }
-
-                // make sure to correct the sum every meanSamples steps to prevent it
-                // from running away due to floating point rounding errors
-                correctionSum += currentValue;
-                if (++correctionCount >= meanSamples) {
-                    meanSum = correctionSum;
-                    correctionSum = 0.0f;
-                    correctionCount = 0;
-                }
-
-                double boxcarAvg = meanSum / yDataHistory->size();
-
-                if (mathFunction == "Standard deviation") {
-                    // Calculate square of sample standard deviation, with Bessel's correction
-                    double stdSum = 0;
-                    for (int i = 0; i < yDataHistory->size(); i++) {
-                        stdSum += pow(yDataHistory->at(i) - boxcarAvg, 2) / (meanSamples - 1);
-                    }
-                    yData->append(sqrt(stdSum));
-                } else {
-                    yData->append(boxcarAvg);
-                }
-            } else {
-                yData->append(currentValue);
-            }
-
-            if (yData->size() > m_xWindowSize) { // If new data overflows the window, remove old data...
-                yData->pop_front();
-            } else { // ...otherwise, add a new y point at position xData
-                xData->insert(xData->size(), xData->size());
-            }
-
-            // notify the gui of changes in the data
-            // dataChanged();
-            return true;
+    if (mathType == MathNone) {
+        return value;
+    }
+
+    yDataHistory->append(value);
+    int n = yDataHistory->size();
+    double delta = value - mean;
+    mean += delta / n;
+    m2   += delta * (value - mean);
+
+    if (n > meanSamples) {
+        double oldest = yDataHistory->first();
+        yDataHistory->removeFirst();
+        n--;
+        delta = oldest - mean;
+        mean -= delta / n;
+        m2   -= delta * (oldest - mean);
+    }
+
+    if (++correctionCount >= meanSamples) {
+        double sum = 0.0;
+        for (int i = 0; i < n; i++) {
+            sum += yDataHistory->at(i);
+        }
+        mean = sum / n;
+        m2   = 0.0;
+        for (int i = 0; i < n; i++) {
+            m2 += (yDataHistory->at(i) - mean) * (yDataHistory->at(i) - mean);
         }
+        correctionCount = 0;
     }
 
-    return false;
+    if (mathType == MathStandardDeviation) {
+        // Sample standard deviation, with Bessel's correction
+        if (meanSamples < 2) {
+            return 0.0;
+        }
+        return sqrt(qMax(m2, 0.0) / (meanSamples - 1));
+    }
+    return mean;
 }
 
-bool ChronoPlotData::append(UAVObject *obj)
+/**
+ * Tell the curve the samples changed
+ */
+void PlotData::updatePlotCurveData()
 {
-    if (uavObject == obj->getName()) {
-        // Get the field of interest
-        UAVObjectField *field = obj->getField(uavField);
-        // qDebug() << "uavObject: " << uavObject << ", uavField: " << uavField;
-
-        if (field) {
-            QDateTime NOW = QDateTime::currentDateTime(); // THINK ABOUT REIMPLEMENTING THIS TO SHOW UAVO TIME, NOT SYSTEM TIME
-            double currentValue = valueAsDouble(obj, field) * pow(10, scalePower);
-
-            // Perform scope math, if necessary
-            if (mathFunction == "Boxcar average" || mathFunction == "Standard deviation") {
-                // Put the new value at the back
-                yDataHistory->append(currentValue);
-
-                // calculate average value
-                meanSum += currentValue;
-                if (yDataHistory->size() > meanSamples) {
-                    meanSum -= yDataHistory->first();
-                    yDataHistory->pop_front();
-                }
-                // make sure to correct the sum every meanSamples steps to prevent it
-                // from running away due to floating point rounding errors
-                correctionSum += currentValue;
-                if (++correctionCount >= meanSamples) {
-                    meanSum = correctionSum;
-                    correctionSum = 0.0f;
-                    correctionCount = 0;
-                }
-
-                double boxcarAvg = meanSum / yDataHistory->size();
-// qDebug()<<mathFunction;
-                if (mathFunction == "Standard deviation") {
-                    // Calculate square of sample standard deviation, with Bessel's correction
-                    double stdSum = 0;
-                    for (int i = 0; i < yDataHistory->size(); i++) {
-                        stdSum += pow(yDataHistory->at(i) - boxcarAvg, 2) / (meanSamples - 1);
-                    }
-                    yData->append(sqrt(stdSum));
-                } else {
-                    yData->append(boxcarAvg);
-                }
-            } else {
-                yData->append(currentValue);
-            }
-
-            double valueX = NOW.toTime_t() + NOW.time().msec() / 1000.0;
-            xData->append(valueX);
-
-            // qDebug() << "Data  " << uavObject << "." << field->getName() << " X,Y:" << valueX << "," <<  valueY;
-
-            // Remove stale data
-            removeStaleData();
-
-            // notify the gui of chages in the data
-            // dataChanged();
-            return true;
-        }
+    if (curve) {
+        static_cast<PlotCurveData *>(curve->data())->invalidate();
     }
+}
 
-    return false;
+QRectF PlotCurveData::boundingRect() const
+{
+    // Computed once per change of the samples
+    if (d_boundingRect.width() < 0.0) {
+        d_boundingRect = qwtBoundingRect(*this);
+    }
+    return d_boundingRect;
 }
 
-void ChronoPlotData::removeStaleData()
+
+bool SequentialPlotData::append(UAVObject *obj)
 {
-    double newestValue;
-    double oldestValue;
+    double value;
 
-    while (1) {
-        if (xData->size() == 0) {
-            break;
-        }
+    if (!currentValue(obj, &value)) {
+        return false;
+    }
 
-        newestValue = xData->last();
-        oldestValue = xData->first();
+    // Perform scope math, if necessary
+    yData->append(applyMath(value));
 
-        if (newestValue - oldestValue > m_xWindowSize) {
-            yData->pop_front();
-            xData->pop_front();
-        } else {
-            break;
-        }
+    if (yData->size() > m_xWindowSize) { // If new data overflows the window, remove old data...
+        yData->removeFirst();
+    } else { // ...otherwise, add a new y point at position xData
+        xData->append(xData->size());
+    }
+
+    // notify the gui of changes in the data
+    // dataChanged();
+    return true;
+}
+
+bool ChronoPlotData::append(UAVObject *obj)
+{
+    double value;
+
+    if (!currentValue(obj, &value)) {
+        return false;
     }
 
-    // qDebug() << "removeStaleData ";
+    QDateTime NOW = QDateTime::currentDateTime(); // THINK ABOUT REIMPLEMENTING THIS TO SHOW UAVO TIME, NOT SYSTEM TIME
+
+    // Perform scope math, if necessary
+    yData->append(applyMath(value));
+
+    double valueX = NOW.toTime_t() + NOW.time().msec() / 1000.0;
+    xData->append(valueX);
+
+    // Remove stale data
+    removeStaleData();
+
+    // notify the gui of chages in the data
+    // dataChanged();
+    return true;
+}
+
+void ChronoPlotData::removeStaleData()
+{
+    while (!xData->isEmpty() && xData->last() - xData->first() > m_xWindowSize) {
+        yData->removeFirst();
+        xData->removeFirst();
+    }
 }
 
 void ChronoPlotData::removeStaleDataTimeout()
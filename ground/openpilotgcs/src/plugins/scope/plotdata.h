@@ -33,6 +33,7 @@
 #include "qwt/src/qwt.h"
 #include "qwt/src/qwt_plot.h"
 #include "qwt/src/qwt_plot_curve.h"
+#include "qwt/src/qwt_series_data.h"
 #include "qwt/src/qwt_scale_draw.h"
 #include "qwt/src/qwt_scale_widget.h"
 
@@ -51,6 +52,68 @@ enum PlotType {
     NPlotTypes
 };
 
+/*!
+   \brief Queue of samples in a circular buffer, appending and removing the
+   oldest sample do not move the others. The buffer doubles when it is full.
+ */
+class PlotBuffer {
+public:
+    PlotBuffer() : head(0), count(0) {}
+
+    void append(double value)
+    {
+        if (count == data.size()) {
+            grow();
+        }
+        data[(head + count) % data.size()] = value;
+        count++;
+    }
+    void removeFirst()
+    {
+        head = (head + 1) % data.size();
+        count--;
+    }
+    void clear()
+    {
+        head  = 0;
+        count = 0;
+    }
+    void reserve(int size)
+    {
+        while (data.size() < size) {
+            grow();
+        }
+    }
+    //! Sample i, counting from the oldest
+    double at(int i) const
+    {
+        return data.at((head + i) % data.size());
+    }
+    double first() const
+    {
+        return at(0);
+    }
+    double last() const
+    {
+        return at(count - 1);
+    }
+    int size() const
+    {
+        return count;
+    }
+    bool isEmpty() const
+    {
+        return count == 0;
+    }
+
+private:
+    QVector<double> data;
+    int head;
+    int count;
+
+    void grow();
+};
+
 /*!
    \brief Base class that keeps the data for each curve in the plot.
  */
@@ -67,18 +130,16 @@ public:
     bool haveSubField;
     int scalePower; // This is the power to which each value must be raised
     int meanSamples;
-    double meanSum;
     QString mathFunction;
-    double correctionSum;
-    int correctionCount;
     double yMinimum;
     double yMaximum;
     double m_xWindowSize;
     QwtPlotCurve *curve;
-    QVector<double> *xData;
-    QVector<double> *yData;
-    QVector<double> *yDataHistory;
+    PlotBuffer *xData;
+    PlotBuffer *yData;
+    PlotBuffer *yDataHistory;
 
+    void configure(UAVObject *obj);
     virtual bool append(UAVObject *obj) = 0;
     virtual PlotType plotType()    = 0;
     virtual void removeStaleData() = 0;
@@ -86,12 +147,56 @@ public:
     void updatePlotCurveData();
 
 protected:
-    double valueAsDouble(UAVObject *obj, UAVObjectField *field);
+    enum MathType { MathNone, MathBoxcarAverage, MathStandardDeviation };
+
+    // Resolved by configure() so that appending a sample does not look anything up
+    bool configured;
+    quint32 objId;
+    int fieldIndex;
+    int elementIndex;
+    double scale;
+    MathType mathType;
+
+    // Running mean and sum of squared deviations of the samples in yDataHistory
+    double mean;
+    double m2;
+    int correctionCount;
+
+    bool currentValue(UAVObject *obj, double *value);
+    double applyMath(double value);
 
 signals:
     void dataChanged();
 };
 
+/*!
+   \brief Gives the curve direct access to the samples of the plot data,
+   they are not copied on every replot.
+ */
+class PlotCurveData : public QwtSeriesData<QPointF> {
+public:
+    PlotCurveData(PlotData *plotData) : plotData(plotData) {}
+
+    size_t size() const
+    {
+        return plotData->yData->size();
+    }
+    QPointF sample(size_t i) const
+    {
+        return QPointF(plotData->xData->at(i), plotData->yData->at(i));
+    }
+    QRectF boundingRect() const;
+
+    //! Called when the samples changed
+    void invalidate()
+    {
+        d_boundingRect = QRectF(0.0, 0.0, -1.0, -1.0);
+    }
+
+private:
+    PlotData *plotData;
+};
+
 /*!
    \brief The sequential plot have a fixed size buffer of data. All the curves in one plot
    have the same size buffer.
@@ -104,9 +104,10 @@ ScopeGadgetWidget::~ScopeGadgetWidget()
     foreach(QString uavObjName, m_connectedUAVObjects) {
         UAVDataObject *obj = dynamic_cast<UAVDataObject *>(objManager->getObject(uavObjName));
 
-        disconnect(obj, SIGNAL(objectUpdated(UAVObject *)), this, SLOT(uavObjectReceived(UAVObject *)));
+        disconnectObject(obj);
     }
 
+    // Waits for an update still being plotted in another thread
     clearCurvePlots();
 }
 
@@ -441,6 +442,9 @@ void ScopeGadgetWidget::addCurvePlot(QString uavObject, QString uavFieldSubField
     }
     QString units = field->getUnits();
 
+    // Look up everything the samples need now rather than on every update
+    plotData->configure(obj);
+
     if (units == 0) {
         units = QString();
     }
@@ -459,17 +463,19 @@ void ScopeGadgetWidget::addCurvePlot(QString uavObject, QString uavFieldSubField
     }
 
     plotCurve->setPen(pen);
-    plotCurve->setSamples(*plotData->xData, *plotData->yData);
+    plotCurve->setData(new PlotCurveData(plotData));
     plotCurve->attach(this);
     plotData->curve = plotCurve;
 
     // Keep the curve details for later
+    mutex.lock();
     m_curvesData.insert(curveNameScaled, plotData);
+    mutex.unlock();
 
     // Link to the new signal data only if this UAVObject has not been connected yet
     if (!m_connectedUAVObjects.contains(obj->getName())) {
         m_connectedUAVObjects.append(obj->getName());
-        connect(obj, SIGNAL(objectUpdated(UAVObject *)), this, SLOT(uavObjectReceived(UAVObject *)));
+        connectObject(obj);
     }
 
     mutex.lock();
@@ -477,6 +483,25 @@ void ScopeGadgetWidget::addCurvePlot(QString uavObject, QString uavFieldSubField
     mutex.unlock();
 }
 
+/**
+ * Plot every update of an object: the unpacks of the telemetry input thread
+ * directly, as objectUpdated() is coalesced for them, and the changes made in
+ * the GCS.
+ */
+void ScopeGadgetWidget::connectObject(UAVObject *obj)
+{
+    connect(obj, SIGNAL(objectUnpacked(UAVObject *)), this, SLOT(uavObjectReceived(UAVObject *)), Qt::DirectConnection);
+    connect(obj, SIGNAL(objectUpdatedAuto(UAVObject *)), this, SLOT(uavObjectReceived(UAVObject *)), Qt::DirectConnection);
+    connect(obj, SIGNAL(objectUpdatedManual(UAVObject *)), this, SLOT(uavObjectReceived(UAVObject *)), Qt::DirectConnection);
+}
+
+void ScopeGadgetWidget::disconnectObject(UAVObject *obj)
+{
+    disconnect(obj, SIGNAL(objectUnpacked(UAVObject *)), this, SLOT(uavObjectReceived(UAVObject *)));
+    disconnect(obj, SIGNAL(objectUpdatedAuto(UAVObject *)), this, SLOT(uavObjectReceived(UAVObject *)));
+    disconnect(obj, SIGNAL(objectUpdatedManual(UAVObject *)), this, SLOT(uavObjectReceived(UAVObject *)));
+}
+
 // void ScopeGadgetWidget::removeCurvePlot(QString uavObject, QString uavField)
 // {
 // QString curveName = uavObject + "." + uavField;
@@ -493,8 +518,14 @@ void ScopeGadgetWidget::addCurvePlot(QString uavObject, QString uavFieldSubField
 // mutex.unlock();
 // }
 
+/**
+ * Called in the thread making the update, with the mutex of the object held
+ * for the unpacks, so each update is sampled with its own data
+ */
 void ScopeGadgetWidget::uavObjectReceived(UAVObject *obj)
 {
+    QMutexLocker locker(&mutex);
+
     foreach(PlotData * plotData, m_curvesData.values()) {
         if (plotData->append(obj)) {
             m_csvLoggingDataUpdated = 1;
@@ -512,7 +543,7 @@ void ScopeGadgetWidget::replotNewData()
     QMutexLocker locker(&mutex);
     foreach(PlotData * plotData, m_curvesData.values()) {
         plotData->removeStaleData();
-        plotData->curve->setSamples(*plotData->xData, *plotData->yData);
+        plotData->updatePlotCurveData();
     }
 
     QDateTime NOW = QDateTime::currentDateTime();
@@ -531,6 +562,8 @@ void ScopeGadgetWidget::replotNewData()
 
 void ScopeGadgetWidget::clearCurvePlots()
 {
+    QMutexLocker locker(&mutex);
+
     foreach(PlotData * plotData, m_curvesData.values()) {
         plotData->curve->detach();
 
@@ -551,6 +584,8 @@ void ScopeGadgetWidget::clearCurvePlots()
  */
 int ScopeGadgetWidget::csvLoggingStart()
 {
+    QMutexLocker locker(&mutex);
+
     if (!m_csvLoggingStarted) {
         if (m_csvLoggingEnabled) {
             if ((!m_csvLoggingNewFileOnConnect) || (m_csvLoggingNewFileOnConnect && m_csvLoggingConnected)) {
@@ -586,6 +621,8 @@ int ScopeGadgetWidget::csvLoggingStart()
 
 int ScopeGadgetWidget::csvLoggingStop()
 {
+    QMutexLocker locker(&mutex);
+
     m_csvLoggingStarted = 0;
 
     return 0;
@@ -132,6 +132,8 @@ private:
 
     void preparePlot(PlotType plotType);
     void setupExamplePlot();
+    void connectObject(UAVObject *obj);
+    void disconnectObject(UAVObject *obj);
 
     PlotType m_plotType;
 
@@ -159,6 +161,8 @@ private:
     QString m_csvLoggingBuffer;
     QFile m_csvLoggingFile;
 
+    // Guards the curves data and the csv logging as well, uavObjectReceived()
+    // is called in the thread making the update
     QMutex mutex;
 
     int csvLoggingInsertHeader();
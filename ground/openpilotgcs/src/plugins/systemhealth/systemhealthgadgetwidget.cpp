@@ -95,37 +95,42 @@ void SystemHealthGadgetWidget::updateAlarms(UAVObject *systemAlarm)
         delete item; // removeItem does _not_ delete the item.
     }
 
-    QString alarm = systemAlarm->getName();
-    foreach(UAVObjectField * field, systemAlarm->getFields()) {
-        for (uint i = 0; i < field->getNumElements(); ++i) {
-            QString element = field->getElementNames()[i];
-            QString value   = field->getValue(i).toString();
-            if (!missingElements->contains(element)) {
-                if (m_renderer->elementExists(element)) {
-                    QMatrix blockMatrix = m_renderer->matrixForElement(element);
-                    qreal startX = blockMatrix.mapRect(m_renderer->boundsOnElement(element)).x();
-                    qreal startY = blockMatrix.mapRect(m_renderer->boundsOnElement(element)).y();
-                    QString element2    = element + "-" + value;
-                    if (!missingElements->contains(element2)) {
-                        if (m_renderer->elementExists(element2)) {
-                            QGraphicsSvgItem *ind = new QGraphicsSvgItem();
-                            ind->setSharedRenderer(m_renderer);
-                            ind->setElementId(element2);
-                            ind->setParentItem(background);
-                            QTransform matrix;
-                            matrix.translate(startX, startY);
-                            ind->setTransform(matrix, false);
-                        } else {
-                            if (value.compare("Uninitialised") != 0) {
-                                missingElements->append(element2);
-                                qDebug() << "Warning: element " << element2 << " not found in SVG.";
-                            }
+    SystemAlarms *alarms = dynamic_cast<SystemAlarms *>(systemAlarm);
+    if (alarms == NULL) {
+        return;
+    }
+    UAVObjectField *field = alarms->getField("Alarm");
+    QStringList elements  = field->getElementNames();
+    QStringList options   = field->getOptions();
+    for (uint i = 0; i < SystemAlarms::ALARM_NUMELEM; ++i) {
+        QString element = elements[i];
+        // An invalid severity is shown as the first option, as UAVObjectField::getValue() does
+        QString value   = options.value(alarms->getAlarm(i), options.first());
+        if (!missingElements->contains(element)) {
+            if (m_renderer->elementExists(element)) {
+                QMatrix blockMatrix = m_renderer->matrixForElement(element);
+                qreal startX = blockMatrix.mapRect(m_renderer->boundsOnElement(element)).x();
+                qreal startY = blockMatrix.mapRect(m_renderer->boundsOnElement(element)).y();
+                QString element2    = element + "-" + value;
+                if (!missingElements->contains(element2)) {
+                    if (m_renderer->elementExists(element2)) {
+                        QGraphicsSvgItem *ind = new QGraphicsSvgItem();
+                        ind->setSharedRenderer(m_renderer);
+                        ind->setElementId(element2);
+                        ind->setParentItem(background);
+                        QTransform matrix;
+                        matrix.translate(startX, startY);
+                        ind->setTransform(matrix, false);
+                    } else {
+                        if (value.compare("Uninitialised") != 0) {
+                            missingElements->append(element2);
+                            qDebug() << "Warning: element " << element2 << " not found in SVG.";
                         }
                     }
-                } else {
-                    missingElements->append(element);
-                    qDebug() << "Warning: Element " << element << " not found in SVG.";
                 }
+            } else {
+                missingElements->append(element);
+                qDebug() << "Warning: Element " << element << " not found in SVG.";
             }
         }
     }
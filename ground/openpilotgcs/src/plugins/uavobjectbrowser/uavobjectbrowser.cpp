@@ -48,6 +48,7 @@ void UAVObjectBrowser::loadConfiguration(IUAVGadgetConfiguration *config)
     m_widget->setRecentlyUpdatedColor(m->recentlyUpdatedColor());
     m_widget->setManuallyChangedColor(m->manuallyChangedColor());
     m_widget->setRecentlyUpdatedTimeout(m->recentlyUpdatedTimeout());
+    m_widget->setRefreshRate(m->refreshRate());
     m_widget->setOnlyHilightChangedValues(m->onlyHighlightChangedValues());
     m_widget->setViewOptions(m->categorizedView(), m->scientificView(), m->showMetaData());
 }
@@ -33,6 +33,7 @@ UAVObjectBrowserConfiguration::UAVObjectBrowserConfiguration(QString classId, QS
     m_manuallyChangedColor(QColor(230, 230, 255)),
     m_onlyHilightChangedValues(false),
     m_recentlyUpdatedTimeout(500),
+    m_refreshRate(20),
     m_useCategorizedView(false),
     m_useScientificView(false),
     m_showMetaData(false)
@@ -42,6 +43,7 @@ UAVObjectBrowserConfiguration::UAVObjectBrowserConfiguration(QString classId, QS
         QColor recent = qSettings->value("recentlyUpdatedColor").value<QColor>();
         QColor manual = qSettings->value("manuallyChangedColor").value<QColor>();
         int timeout   = qSettings->value("recentlyUpdatedTimeout").toInt();
+        int rate      = qSettings->value("refreshRate", m_refreshRate).toInt();
         bool hilight  = qSettings->value("onlyHilightChangedValues").toBool();
 
         m_useCategorizedView       = qSettings->value("CategorizedView").toBool();
@@ -50,6 +52,7 @@ UAVObjectBrowserConfiguration::UAVObjectBrowserConfiguration(QString classId, QS
         m_recentlyUpdatedColor     = recent;
         m_manuallyChangedColor     = manual;
         m_recentlyUpdatedTimeout   = timeout;
+        m_refreshRate = rate;
         m_onlyHilightChangedValues = hilight;
     }
 }
@@ -61,6 +64,7 @@ IUAVGadgetConfiguration *UAVObjectBrowserConfiguration::clone()
     m->m_recentlyUpdatedColor     = m_recentlyUpdatedColor;
     m->m_manuallyChangedColor     = m_manuallyChangedColor;
     m->m_recentlyUpdatedTimeout   = m_recentlyUpdatedTimeout;
+    m->m_refreshRate = m_refreshRate;
     m->m_onlyHilightChangedValues = m_onlyHilightChangedValues;
     m->m_useCategorizedView = m_useCategorizedView;
     m->m_useScientificView  = m_useScientificView;
@@ -77,6 +81,7 @@ void UAVObjectBrowserConfiguration::saveConfig(QSettings *qSettings) const
     qSettings->setValue("recentlyUpdatedColor", m_recentlyUpdatedColor);
     qSettings->setValue("manuallyChangedColor", m_manuallyChangedColor);
     qSettings->setValue("recentlyUpdatedTimeout", m_recentlyUpdatedTimeout);
+    qSettings->setValue("refreshRate", m_refreshRate);
     qSettings->setValue("onlyHilightChangedValues", m_onlyHilightChangedValues);
     qSettings->setValue("CategorizedView", m_useCategorizedView);
     qSettings->setValue("ScientificView", m_useScientificView);
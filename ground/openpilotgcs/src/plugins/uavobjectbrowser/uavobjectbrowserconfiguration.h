@@ -37,6 +37,7 @@ class UAVObjectBrowserConfiguration : public IUAVGadgetConfiguration {
     Q_OBJECT Q_PROPERTY(QColor m_recentlyUpdatedColor READ recentlyUpdatedColor WRITE setRecentlyUpdatedColor)
     Q_PROPERTY(QColor m_manuallyChangedColor READ manuallyChangedColor WRITE setManuallyChangedColor)
     Q_PROPERTY(int m_recentlyUpdatedTimeout READ recentlyUpdatedTimeout WRITE setRecentlyUpdatedTimeout)
+    Q_PROPERTY(int m_refreshRate READ refreshRate WRITE setRefreshRate)
     Q_PROPERTY(bool m_onlyHilightChangedValues READ onlyHighlightChangedValues WRITE setOnlyHighlightChangedValues)
     Q_PROPERTY(bool m_useCategorizedView READ categorizedView WRITE setCategorizedView)
     Q_PROPERTY(bool m_useScientificView READ scientificView WRITE setScientificView)
@@ -59,6 +60,10 @@ public:
     {
         return m_recentlyUpdatedTimeout;
     }
+    int refreshRate() const
+    {
+        return m_refreshRate;
+    }
     bool onlyHighlightChangedValues() const
     {
         return m_onlyHilightChangedValues;
@@ -91,6 +96,10 @@ public slots:
     {
         m_recentlyUpdatedTimeout = timeout;
     }
+    void setRefreshRate(int rate)
+    {
+        m_refreshRate = rate;
+    }
     void setOnlyHighlightChangedValues(bool hilight)
     {
         m_onlyHilightChangedValues = hilight;
@@ -112,6 +121,7 @@ private:
     QColor m_recentlyUpdatedColor;
     QColor m_manuallyChangedColor;
     int m_recentlyUpdatedTimeout;
+    int m_refreshRate;
     bool m_onlyHilightChangedValues;
     bool m_useCategorizedView;
     bool m_useScientificView;
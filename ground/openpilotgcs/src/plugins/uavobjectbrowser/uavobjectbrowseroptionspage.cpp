@@ -51,6 +51,7 @@ QWidget *UAVObjectBrowserOptionsPage::createPage(QWidget *parent)
     m_page->recentlyUpdatedButton->setColor(m_config->recentlyUpdatedColor());
     m_page->manuallyChangedButton->setColor(m_config->manuallyChangedColor());
     m_page->recentlyUpdatedTimeoutSpinBox->setValue(m_config->recentlyUpdatedTimeout());
+    m_page->refreshRateSpinBox->setValue(m_config->refreshRate());
     m_page->hilightBox->setChecked(m_config->onlyHighlightChangedValues());
 
     return w;
@@ -61,6 +62,7 @@ void UAVObjectBrowserOptionsPage::apply()
     m_config->setRecentlyUpdatedColor(m_page->recentlyUpdatedButton->color());
     m_config->setManuallyChangedColor(m_page->manuallyChangedButton->color());
     m_config->setRecentlyUpdatedTimeout(m_page->recentlyUpdatedTimeoutSpinBox->value());
+    m_config->setRefreshRate(m_page->refreshRateSpinBox->value());
     m_config->setOnlyHighlightChangedValues(m_page->hilightBox->isChecked());
 }
 
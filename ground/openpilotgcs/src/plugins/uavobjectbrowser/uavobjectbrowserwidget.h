@@ -60,6 +60,10 @@ public:
     {
         m_onlyHilightChangedValues = hilight; m_model->setOnlyHilightChangedValues(hilight);
     }
+    void setRefreshRate(int rate)
+    {
+        m_refreshRate = rate; m_model->setRefreshRate(rate);
+    }
     void setViewOptions(bool categorized, bool scientific, bool metadata);
 public slots:
     void showMetaData(bool show);
@@ -86,6 +90,7 @@ private:
     UAVObjectTreeModel *m_model;
 
     int m_recentlyUpdatedTimeout;
+    int m_refreshRate;
     QColor m_recentlyUpdatedColor;
     QColor m_manuallyChangedColor;
     bool m_onlyHilightChangedValues;
@@ -36,8 +36,12 @@
 // #include <QtGui/QIcon>
 #include <QtCore/QTimer>
 #include <QtCore/QSignalMapper>
+#include <QtCore/QtConcurrentRun>
 #include <QtCore/QDebug>
 
+// Default number of refreshes per second
+#define DEFAULT_REFRESH_RATE 20
+
 UAVObjectTreeModel::UAVObjectTreeModel(QObject *parent, bool categorize, bool useScientificNotation) :
     QAbstractItemModel(parent),
     m_useScientificFloatNotation(useScientificNotation),
@@ -53,12 +57,19 @@ UAVObjectTreeModel::UAVObjectTreeModel(QObject *parent, bool categorize, bool us
     connect(objManager, SIGNAL(newObject(UAVObject *)), this, SLOT(newObject(UAVObject *)));
     connect(objManager, SIGNAL(newInstance(UAVObject *)), this, SLOT(newObject(UAVObject *)));
 
+    // Updates are collected and shown together when the refresh timer fires
+    m_refreshTimer.setSingleShot(true);
+    setRefreshRate(DEFAULT_REFRESH_RATE);
+    connect(&m_refreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+    connect(&m_diffWatcher, SIGNAL(finished()), this, SLOT(applyObjectChanges()));
+
     TreeItem::setHighlightTime(m_recentlyUpdatedTimeout);
     setupModelData(objManager, categorize);
 }
 
 UAVObjectTreeModel::~UAVObjectTreeModel()
 {
+    m_diffWatcher.waitForFinished();
     delete m_highlightManager;
     delete m_rootItem;
 }
@@ -151,25 +162,27 @@ MetaObjectTreeItem *UAVObjectTreeModel::addMetaObject(UAVMetaObject *obj, TreeIt
 
     meta->setHighlightManager(m_highlightManager);
     connect(meta, SIGNAL(updateHighlight(TreeItem *)), this, SLOT(updateHighlight(TreeItem *)));
+    QVector<TreeItem *> fieldItems;
     foreach(UAVObjectField * field, obj->getFields()) {
         if (field->getNumElements() > 1) {
-            addArrayField(field, meta);
+            fieldItems.append(addArrayField(field, meta));
         } else {
-            addSingleField(0, field, meta);
+            fieldItems.append(addSingleField(0, field, meta));
         }
     }
     parent->appendChild(meta);
+    m_objectItems.insert(obj, meta);
+    m_fieldItems.insert(obj, fieldItems);
     return meta;
 }
 
 void UAVObjectTreeModel::addInstance(UAVObject *obj, TreeItem *parent)
 {
     connect(obj, SIGNAL(objectUpdated(UAVObject *)), this, SLOT(highlightUpdatedObject(UAVObject *)));
-    TreeItem *item;
+    ObjectTreeItem *item;
     if (obj->isSingleInstance()) {
-        item = parent;
-        DataObjectTreeItem *p = static_cast<DataObjectTreeItem *>(parent);
-        p->setObject(obj);
+        item = static_cast<DataObjectTreeItem *>(parent);
+        item->setObject(obj);
     } else {
         QString name = tr("Instance") + " " + QString::number(obj->getInstID());
         item = new InstanceTreeItem(obj, name);
@@ -177,16 +190,19 @@ void UAVObjectTreeModel::addInstance(UAVObject *obj, TreeItem *parent)
         connect(item, SIGNAL(updateHighlight(TreeItem *)), this, SLOT(updateHighlight(TreeItem *)));
         parent->appendChild(item);
     }
+    QVector<TreeItem *> fieldItems;
     foreach(UAVObjectField * field, obj->getFields()) {
         if (field->getNumElements() > 1) {
-            addArrayField(field, item);
+            fieldItems.append(addArrayField(field, item));
         } else {
-            addSingleField(0, field, item);
+            fieldItems.append(addSingleField(0, field, item));
         }
     }
+    m_objectItems.insert(obj, item);
+    m_fieldItems.insert(obj, fieldItems);
 }
 
-void UAVObjectTreeModel::addArrayField(UAVObjectField *field, TreeItem *parent)
+TreeItem *UAVObjectTreeModel::addArrayField(UAVObjectField *field, TreeItem *parent)
 {
     TreeItem *item = new ArrayFieldTreeItem(field->getName());
 
@@ -196,9 +212,10 @@ void UAVObjectTreeModel::addArrayField(UAVObjectField *field, TreeItem *parent)
         addSingleField(i, field, item);
     }
     parent->appendChild(item);
+    return item;
 }
 
-void UAVObjectTreeModel::addSingleField(int index, UAVObjectField *field, TreeItem *parent)
+TreeItem *UAVObjectTreeModel::addSingleField(int index, UAVObjectField *field, TreeItem *parent)
 {
     QList<QVariant> data;
     if (field->getNumElements() == 1) {
@@ -241,6 +258,7 @@ void UAVObjectTreeModel::addSingleField(int index, UAVObjectField *field, TreeIt
     item->setHighlightManager(m_highlightManager);
     connect(item, SIGNAL(updateHighlight(TreeItem *)), this, SLOT(updateHighlight(TreeItem *)));
     parent->appendChild(item);
+    return item;
 }
 
 QModelIndex UAVObjectTreeModel::index(int row, int column, const QModelIndex &parent)
@@ -428,56 +446,145 @@ QVariant UAVObjectTreeModel::headerData(int section, Qt::Orientation orientation
     return QVariant();
 }
 
+/**
+ * Called on every update of an object, the object is only marked as updated
+ * and shown at the next refresh
+ */
 void UAVObjectTreeModel::highlightUpdatedObject(UAVObject *obj)
 {
     Q_ASSERT(obj);
-    ObjectTreeItem *item = findObjectTreeItem(obj);
-    Q_ASSERT(item);
-    if (!m_onlyHilightChangedValues) {
-        item->setHighlight(true);
-    }
-    item->update();
-    if (!m_onlyHilightChangedValues) {
-        QModelIndex itemIndex = index(item);
-        Q_ASSERT(itemIndex != QModelIndex());
-        emit dataChanged(itemIndex, itemIndex);
-    }
+    m_updatedObjects.insert(obj);
+    scheduleRefresh();
 }
 
-ObjectTreeItem *UAVObjectTreeModel::findObjectTreeItem(UAVObject *object)
+/**
+ * Called by the tree items when their highlight changes
+ */
+void UAVObjectTreeModel::updateHighlight(TreeItem *item)
 {
-    UAVDataObject *dataObject = qobject_cast<UAVDataObject *>(object);
-    UAVMetaObject *metaObject = qobject_cast<UAVMetaObject *>(object);
+    m_changedItems.insert(item);
+    scheduleRefresh();
+}
 
-    Q_ASSERT(dataObject || metaObject);
-    if (dataObject) {
-        return findDataObjectTreeItem(dataObject);
-    } else {
-        return findMetaObjectTreeItem(metaObject);
+void UAVObjectTreeModel::scheduleRefresh()
+{
+    if (!m_refreshTimer.isActive()) {
+        m_refreshTimer.start();
     }
-    return 0;
 }
 
-DataObjectTreeItem *UAVObjectTreeModel::findDataObjectTreeItem(UAVDataObject *obj)
+/**
+ * Hand the objects updated since the last refresh to a worker thread that
+ * finds out which of their fields changed, and repaint the items whose
+ * highlight changed meanwhile
+ */
+void UAVObjectTreeModel::refresh()
 {
-    TopTreeItem *root = obj->isSettings() ? m_settingsTree : m_nonSettingsTree;
+    if (!m_updatedObjects.isEmpty()) {
+        if (m_diffWatcher.isRunning()) {
+            // Still busy with the previous refresh, try again later
+            scheduleRefresh();
+        } else {
+            QList<UAVObject *> objects = m_updatedObjects.toList();
+            m_updatedObjects.clear();
+            m_diffWatcher.setFuture(QtConcurrent::run(&UAVObjectTreeModel::diffObjects, objects, &m_lastData));
+        }
+    }
+    emitDataChanged();
+}
 
-    return root->findDataObjectTreeItemByObjectId(obj->getObjID());
+/**
+ * Compare the packed data of the objects with the data they had at the
+ * previous refresh. Runs in a worker thread, the objects are only read
+ * and lastData is not used anywhere else.
+ */
+UAVObjectTreeModel::ObjectChanges UAVObjectTreeModel::diffObjects(QList<UAVObject *> objects, QHash<UAVObject *, QByteArray> *lastData)
+{
+    ObjectChanges changes;
+
+    foreach(UAVObject * obj, objects) {
+        QByteArray data(obj->getNumBytes(), 0);
+        obj->pack((quint8 *)data.data());
+
+        QByteArray &last = (*lastData)[obj];
+        QList<UAVObjectField *> fields = obj->getFields();
+        QList<int> changedFields;
+        for (int n = 0; n < fields.length(); ++n) {
+            quint32 offset = fields[n]->getDataOffset();
+            if (last.size() != data.size() ||
+                memcmp(last.constData() + offset, data.constData() + offset, fields[n]->getNumBytes()) != 0) {
+                changedFields.append(n);
+            }
+        }
+        last = data;
+        changes.insert(obj, changedFields);
+    }
+    return changes;
 }
 
-MetaObjectTreeItem *UAVObjectTreeModel::findMetaObjectTreeItem(UAVMetaObject *obj)
+/**
+ * Update the items of the changed fields, back in the UI thread
+ */
+void UAVObjectTreeModel::applyObjectChanges()
 {
-    UAVDataObject *dataObject = qobject_cast<UAVDataObject *>(obj->getParentObject());
+    ObjectChanges changes = m_diffWatcher.result();
+
+    for (ObjectChanges::const_iterator i = changes.constBegin(); i != changes.constEnd(); ++i) {
+        ObjectTreeItem *item = m_objectItems.value(i.key());
+        Q_ASSERT(item);
+        if (!m_onlyHilightChangedValues) {
+            item->setHighlight(true);
+            m_changedItems.insert(item);
+        }
+        const QVector<TreeItem *> &fieldItems = m_fieldItems[i.key()];
+        foreach(int n, i.value()) {
+            fieldItems[n]->update();
+            markChanged(fieldItems[n]);
+        }
+    }
+    emitDataChanged();
+}
 
-    Q_ASSERT(dataObject);
-    TopTreeItem *root = dataObject->isSettings() ? m_settingsTree : m_nonSettingsTree;
-    return root->findMetaObjectTreeItemByObjectId(obj->getObjID());
+void UAVObjectTreeModel::markChanged(TreeItem *item)
+{
+    if (item->childCount() > 0) {
+        // The elements of an array field
+        foreach(TreeItem * child, item->treeChildren()) {
+            m_changedItems.insert(child);
+        }
+    } else {
+        m_changedItems.insert(item);
+    }
 }
 
-void UAVObjectTreeModel::updateHighlight(TreeItem *item)
+/**
+ * Tell the views about the changed items with one range of rows per parent
+ */
+void UAVObjectTreeModel::emitDataChanged()
 {
-    QModelIndex itemIndex = index(item);
+    QHash<TreeItem *, QPair<int, int> > rows;
+
+    foreach(TreeItem * item, m_changedItems) {
+        TreeItem *parent = item->parent();
+        if (!parent) {
+            continue;
+        }
+        int row = item->row();
+        if (rows.contains(parent)) {
+            QPair<int, int> &range = rows[parent];
+            range.first  = qMin(range.first, row);
+            range.second = qMax(range.second, row);
+        } else {
+            rows.insert(parent, qMakePair(row, row));
+        }
+    }
+    m_changedItems.clear();
 
-    Q_ASSERT(itemIndex != QModelIndex());
-    emit dataChanged(itemIndex, itemIndex.sibling(itemIndex.row(), TreeItem::dataColumn));
+    for (QHash<TreeItem *, QPair<int, int> >::const_iterator i = rows.constBegin(); i != rows.constEnd(); ++i) {
+        TreeItem *parent = i.key();
+        int first = i.value().first;
+        int last  = i.value().second;
+        emit dataChanged(createIndex(first, 0, parent->getChild(first)),
+                         createIndex(last, TreeItem::dataColumn, parent->getChild(last)));
+    }
 }
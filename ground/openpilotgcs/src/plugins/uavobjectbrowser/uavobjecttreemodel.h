@@ -31,7 +31,13 @@
 #include "treeitem.h"
 #include <QAbstractItemModel>
 #include <QtCore/QMap>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
 #include <QtCore/QList>
+#include <QtCore/QVector>
+#include <QtCore/QByteArray>
+#include <QtCore/QTimer>
+#include <QtCore/QFutureWatcher>
 #include <QtGui/QColor>
 
 class TopTreeItem;
@@ -43,7 +49,6 @@ class UAVMetaObject;
 class UAVObjectField;
 class UAVObjectManager;
 class QSignalMapper;
-class QTimer;
 
 class UAVObjectTreeModel : public QAbstractItemModel {
     Q_OBJECT
@@ -79,6 +84,11 @@ public:
     {
         m_onlyHilightChangedValues = hilight;
     }
+    // Object updates are collected and shown this many times per second
+    void setRefreshRate(int rate)
+    {
+        m_refreshTimer.setInterval(1000 / qMax(rate, 1));
+    }
 
     QList<QModelIndex> getMetaDataIndexes();
 
@@ -90,22 +100,29 @@ public slots:
 private slots:
     void highlightUpdatedObject(UAVObject *obj);
     void updateHighlight(TreeItem *);
+    void refresh();
+    void applyObjectChanges();
 
 private:
+    // Indexes of the changed fields of each updated object
+    typedef QHash<UAVObject *, QList<int> > ObjectChanges;
+
+    static ObjectChanges diffObjects(QList<UAVObject *> objects, QHash<UAVObject *, QByteArray> *lastData);
+    void scheduleRefresh();
+    void markChanged(TreeItem *item);
+    void emitDataChanged();
+
     void setupModelData(UAVObjectManager *objManager, bool categorize = true);
     QModelIndex index(TreeItem *item);
     void addDataObject(UAVDataObject *obj, bool categorize = true);
     MetaObjectTreeItem *addMetaObject(UAVMetaObject *obj, TreeItem *parent);
-    void addArrayField(UAVObjectField *field, TreeItem *parent);
-    void addSingleField(int index, UAVObjectField *field, TreeItem *parent);
+    TreeItem *addArrayField(UAVObjectField *field, TreeItem *parent);
+    TreeItem *addSingleField(int index, UAVObjectField *field, TreeItem *parent);
     void addInstance(UAVObject *obj, TreeItem *parent);
 
     TreeItem *createCategoryItems(QStringList categoryPath, TreeItem *root);
 
     QString updateMode(quint8 updateMode);
-    ObjectTreeItem *findObjectTreeItem(UAVObject *obj);
-    DataObjectTreeItem *findDataObjectTreeItem(UAVDataObject *obj);
-    MetaObjectTreeItem *findMetaObjectTreeItem(UAVMetaObject *obj);
 
     TreeItem *m_rootItem;
     TopTreeItem *m_settingsTree;
@@ -118,6 +135,19 @@ private:
 
     // Highlight manager to handle highlighting of tree items.
     HighLightManager *m_highlightManager;
+
+    // Tree item of every object and instance, and the items of their fields in field order
+    QHash<UAVObject *, ObjectTreeItem *> m_objectItems;
+    QHash<UAVObject *, QVector<TreeItem *> > m_fieldItems;
+
+    // Objects updated and items to repaint since the last refresh
+    QSet<UAVObject *> m_updatedObjects;
+    QSet<TreeItem *> m_changedItems;
+    QTimer m_refreshTimer;
+
+    // Packed data of the objects at the last refresh, only used by diffObjects()
+    QHash<UAVObject *, QByteArray> m_lastData;
+    QFutureWatcher<ObjectChanges> m_diffWatcher;
 };
 
 #endif // UAVOBJECTTREEMODEL_H
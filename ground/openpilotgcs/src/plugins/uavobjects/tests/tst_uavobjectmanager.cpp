@@ -0,0 +1,410 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_uavobjectmanager.cpp
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2013.
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVObjectsPlugin UAVObjects Plugin
+ * @{
+ * @brief Lookup and field read benchmark of the UAVObject manager
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <uavobjects/uavobjectmanager.h>
+#include <uavobjects/uavdataobject.h>
+#include <uavobjects/uavobjectfield.h>
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+
+/**
+ * A data object with a single field, stands in for the generated objects
+ */
+class BenchObject : public UAVDataObject {
+    Q_OBJECT
+
+public:
+    BenchObject(quint32 objId, bool isSingleInst) :
+        UAVDataObject(objId, isSingleInst, false, QString("BenchObject%1").arg(objId)), data(0)
+    {
+        QList<UAVObjectField *> fields;
+        fields.append(new UAVObjectField(QString("Value"), QString(""), UAVObjectField::UINT32, 1, QStringList()));
+        initializeFields(fields, (quint8 *)&data, sizeof(data));
+    }
+
+    Metadata getDefaultMetadata()
+    {
+        Metadata metadata;
+
+        memset(&metadata, 0, sizeof(metadata));
+        return metadata;
+    }
+
+    UAVDataObject *clone(quint32 instID)
+    {
+        BenchObject *obj = new BenchObject(getObjID(), isSingleInstance());
+
+        obj->initialize(instID, getMetaObject());
+        return obj;
+    }
+
+    UAVDataObject *dirtyClone()
+    {
+        return new BenchObject(getObjID(), isSingleInstance());
+    }
+
+    // What the generated typed getters do
+    quint32 getValue() const
+    {
+        return readSnapshot<quint32>(0);
+    }
+
+private:
+    quint32 data;
+};
+
+/**
+ * Unpacks new data into an object as fast as it can, like a busy telemetry link
+ */
+class BenchWriter : public QThread {
+public:
+    BenchWriter(UAVObject *obj) : obj(obj), stop(0) {}
+
+    void run()
+    {
+        quint32 value = 0;
+
+        while (stop == 0) {
+            ++value;
+            obj->unpack((const quint8 *)&value);
+        }
+    }
+
+    UAVObject *obj;
+    QAtomicInt stop;
+};
+
+class tst_UAVObjectManager : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void lookup();
+    void getObjectById();
+    void getObjectByName();
+    void getObjectInstance();
+    void getObjectInstances();
+    void scanByName();
+    void fieldRead();
+    void readGetValue();
+    void readGetDouble();
+    void readTypedGetter();
+    void readWhileUnpacking();
+
+private:
+    // About as many object types as the flight side defines
+    enum { NUM_TYPES = 120, NUM_INSTANCES = 16, LOOKUPS = 100000, READS = 1000000 };
+
+    UAVObjectManager *objMngr;
+    QList<quint32> objIds;
+    QStringList names;
+
+    void reportRate(const char *name, qint64 ns, int count);
+};
+
+void tst_UAVObjectManager::initTestCase()
+{
+    objMngr = new UAVObjectManager();
+
+    for (int n = 0; n < NUM_TYPES; ++n) {
+        quint32 objId = 0x10000000 + 2 * n;
+        QVERIFY(objMngr->registerObject(new BenchObject(objId, n != 0)));
+        objIds.append(objId);
+        names.append(QString("BenchObject%1").arg(objId));
+    }
+
+    // The first type is the multi instance one
+    UAVDataObject *multi = dynamic_cast<UAVDataObject *>(objMngr->getObject(objIds.first()));
+    QVERIFY(multi != NULL);
+    for (quint32 instId = 1; instId < NUM_INSTANCES; ++instId) {
+        QVERIFY(objMngr->registerObject(multi->clone(instId)));
+    }
+}
+
+void tst_UAVObjectManager::cleanupTestCase()
+{
+    delete objMngr;
+}
+
+void tst_UAVObjectManager::reportRate(const char *name, qint64 ns, int count)
+{
+    ns = qMax(ns, (qint64)1);
+    qDebug("%s: %.1f M/s, %.0f ns each", name,
+           (double)count * 1000.0 / ns, (double)ns / count);
+}
+
+/**
+ * Every registered object is found by ID and by name, missing ones are not
+ */
+void tst_UAVObjectManager::lookup()
+{
+    for (int n = 0; n < NUM_TYPES; ++n) {
+        UAVObject *obj = objMngr->getObject(objIds[n]);
+        QVERIFY(obj != NULL);
+        QCOMPARE(obj->getObjID(), objIds[n]);
+        QCOMPARE(objMngr->getObject(names[n]), obj);
+        QCOMPARE(objMngr->getNumInstances(objIds[n]), (qint32)(n == 0 ? NUM_INSTANCES : 1));
+        // The metaobject follows its object
+        QVERIFY(objMngr->getObject(objIds[n] + 1) != NULL);
+        QCOMPARE(objMngr->getObject(names[n] + "Meta"), objMngr->getObject(objIds[n] + 1));
+    }
+    for (quint32 instId = 0; instId < NUM_INSTANCES; ++instId) {
+        UAVObject *obj = objMngr->getObject(objIds.first(), instId);
+        QVERIFY(obj != NULL);
+        QCOMPARE(obj->getInstID(), instId);
+    }
+    QCOMPARE(objMngr->getObjectInstances(names.first()).length(), (int)NUM_INSTANCES);
+
+    QVERIFY(objMngr->getObject(objIds.first(), NUM_INSTANCES) == NULL);
+    QVERIFY(objMngr->getObject(objIds[1], 1) == NULL);
+    QVERIFY(objMngr->getObject(0x0BADF00D) == NULL);
+    QVERIFY(objMngr->getObject(QString("NoSuchObject")) == NULL);
+    QCOMPARE(objMngr->getNumInstances(0x0BADF00D), -1);
+    QVERIFY(objMngr->getObjectInstances(0x0BADF00D).isEmpty());
+}
+
+/**
+ * What the telemetry receiver does for every packet
+ */
+void tst_UAVObjectManager::getObjectById()
+{
+    QElapsedTimer timer;
+    UAVObject *obj = NULL;
+
+    QBENCHMARK {
+        for (int n = 0; n < NUM_TYPES; ++n) {
+            obj = objMngr->getObject(objIds[n]);
+        }
+    }
+    QVERIFY(obj != NULL);
+
+    timer.start();
+    for (int n = 0; n < LOOKUPS; ++n) {
+        obj = objMngr->getObject(objIds[n % NUM_TYPES]);
+    }
+    reportRate("getObject(objId)", timer.nsecsElapsed(), LOOKUPS);
+}
+
+/**
+ * What the gadgets do
+ */
+void tst_UAVObjectManager::getObjectByName()
+{
+    QElapsedTimer timer;
+    UAVObject *obj = NULL;
+
+    QBENCHMARK {
+        for (int n = 0; n < NUM_TYPES; ++n) {
+            obj = objMngr->getObject(names[n]);
+        }
+    }
+    QVERIFY(obj != NULL);
+
+    timer.start();
+    for (int n = 0; n < LOOKUPS; ++n) {
+        obj = objMngr->getObject(names[n % NUM_TYPES]);
+    }
+    reportRate("getObject(name)", timer.nsecsElapsed(), LOOKUPS);
+}
+
+void tst_UAVObjectManager::getObjectInstance()
+{
+    QElapsedTimer timer;
+    UAVObject *obj = NULL;
+
+    QBENCHMARK {
+        for (quint32 instId = 0; instId < NUM_INSTANCES; ++instId) {
+            obj = objMngr->getObject(objIds.first(), instId);
+        }
+    }
+    QVERIFY(obj != NULL);
+
+    timer.start();
+    for (int n = 0; n < LOOKUPS; ++n) {
+        obj = objMngr->getObject(objIds.first(), n % NUM_INSTANCES);
+    }
+    reportRate("getObject(objId, instId)", timer.nsecsElapsed(), LOOKUPS);
+}
+
+void tst_UAVObjectManager::getObjectInstances()
+{
+    QElapsedTimer timer;
+    int count = 0;
+
+    QBENCHMARK {
+        for (int n = 0; n < NUM_TYPES; ++n) {
+            count += objMngr->getObjectInstances(objIds[n]).length();
+        }
+    }
+    QVERIFY(count > 0);
+
+    timer.start();
+    for (int n = 0; n < LOOKUPS; ++n) {
+        count += objMngr->getObjectInstances(objIds[n % NUM_TYPES]).length();
+    }
+    reportRate("getObjectInstances(objId)", timer.nsecsElapsed(), LOOKUPS);
+}
+
+/**
+ * The name compare scan the manager used to do, for comparison
+ */
+void tst_UAVObjectManager::scanByName()
+{
+    QList< QList<UAVObject *> > objects = objMngr->getObjects();
+    QElapsedTimer timer;
+    UAVObject *obj = NULL;
+
+    timer.start();
+    for (int n = 0; n < LOOKUPS; ++n) {
+        const QString &name = names[n % NUM_TYPES];
+        for (int objidx = 0; objidx < objects.length(); ++objidx) {
+            if (objects[objidx][0]->getName().compare(name) == 0) {
+                obj = objects[objidx][0];
+                break;
+            }
+        }
+    }
+    QVERIFY(obj != NULL);
+    reportRate("linear scan by name", timer.nsecsElapsed(), LOOKUPS);
+}
+
+/**
+ * Every way of reading a field sees what was unpacked or set last
+ */
+void tst_UAVObjectManager::fieldRead()
+{
+    BenchObject *obj = dynamic_cast<BenchObject *>(objMngr->getObject(objIds[1]));
+    QVERIFY(obj != NULL);
+    UAVObjectField *field = obj->getField("Value");
+    quint32 value = 123456;
+
+    obj->unpack((const quint8 *)&value);
+    QCOMPARE(obj->getValue(), value);
+    QCOMPARE(field->getDouble(), 123456.0);
+    QCOMPARE(field->getValue().toUInt(), value);
+
+    field->setValue(42);
+    QCOMPARE(obj->getValue(), (quint32)42);
+    QCOMPARE(field->getDouble(), 42.0);
+    QCOMPARE(field->getDouble(1), 0.0);
+
+    field->clear();
+    QCOMPARE(obj->getValue(), (quint32)0);
+}
+
+/**
+ * How the gadgets used to read fields
+ */
+void tst_UAVObjectManager::readGetValue()
+{
+    UAVObjectField *field = objMngr->getObject(objIds[1])->getField("Value");
+    QElapsedTimer timer;
+    double sum = 0;
+
+    timer.start();
+    for (int n = 0; n < READS; ++n) {
+        sum += field->getValue().toDouble();
+    }
+    reportRate("UAVObjectField::getValue()", timer.nsecsElapsed(), READS);
+    QVERIFY(sum >= 0);
+}
+
+/**
+ * What the scope does for every sample
+ */
+void tst_UAVObjectManager::readGetDouble()
+{
+    UAVObjectField *field = objMngr->getObject(objIds[1])->getField("Value");
+    QElapsedTimer timer;
+    double sum = 0;
+
+    timer.start();
+    for (int n = 0; n < READS; ++n) {
+        sum += field->getDouble();
+    }
+    reportRate("UAVObjectField::getDouble()", timer.nsecsElapsed(), READS);
+    QVERIFY(sum >= 0);
+}
+
+void tst_UAVObjectManager::readTypedGetter()
+{
+    BenchObject *obj = dynamic_cast<BenchObject *>(objMngr->getObject(objIds[1]));
+    QElapsedTimer timer;
+    quint32 sum = 0;
+
+    QVERIFY(obj != NULL);
+    timer.start();
+    for (int n = 0; n < READS; ++n) {
+        sum += obj->getValue();
+    }
+    reportRate("typed getter", timer.nsecsElapsed(), READS);
+    QVERIFY(sum == (quint32)READS * obj->getValue());
+}
+
+/**
+ * Readers are not held up by the mutex while another thread unpacks,
+ * and the values they see only go forward
+ */
+void tst_UAVObjectManager::readWhileUnpacking()
+{
+    BenchObject *obj = dynamic_cast<BenchObject *>(objMngr->getObject(objIds[2]));
+    QVERIFY(obj != NULL);
+    UAVObjectField *field = obj->getField("Value");
+    BenchWriter writer(obj);
+    QElapsedTimer timer;
+    quint32 last = 0;
+    bool ordered = true;
+    double sum   = 0;
+
+    writer.start();
+
+    timer.start();
+    for (int n = 0; n < READS; ++n) {
+        sum += field->getValue().toDouble();
+    }
+    reportRate("getValue() while unpacking", timer.nsecsElapsed(), READS);
+
+    timer.start();
+    for (int n = 0; n < READS; ++n) {
+        quint32 value = obj->getValue();
+        ordered = ordered && value >= last;
+        last    = value;
+    }
+    reportRate("typed getter while unpacking", timer.nsecsElapsed(), READS);
+
+    writer.stop.fetchAndStoreOrdered(1);
+    writer.wait();
+    QVERIFY(ordered);
+    QVERIFY(sum >= 0);
+}
+
+QTEST_MAIN(tst_UAVObjectManager)
+
+#include "tst_uavobjectmanager.moc"
@@ -0,0 +1,17 @@
+# -------------------------------------------------
+# UAVObjectManager lookup and field read benchmark, run from the build directory
+# with the GCS plugin directory in the library path.
+# -------------------------------------------------
+include(../../../../openpilotgcs.pri)
+
+CONFIG += qtestlib
+CONFIG += console
+CONFIG -= app_bundle
+TEMPLATE = app
+TARGET = uavobjectmanagertest
+
+INCLUDEPATH += $$GCS_SOURCE_TREE/src/plugins
+LIBS += -L$$GCS_PLUGIN_PATH/OpenPilot
+include(../uavobjects.pri)
+
+SOURCES += tst_uavobjectmanager.cpp
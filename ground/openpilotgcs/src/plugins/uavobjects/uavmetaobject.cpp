@@ -50,6 +50,7 @@ UAVMetaObject::UAVMetaObject(quint32 objID, const QString & name, UAVObject *par
     UAVObject::initializeFields(fields, (quint8 *)&parentMetadata, sizeof(Metadata));
     // Setup metadata of parent
     parentMetadata = parent->getDefaultMetadata();
+    publishSnapshot();
 }
 
 /**
@@ -94,6 +95,7 @@ void UAVMetaObject::setData(const Metadata & mdata)
     QMutexLocker locker(mutex);
 
     parentMetadata = mdata;
+    publishSnapshot();
     emit objectUpdatedAuto(this); // trigger object updated event
     emit objectUpdated(this);
 }
@@ -27,6 +27,7 @@
  */
 #include "uavobject.h"
 #include <QtEndian>
+#include <QThread>
 #include <QDebug>
 
 // Constants
@@ -54,6 +55,14 @@ UAVObject::UAVObject(quint32 objID, bool isSingleInst, const QString & name)
     this->isSingleInst = isSingleInst;
     this->name   = name;
     this->mutex  = new QMutex(QMutex::Recursive);
+    this->numBytes = 0;
+    this->data     = NULL;
+    this->snapshot = NULL;
+}
+
+UAVObject::~UAVObject()
+{
+    delete[] snapshot;
 }
 
 /**
@@ -86,6 +95,25 @@ void UAVObject::initializeFields(QList<UAVObjectField *> & fields, quint8 *data,
         offset += fields[n]->getNumBytes();
         connect(fields[n], SIGNAL(fieldUpdated(UAVObjectField *)), this, SLOT(fieldUpdated(UAVObjectField *)));
     }
+    // Room for the two snapshots read by the lock free getters
+    delete[] snapshot;
+    snapshot = new quint8[2 * numBytes];
+    memset(snapshot, 0, 2 * numBytes);
+    publishSnapshot();
+}
+
+/**
+ * Copy the object data to the snapshot read by the lock free getters.
+ * Must be called with the mutex held every time the data is changed.
+ * The data is copied to the snapshot readers are not using and the
+ * sequence number then switches them over to it.
+ */
+void UAVObject::publishSnapshot()
+{
+    int next = snapshotSeq + 1;
+
+    memcpy(&snapshot[(next & 1) * numBytes], data, numBytes);
+    snapshotSeq.fetchAndStoreOrdered(next);
 }
 
 /**
@@ -288,12 +316,31 @@ qint32 UAVObject::unpack(const quint8 *dataIn)
         fields[n]->unpack(&dataIn[offset]);
         offset += fields[n]->getNumBytes();
     }
-    emit objectUnpacked(this); // trigger object updated event
-    emit objectUpdated(this);
+    publishSnapshot();
+    // Emitted for every unpack in the thread unpacking, with the mutex held. The consumers
+    // that record each update connect to it directly and copy the data right away.
+    emit objectUnpacked(this);
+    if (QThread::currentThread() == thread()) {
+        emit objectUpdated(this);
+    } else if (updatePending.testAndSetOrdered(0, 1)) {
+        // Unpacked by the telemetry thread, the updates until the thread of the object
+        // gets to the notification are coalesced into one
+        QMetaObject::invokeMethod(this, "notifyUpdated", Qt::QueuedConnection);
+    }
 
     return numBytes;
 }
 
+/**
+ * Queued notification of the unpacks done by another thread
+ */
+void UAVObject::notifyUpdated()
+{
+    // An unpack from now on queues another notification
+    updatePending.fetchAndStoreOrdered(0);
+    emit objectUpdated(this);
+}
+
 /**
  * Save the object data to the file.
  * The file will be created in the current directory
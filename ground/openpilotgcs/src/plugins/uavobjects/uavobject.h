@@ -33,10 +33,12 @@
 #include <QObject>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QAtomicInt>
 #include <QString>
 #include <QList>
 #include <QFile>
 #include <stdint.h>
+#include <string.h>
 #include "uavobjectfield.h"
 
 #define UAVOBJ_ACCESS_SHIFT                    0
@@ -97,6 +99,7 @@ public:
 
 
     UAVObject(quint32 objID, bool isSingleInst, const QString & name);
+    ~UAVObject();
     void initialize(quint32 instID);
     quint32 getObjID();
     quint32 getInstID();
@@ -158,6 +161,17 @@ signals:
 
 private slots:
     void fieldUpdated(UAVObjectField *field);
+    void notifyUpdated();
+
+private:
+    friend class UAVObjectField;
+
+    // Set while the objectUpdated() notification of an unpack by another thread is queued
+    QAtomicInt updatePending;
+
+    // Two copies of the data, the one selected by the low bit of snapshotSeq is the current one
+    quint8 *snapshot;
+    mutable QAtomicInt snapshotSeq;
 
 protected:
     quint32 objID;
@@ -172,6 +186,25 @@ protected:
     QList<UAVObjectField *> fields;
 
     void initializeFields(QList<UAVObjectField *> & fields, quint8 *data, quint32 numBytes);
+    void publishSnapshot();
+
+    /**
+     * Read a value at the given byte offset of the object data without taking the mutex.
+     * The value comes from the last published snapshot of the data, the read is retried
+     * if a publish overtakes it.
+     */
+    template<typename T>
+    T readSnapshot(quint32 offset) const
+    {
+        T value;
+        int seq;
+
+        do {
+            seq = snapshotSeq.fetchAndAddAcquire(0);
+            memcpy(&value, &snapshot[(seq & 1) * numBytes + offset], sizeof(T));
+        } while (!snapshotSeq.testAndSetOrdered(seq, seq));
+        return value;
+    }
     void setDescription(const QString & description);
     void setCategory(const QString & category);
 };
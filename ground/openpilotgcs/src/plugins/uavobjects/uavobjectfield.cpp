@@ -601,6 +601,7 @@ void UAVObjectField::clear()
         memset(&data[offset], 0, numBytesPerElement * numElements);
         break;
     }
+    obj->publishSnapshot();
 }
 
 QString UAVObjectField::getName()
@@ -1111,12 +1112,45 @@ void UAVObjectField::setValue(const QVariant & value, quint32 index)
             break;
         }
         }
+        obj->publishSnapshot();
     }
 }
 
+/**
+ * Get a numeric element as a double. The element is read from the snapshot
+ * of the object data, without the mutex and without going through a QVariant.
+ */
 double UAVObjectField::getDouble(quint32 index)
 {
-    return getValue(index).toDouble();
+    if (index >= numElements) {
+        return 0.0;
+    }
+    quint32 elementOffset = offset + numBytesPerElement * index;
+    switch (type) {
+    case INT8:
+        return obj->readSnapshot<qint8>(elementOffset);
+
+    case INT16:
+        return obj->readSnapshot<qint16>(elementOffset);
+
+    case INT32:
+        return obj->readSnapshot<qint32>(elementOffset);
+
+    case UINT8:
+        return obj->readSnapshot<quint8>(elementOffset);
+
+    case UINT16:
+        return obj->readSnapshot<quint16>(elementOffset);
+
+    case UINT32:
+        return obj->readSnapshot<quint32>(elementOffset);
+
+    case FLOAT32:
+        return obj->readSnapshot<float>(elementOffset);
+
+    default:
+        return getValue(index).toDouble();
+    }
 }
 
 void UAVObjectField::setDouble(double value, quint32 index)
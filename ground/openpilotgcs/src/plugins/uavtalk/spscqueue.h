@@ -0,0 +1,98 @@
+/**
+ ******************************************************************************
+ *
+ * @file       spscqueue.h
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2013.
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Lock free queue between one producer and one consumer thread
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <QAtomicInt>
+
+/**
+ * Fixed size ring of SIZE - 1 items, SIZE must be a power of two.
+ * The producer fills the item returned by back() in place and publishes it with
+ * push(), the consumer reads the item returned by front() in place and releases
+ * it with pop(). Each index is only written by its own side, the release of one
+ * side is paired with the acquire of the other, no lock is taken.
+ */
+template<typename T, int SIZE>
+class SPSCQueue {
+public:
+    SPSCQueue() : head(0), tail(0) {}
+
+    /**
+     * Producer: the free item to fill, NULL if the queue is full
+     */
+    T *back()
+    {
+        int t = tail;
+
+        if (((t + 1) & MASK) == head.fetchAndAddAcquire(0)) {
+            return NULL;
+        }
+        return &items[t];
+    }
+
+    /**
+     * Producer: hand the item returned by back() to the consumer
+     */
+    void push()
+    {
+        tail.fetchAndStoreRelease((tail + 1) & MASK);
+    }
+
+    /**
+     * Consumer: the oldest item, NULL if the queue is empty
+     */
+    T *front()
+    {
+        int h = head;
+
+        if (h == tail.fetchAndAddAcquire(0)) {
+            return NULL;
+        }
+        return &items[h];
+    }
+
+    /**
+     * Consumer: give the item returned by front() back to the producer
+     */
+    void pop()
+    {
+        head.fetchAndStoreRelease((head + 1) & MASK);
+    }
+
+private:
+    static const int MASK = SIZE - 1;
+    static const int CACHE_LINE = 64;
+
+    // The indexes are on their own cache lines so that the two sides do not share one
+    QAtomicInt head;
+    char headPadding[CACHE_LINE - sizeof(QAtomicInt)];
+    QAtomicInt tail;
+    char tailPadding[CACHE_LINE - sizeof(QAtomicInt)];
+    T items[SIZE];
+};
+
+#endif // SPSCQUEUE_H
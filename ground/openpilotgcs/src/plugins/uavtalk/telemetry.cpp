@@ -66,7 +66,7 @@ Telemetry::Telemetry(UAVTalk *utalk, UAVObjectManager *objMngr)
 
 Telemetry::~Telemetry()
 {
-    for (QMap<quint32, ObjectTransactionInfo *>::iterator itr = transMap.begin(); itr != transMap.end(); ++itr) {
+    for (QMap<quint64, ObjectTransactionInfo *>::iterator itr = transMap.begin(); itr != transMap.end(); ++itr) {
         delete itr.value();
     }
 }
@@ -211,15 +211,18 @@ void Telemetry::updateObject(UAVObject *obj, quint32 eventType)
  */
 void Telemetry::transactionCompleted(UAVObject *obj, bool success)
 {
-    // Lookup the transaction in the transaction map.
-    quint32 objId = obj->getObjID();
+    // Lookup the transaction in the transaction map, first on the instance then on all instances.
+    quint64 key = UAVTalk::transactionKey(obj, false);
 
-    QMap<quint32, ObjectTransactionInfo *>::iterator itr = transMap.find(objId);
+    QMap<quint64, ObjectTransactionInfo *>::iterator itr = transMap.find(key);
+    if (itr == transMap.end() && !obj->isSingleInstance()) {
+        itr = transMap.find(UAVTalk::transactionKey(obj, true));
+    }
     if (itr != transMap.end()) {
         ObjectTransactionInfo *transInfo = itr.value();
         // Remove this transaction as it's complete.
         transInfo->timer->stop();
-        transMap.remove(objId);
+        transMap.erase(itr);
         delete transInfo;
         // Send signal
         obj->emitTransactionCompleted(success);
@@ -245,11 +248,11 @@ void Telemetry::transactionTimeout(ObjectTransactionInfo *transInfo)
         // Stop the timer.
         transInfo->timer->stop();
         // Terminate transaction
-        utalk->cancelTransaction(transInfo->obj);
+        utalk->cancelTransaction(transInfo->obj, transInfo->allInstances);
         // Send signal
         transInfo->obj->emitTransactionCompleted(false);
         // Remove this transaction as it's complete.
-        transMap.remove(transInfo->obj->getObjID());
+        transMap.remove(UAVTalk::transactionKey(transInfo->obj, transInfo->allInstances));
         delete transInfo;
         // Process new object updates from queue
         processObjectQueue();
@@ -273,7 +276,7 @@ void Telemetry::processObjectTransaction(ObjectTransactionInfo *transInfo)
         transInfo->timer->start(REQ_TIMEOUT_MS);
     } else {
         // Otherwise, remove this transaction as it's complete.
-        transMap.remove(transInfo->obj->getObjID());
+        transMap.remove(UAVTalk::transactionKey(transInfo->obj, transInfo->allInstances));
         delete transInfo;
     }
 }
@@ -311,71 +314,65 @@ void Telemetry::processObjectUpdates(UAVObject *obj, EventMask event, bool allIn
 }
 
 /**
- * Process events from the object queue
+ * Process events from the object queue. Up to MAX_OUTSTANDING_TRANSACTIONS
+ * transactions are kept in flight, the queue is processed again each time
+ * one of them completes.
  */
 void Telemetry::processObjectQueue()
 {
-    // Get object information from queue (first the priority and then the regular queue)
-    ObjectQueueInfo objInfo;
-
-    if (!objPriorityQueue.isEmpty()) {
-        objInfo = objPriorityQueue.dequeue();
-    } else if (!objQueue.isEmpty()) {
-        objInfo = objQueue.dequeue();
-    } else {
-        return;
-    }
-
-    // Check if a connection has been established, only process GCSTelemetryStats updates
-    // (used to establish the connection)
-    GCSTelemetryStats::DataFields gcsStats = gcsStatsObj->getData();
-    if (gcsStats.Status != GCSTelemetryStats::STATUS_CONNECTED) {
-        objQueue.clear();
-        if (objInfo.obj->getObjID() != GCSTelemetryStats::OBJID && objInfo.obj->getObjID() != OPLinkSettings::OBJID && objInfo.obj->getObjID() != ObjectPersistence::OBJID) {
-            objInfo.obj->emitTransactionCompleted(false);
+    while (transMap.size() < MAX_OUTSTANDING_TRANSACTIONS) {
+        // Get object information from queue (first the priority and then the regular queue)
+        ObjectQueueInfo objInfo;
+
+        if (!objPriorityQueue.isEmpty()) {
+            objInfo = objPriorityQueue.dequeue();
+        } else if (!objQueue.isEmpty()) {
+            objInfo = objQueue.dequeue();
+        } else {
             return;
         }
-    }
 
-    // Setup transaction (skip if unpack event)
-    UAVObject::Metadata metadata     = objInfo.obj->getMetadata();
-    UAVObject::UpdateMode updateMode = UAVObject::GetGcsTelemetryUpdateMode(metadata);
-    if ((objInfo.event != EV_UNPACKED) && ((objInfo.event != EV_UPDATED_PERIODIC) || (updateMode != UAVObject::UPDATEMODE_THROTTLED))) {
-        QMap<quint32, ObjectTransactionInfo *>::iterator itr = transMap.find(objInfo.obj->getObjID());
-        if (itr != transMap.end()) {
-            qDebug() << "!!!!!! Making request for an object: " << objInfo.obj->getName() << " for which a request is already in progress!!!!!!";
+        // Check if a connection has been established, only process GCSTelemetryStats updates
+        // (used to establish the connection)
+        GCSTelemetryStats::DataFields gcsStats = gcsStatsObj->getData();
+        if (gcsStats.Status != GCSTelemetryStats::STATUS_CONNECTED) {
+            objQueue.clear();
+            if (objInfo.obj->getObjID() != GCSTelemetryStats::OBJID && objInfo.obj->getObjID() != OPLinkSettings::OBJID && objInfo.obj->getObjID() != ObjectPersistence::OBJID) {
+                objInfo.obj->emitTransactionCompleted(false);
+                continue;
+            }
         }
+
+        // Setup transaction (skip if unpack event)
         UAVObject::Metadata metadata     = objInfo.obj->getMetadata();
-        ObjectTransactionInfo *transInfo = new ObjectTransactionInfo(this);
-        transInfo->obj   = objInfo.obj;
-        transInfo->allInstances = objInfo.allInstances;
-        transInfo->retriesRemaining = MAX_RETRIES;
-        transInfo->acked = UAVObject::GetGcsTelemetryAcked(metadata);
-        if (objInfo.event == EV_UPDATED || objInfo.event == EV_UPDATED_MANUAL || objInfo.event == EV_UPDATED_PERIODIC) {
-            transInfo->objRequest = false;
-        } else if (objInfo.event == EV_UPDATE_REQ) {
-            transInfo->objRequest = true;
+        UAVObject::UpdateMode updateMode = UAVObject::GetGcsTelemetryUpdateMode(metadata);
+        if ((objInfo.event != EV_UNPACKED) && ((objInfo.event != EV_UPDATED_PERIODIC) || (updateMode != UAVObject::UPDATEMODE_THROTTLED))) {
+            // A transaction already in progress on the same instance is restarted with the new event
+            quint64 key = UAVTalk::transactionKey(objInfo.obj, objInfo.allInstances);
+            ObjectTransactionInfo *transInfo = transMap.value(key);
+            if (transInfo != NULL) {
+                transInfo->timer->stop();
+            } else {
+                transInfo = new ObjectTransactionInfo(this);
+                transInfo->telem = this;
+                // Insert the transaction into the transaction map.
+                transMap.insert(key, transInfo);
+            }
+            transInfo->obj = objInfo.obj;
+            transInfo->allInstances     = objInfo.allInstances;
+            transInfo->retriesRemaining = MAX_RETRIES;
+            transInfo->acked = UAVObject::GetGcsTelemetryAcked(metadata);
+            transInfo->objRequest = (objInfo.event == EV_UPDATE_REQ);
+            processObjectTransaction(transInfo);
         }
-        transInfo->telem = this;
-        // Insert the transaction into the transaction map.
-        transMap.insert(objInfo.obj->getObjID(), transInfo);
-        processObjectTransaction(transInfo);
-    }
 
-    // If this is a metaobject then make necessary telemetry updates
-    UAVMetaObject *metaobj = dynamic_cast<UAVMetaObject *>(objInfo.obj);
-    if (metaobj != NULL) {
-        updateObject(metaobj->getParentObject(), EV_NONE);
-    } else if (updateMode != UAVObject::UPDATEMODE_THROTTLED) {
-        updateObject(objInfo.obj, objInfo.event);
-    }
-
-    // The fact we received an unpacked event does not mean that
-    // we do not have additional objects still in the queue,
-    // so we have to reschedule queue processing to make sure they are not
-    // stuck:
-    if (objInfo.event == EV_UNPACKED) {
-        processObjectQueue();
+        // If this is a metaobject then make necessary telemetry updates
+        UAVMetaObject *metaobj = dynamic_cast<UAVMetaObject *>(objInfo.obj);
+        if (metaobj != NULL) {
+            updateObject(metaobj->getParentObject(), EV_NONE);
+        } else if (updateMode != UAVObject::UPDATEMODE_THROTTLED) {
+            updateObject(objInfo.obj, objInfo.event);
+        }
     }
 }
 
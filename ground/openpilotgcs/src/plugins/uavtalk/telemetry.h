@@ -84,7 +84,8 @@ private:
     static const int MAX_RETRIES    = 2;
     static const int MAX_UPDATE_PERIOD_MS = 1000;
     static const int MIN_UPDATE_PERIOD_MS = 1;
-    static const int MAX_QUEUE_SIZE = 20;
+    static const int MAX_QUEUE_SIZE = 64;
+    static const int MAX_OUTSTANDING_TRANSACTIONS = 8;
 
     // Types
     /**
@@ -118,7 +119,7 @@ private:
     QList<ObjectTimeInfo> objList;
     QQueue<ObjectQueueInfo> objQueue;
     QQueue<ObjectQueueInfo> objPriorityQueue;
-    QMap<quint32, ObjectTransactionInfo *>transMap;
+    QMap<quint64, ObjectTransactionInfo *>transMap;
     QMutex *mutex;
     QTimer *updateTimer;
     QTimer *statsTimer;
@@ -40,7 +40,8 @@ TelemetryManager::TelemetryManager() :
 
     // connect to start stop signals
     connect(this, SIGNAL(myStart()), this, SLOT(onStart()), Qt::QueuedConnection);
-    connect(this, SIGNAL(myStop()), this, SLOT(onStop()), Qt::QueuedConnection);
+    // The device is closed once stop() returns, UAVTalk must be done with it by then
+    connect(this, SIGNAL(myStop()), this, SLOT(onStop()), Qt::BlockingQueuedConnection);
 }
 
 TelemetryManager::~TelemetryManager()
@@ -60,6 +61,7 @@ void TelemetryManager::start(QIODevice *dev)
 void TelemetryManager::onStart()
 {
     utalk        = new UAVTalk(device, objMngr);
+    utalk->startInputThread();
     telemetry    = new Telemetry(utalk, objMngr);
     telemetryMon = new TelemetryMonitor(objMngr, telemetry);
     connect(telemetryMon, SIGNAL(connected()), this, SLOT(onConnect()));
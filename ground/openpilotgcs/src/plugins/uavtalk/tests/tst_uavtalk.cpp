@@ -0,0 +1,530 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_uavtalk.cpp
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2013.
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Receive tests and throughput benchmark of the UAVTalk protocol plugin
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <uavtalk/uavtalk.h>
+#include <uavobjects/uavobjectmanager.h>
+#include <uavobjects/uavdataobject.h>
+#include <uavobjects/uavobjectfield.h>
+
+#include <QtCore/QBuffer>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSet>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+
+/**
+ * A data object made of a float array, stands in for the generated objects
+ */
+class BenchObject : public UAVDataObject {
+    Q_OBJECT
+
+public:
+    static const int MAX_FLOATS = 60;
+
+    BenchObject(quint32 objId, bool isSingleInst, int numFloats) :
+        UAVDataObject(objId, isSingleInst, false, QString("BenchObject%1").arg(objId)), numFloats(numFloats)
+    {
+        QList<UAVObjectField *> fields;
+        fields.append(new UAVObjectField(QString("Values"), QString(""), UAVObjectField::FLOAT32, numFloats, QStringList()));
+        memset(data, 0, sizeof(data));
+        initializeFields(fields, (quint8 *)data, numFloats * sizeof(float));
+    }
+
+    Metadata getDefaultMetadata()
+    {
+        Metadata metadata;
+
+        memset(&metadata, 0, sizeof(metadata));
+        return metadata;
+    }
+
+    UAVDataObject *clone(quint32 instID)
+    {
+        BenchObject *obj = new BenchObject(getObjID(), isSingleInstance(), numFloats);
+
+        obj->initialize(instID, getMetaObject());
+        return obj;
+    }
+
+    UAVDataObject *dirtyClone()
+    {
+        return new BenchObject(getObjID(), isSingleInstance(), numFloats);
+    }
+
+private:
+    int numFloats;
+    float data[MAX_FLOATS];
+};
+
+/**
+ * A buffer handing out at most chunkSize bytes per read, a chunk size of 1 is
+ * what the receiver used to do on every device.
+ */
+class ChunkedBuffer : public QBuffer {
+public:
+    ChunkedBuffer(qint64 chunkSize) : chunkSize(chunkSize) {}
+
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    {
+        return QBuffer::readData(data, qMin(maxSize, chunkSize));
+    }
+
+private:
+    qint64 chunkSize;
+};
+
+/**
+ * Counts the update notifications delivered to the thread it lives in, all the
+ * unpacks, and those done in that thread or in the one of UAVTalk rather than
+ * the input thread
+ */
+class UpdateCounter : public QObject {
+    Q_OBJECT
+
+public:
+    UpdateCounter(QThread *talkThread) : notifications(0), talkThread(talkThread) {}
+
+    int notifications;
+    QSet<UAVObject *> objects;
+    QAtomicInt unpacks;
+    QAtomicInt misplacedUnpacks;
+
+public slots:
+    void objectUpdated(UAVObject *obj)
+    {
+        ++notifications;
+        objects.insert(obj);
+    }
+
+    // Connected directly, called in the thread unpacking
+    void objectUnpacked(UAVObject *)
+    {
+        unpacks.ref();
+        if (QThread::currentThread() == thread() || QThread::currentThread() == talkThread) {
+            misplacedUnpacks.ref();
+        }
+    }
+
+private:
+    QThread *talkThread;
+};
+
+class tst_UAVTalk : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void receive_data();
+    void receive();
+    void receiveAggregate();
+    void receiveDelta();
+    void receiveThreaded();
+    void throughput_data();
+    void throughput();
+
+private:
+    static const int STREAM_REPETITIONS = 200;
+    static const int THROUGHPUT_PASSES  = 20;
+    static const int THREADED_TIMEOUT_MS = 10000;
+    // Time the test thread spends away from its event loop, as a GUI busy rendering
+    static const int THREADED_BUSY_MS    = 20;
+
+    UAVObjectManager *objMngr;
+    QByteArray stream;
+    quint32 streamObjects;
+
+    void addChunkSizes();
+    void receiveStream(UAVTalk *talk, ChunkedBuffer *device);
+    static QByteArray packet(quint8 type, quint32 objId, const QByteArray &payload);
+    static QByteArray aggregatePacket(const QByteArray &payload);
+    static QByteArray offerPacket(quint8 flags, quint8 known, quint8 knownCrc, const QList<quint32> &table);
+    static quint8 crc8(quint8 crc, const QByteArray &data);
+    static QByteArray deltaPayload(quint8 seq, const QByteArray &keyframe, const QByteArray &data);
+    static QByteArray floats(float firstValue, int numFloats);
+    static void appendEntry(QByteArray &payload, quint8 index, int instId, float firstValue, int numFloats);
+};
+
+void tst_UAVTalk::initTestCase()
+{
+    // A mix of small and large single instance objects and a multi instance one
+    static const int objectFloats[] = { 3, 4, 10, 13, 27, 60 };
+
+    objMngr = new UAVObjectManager();
+    for (quint32 n = 0; n < sizeof(objectFloats) / sizeof(objectFloats[0]); ++n) {
+        QVERIFY(objMngr->registerObject(new BenchObject(0x1000 + 2 * n, true, objectFloats[n])));
+    }
+    BenchObject *multi = new BenchObject(0x2000, false, 8);
+    QVERIFY(objMngr->registerObject(multi));
+    for (quint32 instId = 1; instId < 8; ++instId) {
+        QVERIFY(objMngr->registerObject(multi->clone(instId)));
+    }
+
+    // Build the stream with a transmitting instance of the protocol
+    QBuffer txDevice(&stream);
+    txDevice.open(QIODevice::WriteOnly);
+    UAVTalk tx(&txDevice, objMngr);
+    QList< QList<UAVObject *> > objects = objMngr->getObjects();
+    for (int n = 0; n < STREAM_REPETITIONS; ++n) {
+        foreach(QList<UAVObject *> instances, objects) {
+            foreach(UAVObject * obj, instances) {
+                QVERIFY(tx.sendObject(obj, false, false));
+            }
+        }
+        // Some line noise between the packets
+        txDevice.write("\x00\xff\x3c\x00", 4);
+    }
+    streamObjects = tx.getStats().txObjects;
+}
+
+void tst_UAVTalk::cleanupTestCase()
+{
+    delete objMngr;
+}
+
+void tst_UAVTalk::addChunkSizes()
+{
+    QTest::addColumn<int>("chunkSize");
+
+    QTest::newRow("1 byte") << 1;
+    QTest::newRow("64 bytes") << 64;
+    QTest::newRow("all") << stream.size();
+}
+
+void tst_UAVTalk::receiveStream(UAVTalk *talk, ChunkedBuffer *device)
+{
+    device->seek(0);
+    QMetaObject::invokeMethod(talk, "processInputStream", Qt::DirectConnection);
+}
+
+void tst_UAVTalk::receive_data()
+{
+    addChunkSizes();
+}
+
+/**
+ * Every packet is received whatever the size of the reads
+ */
+void tst_UAVTalk::receive()
+{
+    QFETCH(int, chunkSize);
+
+    ChunkedBuffer device(chunkSize);
+    device.setData(stream);
+    device.open(QIODevice::ReadOnly);
+    UAVTalk rx(&device, objMngr);
+
+    receiveStream(&rx, &device);
+
+    UAVTalk::ComStats stats = rx.getStats();
+    QCOMPARE(stats.rxObjects, streamObjects);
+    QCOMPARE(stats.rxBytes, (quint32)stream.size());
+    QCOMPARE(stats.rxErrors, (quint32)0);
+}
+
+/**
+ * A packet of a single instance object, as the flight side sends them
+ */
+QByteArray tst_UAVTalk::packet(quint8 type, quint32 objId, const QByteArray &payload)
+{
+    QByteArray packet;
+    quint8 header[8] = { 0x3c, type, 0, 0, 0, 0, 0, 0 };
+
+    qToLittleEndian<quint16>(sizeof(header) + payload.size(), &header[2]);
+    qToLittleEndian<quint32>(objId, &header[4]);
+    packet.append((const char *)header, sizeof(header));
+    packet.append(payload);
+    packet.append((char)crc8(0, packet));
+    return packet;
+}
+
+/**
+ * CRC-8, polynomial 0x07
+ */
+quint8 tst_UAVTalk::crc8(quint8 crc, const QByteArray &data)
+{
+    foreach(char c, data) {
+        crc ^= (quint8)c;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? (quint8)((crc << 1) ^ 0x07) : (quint8)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * A packet of the aggregate type with the given payload
+ */
+QByteArray tst_UAVTalk::aggregatePacket(const QByteArray &payload)
+{
+    return packet(0x25, 0xffffffff, payload);
+}
+
+/**
+ * An aggregate offer holding a whole table of object indexes
+ */
+QByteArray tst_UAVTalk::offerPacket(quint8 flags, quint8 known, quint8 knownCrc, const QList<quint32> &table)
+{
+    QByteArray payload;
+
+    payload.append((char)flags);
+    payload.append((char)known);
+    payload.append((char)knownCrc);
+    payload.append((char)0); // first entry
+    foreach(quint32 objId, table) {
+        quint8 id[4];
+        qToLittleEndian<quint32>(objId, id);
+        payload.append((const char *)id, sizeof(id));
+    }
+    return packet(0x25, 0xfffffffe, payload);
+}
+
+/**
+ * The payload of a delta packet: the keyframe sequence number and the runs of
+ * unchanged and changed bytes of data against the keyframe
+ */
+QByteArray tst_UAVTalk::deltaPayload(quint8 seq, const QByteArray &keyframe, const QByteArray &data)
+{
+    QByteArray payload(1, (char)seq);
+    int offset = 0;
+
+    while (offset < data.size()) {
+        bool unchanged = (keyframe[offset] == data[offset]);
+        int run = 0;
+        while (offset + run < data.size() && run < 128 && (keyframe[offset + run] == data[offset + run]) == unchanged) {
+            ++run;
+        }
+        if (unchanged) {
+            payload.append((char)(0x80 | (run - 1)));
+        } else {
+            payload.append((char)(run - 1));
+            for (int n = 0; n < run; ++n) {
+                payload.append((char)(keyframe[offset + n] ^ data[offset + n]));
+            }
+        }
+        offset += run;
+    }
+    return payload;
+}
+
+/**
+ * The data of a BenchObject holding consecutive values
+ */
+QByteArray tst_UAVTalk::floats(float firstValue, int numFloats)
+{
+    QByteArray data;
+
+    for (int n = 0; n < numFloats; ++n) {
+        float value = firstValue + n;
+        data.append((const char *)&value, sizeof(value));
+    }
+    return data;
+}
+
+/**
+ * Append the entry of an object to an aggregate payload, instId is -1 for single instance objects
+ */
+void tst_UAVTalk::appendEntry(QByteArray &payload, quint8 index, int instId, float firstValue, int numFloats)
+{
+    quint8 header[3];
+    int headerLength = (instId < 0) ? 1 : 3;
+
+    header[0] = index;
+    if (instId >= 0) {
+        qToLittleEndian<quint16>((quint16)instId, &header[1]);
+    }
+    payload.append((const char *)header, headerLength);
+    payload.append(floats(firstValue, numFloats));
+}
+
+/**
+ * The table of an aggregate offer is acknowledged up to the first object which
+ * is not known, and the objects of aggregate packets are unpacked by their index
+ */
+void tst_UAVTalk::receiveAggregate()
+{
+    QList<quint32> table;
+    QByteArray payload;
+    QByteArray unknown;
+
+    table << 0x1000 << 0 << 0x2000 << 0x1ffe << 0x1002;
+    appendEntry(payload, 0, -1, 100.0f, 3);
+    appendEntry(payload, 2, 3, 300.0f, 8);
+    // An entry of an object the GCS does not know drops the rest of its packet
+    appendEntry(unknown, 3, -1, 200.0f, 5);
+    appendEntry(unknown, 4, -1, 400.0f, 4);
+    QByteArray stream = offerPacket(0x01 | 0x04, 0, 0, table) + aggregatePacket(payload) + aggregatePacket(unknown);
+
+    ChunkedBuffer device(16);
+    device.setData(stream);
+    device.open(QIODevice::ReadWrite);
+    UAVTalk rx(&device, objMngr);
+
+    receiveStream(&rx, &device);
+
+    QCOMPARE(objMngr->getObject(0x1000)->getField("Values")->getDouble(2), 102.0);
+    QCOMPARE(objMngr->getObject(0x2000, 3)->getField("Values")->getDouble(7), 307.0);
+    QCOMPARE(objMngr->getObject(0x2000, 2)->getField("Values")->getDouble(7), 0.0);
+    QVERIFY(objMngr->getObject(0x1002)->getField("Values")->getDouble(0) != 400.0);
+    UAVTalk::ComStats stats = rx.getStats();
+    QCOMPARE(stats.rxObjects, (quint32)3);
+    QCOMPARE(stats.rxErrors, (quint32)0);
+
+    // The answer to the offer acknowledges the first three entries and accepts delta packets too,
+    // it is written after the received stream
+    QByteArray known;
+    for (int n = 0; n < 3; ++n) {
+        quint8 id[4];
+        qToLittleEndian<quint32>(table[n], id);
+        known.append((const char *)id, sizeof(id));
+    }
+    QCOMPARE(device.data().mid(stream.size()), offerPacket(0x02 | 0x04, 3, crc8(0, known), QList<quint32>()));
+}
+
+/**
+ * A delta packet is applied to the last keyframe of the object, a delta of
+ * another keyframe is dropped and answered with a NACK
+ */
+void tst_UAVTalk::receiveDelta()
+{
+    QByteArray keyframe = floats(10.0f, 13);
+    QByteArray data     = keyframe;
+    float value = 50.0f;
+
+    memcpy(data.data() + 2 * sizeof(float), &value, sizeof(value));
+    QByteArray stream = packet(0x26, 0x1006, QByteArray(1, (char)(0x80 | 5)) + keyframe) +
+                        packet(0x26, 0x1006, deltaPayload(5, keyframe, data)) +
+                        packet(0x26, 0x1006, deltaPayload(4, keyframe, floats(0.0f, 13)));
+
+    ChunkedBuffer device(16);
+    device.setData(stream);
+    device.open(QIODevice::ReadWrite);
+    UAVTalk rx(&device, objMngr);
+
+    receiveStream(&rx, &device);
+
+    UAVObjectField *field = objMngr->getObject(0x1006)->getField("Values");
+    QCOMPARE(field->getDouble(0), 10.0);
+    QCOMPARE(field->getDouble(2), 50.0);
+    QCOMPARE(field->getDouble(12), 22.0);
+    UAVTalk::ComStats stats = rx.getStats();
+    QCOMPARE(stats.rxObjects, (quint32)3);
+    QCOMPARE(stats.rxErrors, (quint32)0);
+
+    // The NACK of the unknown keyframe is written after the received stream
+    QCOMPARE(device.data().mid(stream.size()), packet(0x24, 0x1006, QByteArray()));
+}
+
+/**
+ * With the input thread the device is only read in the test thread, which stands in for
+ * a busy GUI and seldom runs its event loop. The stream is parsed and unpacked by the
+ * input thread, the updates unpacked meanwhile are notified to the test thread coalesced,
+ * at least once per object. The direct unpack notification, which the recorders of the
+ * updates use, is not coalesced.
+ */
+void tst_UAVTalk::receiveThreaded()
+{
+    ChunkedBuffer device(64);
+
+    device.setData(stream);
+    device.open(QIODevice::ReadOnly);
+    UAVTalk rx(&device, objMngr);
+
+    // The objects are received in a thread of their own, as the telemetry manager does
+    QThread telemetryThread;
+    UpdateCounter counter(&telemetryThread);
+    int numInstances = 0;
+    foreach(QList<UAVObject *> instances, objMngr->getObjects()) {
+        foreach(UAVObject * obj, instances) {
+            connect(obj, SIGNAL(objectUpdated(UAVObject *)), &counter, SLOT(objectUpdated(UAVObject *)));
+            connect(obj, SIGNAL(objectUnpacked(UAVObject *)), &counter, SLOT(objectUnpacked(UAVObject *)), Qt::DirectConnection);
+            ++numInstances;
+        }
+    }
+    rx.moveToThread(&telemetryThread);
+    telemetryThread.start();
+    rx.startInputThread();
+
+    QElapsedTimer timer;
+    timer.start();
+    int eventLoops = 0;
+    while ((rx.getStats().rxObjects < streamObjects || counter.objects.size() < numInstances)
+           && timer.elapsed() < THREADED_TIMEOUT_MS) {
+        QCoreApplication::processEvents();
+        ++eventLoops;
+        QTest::qSleep(THREADED_BUSY_MS);
+    }
+    qint64 decodeMs = timer.elapsed();
+    telemetryThread.quit();
+    telemetryThread.wait();
+
+    QCOMPARE(rx.getStats().rxObjects, streamObjects);
+    QCOMPARE(counter.objects.size(), numInstances);
+    QCOMPARE((int)counter.misplacedUnpacks, 0);
+    QCOMPARE((quint32)(int)counter.unpacks, streamObjects);
+    QVERIFY(counter.notifications < (int)streamObjects);
+    QCOMPARE(rx.getStats().rxErrors, (quint32)0);
+    qDebug("%u packets decoded in %lld ms with %d runs of a busy event loop, %d notifications",
+           streamObjects, decodeMs, eventLoops, counter.notifications);
+}
+
+void tst_UAVTalk::throughput_data()
+{
+    addChunkSizes();
+}
+
+/**
+ * Receive throughput of the stream, reported in MB/s next to the benchmark result
+ */
+void tst_UAVTalk::throughput()
+{
+    QFETCH(int, chunkSize);
+
+    ChunkedBuffer device(chunkSize);
+    device.setData(stream);
+    device.open(QIODevice::ReadOnly);
+    UAVTalk rx(&device, objMngr);
+
+    QBENCHMARK {
+        receiveStream(&rx, &device);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int n = 0; n < THROUGHPUT_PASSES; ++n) {
+        receiveStream(&rx, &device);
+    }
+    qint64 ns = qMax(timer.nsecsElapsed(), (qint64)1);
+    double mbPerSecond = (double)stream.size() * THROUGHPUT_PASSES * 1000.0 / ns;
+    qDebug("%d byte reads: %.1f MB/s, %.0f packets/s", chunkSize, mbPerSecond,
+           (double)streamObjects * THROUGHPUT_PASSES * 1000000000.0 / ns);
+}
+
+QTEST_MAIN(tst_UAVTalk)
+
+#include "tst_uavtalk.moc"
@@ -0,0 +1,18 @@
+# -------------------------------------------------
+# UAVTalk receive benchmark, run from the build directory
+# with the GCS plugin directory in the library path.
+# -------------------------------------------------
+include(../../../../openpilotgcs.pri)
+
+CONFIG += qtestlib
+CONFIG += console
+CONFIG -= app_bundle
+TEMPLATE = app
+TARGET = uavtalktest
+QT += network
+
+INCLUDEPATH += $$GCS_SOURCE_TREE/src/plugins
+LIBS += -L$$GCS_PLUGIN_PATH/OpenPilot
+include(../uavtalk.pri)
+
+SOURCES += tst_uavtalk.cpp
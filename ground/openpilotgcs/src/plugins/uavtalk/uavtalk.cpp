@@ -71,14 +71,20 @@ UAVTalk::UAVTalk(QIODevice *iodev, UAVObjectManager *objMngr)
     rxState = STATE_SYNC;
     rxPacketLength = 0;
 
+    inputReader = NULL;
+    inputThread = NULL;
+
+    aggRxCount  = 0;
+    aggRxCrc    = 0;
+
     mutex = new QMutex(QMutex::Recursive);
 
     memset(&stats, 0, sizeof(ComStats));
 
     connect(io, SIGNAL(readyRead()), this, SLOT(processInputStream()));
     ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
-    Core::Internal::GeneralSettings *settings = pm->getObject<Core::Internal::GeneralSettings>();
-    useUDPMirror = settings->useUDPMirror();
+    Core::Internal::GeneralSettings *settings = pm ? pm->getObject<Core::Internal::GeneralSettings>() : NULL;
+    useUDPMirror = settings ? settings->useUDPMirror() : false;
     qDebug() << "USE UDP:::::::::::." << useUDPMirror;
     if (useUDPMirror) {
         udpSocketTx = new QUdpSocket(this);
@@ -95,6 +101,37 @@ UAVTalk::~UAVTalk()
     // According to Qt, it is not necessary to disconnect upon
     // object deletion.
     // disconnect(io, SIGNAL(readyRead()), this, SLOT(processInputStream()));
+    if (inputThread) {
+        inputStop.fetchAndStoreOrdered(1);
+        inputReader->wakeUp();
+        inputThread->wait();
+        delete inputThread;
+        // The reader may be reading in the thread of the device, it is deleted there
+        inputReader->deleteLater();
+    }
+}
+
+/**
+ * Move the parsing of the input and the unpacking of the objects to a thread of their own,
+ * so that they go on whatever the load of the thread of the device or of this object.
+ * The device is still read in its own thread, by the input reader. The acks, transactions
+ * and answers are queued to this object, which processes them in its own thread.
+ * The UDP mirror keeps the input in the thread of this object.
+ */
+void UAVTalk::startInputThread()
+{
+    if (inputThread || useUDPMirror || io.isNull()) {
+        return;
+    }
+    disconnect(io, SIGNAL(readyRead()), this, SLOT(processInputStream()));
+    inputReader = new UAVTalkInputReader(io);
+    inputReader->moveToThread(io->thread());
+    connect(io, SIGNAL(readyRead()), inputReader, SLOT(readInput()));
+    inputThread = new InputThread(this);
+    inputThread->start(QThread::TimeCriticalPriority);
+
+    // Take what the device received before
+    QMetaObject::invokeMethod(inputReader, "readInput", Qt::QueuedConnection);
 }
 
 
@@ -123,13 +160,78 @@ UAVTalk::ComStats UAVTalk::getStats()
  */
 void UAVTalk::processInputStream()
 {
-    quint8 tmp;
-
     if (io && io->isReadable()) {
         while (io->bytesAvailable() > 0) {
-            io->read((char *)&tmp, 1);
-            processInputByte(tmp);
+            qint64 length = io->read((char *)rxReadBuffer, RX_READ_SIZE);
+            if (length <= 0) {
+                break;
+            }
+            processInputBuffer(rxReadBuffer, length);
+            receiveBatch();
+        }
+    }
+}
+
+/**
+ * Loop of the input thread: parse the buffers read by the input reader and unpack the
+ * objects received, the rest is queued to the thread of this object.
+ */
+void UAVTalk::decodeInput()
+{
+    while (!inputStop) {
+        UAVTalkInputReader::Buffer *buffer = inputReader->nextBuffer();
+        if (buffer == NULL) {
+            continue;
         }
+        processInputBuffer(buffer->data, buffer->length);
+        inputReader->releaseBuffer();
+        receiveBatch();
+    }
+}
+
+/**
+ * Hand a packet decoded by the input thread to the thread of this object. When the queue
+ * is full the input thread waits, the input stays in the reader and the device meanwhile.
+ * Only one call to receiveQueue() is pending at any time.
+ * Packets received in the thread of this object are processed right away.
+ */
+void UAVTalk::receiveCompleted(quint8 type, quint32 objId, quint16 instId, UAVObject *obj)
+{
+    if (QThread::currentThread() != inputThread) {
+        processReceived(type, objId, instId, obj);
+        return;
+    }
+
+    RxReceived *received;
+    while ((received = rxQueue.back()) == NULL) {
+        if (inputStop) {
+            return;
+        }
+        InputThread::msleep(1);
+    }
+    received->type   = type;
+    received->objId  = objId;
+    received->instId = instId;
+    received->obj    = obj;
+    rxQueue.push();
+
+    if (rxQueuePending.testAndSetOrdered(0, 1)) {
+        QMetaObject::invokeMethod(this, "receiveQueue", Qt::QueuedConnection);
+    }
+}
+
+/**
+ * Process the packets queued by the input thread, in the order they arrived
+ */
+void UAVTalk::receiveQueue()
+{
+    // Packets queued from now on post another call
+    rxQueuePending.fetchAndStoreOrdered(0);
+
+    RxReceived *received;
+    while ((received = rxQueue.front()) != NULL) {
+        processReceived(received->type, received->objId, received->instId, received->obj);
+        rxQueue.pop();
     }
 }
 
@@ -176,22 +278,34 @@ bool UAVTalk::sendObject(UAVObject *obj, bool acked, bool allInstances)
     }
 }
 
+/**
+ * Send an unacked update of an object with data packed when the update was made
+ * rather than the current data of the object. Used to record every update.
+ * \param[in] obj Object to send
+ * \param[in] data Packed object data, getNumBytes() long
+ * \return Success (true), Failure (false)
+ */
+bool UAVTalk::sendObjectData(UAVObject *obj, const QByteArray & data)
+{
+    QMutexLocker locker(mutex);
+
+    if (data.size() != (int)obj->getNumBytes()) {
+        return false;
+    }
+    return transmitSingleObject(obj, TYPE_OBJ, false, (const quint8 *)data.constData());
+}
+
 /**
  * Cancel a pending transaction
  */
-void UAVTalk::cancelTransaction(UAVObject *obj)
+void UAVTalk::cancelTransaction(UAVObject *obj, bool allInstances)
 {
     QMutexLocker locker(mutex);
-    quint32 objId = obj->getObjID();
 
     if (io.isNull()) {
         return;
     }
-    QMap<quint32, Transaction *>::iterator itr = transMap.find(objId);
-    if (itr != transMap.end()) {
-        transMap.remove(objId);
-        delete itr.value();
-    }
+    delete transMap.take(transactionKey(obj, allInstances));
 }
 
 /**
@@ -209,10 +323,16 @@ bool UAVTalk::objectTransaction(UAVObject *obj, quint8 type, bool allInstances)
     // Send object depending on if a response is needed
     if (type == TYPE_OBJ_ACK || type == TYPE_OBJ_REQ) {
         if (transmitObject(obj, type, allInstances)) {
-            Transaction *trans = new Transaction();
+            // Transactions on other objects and instances stay pending, a
+            // transaction on the same instance is replaced
+            quint64 key = transactionKey(obj, allInstances);
+            Transaction *trans = transMap.value(key);
+            if (trans == NULL) {
+                trans = new Transaction();
+                transMap.insert(key, trans);
+            }
             trans->obj = obj;
             trans->allInstances = allInstances;
-            transMap.insert(obj->getObjID(), trans);
             return true;
         } else {
             return false;
@@ -224,6 +344,111 @@ bool UAVTalk::objectTransaction(UAVObject *obj, quint8 type, bool allInstances)
     }
 }
 
+/**
+ * Process a buffer from the telemetry stream. The buffer is parsed in one pass
+ * with the mutex held once, packet headers and object data are taken in bulk
+ * where possible and only the remaining states go through processInputByte().
+ * The packets completed in the buffer are batched, to be received in one go.
+ * \param[in] data Received bytes
+ * \param[in] length Number of bytes in data
+ */
+void UAVTalk::processInputBuffer(const quint8 *data, qint64 length)
+{
+    QMutexLocker locker(mutex);
+    qint64 position = 0;
+
+    while (position < length) {
+        if (rxState == STATE_SYNC) {
+            // Skip everything up to the next sync byte
+            const quint8 *sync = (const quint8 *)memchr(&data[position], SYNC_VAL, length - position);
+            if (sync == NULL) {
+                stats.rxBytes += length - position;
+                break;
+            }
+            stats.rxBytes += sync - &data[position];
+            position = sync - data;
+
+            // Take the whole minimal header at once if it is there
+            if (length - position < MIN_HEADER_LENGTH || (data[position + 1] & TYPE_MASK) != TYPE_VER) {
+                processInputByte(data[position++]);
+                continue;
+            }
+            const quint8 *header = &data[position];
+            rxType     = header[1];
+            packetSize = qFromLittleEndian<quint16>(&header[2]);
+            if (packetSize < MIN_HEADER_LENGTH || packetSize > MAX_HEADER_LENGTH + MAX_PAYLOAD_LENGTH) {
+                // incorrect packet size, drop the sync, type and size bytes like the state machine does
+                UAVTALK_QXTLOG_DEBUG("UAVTalk: Size->Sync");
+                stats.rxBytes += 4;
+                position += 4;
+                continue;
+            }
+            rxObjId        = qFromLittleEndian<quint32>(&header[4]);
+            rxCS           = updateCRC(0, header, MIN_HEADER_LENGTH);
+            rxPacketLength = MIN_HEADER_LENGTH;
+            if (useUDPMirror) {
+                rxDataArray.clear();
+                rxDataArray.append((const char *)header, MIN_HEADER_LENGTH);
+            }
+            stats.rxBytes += MIN_HEADER_LENGTH;
+            position += MIN_HEADER_LENGTH;
+            processObjId();
+        } else if (rxState == STATE_DATA) {
+            // Copy as much of the object data as there is
+            qint32 count = rxLength - rxCount;
+            if (count > length - position) {
+                count = length - position;
+            }
+            memcpy(&rxBuffer[rxCount], &data[position], count);
+            rxCS = updateCRC(rxCS, &data[position], count);
+            if (useUDPMirror) {
+                rxDataArray.append((const char *)&data[position], count);
+            }
+            rxCount        += count;
+            rxPacketLength += count;
+            stats.rxBytes  += count;
+            position += count;
+            if (rxCount == rxLength) {
+                rxState = STATE_CS;
+                UAVTALK_QXTLOG_DEBUG("UAVTalk: Data->CSum");
+                rxCount = 0;
+            }
+        } else {
+            processInputByte(data[position++]);
+        }
+    }
+}
+
+/**
+ * Receive the packets queued by processInputByte(), in the order they arrived.
+ */
+void UAVTalk::receiveBatch()
+{
+    // The input thread unpacks without the mutex, it waits for the thread of this object
+    QMutexLocker locker(QThread::currentThread() == inputThread ? NULL : mutex);
+
+    // Take the batch, a slot connected to an object update may process more input
+    QVector<RxPacket> batch;
+    QByteArray batchData;
+
+    batch.swap(rxBatch);
+    batchData.swap(rxBatchData);
+
+    for (int n = 0; n < batch.size(); ++n) {
+        const RxPacket &packet = batch.at(n);
+        receiveObject(packet.type, packet.objId, packet.instId,
+                      (quint8 *)batchData.data() + packet.offset, packet.length);
+    }
+
+    // Hand the buffers back to be reused by the next batch
+    if (rxBatch.isEmpty()) {
+        batch.resize(0);
+        batchData.resize(0);
+        rxBatch.swap(batch);
+        rxBatchData.swap(batchData);
+    }
+}
+
 /**
  * Process an byte from the telemetry stream.
  * \param[in] rxbyte Received byte
@@ -319,68 +544,8 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
             break;
         }
 
-        // Search for object, if not found reset state machine
         rxObjId = (qint32)qFromLittleEndian<quint32>(rxTmpBuffer);
-        {
-            UAVObject *rxObj = objMngr->getObject(rxObjId);
-            if (rxObj == NULL && rxType != TYPE_OBJ_REQ) {
-                stats.rxErrors++;
-                rxState = STATE_SYNC;
-                UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Sync (badtype)");
-                break;
-            }
-
-            // Determine data length
-            if (rxType == TYPE_OBJ_REQ || rxType == TYPE_ACK || rxType == TYPE_NACK) {
-                rxLength = 0;
-                rxInstanceLength = 0;
-            } else {
-                rxLength = rxObj->getNumBytes();
-                rxInstanceLength = (rxObj->isSingleInstance() ? 0 : 2);
-            }
-
-            // Check length and determine next state
-            if (rxLength >= MAX_PAYLOAD_LENGTH) {
-                stats.rxErrors++;
-                rxState = STATE_SYNC;
-                UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Sync (oversize)");
-                break;
-            }
-
-            // Check the lengths match
-            if ((rxPacketLength + rxInstanceLength + rxLength) != packetSize) { // packet error - mismatched packet size
-                stats.rxErrors++;
-                rxState = STATE_SYNC;
-                UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Sync (length mismatch)");
-                break;
-            }
-
-            // Check if this is a single instance object (i.e. if the instance ID field is coming next)
-            if (rxObj == NULL) {
-                // This is a non-existing object, just skip to checksum
-                // and we'll send a NACK next.
-                rxState  = STATE_CS;
-                UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->CSum (no obj)");
-                rxInstId = 0;
-                rxCount  = 0;
-            } else if (rxObj->isSingleInstance()) {
-                // If there is a payload get it, otherwise receive checksum
-                if (rxLength > 0) {
-                    rxState = STATE_DATA;
-                    UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Data (needs data)");
-                } else {
-                    rxState = STATE_CS;
-                    UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Checksum");
-                }
-                rxInstId = 0;
-                rxCount  = 0;
-            } else {
-                rxState = STATE_INSTID;
-                UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->InstID");
-                rxCount = 0;
-            }
-        }
-
+        processObjId();
         break;
 
     case STATE_INSTID:
@@ -443,14 +608,22 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
             break;
         }
 
-        mutex->lock();
-        receiveObject(rxType, rxObjId, rxInstId, rxBuffer, rxLength);
+        // Queue the packet, it is received once the whole input buffer is parsed
+        {
+            RxPacket packet;
+            packet.type   = rxType;
+            packet.objId  = rxObjId;
+            packet.instId = rxInstId;
+            packet.length = rxLength;
+            packet.offset = rxBatchData.size();
+            rxBatchData.append((const char *)rxBuffer, rxLength);
+            rxBatch.append(packet);
+        }
         if (useUDPMirror) {
             udpSocketTx->writeDatagram(rxDataArray, QHostAddress::LocalHost, udpSocketRx->localPort());
         }
         stats.rxObjectBytes += rxLength;
         stats.rxObjects++;
-        mutex->unlock();
 
         rxState = STATE_SYNC;
         UAVTALK_QXTLOG_DEBUG("UAVTalk: CSum->Sync (OK)");
@@ -467,8 +640,107 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
 }
 
 /**
- * Receive an object. This function process objects received through the telemetry stream.
- * \param[in] type Type of received message (TYPE_OBJ, TYPE_OBJ_REQ, TYPE_OBJ_ACK, TYPE_ACK, TYPE_NACK)
+ * Look up the object of the packet header just received and determine the next
+ * state of the receive state machine.
+ */
+void UAVTalk::processObjId()
+{
+    // Aggregate packets have no object of their own, the payload runs up to the checksum
+    if (rxType == TYPE_AGGREGATE) {
+        rxLength = packetSize - rxPacketLength;
+        rxInstanceLength = 0;
+        rxInstId = 0;
+        rxCount  = 0;
+        if ((rxObjId != AGGREGATE_OBJID && rxObjId != AGGREGATE_OFFER_OBJID) || rxLength >= MAX_PAYLOAD_LENGTH) {
+            stats.rxErrors++;
+            rxState = STATE_SYNC;
+            UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Sync (bad aggregate)");
+        } else if (rxLength > 0) {
+            rxState = STATE_DATA;
+            UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Data (aggregate)");
+        } else {
+            rxState = STATE_CS;
+            UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->CSum (aggregate)");
+        }
+        return;
+    }
+
+    // Search for object, if not found reset state machine
+    UAVObject *rxObj = objMngr->getObject(rxObjId);
+
+    if (rxObj == NULL && rxType != TYPE_OBJ_REQ) {
+        stats.rxErrors++;
+        rxState = STATE_SYNC;
+        UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Sync (badtype)");
+        return;
+    }
+
+    // Determine data length
+    if (rxType == TYPE_OBJ_DELTA) {
+        // Delta packets are at most one byte longer than the object
+        rxInstanceLength = (rxObj->isSingleInstance() ? 0 : 2);
+        rxLength = packetSize - rxPacketLength - rxInstanceLength;
+        if (packetSize < rxPacketLength + rxInstanceLength + 1 || rxLength > rxObj->getNumBytes() + 1) {
+            stats.rxErrors++;
+            rxState = STATE_SYNC;
+            UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Sync (bad delta)");
+            return;
+        }
+    } else if (rxType == TYPE_OBJ_REQ || rxType == TYPE_ACK || rxType == TYPE_NACK) {
+        rxLength = 0;
+        // Requests and acks of multi instance objects carry the instance ID
+        rxInstanceLength = (rxObj != NULL && rxType != TYPE_NACK && !rxObj->isSingleInstance()) ? 2 : 0;
+    } else {
+        rxLength = rxObj->getNumBytes();
+        rxInstanceLength = (rxObj->isSingleInstance() ? 0 : 2);
+    }
+
+    // Check length and determine next state
+    if (rxLength >= MAX_PAYLOAD_LENGTH) {
+        stats.rxErrors++;
+        rxState = STATE_SYNC;
+        UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Sync (oversize)");
+        return;
+    }
+
+    // Check the lengths match
+    if ((rxPacketLength + rxInstanceLength + rxLength) != packetSize) { // packet error - mismatched packet size
+        stats.rxErrors++;
+        rxState = STATE_SYNC;
+        UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Sync (length mismatch)");
+        return;
+    }
+
+    // Check if this is a single instance object (i.e. if the instance ID field is coming next)
+    if (rxObj == NULL) {
+        // This is a non-existing object, just skip to checksum
+        // and we'll send a NACK next.
+        rxState  = STATE_CS;
+        UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->CSum (no obj)");
+        rxInstId = 0;
+        rxCount  = 0;
+    } else if (rxObj->isSingleInstance()) {
+        // If there is a payload get it, otherwise receive checksum
+        if (rxLength > 0) {
+            rxState = STATE_DATA;
+            UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Data (needs data)");
+        } else {
+            rxState = STATE_CS;
+            UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Checksum");
+        }
+        rxInstId = 0;
+        rxCount  = 0;
+    } else {
+        rxState = STATE_INSTID;
+        UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->InstID");
+        rxCount = 0;
+    }
+}
+
+/**
+ * Receive an object. This function unpacks the objects received through the telemetry stream,
+ * the acks, transactions and answers are left to processReceived().
+ * \param[in] type Type of received message (TYPE_OBJ, TYPE_OBJ_REQ, TYPE_OBJ_ACK, TYPE_ACK, TYPE_NACK, TYPE_AGGREGATE, TYPE_OBJ_DELTA)
  * \param[in] obj Handle of the received object
  * \param[in] instId The instance ID of UAVOBJ_ALL_INSTANCES for all instances.
  * \param[in] data Data buffer
@@ -477,7 +749,6 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
  */
 bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length)
 {
-    Q_UNUSED(length);
     UAVObject *obj    = NULL;
     bool error        = false;
     bool allInstances = (instId == ALL_INSTANCES);
@@ -485,13 +756,14 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
     // Process message type
     switch (type) {
     case TYPE_OBJ:
+    case TYPE_OBJ_ACK:
         // All instances, not allowed for OBJ messages
         if (!allInstances) {
             // Get object and update its data
             obj = updateObject(objId, instId, data);
-            // Check if an ack is pending
+            // Check if an ack is pending or transmit the ACK
             if (obj != NULL) {
-                updateAck(obj);
+                receiveCompleted(type, objId, instId, obj);
             } else {
                 error = true;
             }
@@ -499,21 +771,54 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
             error = true;
         }
         break;
-    case TYPE_OBJ_ACK:
-        // All instances, not allowed for OBJ_ACK messages
+    case TYPE_OBJ_REQ:
+    case TYPE_NACK:
+    case TYPE_ACK:
+        // Nothing to unpack
+        receiveCompleted(type, objId, instId, NULL);
+        break;
+    case TYPE_AGGREGATE:
+        error = !receiveAggregate(objId, data, length);
+        break;
+    case TYPE_OBJ_DELTA:
+        // All instances, not allowed for delta messages
         if (!allInstances) {
-            // Get object and update its data
-            obj = updateObject(objId, instId, data);
-            // Transmit ACK
-            if (obj != NULL) {
-                transmitObject(obj, TYPE_ACK, false);
-            } else {
-                error = true;
-            }
+            error = !receiveDelta(objId, instId, data, length);
         } else {
             error = true;
         }
         break;
+    default:
+        error = true;
+    }
+    // Done
+    return !error;
+}
+
+/**
+ * Process the acks, transactions and answers of a received packet whose object data was
+ * unpacked by receiveObject(). An aggregate offer that wants a reply is passed as
+ * TYPE_AGGREGATE with the number and the CRC of the table entries received in instId,
+ * a delta of an unknown keyframe as TYPE_OBJ_DELTA.
+ * \param[in] type Message type
+ * \param[in] objId Object ID
+ * \param[in] instId The instance ID or ALL_INSTANCES
+ * \param[in] obj The object unpacked, NULL if there was no object data
+ */
+void UAVTalk::processReceived(quint8 type, quint32 objId, quint16 instId, UAVObject *obj)
+{
+    QMutexLocker locker(mutex);
+    bool allInstances = (instId == ALL_INSTANCES);
+
+    // Process message type
+    switch (type) {
+    case TYPE_OBJ:
+        updateAck(obj);
+        break;
+    case TYPE_OBJ_ACK:
+        // Transmit ACK
+        transmitObject(obj, TYPE_ACK, false);
+        break;
     case TYPE_OBJ_REQ:
         // Get object, if all instances are requested get instance 0 of the object
         if (allInstances) {
@@ -528,7 +833,6 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
             // Object was not found, transmit a NACK with the
             // objId which was not found.
             transmitNack(objId);
-            error = true;
         }
         break;
     case TYPE_NACK:
@@ -539,8 +843,6 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
             // Check if object exists:
             if (obj != NULL) {
                 updateNack(obj);
-            } else {
-                error = true;
             }
         }
         break;
@@ -552,16 +854,181 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
             // Check if an ack is pending
             if (obj != NULL) {
                 updateAck(obj);
-            } else {
-                error = true;
             }
         }
         break;
-    default:
-        error = true;
+    case TYPE_AGGREGATE:
+        transmitAggregateOffer(instId & 0xFF, instId >> 8);
+        break;
+    case TYPE_OBJ_DELTA:
+        // Have the other end send a keyframe next
+        transmitNack(objId);
+        break;
     }
-    // Done
-    return !error;
+}
+
+/**
+ * Receive an aggregate offer, a chunk of the table of object indexes of the other end.
+ * The last chunk is answered, the GCS itself does not send aggregate packets.
+ * \param[in] data Payload
+ * \param[in] length Payload length
+ * \return Success (true), Failure (false)
+ */
+bool UAVTalk::receiveAggregateOffer(quint8 *data, qint32 length)
+{
+    if (length < AGGREGATE_OFFER_HEADER ||
+        (length > AGGREGATE_OFFER_HEADER && (length - AGGREGATE_OFFER_HEADER - 1) % 4 != 0)) {
+        return false;
+    }
+    if (length == AGGREGATE_OFFER_HEADER) {
+        return true;
+    }
+
+    // A table starts over at its first chunk, the keyframes of the previous connection
+    // are not valid anymore then.
+    quint8 flags = data[0];
+    int first    = data[AGGREGATE_OFFER_HEADER];
+    int count    = (length - AGGREGATE_OFFER_HEADER - 1) / 4;
+    if (first == 0) {
+        rxDeltas.clear();
+        aggRxCount = 0;
+        aggRxCrc   = 0;
+    }
+    if (first == aggRxCount && first + count <= AGGREGATE_MAX_INDEXES) {
+        bool complete = true;
+        if (aggRxTable.size() < first + count) {
+            aggRxTable.resize(first + count);
+        }
+        for (int n = 0; n < count; ++n) {
+            quint8 *id    = &data[AGGREGATE_OFFER_HEADER + 1 + 4 * n];
+            quint32 objId = qFromLittleEndian<quint32>(id);
+            aggRxTable[first + n] = objId;
+            // The other end must not aggregate the objects from the first one we do not know
+            if (complete && (objId == 0 || objMngr->getObject(objId) != NULL)) {
+                aggRxCrc = updateCRC(aggRxCrc, id, 4);
+                ++aggRxCount;
+            } else {
+                complete = false;
+            }
+        }
+    }
+
+    if ((flags & AGGREGATE_OFFER_END) && (flags & AGGREGATE_OFFER_REPLY)) {
+        receiveCompleted(TYPE_AGGREGATE, AGGREGATE_OFFER_OBJID, (aggRxCrc << 8) | aggRxCount, NULL);
+    }
+    return true;
+}
+
+/**
+ * Receive an aggregate packet, either an offer or the updates of several objects.
+ * The length of an entry is known from its object, so the packet is dropped from
+ * the first entry whose index is not in the table of the other end.
+ * \param[in] objId AGGREGATE_OBJID or AGGREGATE_OFFER_OBJID
+ * \param[in] data Payload
+ * \param[in] length Payload length
+ * \return Success (true), Failure (false)
+ */
+bool UAVTalk::receiveAggregate(quint32 objId, quint8 *data, qint32 length)
+{
+    qint32 offset = 0;
+
+    if (objId == AGGREGATE_OFFER_OBJID) {
+        return receiveAggregateOffer(data, length);
+    }
+
+    while (offset + AGGREGATE_ENTRY_HEADER <= length) {
+        quint8 index = data[offset];
+        quint32 entryObjId = (index < aggRxTable.size()) ? aggRxTable[index] : 0;
+        UAVObject *tobj    = entryObjId ? objMngr->getObject(entryObjId) : NULL;
+        if (tobj == NULL) {
+            return false;
+        }
+        offset += AGGREGATE_ENTRY_HEADER;
+
+        qint32 instanceLength = tobj->isSingleInstance() ? 0 : 2;
+        if (offset + instanceLength + (qint32)tobj->getNumBytes() > length) {
+            return false;
+        }
+        quint16 instId = instanceLength ? qFromLittleEndian<quint16>(&data[offset]) : 0;
+        // Get object and update its data
+        UAVObject *obj = updateObject(entryObjId, instId, &data[offset + instanceLength]);
+        // Check if an ack is pending
+        if (obj != NULL) {
+            receiveCompleted(TYPE_OBJ, entryObjId, instId, obj);
+        } else {
+            return false;
+        }
+        offset += instanceLength + tobj->getNumBytes();
+    }
+
+    return offset == length;
+}
+
+/**
+ * Receive a delta encoded object, a delta of a keyframe which was not received is
+ * answered with a NACK so that the other end sends a keyframe next.
+ * \param[in] objId Object ID
+ * \param[in] instId The instance ID
+ * \param[in] data Payload
+ * \param[in] length Payload length
+ * \return Success (true), Failure (false)
+ */
+bool UAVTalk::receiveDelta(quint32 objId, quint16 instId, quint8 *data, qint32 length)
+{
+    quint64 key = ((quint64)objId << 16) | instId;
+    UAVObject *obj;
+
+    if (data[0] & DELTA_KEYFRAME) {
+        UAVObject *tobj = objMngr->getObject(objId);
+        if (tobj == NULL || (quint32)length != tobj->getNumBytes() + 1) {
+            return false;
+        }
+        DeltaBaseline &baseline = rxDeltas[key];
+        baseline.seq  = data[0] & DELTA_SEQ_MASK;
+        baseline.data = QByteArray((const char *)&data[1], length - 1);
+        obj = updateObject(objId, instId, &data[1]);
+    } else {
+        QHash<quint64, DeltaBaseline>::const_iterator baseline = rxDeltas.constFind(key);
+        if (baseline == rxDeltas.constEnd() || baseline->seq != data[0]) {
+            receiveCompleted(TYPE_OBJ_DELTA, objId, instId, NULL);
+            return false;
+        }
+
+        // XOR the runs of changed bytes into a copy of the keyframe
+        QByteArray current = baseline->data;
+        quint8 *out = (quint8 *)current.data();
+        qint32 size = current.size();
+        qint32 pos  = 1;
+        qint32 offset = 0;
+        while (pos < length) {
+            quint8 token = data[pos++];
+            qint32 run   = (token & ~DELTA_ZERO_RUN) + 1;
+            if (offset + run > size) {
+                return false;
+            }
+            if (token & DELTA_ZERO_RUN) {
+                offset += run;
+                continue;
+            }
+            if (pos + run > length) {
+                return false;
+            }
+            for (qint32 k = 0; k < run; ++k) {
+                out[offset++] ^= data[pos++];
+            }
+        }
+        if (offset != size) {
+            return false;
+        }
+        obj = updateObject(objId, instId, out);
+    }
+
+    // Check if an ack is pending
+    if (obj == NULL) {
+        return false;
+    }
+    receiveCompleted(TYPE_OBJ, objId, instId, obj);
+    return true;
 }
 
 /**
@@ -588,6 +1055,8 @@ UAVObject *UAVTalk::updateObject(quint32 objId, quint16 instId, quint8 *data)
         }
         // Create a new instance, unpack and register
         UAVDataObject *instobj = dobj->clone(instId);
+        // The instance belongs to the thread of the other instances whatever the thread receiving it
+        instobj->moveToThread(dobj->thread());
         if (!objMngr->registerObject(instobj)) {
             return NULL;
         }
@@ -609,11 +1078,7 @@ void UAVTalk::updateNack(UAVObject *obj)
     if (!obj) {
         return;
     }
-    quint32 objId = obj->getObjID();
-    QMap<quint32, Transaction *>::iterator itr = transMap.find(objId);
-    if (itr != transMap.end() && (itr.value()->obj->getInstID() == obj->getInstID() || itr.value()->allInstances)) {
-        transMap.remove(objId);
-        delete itr.value();
+    if (closeTransaction(obj)) {
         emit transactionCompleted(obj, false);
     }
 }
@@ -624,16 +1089,26 @@ void UAVTalk::updateNack(UAVObject *obj)
  */
 void UAVTalk::updateAck(UAVObject *obj)
 {
-    quint32 objId = obj->getObjID();
-
-    QMap<quint32, Transaction *>::iterator itr = transMap.find(objId);
-    if (itr != transMap.end() && (itr.value()->obj->getInstID() == obj->getInstID() || itr.value()->allInstances)) {
-        transMap.remove(objId);
-        delete itr.value();
+    if (closeTransaction(obj)) {
         emit transactionCompleted(obj, true);
     }
 }
 
+/**
+ * Remove the transaction pending on an object instance, or else on all instances of the object
+ * \return True if a transaction was pending
+ */
+bool UAVTalk::closeTransaction(UAVObject *obj)
+{
+    Transaction *trans = transMap.take(transactionKey(obj, false));
+
+    if (trans == NULL && !obj->isSingleInstance()) {
+        trans = transMap.take(transactionKey(obj, true));
+    }
+    delete trans;
+    return trans != NULL;
+}
+
 
 /**
  * Send an object through the telemetry link.
@@ -686,13 +1161,53 @@ bool UAVTalk::transmitNack(quint32 objId)
 
     txBuffer[0] = SYNC_VAL;
     txBuffer[1] = TYPE_NACK;
+    qToLittleEndian<quint16>(dataOffset, &txBuffer[2]);
     qToLittleEndian<quint32>(objId, &txBuffer[4]);
 
     // Calculate checksum
     txBuffer[dataOffset] = updateCRC(0, txBuffer, dataOffset);
 
+    // Send buffer, check that the transmit backlog does not grow above limit
+    if (io && io->isWritable() && io->bytesToWrite() < TX_BUFFER_SIZE) {
+        io->write((const char *)txBuffer, dataOffset + CHECKSUM_LENGTH);
+        if (useUDPMirror) {
+            udpSocketRx->writeDatagram((const char *)txBuffer, dataOffset + CHECKSUM_LENGTH, QHostAddress::LocalHost, udpSocketTx->localPort());
+        }
+    } else {
+        ++stats.txErrors;
+        return false;
+    }
+
+    // Update stats
+    stats.txBytes += 8 + CHECKSUM_LENGTH;
+
+    // Done
+    return true;
+}
+
+
+/**
+ * Answer an aggregate offer through the telemetry link with an empty table, delta packets are accepted too.
+ * \param[in] known Number of table entries of the other end received
+ * \param[in] crc CRC of their object IDs
+ */
+bool UAVTalk::transmitAggregateOffer(quint8 known, quint8 crc)
+{
+    int dataOffset = 12;
+
+    txBuffer[0]  = SYNC_VAL;
+    txBuffer[1]  = TYPE_AGGREGATE;
+    qToLittleEndian<quint32>(AGGREGATE_OFFER_OBJID, &txBuffer[4]);
+    txBuffer[8]  = AGGREGATE_OFFER_DELTA | AGGREGATE_OFFER_END; // flags, no answer wanted
+    txBuffer[9]  = known;
+    txBuffer[10] = crc;
+    txBuffer[11] = 0; // first entry of the table
+
     qToLittleEndian<quint16>(dataOffset, &txBuffer[2]);
 
+    // Calculate checksum
+    txBuffer[dataOffset] = updateCRC(0, txBuffer, dataOffset);
+
     // Send buffer, check that the transmit backlog does not grow above limit
     if (io && io->isWritable() && io->bytesToWrite() < TX_BUFFER_SIZE) {
         io->write((const char *)txBuffer, dataOffset + CHECKSUM_LENGTH);
@@ -705,7 +1220,7 @@ bool UAVTalk::transmitNack(quint32 objId)
     }
 
     // Update stats
-    stats.txBytes += 8 + CHECKSUM_LENGTH;
+    stats.txBytes += dataOffset + CHECKSUM_LENGTH;
 
     // Done
     return true;
@@ -716,9 +1231,10 @@ bool UAVTalk::transmitNack(quint32 objId)
  * Send an object through the telemetry link.
  * \param[in] obj Object handle to send
  * \param[in] type Transaction type
+ * \param[in] data Packed object data to send, NULL to pack the object
  * \return Success (true), Failure (false)
  */
-bool UAVTalk::transmitSingleObject(UAVObject *obj, quint8 type, bool allInstances)
+bool UAVTalk::transmitSingleObject(UAVObject *obj, quint8 type, bool allInstances, const quint8 *data)
 {
     qint32 length;
     qint32 dataOffset;
@@ -760,7 +1276,9 @@ bool UAVTalk::transmitSingleObject(UAVObject *obj, quint8 type, bool allInstance
 
     // Copy data (if any)
     if (length > 0) {
-        if (!obj->pack(&txBuffer[dataOffset])) {
+        if (data != NULL) {
+            memcpy(&txBuffer[dataOffset], data, length);
+        } else if (!obj->pack(&txBuffer[dataOffset])) {
             return false;
         }
     }
@@ -819,3 +1337,64 @@ quint8 UAVTalk::updateCRC(quint8 crc, const quint8 *data, qint32 length)
     }
     return crc;
 }
+
+/**
+ * Constructor, the reader must be moved to the thread of the device
+ */
+UAVTalkInputReader::UAVTalkInputReader(QIODevice *iodev) : io(iodev)
+{}
+
+/**
+ * Called in the thread of the device each time there are data in the input buffer
+ */
+void UAVTalkInputReader::readInput()
+{
+    while (io && io->isReadable() && io->bytesAvailable() > 0) {
+        Buffer *buffer = buffers.back();
+        if (buffer == NULL) {
+            // Called again once the input thread releases a buffer, unless it just did
+            stalled.fetchAndStoreOrdered(1);
+            if (buffers.back() == NULL || !stalled.testAndSetOrdered(1, 0)) {
+                return;
+            }
+            continue;
+        }
+        buffer->length = io->read((char *)buffer->data, BUFFER_SIZE);
+        if (buffer->length <= 0) {
+            break;
+        }
+        buffers.push();
+        available.release();
+    }
+}
+
+/**
+ * Input thread: the oldest buffer read, waits for one if there is none.
+ * The semaphore counts the buffers pushed and the calls to wakeUp(), one
+ * count is taken for each call so that none are left over to spin on.
+ * \return The buffer, NULL if woken up by wakeUp()
+ */
+UAVTalkInputReader::Buffer *UAVTalkInputReader::nextBuffer()
+{
+    available.acquire();
+    return buffers.front();
+}
+
+/**
+ * Input thread: hand the buffer returned by nextBuffer() back to the reader
+ */
+void UAVTalkInputReader::releaseBuffer()
+{
+    buffers.pop();
+    if (stalled.testAndSetOrdered(1, 0)) {
+        QMetaObject::invokeMethod(this, "readInput", Qt::QueuedConnection);
+    }
+}
+
+/**
+ * Wake up the input thread waiting in nextBuffer()
+ */
+void UAVTalkInputReader::wakeUp()
+{
+    available.release();
+}
@@ -35,8 +35,45 @@
 #include <QSemaphore>
 #include "uavobjectmanager.h"
 #include "uavtalk_global.h"
+#include "spscqueue.h"
 #include <QtNetwork/QUdpSocket>
 
+/**
+ * Reads the telemetry input in the thread of the device, the only one a QIODevice may be
+ * used from, and hands it over a buffer at a time to the input thread of UAVTalk through
+ * a lock free ring. When the ring is full the input stays in the device until the input
+ * thread takes a buffer.
+ */
+class UAVTalkInputReader : public QObject {
+    Q_OBJECT
+
+public:
+    static const int BUFFER_SIZE = 4 * 1024;
+    static const int NUM_BUFFERS = 16;
+
+    typedef struct {
+        qint64 length;
+        quint8 data[BUFFER_SIZE];
+    } Buffer;
+
+    UAVTalkInputReader(QIODevice *iodev);
+
+    // Called by the input thread
+    Buffer *nextBuffer();
+    void releaseBuffer();
+    void wakeUp();
+
+public slots:
+    void readInput();
+
+private:
+    QPointer<QIODevice> io;
+    SPSCQueue<Buffer, NUM_BUFFERS> buffers;
+    QSemaphore available;
+    // Set when the input was left in the device because the ring was full
+    QAtomicInt stalled;
+};
+
 class UAVTALK_EXPORT UAVTalk : public QObject {
     Q_OBJECT
 
@@ -55,16 +92,30 @@ public:
     UAVTalk(QIODevice *iodev, UAVObjectManager *objMngr);
     ~UAVTalk();
     bool sendObject(UAVObject *obj, bool acked, bool allInstances);
+    bool sendObjectData(UAVObject *obj, const QByteArray & data);
     bool sendObjectRequest(UAVObject *obj, bool allInstances);
-    void cancelTransaction(UAVObject *obj);
+    void cancelTransaction(UAVObject *obj, bool allInstances);
     ComStats getStats();
     void resetStats();
+    void startInputThread();
+
+    static quint8 updateCRC(quint8 crc, const quint8 data);
+    static quint8 updateCRC(quint8 crc, const quint8 *data, qint32 length);
+
+    /**
+     * Key of the transaction on an object instance, or on all instances of the object
+     */
+    static quint64 transactionKey(UAVObject *obj, bool allInstances)
+    {
+        return ((quint64)obj->getObjID() << 16) | (allInstances ? ALL_INSTANCES : obj->getInstID());
+    }
 
 signals:
     void transactionCompleted(UAVObject *obj, bool success);
 
 private slots:
     void processInputStream(void);
+    void receiveQueue();
     void dummyUDPRead();
 
 private:
@@ -74,6 +125,19 @@ private:
         bool allInstances;
     } Transaction;
 
+    typedef struct {
+        quint8     seq;
+        QByteArray data;
+    } DeltaBaseline;
+
+    typedef struct {
+        quint8  type;
+        quint32 objId;
+        quint16 instId;
+        qint32  length;
+        qint32  offset;
+    } RxPacket;
+
     // Constants
     static const int TYPE_MASK    = 0xF8;
     static const int TYPE_VER     = 0x20;
@@ -82,6 +146,8 @@ private:
     static const int TYPE_OBJ_ACK = (TYPE_VER | 0x02);
     static const int TYPE_ACK     = (TYPE_VER | 0x03);
     static const int TYPE_NACK    = (TYPE_VER | 0x04);
+    static const int TYPE_AGGREGATE = (TYPE_VER | 0x05);
+    static const int TYPE_OBJ_DELTA = (TYPE_VER | 0x06);
 
     static const int MIN_HEADER_LENGTH  = 8; // sync(1), type (1), size(2), object ID(4)
     static const int MAX_HEADER_LENGTH  = 10; // sync(1), type (1), size(2), object ID (4), instance ID(2, not used in single objects)
@@ -95,19 +161,91 @@ private:
     static const quint16 ALL_INSTANCES  = 0xFFFF;
     static const quint16 OBJID_NOTFOUND = 0x0000;
 
+    // Aggregate packets carry the updates of several objects in a payload of entries made of
+    // the object index (1), the instance ID (2, multi instance objects only) and the object data.
+    // The index is the position of the object in the table of the sending end, which it sends in
+    // offer packets: flags (1), the number (1) and the CRC (1) of the table entries received from
+    // the peer, then optionally the index of the first table entry (1) and a chunk of object IDs
+    // (4 each). The GCS has no table, it acknowledges the table of the flight side when answering
+    // the last chunk. The acknowledged entries stop at the first object the GCS does not know.
+    static const quint32 AGGREGATE_OBJID       = 0xFFFFFFFF;
+    static const quint32 AGGREGATE_OFFER_OBJID = 0xFFFFFFFE;
+    static const int AGGREGATE_ENTRY_HEADER    = 1;
+    static const int AGGREGATE_MAX_INDEXES     = 255;
+    static const int AGGREGATE_OFFER_HEADER    = 3;
+    static const quint8 AGGREGATE_OFFER_REPLY  = 0x01;
+    static const quint8 AGGREGATE_OFFER_DELTA  = 0x02;
+    static const quint8 AGGREGATE_OFFER_END    = 0x04;
+
+    // Delta packets start with the keyframe flag and the sequence number of the keyframe, followed
+    // by the object data (keyframe) or by the object data XORed with the keyframe and run length
+    // encoded: a token with the zero run flag stands for (token & 0x7F) + 1 unchanged bytes,
+    // otherwise token + 1 literal bytes follow it. The GCS only receives delta packets.
+    static const quint8 DELTA_KEYFRAME = 0x80;
+    static const quint8 DELTA_SEQ_MASK = 0x7F;
+    static const quint8 DELTA_ZERO_RUN = 0x80;
+
     static const int TX_BUFFER_SIZE     = 2 * 1024;
+    static const int RX_READ_SIZE       = 4 * 1024;
+    static const int RX_QUEUE_SIZE      = 256;
     static const quint8 crc_table[256];
 
     // Types
     typedef enum { STATE_SYNC, STATE_TYPE, STATE_SIZE, STATE_OBJID, STATE_INSTID, STATE_DATA, STATE_CS } RxStateType;
 
+    /**
+     * A packet decoded by the input thread, its object data already unpacked. Only the acks,
+     * transactions and answers are left to the thread of UAVTalk.
+     */
+    typedef struct {
+        quint8     type;
+        quint32    objId;
+        quint16    instId;
+        UAVObject *obj;
+    } RxReceived;
+
+    /**
+     * Parses the input and unpacks the objects, the rest is received in the thread of UAVTalk
+     */
+    class InputThread : public QThread {
+public:
+        InputThread(UAVTalk *talk) : talk(talk) {}
+        using QThread::msleep;
+
+protected:
+        void run()
+        {
+            talk->decodeInput();
+        }
+
+private:
+        UAVTalk *talk;
+    };
+
     // Variables
     QPointer<QIODevice> io;
     UAVObjectManager *objMngr;
     QMutex *mutex;
-    QMap<quint32, Transaction *> transMap;
+    QMap<quint64, Transaction *> transMap;
+    // Last keyframe of each delta encoded object instance
+    QHash<quint64, DeltaBaseline> rxDeltas;
+    // Table of object indexes of the other end, only used by the input thread
+    QVector<quint32> aggRxTable;
+    quint8 aggRxCount;
+    quint8 aggRxCrc;
     quint8 rxBuffer[MAX_PACKET_LENGTH];
     quint8 txBuffer[MAX_PACKET_LENGTH];
+    quint8 rxReadBuffer[RX_READ_SIZE];
+    // Packets completed in the current input buffer and their object data
+    QVector<RxPacket> rxBatch;
+    QByteArray rxBatchData;
+    // Input read in the thread of the device and decoded by the input thread
+    UAVTalkInputReader *inputReader;
+    InputThread *inputThread;
+    QAtomicInt inputStop;
+    // Packets decoded by the input thread, handed over to the thread of this object
+    SPSCQueue<RxReceived, RX_QUEUE_SIZE> rxQueue;
+    QAtomicInt rxQueuePending;
     // Variables used by the receive state machine
     quint8 rxTmpBuffer[4];
     quint8 rxType;
@@ -130,16 +268,25 @@ private:
 
     // Methods
     bool objectTransaction(UAVObject *obj, quint8 type, bool allInstances);
+    void processInputBuffer(const quint8 *data, qint64 length);
     bool processInputByte(quint8 rxbyte);
+    void processObjId();
+    void receiveBatch();
+    void decodeInput();
     bool receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length);
+    void receiveCompleted(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);
+    void processReceived(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);
+    bool receiveAggregateOffer(quint8 *data, qint32 length);
+    bool receiveAggregate(quint32 objId, quint8 *data, qint32 length);
+    bool receiveDelta(quint32 objId, quint16 instId, quint8 *data, qint32 length);
     UAVObject *updateObject(quint32 objId, quint16 instId, quint8 *data);
     void updateAck(UAVObject *obj);
     void updateNack(UAVObject *obj);
+    bool closeTransaction(UAVObject *obj);
     bool transmitNack(quint32 objId);
+    bool transmitAggregateOffer(quint8 known, quint8 crc);
     bool transmitObject(UAVObject *obj, quint8 type, bool allInstances);
-    bool transmitSingleObject(UAVObject *obj, quint8 type, bool allInstances);
-    quint8 updateCRC(quint8 crc, const quint8 data);
-    quint8 updateCRC(quint8 crc, const quint8 *data, qint32 length);
+    bool transmitSingleObject(UAVObject *obj, quint8 type, bool allInstances, const quint8 *data = NULL);
 };
 
 #endif // UAVTALK_H
@@ -133,8 +133,7 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo *info)
             propertiesImpl  +=
                 QString("%1 %2::get%3(quint32 index) const\n"
                         "{\n"
-                        "   QMutexLocker locker(mutex);\n"
-                        "   return data.%3[index];\n"
+                        "   return readSnapshot<%1>(offsetof(DataFields, %3) + index * sizeof(%1));\n"
                         "}\n")
                 .arg(type).arg(info->name).arg(field->name);
             propertySetters +=
@@ -146,6 +145,7 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo *info)
                         "   mutex->lock();\n"
                         "   bool changed = data.%2[index] != value;\n"
                         "   data.%2[index] = value;\n"
+                        "   publishSnapshot();\n"
                         "   mutex->unlock();\n"
                         "   if (changed) emit %2Changed(index,value);\n"
                         "}\n\n")
@@ -162,8 +162,7 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo *info)
             propertiesImpl  +=
                 QString("%1 %2::get%3() const\n"
                         "{\n"
-                        "   QMutexLocker locker(mutex);\n"
-                        "   return data.%3;\n"
+                        "   return readSnapshot<%1>(offsetof(DataFields, %3));\n"
                         "}\n")
                 .arg(type).arg(info->name).arg(field->name);
             propertySetters +=
@@ -175,6 +174,7 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo *info)
                         "   mutex->lock();\n"
                         "   bool changed = data.%2 != value;\n"
                         "   data.%2 = value;\n"
+                        "   publishSnapshot();\n"
                         "   mutex->unlock();\n"
                         "   if (changed) emit %2Changed(value);\n"
                         "}\n\n")